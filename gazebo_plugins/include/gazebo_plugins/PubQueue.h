@@ -20,74 +20,425 @@
 
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
-#include <deque>
+#include <boost/lexical_cast.hpp>
+#include <boost/scoped_array.hpp>
+#include <algorithm>
+#include <atomic>
 #include <list>
-#include <vector>
+#include <stdint.h>
+#include <string>
+#include <utility>
 
 #include <ros/ros.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <sdf/sdf.hh>
 
+/// \brief What push() does when a queue already holds its capacity.
+enum PubQueuePolicy
+{
+  /// \brief Bounded FIFO, the oldest waiting message is dropped.
+  PUB_QUEUE_DROP_OLDEST,
+  /// \brief Only the newest message is kept, older ones are coalesced away.
+  PUB_QUEUE_KEEP_LATEST,
+  /// \brief The pushing thread waits until the service thread catches up.
+  PUB_QUEUE_BLOCK
+};
 
-/// \brief Container for a (ROS publisher, outgoing message) pair.
-/// We'll have queues of these.  Templated on a ROS message type.
-template<class T>
-class PubMessagePair
+/// \brief Parse "drop_oldest", "keep_latest" or "block".
+/// \return False if the string is not a known policy.
+inline bool PubQueuePolicyFromString(const std::string& str,
+                                     PubQueuePolicy& policy)
+{
+  if (str == "drop_oldest")
+    policy = PUB_QUEUE_DROP_OLDEST;
+  else if (str == "keep_latest")
+    policy = PUB_QUEUE_KEEP_LATEST;
+  else if (str == "block")
+    policy = PUB_QUEUE_BLOCK;
+  else
+    return false;
+  return true;
+}
+
+/// \brief How a plugin sets up its publish queue.
+struct PubQueueOptions
+{
+  /// \brief How many messages may wait for the publisher thread.
+  unsigned int capacity;
+  /// \brief What happens once that many are waiting.
+  PubQueuePolicy policy;
+  /// \brief Whether the queue depth, drops and latency go to /diagnostics.
+  bool diagnostics;
+};
+
+/// \brief Read <publishQueueSize> (64), <publishQueuePolicy> (drop_oldest)
+/// and <publishQueueDiagnostics> (false) of a plugin.
+/// \param[in] sdf SDF of the plugin.
+/// \param[in] name Logger name of the plugin, for the warnings.
+inline PubQueueOptions PubQueueOptionsFromSDF(const sdf::ElementPtr& sdf,
+                                              const std::string& name)
+{
+  PubQueueOptions options;
+  options.capacity = 64;
+  if (sdf->HasElement("publishQueueSize"))
+    options.capacity = sdf->Get<unsigned int>("publishQueueSize");
+
+  options.policy = PUB_QUEUE_DROP_OLDEST;
+  if (sdf->HasElement("publishQueuePolicy") &&
+      !PubQueuePolicyFromString(sdf->Get<std::string>("publishQueuePolicy"),
+                                options.policy))
+  {
+    ROS_WARN_NAMED(name, "Unknown <publishQueuePolicy> \"%s\", expected "
+      "drop_oldest, keep_latest or block; using drop_oldest",
+      sdf->Get<std::string>("publishQueuePolicy").c_str());
+  }
+
+  options.diagnostics = false;
+  if (sdf->HasElement("publishQueueDiagnostics"))
+    options.diagnostics = sdf->Get<bool>("publishQueueDiagnostics");
+  return options;
+}
+
+/// \brief Type-independent part of a PubQueue, as seen by PubMultiQueue.
+class PubQueueBase
 {
   public:
-    /// \brief The outgoing message.
-    T msg_;
-    /// \brief The publisher to use to publish the message.
-    ros::Publisher pub_;
-    PubMessagePair(T& msg, ros::Publisher& pub) :
-      msg_(msg), pub_(pub) {}
+    PubQueueBase() : dirty_(false), next_dirty_(NULL) {}
+    virtual ~PubQueueBase() {}
+
+    /// \brief Publish every message waiting in the queue.
+    virtual void service() = 0;
+
+    /// \brief Fill a diagnostics status with the counters gathered since
+    /// the previous call.  Called from the service thread.
+    virtual void fillStatus(diagnostic_msgs::DiagnosticStatus& status) = 0;
+
+  private:
+    /// \brief True while the queue is on PubMultiQueue's dirty list.
+    std::atomic<bool> dirty_;
+    /// \brief Next queue on PubMultiQueue's dirty list.
+    PubQueueBase* next_dirty_;
+
+    friend class PubMultiQueue;
 };
 
 /// \brief A queue of outgoing messages.  Instead of calling publish() directly,
 /// you can push() messages here to defer ROS serialization and locking.
 /// Templated on a ROS message type.
+///
+/// The queue is a bounded ring buffer of sequence-numbered slots (Vyukov's
+/// MPMC queue), so push() never takes a lock unless the policy is
+/// PUB_QUEUE_BLOCK and the queue is full.  Each slot keeps its message
+/// between uses, which lets copies reuse the previously allocated buffers
+/// instead of heap allocating per push.
 template<class T>
-class PubQueue
+class PubQueue : public PubQueueBase
 {
   public:
-    typedef boost::shared_ptr<std::deque<boost::shared_ptr<
-      PubMessagePair<T> > > > QueuePtr;
     typedef boost::shared_ptr<PubQueue<T> > Ptr;
 
   private:
-    /// \brief Our queue of outgoing messages.
-    QueuePtr queue_;
-    /// \brief Mutex to control access to the queue.
-    boost::shared_ptr<boost::mutex> queue_lock_;
-    /// \brief Function that will be called when a new message is pushed on.
-    boost::function<void()> notify_func_;
+    /// \brief A ring buffer slot.
+    struct Slot
+    {
+      /// \brief Ready for the producer of position p when equal to p, and
+      /// for the consumer when equal to p + 1.
+      std::atomic<size_t> sequence_;
+      /// \brief The outgoing message.
+      T msg_;
+      /// \brief The publisher to use to publish the message.
+      ros::Publisher pub_;
+      /// \brief When the message was pushed.
+      ros::WallTime stamp_;
+    };
+
+    boost::scoped_array<Slot> slots_;
+    size_t mask_;
+    /// \brief Maximum number of waiting messages.
+    size_t capacity_;
+    PubQueuePolicy policy_;
+    std::atomic<size_t> enqueue_pos_;
+    std::atomic<size_t> dequeue_pos_;
+    /// \brief Function that will be called when a message is pushed.
+    boost::function<void(PubQueueBase*)> notify_func_;
+
+    /// \brief Message being published, swapped out of its slot so that a
+    /// slow publish() never holds a slot.  Only touched by service().
+    T publishing_msg_;
+    ros::Publisher publishing_pub_;
+
+    /// \brief Producers waiting for space with PUB_QUEUE_BLOCK.
+    std::atomic<int> waiters_;
+    boost::mutex space_lock_;
+    boost::condition_variable space_cond_var_;
+
+    /// \brief Counters, updated by any thread.
+    std::atomic<unsigned long> pushed_;
+    std::atomic<unsigned long> dropped_;
+
+    /// \brief Counters only touched by the service thread.
+    std::string topic_;
+    unsigned long published_;
+    unsigned long reported_pushed_;
+    unsigned long reported_dropped_;
+    unsigned long reported_published_;
+    size_t max_depth_;
+    double latency_sum_;
+    double latency_max_;
+
+    /// \brief Release the oldest waiting message without publishing it.
+    /// \return False if there was nothing to release.
+    bool dropOldest()
+    {
+      size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+      Slot* slot = &slots_[pos & mask_];
+      if (slot->sequence_.load(std::memory_order_acquire) != pos + 1)
+        return false;
+      // losing this race means someone else made room
+      if (dequeue_pos_.compare_exchange_strong(pos, pos + 1,
+            std::memory_order_relaxed))
+      {
+        slot->sequence_.store(pos + mask_ + 1, std::memory_order_release);
+        ++dropped_;
+      }
+      return true;
+    }
+
+    /// \brief Wait until the queue is below capacity.
+    /// \return False if ROS is shutting down.
+    bool waitForSpace()
+    {
+      boost::mutex::scoped_lock lock(space_lock_);
+      ++waiters_;
+      while (size() >= capacity_ && ros::ok())
+        space_cond_var_.timed_wait(lock, boost::posix_time::milliseconds(100));
+      --waiters_;
+      return ros::ok();
+    }
+
+    /// \brief Claim a free slot, applying the queue policy when full.
+    /// \return The slot, or NULL if the message has to be dropped.
+    Slot* claim(size_t& pos)
+    {
+      while (true)
+      {
+        if (size() >= capacity_)
+        {
+          if (policy_ == PUB_QUEUE_BLOCK)
+          {
+            if (!waitForSpace())
+              return NULL;
+          }
+          else if (!dropOldest())
+          {
+            // the oldest slot is still being written or published
+            boost::this_thread::yield();
+          }
+          continue;
+        }
+
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Slot* slot = &slots_[pos & mask_];
+        size_t seq = slot->sequence_.load(std::memory_order_acquire);
+        intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (dif == 0)
+        {
+          if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                std::memory_order_relaxed))
+            return slot;
+        }
+        else if (dif < 0)
+        {
+          // concurrent producers went past capacity, or service() is
+          // swapping the message out of this slot
+          boost::this_thread::yield();
+        }
+      }
+    }
+
+    /// \brief Hand a filled slot over to the consumer.
+    void commit(Slot* slot, size_t pos)
+    {
+      slot->stamp_ = ros::WallTime::now();
+      slot->sequence_.store(pos + 1, std::memory_order_release);
+      ++pushed_;
+      notify_func_(this);
+    }
 
   public:
-    PubQueue(QueuePtr queue,
-             boost::shared_ptr<boost::mutex> queue_lock,
-             boost::function<void()> notify_func) :
-      queue_(queue), queue_lock_(queue_lock), notify_func_(notify_func) {}
+    /// \param[in] capacity Maximum number of waiting messages, forced to 1
+    /// with PUB_QUEUE_KEEP_LATEST.
+    /// \param[in] policy What to do when the queue is full.
+    /// \param[in] notify_func Called with this queue after each push.
+    PubQueue(size_t capacity, PubQueuePolicy policy,
+             boost::function<void(PubQueueBase*)> notify_func) :
+      capacity_(policy == PUB_QUEUE_KEEP_LATEST ? 1 : std::max<size_t>(capacity, 1)),
+      policy_(policy), enqueue_pos_(0), dequeue_pos_(0),
+      notify_func_(notify_func), waiters_(0), pushed_(0), dropped_(0),
+      published_(0), reported_pushed_(0), reported_dropped_(0),
+      reported_published_(0), max_depth_(0), latency_sum_(0.0),
+      latency_max_(0.0)
+    {
+      // the waiting messages, one slot being claimed and one being
+      // emptied by service()
+      size_t size = 2;
+      while (size < capacity_ + 2)
+        size <<= 1;
+      slots_.reset(new Slot[size]);
+      mask_ = size - 1;
+      for (size_t i = 0; i < size; ++i)
+        slots_[i].sequence_.store(i, std::memory_order_relaxed);
+    }
     ~PubQueue() {}
 
-    /// \brief Push a new message onto the queue.
+    /// \brief Push a new message onto the queue, copying it into a slot.
     /// \param[in] msg The outgoing message
     /// \param[in] pub The ROS publisher to use to publish the message
-    void push(T& msg, ros::Publisher& pub)
+    /// \return False if the message was dropped.
+    bool push(const T& msg, const ros::Publisher& pub)
+    {
+      size_t pos;
+      Slot* slot = claim(pos);
+      if (!slot)
+      {
+        ++dropped_;
+        return false;
+      }
+      slot->msg_ = msg;
+      slot->pub_ = pub;
+      commit(slot, pos);
+      return true;
+    }
+
+    /// \brief Push a new message onto the queue without copying it.
+    /// \param[in] msg The outgoing message, swapped with a recycled slot
+    /// message, so its buffers can be reused by the caller.
+    /// \param[in] pub The ROS publisher to use to publish the message
+    /// \return False if the message was dropped.
+    bool push(T&& msg, const ros::Publisher& pub)
+    {
+      size_t pos;
+      Slot* slot = claim(pos);
+      if (!slot)
+      {
+        ++dropped_;
+        return false;
+      }
+      std::swap(slot->msg_, msg);
+      slot->pub_ = pub;
+      commit(slot, pos);
+      return true;
+    }
+
+    /// \brief Publish all waiting messages.  Only one thread may call this
+    /// at a time.
+    virtual void service()
     {
-      boost::shared_ptr<PubMessagePair<T> > el(new PubMessagePair<T>(msg, pub));
-      boost::mutex::scoped_lock lock(*queue_lock_);
-      queue_->push_back(el);
-      notify_func_();
+      max_depth_ = std::max(max_depth_, size());
+      while (true)
+      {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Slot* slot = &slots_[pos & mask_];
+        size_t seq = slot->sequence_.load(std::memory_order_acquire);
+        if (seq != pos + 1)
+        {
+          // empty, or a dropOldest() moved dequeue_pos_ under us
+          if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0)
+            break;
+          continue;
+        }
+        if (!dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+              std::memory_order_relaxed))
+          continue;
+
+        double latency = (ros::WallTime::now() - slot->stamp_).toSec();
+        latency_sum_ += latency;
+        latency_max_ = std::max(latency_max_, latency);
+        if (topic_.empty())
+          topic_ = slot->pub_.getTopic();
+
+        // release the slot before publishing, the producers keep wrapping
+        // around the ring while a large message is serialized, and get the
+        // buffers of the previous message back
+        std::swap(publishing_msg_, slot->msg_);
+        std::swap(publishing_pub_, slot->pub_);
+        slot->sequence_.store(pos + mask_ + 1, std::memory_order_release);
+
+        if (waiters_.load() > 0)
+        {
+          boost::mutex::scoped_lock lock(space_lock_);
+          space_cond_var_.notify_all();
+        }
+
+        publishing_pub_.publish(publishing_msg_);
+        ++published_;
+      }
     }
 
-    /// \brief Pop all waiting messages off the queue.
-    /// \param[out] els Place to store the popped messages
-    void pop(std::vector<boost::shared_ptr<PubMessagePair<T> > >& els)
+    /// \brief Fill a diagnostics status with the counters gathered since
+    /// the previous call.
+    virtual void fillStatus(diagnostic_msgs::DiagnosticStatus& status)
     {
-      boost::mutex::scoped_lock lock(*queue_lock_);
-      while(!queue_->empty())
+      unsigned long pushed = pushed_.load();
+      unsigned long dropped = dropped_.load();
+      unsigned long window_published = published_ - reported_published_;
+      unsigned long window_dropped = dropped - reported_dropped_;
+      static const char* policies[] = {"drop_oldest", "keep_latest", "block"};
+
+      status.name = topic_.empty() ? std::string("(no messages yet)") : topic_;
+      if (window_dropped > 0)
+      {
+        status.level = diagnostic_msgs::DiagnosticStatus::WARN;
+        status.message = "Dropping messages, publisher is congested";
+      }
+      else
       {
-        els.push_back(queue_->front());
-        queue_->pop_front();
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.message = "OK";
       }
+
+      addValue(status, "Policy", policies[policy_]);
+      addValue(status, "Capacity", capacity_);
+      addValue(status, "Depth", size());
+      addValue(status, "Max depth", max_depth_);
+      addValue(status, "Pushed", pushed - reported_pushed_);
+      addValue(status, "Published", window_published);
+      addValue(status, "Dropped", window_dropped);
+      addValue(status, "Total dropped", dropped);
+      addValue(status, "Mean latency (ms)", window_published > 0 ?
+        1000.0 * latency_sum_ / window_published : 0.0);
+      addValue(status, "Max latency (ms)", 1000.0 * latency_max_);
+
+      reported_pushed_ = pushed;
+      reported_dropped_ = dropped;
+      reported_published_ = published_;
+      max_depth_ = 0;
+      latency_sum_ = 0.0;
+      latency_max_ = 0.0;
+    }
+
+    template <class V>
+    static void addValue(diagnostic_msgs::DiagnosticStatus& status,
+                         const std::string& key, const V& value)
+    {
+      diagnostic_msgs::KeyValue kv;
+      kv.key = key;
+      kv.value = boost::lexical_cast<std::string>(value);
+      status.values.push_back(kv);
+    }
+
+    /// \brief Number of messages waiting.
+    size_t size() const
+    {
+      // dequeue_pos_ first, it never gets ahead of enqueue_pos_
+      size_t dequeue = dequeue_pos_.load(std::memory_order_acquire);
+      return enqueue_pos_.load(std::memory_order_acquire) - dequeue;
+    }
+
+    /// \brief Number of messages dropped by the queue policy.
+    unsigned long dropped() const
+    {
+      return dropped_.load(std::memory_order_relaxed);
     }
 };
 
@@ -95,86 +446,215 @@ class PubQueue
 /// This class is the programmer's interface to this queuing system.
 class PubMultiQueue
 {
+  public:
+    /// \brief Fills an extra diagnostics status, see addStatus().
+    typedef boost::function<void(diagnostic_msgs::DiagnosticStatus&)> StatusFunc;
+
   private:
-    /// \brief List of functions to be called to service our queues.
-    std::list<boost::function<void()> > service_funcs_;
-    /// \brief Mutex to lock access to service_funcs_
-    boost::mutex service_funcs_lock_;
+    /// \brief All queues, keeps them alive.
+    std::list<boost::shared_ptr<PubQueueBase> > queues_;
+    /// \brief Extra diagnostics statuses.
+    std::list<StatusFunc> status_funcs_;
+    /// \brief Mutex to lock access to queues_ and status_funcs_
+    boost::mutex queues_lock_;
+    /// \brief Lock-free stack of queues with pending messages.
+    std::atomic<PubQueueBase*> dirty_head_;
     /// \brief If started, the thread that will call the service functions
     boost::thread service_thread_;
     /// \brief Boolean flag to shutdown the service thread if PubMultiQueue is destructed
     bool service_thread_running_;
+    /// \brief Set when queues were marked dirty since the service thread last
+    /// looked, protected by service_cond_var_lock_.
+    bool service_pending_;
     /// \brief Condition variable used to block and resume service_thread_
     boost::condition_variable service_cond_var_;
     /// \brief Mutex to accompany service_cond_var_
     boost::mutex service_cond_var_lock_;
+    /// \brief Diagnostics publisher, see startDiagnostics().  Protected by
+    /// service_cond_var_lock_.
+    ros::Publisher diagnostics_pub_;
+    std::string diagnostics_name_;
+    ros::WallDuration diagnostics_period_;
+    ros::WallTime next_diagnostics_;
 
-    /// \brief Service a given queue by popping outgoing message off it and
-    /// publishing them.
-    template <class T>
-    void serviceFunc(boost::shared_ptr<PubQueue<T> > pq)
+    /// \brief Called by a queue after a push.  Only the push that makes a
+    /// queue dirty puts it on the dirty list and wakes the service thread.
+    void markDirty(PubQueueBase* pq)
     {
-      std::vector<boost::shared_ptr<PubMessagePair<T> > > els;
-      pq->pop(els);
-      for(typename std::vector<boost::shared_ptr<PubMessagePair<T> > >::iterator it = els.begin();
-          it != els.end();
-          ++it)
+      if (pq->dirty_.exchange(true))
+        return;
+      PubQueueBase* head = dirty_head_.load(std::memory_order_relaxed);
+      do
       {
-        (*it)->pub_.publish((*it)->msg_);
-      }
+        pq->next_dirty_ = head;
+      } while (!dirty_head_.compare_exchange_weak(head, pq,
+                 std::memory_order_release, std::memory_order_relaxed));
+      notifyServiceThread();
     }
 
   public:
-    PubMultiQueue() {}
+    PubMultiQueue() : dirty_head_(NULL), service_thread_running_(false),
+                      service_pending_(false) {}
     ~PubMultiQueue()
     {
       if(service_thread_.joinable())
       {
-        service_thread_running_ = false;
-        notifyServiceThread();
+        {
+          boost::mutex::scoped_lock lock(service_cond_var_lock_);
+          service_thread_running_ = false;
+        }
+        service_cond_var_.notify_one();
         service_thread_.join();
       }
     }
 
     /// \brief Add a new queue.  Call this once for each published topic (or at
     /// least each type of publish message).
+    /// \param[in] capacity Maximum number of messages waiting to be published.
+    /// Queues used to be unbounded, plugins let users raise this through
+    /// <publishQueueSize>.
+    /// \param[in] policy What push() does when capacity is reached, see
+    /// <publishQueuePolicy>.
     /// \return Pointer to the newly created queue, good for calling push() on.
     template <class T>
-    boost::shared_ptr<PubQueue<T> > addPub()
+    boost::shared_ptr<PubQueue<T> > addPub(size_t capacity = 64,
+      PubQueuePolicy policy = PUB_QUEUE_DROP_OLDEST)
     {
-      typename PubQueue<T>::QueuePtr queue(new std::deque<boost::shared_ptr<PubMessagePair<T> > >);
-      boost::shared_ptr<boost::mutex> queue_lock(new boost::mutex);
-      boost::shared_ptr<PubQueue<T> > pq(new PubQueue<T>(queue, queue_lock, boost::bind(&PubMultiQueue::notifyServiceThread, this)));
-      boost::function<void()> f = boost::bind(&PubMultiQueue::serviceFunc<T>, this, pq);
+      boost::shared_ptr<PubQueue<T> > pq(new PubQueue<T>(capacity, policy,
+        boost::bind(&PubMultiQueue::markDirty, this, _1)));
       {
-        boost::mutex::scoped_lock lock(service_funcs_lock_);
-        service_funcs_.push_back(f);
+        boost::mutex::scoped_lock lock(queues_lock_);
+        queues_.push_back(pq);
       }
       return pq;
     }
 
-    /// \brief Service each queue one time.
+    /// \brief Add a status to the diagnostics of startDiagnostics(), e.g.
+    /// measurements the plugin makes before pushing.
+    /// \param[in] func Called from the service thread, fills the status.
+    /// Its name gets the same prefix as the queues.
+    void addStatus(const StatusFunc& func)
+    {
+      boost::mutex::scoped_lock lock(queues_lock_);
+      status_funcs_.push_back(func);
+    }
+
+    /// \brief Service each queue with pending messages one time.
     void spinOnce()
     {
-      boost::mutex::scoped_lock lock(service_funcs_lock_);
-      for(std::list<boost::function<void()> >::iterator it = service_funcs_.begin();
-          it != service_funcs_.end();
-          ++it)
+      PubQueueBase* pq = dirty_head_.exchange(NULL, std::memory_order_acquire);
+
+      // the dirty list is a stack, reverse it to service in push order
+      PubQueueBase* ordered = NULL;
+      while (pq)
+      {
+        PubQueueBase* next = pq->next_dirty_;
+        pq->next_dirty_ = ordered;
+        ordered = pq;
+        pq = next;
+      }
+
+      while (ordered)
+      {
+        PubQueueBase* next = ordered->next_dirty_;
+        // clear before draining, a push racing with service() marks the
+        // queue dirty again instead of being missed
+        ordered->dirty_.store(false);
+        ordered->service();
+        ordered = next;
+      }
+    }
+
+    /// \brief Publish the counters of every queue on the diagnostics topic.
+    /// Called from the service thread.
+    void publishDiagnostics(ros::Publisher& pub, const std::string& name)
+    {
+      diagnostic_msgs::DiagnosticArray array;
+      array.header.stamp = ros::Time::now();
       {
-        (*it)();
+        boost::mutex::scoped_lock lock(queues_lock_);
+        for (std::list<boost::shared_ptr<PubQueueBase> >::iterator it =
+               queues_.begin(); it != queues_.end(); ++it)
+        {
+          diagnostic_msgs::DiagnosticStatus status;
+          (*it)->fillStatus(status);
+          status.name = name + ": " + status.name;
+          status.hardware_id = name;
+          array.status.push_back(status);
+        }
+        for (std::list<StatusFunc>::iterator it = status_funcs_.begin();
+             it != status_funcs_.end(); ++it)
+        {
+          diagnostic_msgs::DiagnosticStatus status;
+          (*it)(status);
+          status.name = name + ": " + status.name;
+          status.hardware_id = name;
+          array.status.push_back(status);
+        }
       }
+      pub.publish(array);
     }
 
     /// \brief Service all queues indefinitely, waiting on a condition variable
     /// in between cycles.
     void spin()
     {
-      while(ros::ok() && service_thread_running_)
+      while(ros::ok())
       {
-        boost::unique_lock<boost::mutex> lock(service_cond_var_lock_);
-        service_cond_var_.wait(lock);
+        ros::Publisher diagnostics_pub;
+        std::string diagnostics_name;
+        {
+          boost::unique_lock<boost::mutex> lock(service_cond_var_lock_);
+          while (service_thread_running_ && !service_pending_)
+          {
+            if (!diagnostics_pub_)
+            {
+              service_cond_var_.wait(lock);
+              continue;
+            }
+            ros::WallTime now = ros::WallTime::now();
+            if (now >= next_diagnostics_)
+              break;
+            service_cond_var_.timed_wait(lock, boost::posix_time::microseconds(
+              (next_diagnostics_ - now).toNSec() / 1000));
+          }
+          if (!service_thread_running_)
+            break;
+          service_pending_ = false;
+
+          if (diagnostics_pub_ && ros::WallTime::now() >= next_diagnostics_)
+          {
+            diagnostics_pub = diagnostics_pub_;
+            diagnostics_name = diagnostics_name_;
+            next_diagnostics_ += diagnostics_period_;
+            if (next_diagnostics_ < ros::WallTime::now())
+              next_diagnostics_ = ros::WallTime::now() + diagnostics_period_;
+          }
+        }
         spinOnce();
+        if (diagnostics_pub)
+          publishDiagnostics(diagnostics_pub, diagnostics_name);
+      }
+    }
+
+    /// \brief Periodically publish depth, drop and latency counters of every
+    /// queue as diagnostic_msgs/DiagnosticArray on /diagnostics.
+    /// \param[in] nh Node handle used to advertise the topic.
+    /// \param[in] name Prefix of the status names, e.g. the plugin name.
+    /// \param[in] period Seconds between two reports.
+    void startDiagnostics(ros::NodeHandle& nh, const std::string& name,
+                          double period = 1.0)
+    {
+      ros::Publisher pub =
+        nh.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+      {
+        boost::mutex::scoped_lock lock(service_cond_var_lock_);
+        diagnostics_pub_ = pub;
+        diagnostics_name_ = name;
+        diagnostics_period_ = ros::WallDuration(period);
+        next_diagnostics_ = ros::WallTime::now() + diagnostics_period_;
       }
+      service_cond_var_.notify_one();
     }
 
     /// \brief Start a thread to call spin().
@@ -188,6 +668,10 @@ class PubMultiQueue
     /// message onto one of the queues).
     void notifyServiceThread()
     {
+      {
+        boost::mutex::scoped_lock lock(service_cond_var_lock_);
+        service_pending_ = true;
+      }
       service_cond_var_.notify_one();
     }
 };
@@ -26,6 +26,7 @@
 // Custom Callback Queue
 #include <ros/ros.h>
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 
 #include <sdf/Param.hh>
@@ -42,6 +43,10 @@
 #include <boost/thread/mutex.hpp>
 
 #include <sensor_msgs/PointCloud.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <gazebo_plugins/gazebo_ros_block_laser_projection.h>
+#include <gazebo_plugins/gazebo_ros_noise.h>
 
 namespace gazebo
 {
@@ -65,6 +70,9 @@ namespace gazebo
     /// \brief Put laser data to the ROS topic
     private: void PutLaserData(common::Time &_updateTime);
 
+    /// \brief Put laser data to the ROS topic as a PointCloud2
+    private: void PutLaserData2(common::Time &_updateTime);
+
     private: common::Time last_update_time_;
 
     /// \brief Keep track of number of connctions
@@ -85,6 +93,15 @@ namespace gazebo
     /// \brief ros message
     private: sensor_msgs::PointCloud cloud_msg_;
 
+    /// \brief publish sensor_msgs::PointCloud2 instead of sensor_msgs::PointCloud
+    private: bool point_cloud2_;
+    private: sensor_msgs::PointCloud2 cloud2_msg_;
+    private: BlockLaserProjection projection_;
+
+    /// \brief range and retro of each ray, read once per scan
+    private: std::vector<double> ranges_;
+    private: std::vector<double> retros_;
+
     /// \brief topic name
     private: std::string topic_name_;
 
@@ -95,7 +112,7 @@ namespace gazebo
     private: double gaussian_noise_;
 
     /// \brief Gaussian noise generator
-    private: double GaussianKernel(double mu,double sigma);
+    private: NoiseGenerator noise_;
 
     /// \brief A mutex to lock access to fields that are used in message callbacks
     private: boost::mutex lock;
@@ -111,7 +128,7 @@ namespace gazebo
     private: std::string robot_namespace_;
 
     // Custom Callback Queue
-    private: ros::CallbackQueue laser_queue_;
+    private: SharedCallbackQueue laser_queue_;
     private: void LaserQueueThread();
     private: boost::thread callback_laser_queue_thread_;
 
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+/*
+ * Desc: Block laser ranges to xyz+intensity PointCloud2 conversion used by
+ *       the block laser plugin.
+ */
+
+#ifndef GAZEBO_ROS_BLOCK_LASER_PROJECTION_H
+#define GAZEBO_ROS_BLOCK_LASER_PROJECTION_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <sensor_msgs/PointCloud2.h>
+
+#include <gazebo_plugins/gazebo_ros_worker_pool.h>
+
+namespace gazebo
+{
+  /// \brief Converts the rays of a block laser into an organized
+  /// xyz+intensity sensor_msgs::PointCloud2.
+  ///
+  /// Each output point interpolates the four rays around it, like
+  /// GazeboRosBlockLaser always did.  The ray indices, interpolation
+  /// weights and the sin/cos of the point angles only depend on the
+  /// sensor geometry, so they are kept in per-row and per-column tables
+  /// that are rebuilt only when the geometry changes.  Gaussian noise is
+  /// generated a row at a time from a per-row generator, so the output
+  /// does not depend on how rows are split across the WorkerPool.
+  class BlockLaserProjection
+  {
+    /// \brief Constructor
+    public: BlockLaserProjection();
+
+    /// \brief Destructor
+    public: ~BlockLaserProjection();
+
+    /// \brief Set the number of threads used to fill a cloud.
+    /// \param[in] _threads Thread count, 0 picks a default.
+    public: void SetThreads(unsigned int _threads);
+
+    /// \brief Set the standard deviation of the noise added to x, y, z
+    /// and intensity, 0 disables the noise.
+    /// \param[in] _sigma Standard deviation.
+    /// \param[in] _seed Seed of the noise generators.
+    public: void SetNoise(double _sigma, uint64_t _seed = 0);
+
+    /// \brief Set the range limits of the sensor, ranges are clamped to
+    /// _max - _min and points at that range get no xyz noise.
+    public: void SetRange(double _min, double _max);
+
+    /// \brief Set the sensor geometry, rebuilding the tables if it
+    /// differs from the current one.
+    /// \param[in] _rayCount Horizontal rays.
+    /// \param[in] _rangeCount Horizontal points of the cloud.
+    /// \param[in] _verticalRayCount Vertical rays.
+    /// \param[in] _verticalRangeCount Vertical points of the cloud.
+    /// \param[in] _minAngle Horizontal angle of the first ray.
+    /// \param[in] _maxAngle Horizontal angle of the last ray.
+    /// \param[in] _verticalMinAngle Vertical angle of the first ray.
+    /// \param[in] _verticalMaxAngle Vertical angle of the last ray.
+    public: void SetGeometry(int _rayCount, int _rangeCount,
+                             int _verticalRayCount, int _verticalRangeCount,
+                             double _minAngle, double _maxAngle,
+                             double _verticalMinAngle, double _verticalMaxAngle);
+
+    /// \brief Fill the point cloud of one scan.
+    /// \param[out] _msg Point cloud, verticalRangeCount rows of
+    /// rangeCount points.
+    /// \param[in] _ranges Range of each ray, row major.
+    /// \param[in] _retros Retro reflectance of each ray, row major.
+    public: void Fill(sensor_msgs::PointCloud2 &_msg, const double *_ranges,
+                      const double *_retros);
+
+    /// \brief Fill rows [_begin, _end) of the current scan.
+    private: void FillRows(unsigned int _begin, unsigned int _end);
+
+    /// \brief Geometry the tables were built for.
+    private: int ray_count_;
+    private: int range_count_;
+    private: int vertical_ray_count_;
+    private: int vertical_range_count_;
+    private: double min_angle_;
+    private: double max_angle_;
+    private: double vertical_min_angle_;
+    private: double vertical_max_angle_;
+
+    /// \brief Rays interpolated by each column, weight of the second
+    /// one, and cos / sin of the column angle.
+    private: std::vector<int> col_a_;
+    private: std::vector<int> col_b_;
+    private: std::vector<double> col_frac_;
+    private: std::vector<double> col_cos_;
+    private: std::vector<double> col_sin_;
+
+    /// \brief Same for the rows, with the ray indices premultiplied by
+    /// the horizontal ray count.
+    private: std::vector<int> row_a_;
+    private: std::vector<int> row_b_;
+    private: std::vector<double> row_frac_;
+    private: std::vector<double> row_cos_;
+    private: std::vector<double> row_sin_;
+
+    private: double min_range_;
+    private: double max_range_;
+    private: double sigma_;
+    private: uint64_t seed_;
+    private: uint64_t scan_count_;
+
+    /// \brief State of the scan being filled, shared with the workers.
+    private: const double *ranges_;
+    private: const double *retros_;
+    private: uint8_t *cloud_;
+
+    private: WorkerPool::RangeFunc fill_rows_func_;
+    private: boost::scoped_ptr<WorkerPool> pool_;
+  };
+}
+#endif
@@ -19,9 +19,12 @@
 #define GAZEBO_ROS_BUMPER_HH
 
 #include <string>
+#include <vector>
 
 #include <ros/ros.h>
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_bumper_contacts.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 
 #include <sys/time.h>
@@ -33,6 +36,7 @@
 
 #include <gazebo_msgs/ContactState.h>
 #include <gazebo_msgs/ContactsState.h>
+#include <gazebo_msgs/ContactsSummary.h>
 
 #include <gazebo/sensors/sensors.hh>
 #include <gazebo/msgs/msgs.hh>
@@ -77,10 +81,18 @@ namespace gazebo
     /// \brief broadcast some string for now.
     private: gazebo_msgs::ContactsState contact_state_msg_;
 
+    /// \brief <contactSummary>, publish a ContactsSummary with the totals
+    /// and the deepest point of each collision pair instead
+    private: bool summary_;
+    private: gazebo_msgs::ContactsSummary contact_summary_msg_;
+
+    /// \brief fills the messages, with <debugInfo> and <otherCollisionName>
+    private: BumperContacts contacts_;
+
     /// \brief for setting ROS name space
     private: std::string robot_namespace_;
 
-    private: ros::CallbackQueue contact_queue_;
+    private: SharedCallbackQueue contact_queue_;
     private: void ContactQueueThread();
     private: boost::thread callback_queue_thread_;
 
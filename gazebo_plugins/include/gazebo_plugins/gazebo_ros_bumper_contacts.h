@@ -0,0 +1,102 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+/*
+ * Desc: Contact sensor contacts to ContactsState / ContactsSummary
+ *       conversion used by the bumper plugin.
+ */
+
+#ifndef GAZEBO_ROS_BUMPER_CONTACTS_H
+#define GAZEBO_ROS_BUMPER_CONTACTS_H
+
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+
+#include <gazebo_msgs/ContactsState.h>
+#include <gazebo_msgs/ContactsSummary.h>
+
+#include <gazebo/msgs/msgs.hh>
+#include <ignition/math/Quaternion.hh>
+#include <ignition/math/Vector3.hh>
+
+namespace gazebo
+{
+  /// \brief Fills the messages of GazeboRosBumper from the contacts of a
+  /// contact sensor.
+  ///
+  /// The messages are filled in place: states and their arrays are
+  /// resized rather than rebuilt, and the states an update does not need
+  /// are set aside with their arrays for the next updates rather than
+  /// freed.  Once the buffers have grown to the largest contact set seen,
+  /// filling a message allocates nothing, unless the debug info is on.
+  class BumperContacts
+  {
+    /// \brief Constructor
+    public: BumperContacts();
+
+    /// \brief Set the scoped names of the sensor collisions, to tell which
+    /// side of a contact is the other collision.
+    public: void SetCollisionNames(const std::vector<std::string> &_names);
+
+    /// \brief Only report contacts whose other collision name starts with
+    /// _filter, all contacts if empty.
+    public: void SetOtherCollisionFilter(const std::string &_filter);
+
+    /// \brief Fill ContactState::info for every contact.
+    public: void SetDebugInfo(bool _debug_info);
+
+    /// \brief Fill a state per contact, with every point of the contact.
+    /// \param[in,out] _msg Message of the previous update, its header
+    /// frame is left as is.
+    /// \param[in] _contacts Contacts of the sensor.
+    /// \param[in] _frame_pos Position of the reporting frame.
+    /// \param[in] _frame_rot Rotation of the reporting frame.
+    public: void Fill(gazebo_msgs::ContactsState &_msg,
+                      const msgs::Contacts &_contacts,
+                      const ignition::math::Vector3d &_frame_pos,
+                      const ignition::math::Quaterniond &_frame_rot);
+
+    /// \brief Fill one summary per pair of collisions in contact, with the
+    /// totals and the deepest point of the latest step of the pair.
+    /// \param[in,out] _msg Message of the previous update, its header
+    /// frame is left as is.
+    /// \param[in] _contacts Contacts of the sensor.
+    /// \param[in] _frame_pos Position of the reporting frame.
+    /// \param[in] _frame_rot Rotation of the reporting frame.
+    public: void FillSummary(gazebo_msgs::ContactsSummary &_msg,
+                             const msgs::Contacts &_contacts,
+                             const ignition::math::Vector3d &_frame_pos,
+                             const ignition::math::Quaterniond &_frame_rot);
+
+    /// \brief Whether the contact passes the other collision filter
+    private: bool Accept(const msgs::Contact &_contact) const;
+
+    private: std::vector<std::string> collision_names_;
+    private: std::string other_collision_filter_;
+    private: bool debug_info_;
+
+    /// \brief time of the contact each summary comes from
+    private: std::vector<ros::Time> summary_stamps_;
+
+    /// \brief states set aside by the updates with fewer contacts
+    private: std::vector<gazebo_msgs::ContactState> spare_states_;
+    private: std::vector<gazebo_msgs::ContactSummary> spare_summaries_;
+  };
+}
+#endif
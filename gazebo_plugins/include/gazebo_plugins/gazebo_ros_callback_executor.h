@@ -0,0 +1,152 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef GAZEBO_ROS_CALLBACK_EXECUTOR_H
+#define GAZEBO_ROS_CALLBACK_EXECUTOR_H
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include <ros/callback_queue.h>
+#include <sdf/sdf.hh>
+
+namespace gazebo
+{
+  class CallbackQueueExecutor;
+
+  /// \brief A ros::CallbackQueue that tells a CallbackQueueExecutor when
+  /// callbacks arrive, so that no thread has to poll it.
+  ///
+  /// Plugins use it in place of their ros::CallbackQueue and call Attach()
+  /// where they used to start their queue thread.  Before the plugin state
+  /// goes away, Detach() waits for callbacks already running on the
+  /// executor.
+  class SharedCallbackQueue : public ros::CallbackQueue
+  {
+    /// \brief Constructor
+    public: SharedCallbackQueue();
+
+    /// \brief Destructor, detaches the queue.
+    public: virtual ~SharedCallbackQueue();
+
+    /// \brief Attach to the process wide executor, unless the plugin SDF
+    /// sets <callbackQueueThread> to true.
+    /// \param[in] _sdf Plugin SDF.
+    /// \return False if the caller has to serve the queue with a thread of
+    /// its own.
+    public: bool Attach(sdf::ElementPtr _sdf);
+
+    /// \brief Attach to an executor.
+    /// \param[in] _executor The executor, it must outlive the attachment.
+    public: void Attach(CallbackQueueExecutor &_executor);
+
+    /// \brief Detach from the executor, waiting for callbacks of this
+    /// queue running on it.  Callbacks still queued are not called.
+    /// Called from a callback of this queue, it returns without waiting for
+    /// that callback, so the queue has to outlive it.
+    public: void Detach();
+
+    /// \brief Queue a callback and wake the executor.
+    public: virtual void addCallback(const ros::CallbackInterfacePtr &_callback,
+                                     uint64_t _removal_id = 0);
+
+    /// \brief Guards executor_ against a concurrent Detach().
+    private: boost::mutex attach_mutex_;
+    private: CallbackQueueExecutor *executor_;
+
+    /// \brief Scheduling state, protected by the executor mutex.
+    private: bool scheduled_;
+    private: bool running_;
+    private: bool dirty_;
+    /// \brief Waiting in the back off list of the executor.
+    private: bool retry_;
+    /// \brief Detached by one of its own callbacks, not to be scheduled again.
+    private: bool removed_;
+    /// \brief Thread serving the queue while running_.
+    private: boost::thread::id runner_;
+    /// \brief When a queue in the back off list is served again.
+    private: boost::system_time retry_time_;
+
+    private: friend class CallbackQueueExecutor;
+  };
+
+  /// \brief A sized pool of threads serving SharedCallbackQueues.
+  ///
+  /// Threads sleep on a condition variable until a queue gets a callback,
+  /// the idle pool does not wake up at all.  A queue is served by one
+  /// thread at a time, so its callbacks run in order and never concurrently,
+  /// as they did on a dedicated queue thread.  A queue left with callbacks
+  /// that returned TryAgain is served again after a short back off, or as
+  /// soon as a new callback arrives, rather than right away.
+  class CallbackQueueExecutor
+  {
+    /// \brief Constructor
+    /// \param[in] _threads Number of threads, 0 picks a default based on
+    /// the number of hardware threads.
+    public: explicit CallbackQueueExecutor(unsigned int _threads = 0);
+
+    /// \brief Destructor, joins all threads.
+    public: ~CallbackQueueExecutor();
+
+    /// \brief Executor shared by all plugins of the process.  Its size is
+    /// read from the GAZEBO_ROS_CALLBACK_THREADS environment variable on
+    /// first use.
+    public: static CallbackQueueExecutor &Instance();
+
+    /// \brief Number of threads.
+    public: unsigned int Size() const;
+
+    /// \brief Number of times a queue was served, since construction.
+    public: unsigned long Dispatches() const;
+
+    /// \brief Schedule a queue that got callbacks.
+    private: void Notify(SharedCallbackQueue *_queue);
+
+    /// \brief Stop scheduling a queue, wait until it is not running.
+    private: void Remove(SharedCallbackQueue *_queue);
+
+    /// \brief Move the queues whose back off is over to the ready queues.
+    private: void PromoteDelayed();
+
+    /// \brief Thread main loop.
+    private: void Run();
+
+    private: std::vector<boost::thread*> threads_;
+
+    /// \brief Protects the queue below and the scheduling state of the
+    /// attached queues.
+    private: mutable boost::mutex mutex_;
+    private: boost::condition_variable work_cond_;
+    private: boost::condition_variable done_cond_;
+
+    /// \brief Queues with callbacks, in order of arrival.
+    private: std::deque<SharedCallbackQueue*> ready_;
+
+    /// \brief Queues backing off after TryAgain, in order of retry time.
+    private: std::deque<SharedCallbackQueue*> delayed_;
+    private: unsigned long dispatches_;
+    private: bool shutdown_;
+
+    private: friend class SharedCallbackQueue;
+  };
+}
+#endif
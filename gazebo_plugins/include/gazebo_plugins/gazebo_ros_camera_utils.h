@@ -26,6 +26,7 @@
 // ros stuff
 #include <ros/ros.h>
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 
 // ros messages stuff
@@ -185,7 +186,7 @@ namespace gazebo
     void configCallback(gazebo_plugins::GazeboRosCameraConfig &config,
       uint32_t level);
 
-    protected: ros::CallbackQueue camera_queue_;
+    protected: SharedCallbackQueue camera_queue_;
     protected: void CameraQueueThread();
     protected: boost::thread callback_queue_thread_;
 
@@ -54,6 +54,8 @@
 
 // camera stuff
 #include <gazebo_plugins/gazebo_ros_camera_utils.h>
+#include <gazebo_plugins/gazebo_ros_depth_projection.h>
+#include <gazebo_plugins/gazebo_ros_message_pool.h>
 
 namespace gazebo
 {
@@ -121,6 +123,14 @@ namespace gazebo
     private: sensor_msgs::PointCloud2 point_cloud_msg_;
     private: sensor_msgs::Image depth_image_msg_;
 
+    /// \brief Converts depth frames into point_cloud_msg_
+    private: DepthProjection depth_projection_;
+
+    /// \brief Publish depth images by pointer from depth_image_pool_
+    /// instead of copying depth_image_msg_
+    private: bool depth_image_zero_copy_;
+    private: MessagePool<sensor_msgs::Image> depth_image_pool_;
+
     private: double point_cloud_cutoff_;
 
     /// \brief ROS image topic name
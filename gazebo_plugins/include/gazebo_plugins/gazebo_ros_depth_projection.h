@@ -0,0 +1,108 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+/*
+ * Desc: Depth image to xyz+rgb point cloud projection shared by the depth
+ *       camera plugins.
+ */
+
+#ifndef GAZEBO_ROS_DEPTH_PROJECTION_H
+#define GAZEBO_ROS_DEPTH_PROJECTION_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+
+#include <sensor_msgs/PointCloud2.h>
+
+#include <gazebo_plugins/gazebo_ros_worker_pool.h>
+
+namespace gazebo
+{
+  /// \brief Converts depth frames into an xyz+rgb sensor_msgs::PointCloud2.
+  ///
+  /// The per-pixel ray directions only depend on the image size and the
+  /// horizontal field of view, so they are kept in per-row and per-column
+  /// tables that are rebuilt only when the geometry changes.  The fill
+  /// itself is split by rows across a WorkerPool and uses SSE2/AVX when
+  /// the compiler targets them, with a scalar fallback otherwise.
+  class DepthProjection
+  {
+    /// \brief Constructor
+    public: DepthProjection();
+
+    /// \brief Destructor
+    public: ~DepthProjection();
+
+    /// \brief Set the number of threads used to fill a cloud.
+    /// \param[in] _threads Thread count, 0 picks a default.
+    public: void SetThreads(unsigned int _threads);
+
+    /// \brief Set the valid depth range, points outside of
+    /// (_min, _max) are set to NaN.
+    /// \param[in] _min Minimum depth, exclusive.
+    /// \param[in] _max Maximum depth, exclusive.  Use
+    /// std::numeric_limits<double>::infinity() for no upper bound.
+    public: void SetCutoff(double _min, double _max);
+
+    /// \brief Set the image geometry, rebuilding the ray tables if it
+    /// differs from the current one.
+    /// \param[in] _rows Image height in pixels.
+    /// \param[in] _cols Image width in pixels.
+    /// \param[in] _hfov Horizontal field of view in radians.
+    public: void SetGeometry(uint32_t _rows, uint32_t _cols, double _hfov);
+
+    /// \brief Fill an xyz+rgb point cloud from a depth frame.
+    /// \param[out] _msg Point cloud, resized to a flat rows * cols array.
+    /// \param[in] _depth Depth frame, rows * cols floats.
+    /// \param[in] _image Color (rgb8) or mono (8 bit) image registered with
+    /// the depth frame, may be empty.
+    /// \return True if all points are within the valid range (is_dense).
+    public: bool Fill(sensor_msgs::PointCloud2 &_msg, const float *_depth,
+                      const std::vector<uint8_t> &_image);
+
+    /// \brief Fill rows [_begin, _end) of the current frame.
+    private: void FillRows(unsigned int _begin, unsigned int _end);
+
+    /// \brief Image geometry the tables were built for.
+    private: uint32_t rows_;
+    private: uint32_t cols_;
+    private: double hfov_;
+
+    /// \brief tan() of the ray angle of each row and column.
+    private: std::vector<float> row_tan_;
+    private: std::vector<float> col_tan_;
+
+    private: float cutoff_min_;
+    private: float cutoff_max_;
+
+    /// \brief State of the frame being filled, shared with the workers.
+    private: const float *depth_;
+    private: const uint8_t *image_;
+    private: unsigned int image_channels_;
+    private: uint8_t *cloud_;
+    private: uint32_t point_step_;
+    private: uint32_t rgb_offset_;
+
+    /// \brief Per-row dense flags, written by the workers.
+    private: std::vector<uint8_t> row_dense_;
+
+    private: WorkerPool::RangeFunc fill_rows_func_;
+    private: boost::scoped_ptr<WorkerPool> pool_;
+  };
+}
+#endif
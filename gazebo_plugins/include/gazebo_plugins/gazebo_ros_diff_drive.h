@@ -46,6 +46,7 @@
 // Gazebo
 #include <gazebo/common/common.hh>
 #include <gazebo/physics/physics.hh>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 #include <gazebo_plugins/gazebo_ros_utils.h>
 
 // ROS
@@ -59,6 +60,7 @@
 
 // Custom Callback Queue
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 
 // Boost
@@ -127,7 +129,7 @@ namespace gazebo {
       bool publish_tf_;
       bool legacy_mode_;
       // Custom Callback Queue
-      ros::CallbackQueue queue_;
+      SharedCallbackQueue queue_;
       boost::thread callback_queue_thread_;
       void QueueThread();
 
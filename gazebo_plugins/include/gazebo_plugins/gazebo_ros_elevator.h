@@ -27,6 +27,7 @@
 #include <ros/ros.h>
 #include <std_msgs/String.h>
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 
 namespace gazebo
@@ -62,7 +63,7 @@ namespace gazebo
     private: ros::Subscriber elevatorSub_;
 
     /// \brief Custom Callback Queue
-    private: ros::CallbackQueue queue_;
+    private: SharedCallbackQueue queue_;
 
     // \brief Custom Callback Queue thread
     private: boost::thread callbackQueueThread_;
@@ -25,12 +25,14 @@
 
 // Custom Callback Queue
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 
 #include <gazebo/physics/physics.hh>
 #include <gazebo/transport/TransportTypes.hh>
 #include <gazebo/common/Plugin.hh>
 #include <gazebo/common/Events.hh>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 
 #include <ros/ros.h>
 #include <boost/thread.hpp>
@@ -92,7 +94,7 @@ class GazeboRosF3D : public ModelPlugin
   private: void F3DDisconnect();
 
   // Custom Callback Queue
-  private: ros::CallbackQueue queue_;
+  private: SharedCallbackQueue queue_;
   private: void QueueThread();
   private: boost::thread callback_queue_thread_;
 
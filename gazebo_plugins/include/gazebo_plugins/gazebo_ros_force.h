@@ -27,6 +27,7 @@
 
 // Custom Callback Queue
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/subscribe_options.h>
 #include <geometry_msgs/Wrench.h>
 
@@ -38,6 +39,7 @@
 #include <gazebo/transport/TransportTypes.hh>
 #include <gazebo/common/Plugin.hh>
 #include <gazebo/common/Events.hh>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 
 
 namespace gazebo
@@ -111,7 +113,7 @@ class GazeboRosForce : public ModelPlugin
   private: std::string robot_namespace_;
 
   // Custom Callback Queue
-  private: ros::CallbackQueue queue_;
+  private: SharedCallbackQueue queue_;
   /// \brief Thead object for the running callback Thread.
   private: boost::thread callback_queue_thread_;
   /// \brief Container for the wrench force that this plugin exerts on the body.
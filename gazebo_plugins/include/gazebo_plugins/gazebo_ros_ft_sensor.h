@@ -25,18 +25,22 @@
 
 // Custom Callback Queue
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 
 #include <gazebo/physics/physics.hh>
 #include <gazebo/transport/TransportTypes.hh>
 #include <gazebo/common/Plugin.hh>
 #include <gazebo/common/Events.hh>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 
 #include <ros/ros.h>
 #include <boost/thread.hpp>
 #include <boost/thread/mutex.hpp>
 #include <geometry_msgs/WrenchStamped.h>
 
+#include <gazebo_plugins/gazebo_ros_noise.h>
+
 namespace gazebo
 {
 /// @addtogroup gazebo_dynamic_plugins Gazebo ROS Dynamic Plugins
@@ -88,9 +92,8 @@ class GazeboRosFT : public ModelPlugin
 
   /// \brief Gaussian noise
   private: double gaussian_noise_;
-  private: unsigned int seed;
   /// \brief Gaussian noise generator
-  private: double GaussianKernel(double mu, double sigma);
+  private: NoiseGenerator noise_;
 
   /// \brief A pointer to the Gazebo joint
   private: physics::JointPtr joint_;
@@ -142,7 +145,7 @@ class GazeboRosFT : public ModelPlugin
   private: void FTDisconnect();
 
   // Custom Callback Queue
-  private: ros::CallbackQueue queue_;
+  private: SharedCallbackQueue queue_;
   private: void QueueThread();
   private: boost::thread callback_queue_thread_;
 
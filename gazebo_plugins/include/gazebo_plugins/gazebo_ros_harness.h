@@ -19,6 +19,7 @@
 
 // Custom Callback Queue
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/subscribe_options.h>
 
 #include <ros/ros.h>
@@ -73,7 +74,7 @@ class GazeboRosHarness : public HarnessPlugin
 
     /// \brief for setting ROS name space
     private: std::string robotNamespace_;
-    private: ros::CallbackQueue queue_;
+    private: SharedCallbackQueue queue_;
     private: boost::thread callbackQueueThread_;
 };
 }
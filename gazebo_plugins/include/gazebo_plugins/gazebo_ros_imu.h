@@ -24,6 +24,7 @@
 
 #include <ros/ros.h>
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 #include <sensor_msgs/Imu.h>
 #include <std_srvs/Empty.h>
@@ -31,8 +32,10 @@
 #include <gazebo/physics/physics.hh>
 #include <gazebo/transport/transport.hh>
 #include <gazebo/common/common.hh>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 
 #include <gazebo_plugins/PubQueue.h>
+#include <gazebo_plugins/gazebo_ros_noise.h>
 
 namespace gazebo
 {
@@ -62,6 +65,10 @@ namespace gazebo
     private: ros::Publisher pub_;
     private: PubQueue<sensor_msgs::Imu>::Ptr pub_Queue;
 
+    /// \brief <publishQueueSize> (64), <publishQueuePolicy> (drop_oldest)
+    /// and <publishQueueDiagnostics> (false) of pub_Queue
+    private: PubQueueOptions publish_queue_;
+
     /// \brief ros message
     private: sensor_msgs::Imu imu_msg_;
 
@@ -98,7 +105,11 @@ namespace gazebo
     private: double gaussian_noise_;
 
     /// \brief Gaussian noise generator
-    private: double GaussianKernel(double mu, double sigma);
+    private: NoiseGenerator noise_;
+
+    /// \brief Bias, drift and noise of each rate and acceleration axis
+    private: BiasDriftNoise rate_noise_[3];
+    private: BiasDriftNoise accel_noise_[3];
 
     /// \brief for setting ROS name space
     private: std::string robot_namespace_;
@@ -110,7 +121,7 @@ namespace gazebo
     private: ros::ServiceServer srv_;
     private: std::string service_name_;
 
-    private: ros::CallbackQueue imu_queue_;
+    private: SharedCallbackQueue imu_queue_;
     private: void IMUQueueThread();
     private: boost::thread callback_queue_thread_;
 
@@ -121,7 +132,6 @@ namespace gazebo
     private: sdf::ElementPtr sdf;
     private: void LoadThread();
     private: boost::thread deferred_load_thread_;
-    private: unsigned int seed;
 
     // ros publish multi queue, prevents publish() blocking
     private: PubMultiQueue pmq;
@@ -19,12 +19,15 @@
 
 #include <gazebo/common/Plugin.hh>
 #include <gazebo/common/UpdateInfo.hh>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 #include <ignition/math/Vector3.hh>
 #include <ignition/math/Pose3.hh>
 #include <ros/ros.h>
 #include <sensor_msgs/Imu.h>
 #include <string>
 
+#include <gazebo_plugins/gazebo_ros_noise.h>
+
 namespace gazebo
 {
   namespace sensors
@@ -58,10 +61,6 @@ namespace gazebo
   private:
     /// \brief Load the parameters from the sdf file.
     bool LoadParameters();
-    /// \brief Gaussian noise generator.
-    /// \param mu offset value.
-    /// \param sigma scaling value.
-    double GuassianKernel(double mu, double sigma);
     
     /// \brief Ros NodeHandle pointer.
     ros::NodeHandle* node;
@@ -85,8 +84,8 @@ namespace gazebo
     /// \brief Angular velocity data from the sensor.
     ignition::math::Vector3d gyroscope_data;
     
-    /// \brief Seed for the Gaussian noise generator.
-    unsigned int seed;
+    /// \brief Gaussian noise generator.
+    NoiseGenerator noise_generator;
 
     //loaded parameters
     /// \brief The data is published on the topic named: /robot_namespace/topic_name.
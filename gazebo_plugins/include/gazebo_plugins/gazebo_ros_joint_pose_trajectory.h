@@ -31,6 +31,7 @@
 
 #include <ros/ros.h>
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 #include <ros/subscribe_options.h>
 
@@ -47,6 +48,7 @@
 #include <gazebo/common/Time.hh>
 #include <gazebo/common/Plugin.hh>
 #include <gazebo/common/Events.hh>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 
 namespace gazebo
 {
@@ -112,7 +114,7 @@ namespace gazebo
     /// \brief for setting ROS name space
     private: std::string robot_namespace_;
 
-    private: ros::CallbackQueue queue_;
+    private: SharedCallbackQueue queue_;
     private: void QueueThread();
     private: boost::thread callback_queue_thread_;
 
@@ -34,6 +34,7 @@
 #include <gazebo/gazebo.hh>
 #include <gazebo/physics/physics.hh>
 #include <gazebo/common/common.hh>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 #include <stdio.h>
 
 // ROS
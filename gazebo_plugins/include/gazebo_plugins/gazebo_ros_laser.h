@@ -19,6 +19,7 @@
 #define GAZEBO_ROS_LASER_HH
 
 #include <string>
+#include <vector>
 
 #include <boost/bind.hpp>
 #include <boost/thread.hpp>
@@ -39,6 +40,8 @@
 #include <gazebo_plugins/gazebo_ros_utils.h>
 
 #include <gazebo_plugins/PubQueue.h>
+#include <gazebo_plugins/gazebo_ros_message_pool.h>
+#include <gazebo_plugins/gazebo_ros_latency_histogram.h>
 
 namespace gazebo
 {
@@ -71,6 +74,21 @@ namespace gazebo
     private: ros::Publisher pub_;
     private: PubQueue<sensor_msgs::LaserScan>::Ptr pub_queue_;
 
+    /// \brief Read scans straight from the sensor on its update event
+    /// instead of going through its gazebo transport topic
+    private: bool direct_scan_;
+    private: event::ConnectionPtr sensor_update_connection_;
+    private: void OnSensorUpdate();
+    private: MessagePool<sensor_msgs::LaserScan> scan_pool_;
+    private: PubQueue<sensor_msgs::LaserScanPtr>::Ptr scan_ptr_queue_;
+    private: std::vector<double> ranges_;
+
+    /// \brief Sensor update to publish queue latency of each scan
+    private: LatencyHistogram scan_latency_;
+
+    /// \brief Capacity, full-queue policy and diagnostics of pub_queue_
+    private: PubQueueOptions publish_queue_;
+
     /// \brief topic name
     private: std::string topic_name_;
 
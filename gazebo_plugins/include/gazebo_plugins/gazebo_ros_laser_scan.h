@@ -0,0 +1,102 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+/*
+ * Desc: Fill a sensor_msgs::LaserScan straight from a (GPU) ray sensor,
+ *       shared by the laser plugins.
+ */
+
+#ifndef GAZEBO_ROS_LASER_SCAN_H
+#define GAZEBO_ROS_LASER_SCAN_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <ros/time.h>
+#include <sensor_msgs/LaserScan.h>
+
+#include <gazebo/common/Time.hh>
+#include <gazebo/physics/MultiRayShape.hh>
+#include <gazebo/sensors/RaySensor.hh>
+
+namespace gazebo
+{
+  /// \brief Key of a scan for LatencyHistogram, from its sensor stamp.
+  inline uint64_t LaserScanKey(const common::Time &_stamp)
+  {
+    return static_cast<uint64_t>(_stamp.sec) * 1000000000ull + _stamp.nsec;
+  }
+
+  /// \brief Copy the retro values of all rays, in the order of the ranges.
+  /// Sensors without a ray shape, as the GPU ray sensor, are asked per ray.
+  template <class SensorT>
+  void LaserRetros(SensorT &_sensor, std::vector<float> &_intensities)
+  {
+    for (size_t i = 0; i < _intensities.size(); ++i)
+      _intensities[i] = _sensor.Retro(static_cast<int>(i));
+  }
+
+  /// \brief Copy the retro values of all rays of a RaySensor straight from
+  /// its ray shape, which is where RaySensor::Retro() reads each of them.
+  inline void LaserRetros(sensors::RaySensor &_sensor, std::vector<float> &_intensities)
+  {
+    physics::MultiRayShapePtr shape = _sensor.LaserShape();
+    if (!shape || shape->GetCount() < _intensities.size())
+    {
+      std::fill(_intensities.begin(), _intensities.end(), 0.0f);
+      return;
+    }
+    for (size_t i = 0; i < _intensities.size(); ++i)
+      _intensities[i] = shape->GetRetro(i);
+  }
+
+  /// \brief Fill a LaserScan from the last measurement of a RaySensor or
+  /// GpuRaySensor, with the fields the sensor would put in its gazebo
+  /// transport message.  Meant to be called from the sensor update event,
+  /// while the measurement is current.
+  /// \param[in] _sensor The sensor.
+  /// \param[in] _frame Frame id of the message.
+  /// \param[in,out] _ranges Scratch buffer, kept between scans.
+  /// \param[out] _msg The message, its buffers are reused.
+  template <class SensorT>
+  void FillLaserScan(SensorT &_sensor, const std::string &_frame,
+                     std::vector<double> &_ranges, sensor_msgs::LaserScan &_msg)
+  {
+    common::Time stamp = _sensor.LastMeasurementTime();
+    _msg.header.stamp = ros::Time(stamp.sec, stamp.nsec);
+    _msg.header.frame_id = _frame;
+    _msg.angle_min = _sensor.AngleMin().Radian();
+    _msg.angle_max = _sensor.AngleMax().Radian();
+    _msg.angle_increment = _sensor.AngleResolution();
+    _msg.time_increment = 0;  // instantaneous simulator scan
+    _msg.scan_time = 0;  // not sure whether this is correct
+    _msg.range_min = _sensor.RangeMin();
+    _msg.range_max = _sensor.RangeMax();
+
+    // ranges with the sensor noise applied, copied once under the sensor lock
+    _sensor.Ranges(_ranges);
+    _msg.ranges.resize(_ranges.size());
+    for (size_t i = 0; i < _ranges.size(); ++i)
+      _msg.ranges[i] = _ranges[i];
+    // there is no bulk accessor for the retro values, but the shape they are
+    // kept in is not written until the next sensor update
+    _msg.intensities.resize(_ranges.size());
+    LaserRetros(_sensor, _msg.intensities);
+  }
+}
+#endif
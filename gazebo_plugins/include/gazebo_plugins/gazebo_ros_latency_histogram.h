@@ -0,0 +1,186 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef GAZEBO_ROS_LATENCY_HISTOGRAM_H
+#define GAZEBO_ROS_LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <string>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <ros/time.h>
+#include <diagnostic_msgs/DiagnosticStatus.h>
+
+namespace gazebo
+{
+  /// \brief Wall clock latency histogram with power of two microsecond
+  /// buckets, reported as a diagnostics status.
+  ///
+  /// Latencies are either recorded directly, or measured between Start()
+  /// and Stop() calls made with the same key, e.g. the sensor update and
+  /// the ROS push of the scan with a given stamp.  Counters cover the time
+  /// since the previous FillStatus() call.
+  class LatencyHistogram
+  {
+    /// \brief Bucket k counts latencies below 2^k microseconds, the last
+    /// one everything above.
+    public: static const unsigned int kBuckets = 16;
+
+    /// \brief Constructor
+    /// \param[in] _name Status name.
+    public: explicit LatencyHistogram(const std::string &_name = "latency")
+      : next_pending_(0), name_(_name)
+    {
+      this->Clear();
+      for (unsigned int i = 0; i < kPending; ++i)
+        this->pending_[i].key = 0;
+    }
+
+    /// \brief Record one latency.
+    /// \param[in] _seconds Latency in seconds.
+    public: void Record(double _seconds)
+    {
+      boost::mutex::scoped_lock lock(this->mutex_);
+      this->RecordLocked(_seconds);
+    }
+
+    /// \brief Remember when the item _key started.
+    /// \param[in] _key Non zero key of the item.
+    public: void Start(uint64_t _key)
+    {
+      ros::WallTime now = ros::WallTime::now();
+      boost::mutex::scoped_lock lock(this->mutex_);
+      Pending &pending = this->pending_[this->next_pending_];
+      this->next_pending_ = (this->next_pending_ + 1) % kPending;
+      pending.key = _key;
+      pending.start = now;
+    }
+
+    /// \brief Record the time since Start() was called with _key.  Items
+    /// without a matching Start(), e.g. pushed out by later ones, are only
+    /// counted.
+    /// \param[in] _key Non zero key of the item.
+    public: void Stop(uint64_t _key)
+    {
+      ros::WallTime now = ros::WallTime::now();
+      boost::mutex::scoped_lock lock(this->mutex_);
+      for (unsigned int i = 0; i < kPending; ++i)
+      {
+        Pending &pending = this->pending_[i];
+        if (pending.key == _key)
+        {
+          pending.key = 0;
+          this->RecordLocked((now - pending.start).toSec());
+          return;
+        }
+      }
+      ++this->unmatched_;
+    }
+
+    /// \brief Fill a diagnostics status and clear the counters.
+    public: void FillStatus(diagnostic_msgs::DiagnosticStatus &_status)
+    {
+      boost::mutex::scoped_lock lock(this->mutex_);
+      _status.name = this->name_;
+      _status.level = diagnostic_msgs::DiagnosticStatus::OK;
+      _status.message = "OK";
+      AddValue(_status, "Samples", this->count_);
+      AddValue(_status, "Unmatched", this->unmatched_);
+      AddValue(_status, "Mean latency (ms)", this->count_ > 0 ?
+        1000.0 * this->sum_ / this->count_ : 0.0);
+      AddValue(_status, "Max latency (ms)", 1000.0 * this->max_);
+      for (unsigned int i = 0; i < kBuckets; ++i)
+      {
+        if (this->buckets_[i] == 0)
+          continue;
+        std::string key = i + 1 < kBuckets ?
+          "< " + boost::lexical_cast<std::string>(1u << i) + " us" :
+          ">= " + boost::lexical_cast<std::string>(1u << (i - 1)) + " us";
+        AddValue(_status, key, this->buckets_[i]);
+      }
+      this->Clear();
+    }
+
+    /// \brief Number of latencies recorded since the last FillStatus().
+    public: unsigned long Count() const
+    {
+      boost::mutex::scoped_lock lock(this->mutex_);
+      return this->count_;
+    }
+
+    /// \brief Count of bucket _i since the last FillStatus().
+    public: unsigned long Bucket(unsigned int _i) const
+    {
+      boost::mutex::scoped_lock lock(this->mutex_);
+      return this->buckets_[_i];
+    }
+
+    private: void RecordLocked(double _seconds)
+    {
+      _seconds = std::max(_seconds, 0.0);
+      double us = _seconds * 1e6;
+      unsigned int bucket = 0;
+      while (bucket + 1 < kBuckets && us >= static_cast<double>(1u << bucket))
+        ++bucket;
+      ++this->buckets_[bucket];
+      ++this->count_;
+      this->sum_ += _seconds;
+      this->max_ = std::max(this->max_, _seconds);
+    }
+
+    private: void Clear()
+    {
+      std::fill(this->buckets_, this->buckets_ + kBuckets, 0ul);
+      this->count_ = 0;
+      this->unmatched_ = 0;
+      this->sum_ = 0.0;
+      this->max_ = 0.0;
+    }
+
+    private: template <class V>
+             static void AddValue(diagnostic_msgs::DiagnosticStatus &_status,
+                                  const std::string &_key, const V &_value)
+    {
+      diagnostic_msgs::KeyValue kv;
+      kv.key = _key;
+      kv.value = boost::lexical_cast<std::string>(_value);
+      _status.values.push_back(kv);
+    }
+
+    /// \brief Last started items, overwritten round robin.
+    private: static const unsigned int kPending = 8;
+    private: struct Pending
+    {
+      uint64_t key;
+      ros::WallTime start;
+    };
+    private: Pending pending_[kPending];
+    private: unsigned int next_pending_;
+
+    private: std::string name_;
+    private: mutable boost::mutex mutex_;
+    private: unsigned long buckets_[kBuckets];
+    private: unsigned long count_;
+    private: unsigned long unmatched_;
+    private: double sum_;
+    private: double max_;
+  };
+}
+#endif
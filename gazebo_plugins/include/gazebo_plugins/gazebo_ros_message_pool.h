@@ -0,0 +1,117 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef GAZEBO_ROS_MESSAGE_POOL_H
+#define GAZEBO_ROS_MESSAGE_POOL_H
+
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace gazebo
+{
+  /// \brief A recycling pool of ROS messages handed out as shared pointers.
+  ///
+  /// Publishing a boost::shared_ptr lets roscpp deliver the message to
+  /// intraprocess (nodelet) subscribers without serializing it, and only
+  /// serialize once for remote ones.  Once every reference is dropped the
+  /// message goes back to the pool with its buffers still allocated, so the
+  /// next frame is written in place without reallocating.
+  ///
+  /// Acquired messages keep the contents of their previous use, callers are
+  /// expected to overwrite every field they publish.
+  template <class T>
+  class MessagePool
+  {
+    public: typedef boost::shared_ptr<T> Ptr;
+
+    /// \brief Constructor
+    /// \param[in] _max_free Maximum number of idle messages kept around.
+    public: explicit MessagePool(size_t _max_free = 4)
+      : state_(new State(_max_free)) {}
+
+    /// \brief Get a message, recycled if one is available.
+    /// \return Message that returns to the pool when released.
+    public: Ptr Acquire()
+    {
+      T *msg = NULL;
+      {
+        boost::mutex::scoped_lock lock(this->state_->mutex);
+        if (!this->state_->free.empty())
+        {
+          msg = this->state_->free.back();
+          this->state_->free.pop_back();
+        }
+        else
+        {
+          ++this->state_->allocated;
+        }
+      }
+      if (!msg)
+        msg = new T();
+
+      // messages still in flight when the pool goes away are simply deleted
+      return Ptr(msg, boost::bind(&MessagePool::Release,
+        boost::weak_ptr<State>(this->state_), _1));
+    }
+
+    /// \brief Total number of messages allocated by this pool.
+    public: size_t Allocated() const
+    {
+      boost::mutex::scoped_lock lock(this->state_->mutex);
+      return this->state_->allocated;
+    }
+
+    /// \brief Shared with the deleters of outstanding messages.
+    private: struct State
+    {
+      explicit State(size_t _max_free) : max_free(_max_free), allocated(0) {}
+      ~State()
+      {
+        for (size_t i = 0; i < this->free.size(); ++i)
+          delete this->free[i];
+      }
+      boost::mutex mutex;
+      std::vector<T*> free;
+      size_t max_free;
+      size_t allocated;
+    };
+
+    /// \brief Deleter, puts the message back into the pool.
+    private: static void Release(boost::weak_ptr<State> _state, T *_msg)
+    {
+      boost::shared_ptr<State> state = _state.lock();
+      if (state)
+      {
+        boost::mutex::scoped_lock lock(state->mutex);
+        if (state->free.size() < state->max_free)
+        {
+          state->free.push_back(_msg);
+          return;
+        }
+        --state->allocated;
+      }
+      delete _msg;
+    }
+
+    private: boost::shared_ptr<State> state_;
+  };
+}
+#endif
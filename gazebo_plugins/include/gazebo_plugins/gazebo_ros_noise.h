@@ -0,0 +1,157 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+/*
+ * Desc: Random number generation and noise models shared by the sensor
+ *       plugins.
+ */
+
+#ifndef GAZEBO_ROS_NOISE_H
+#define GAZEBO_ROS_NOISE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace gazebo
+{
+  /// \brief Per-plugin random number generator.
+  ///
+  /// A xoshiro256** generator: no shared state and no libc lock, unlike
+  /// rand(), so every plugin owns one and the sequence it produces only
+  /// depends on its seed.  Gaussian samples come from the Box-Muller
+  /// transform, using both of its outputs; FillGaussian produces them in
+  /// batches into a caller buffer.
+  class NoiseGenerator
+  {
+    /// \brief Constructor
+    /// \param[in] _seed Seed, see Seed().
+    public: explicit NoiseGenerator(uint64_t _seed = 0);
+
+    /// \brief Restart the sequence from a seed.  Any value, 0 included,
+    /// is a valid seed.
+    public: void Seed(uint64_t _seed);
+
+    /// \brief Seed derived from a name, e.g. the topic of a plugin, so
+    /// that plugins get different but reproducible sequences.
+    public: static uint64_t SeedFromName(const std::string &_name);
+
+    /// \brief splitmix64 step, used to turn seeds into generator states.
+    public: static uint64_t SplitMix64(uint64_t _x);
+
+    /// \brief Next 64 random bits.
+    public: inline uint64_t Next()
+    {
+      const uint64_t result = Rotl(this->s_[1] * 5, 7) * 9;
+      const uint64_t t = this->s_[1] << 17;
+      this->s_[2] ^= this->s_[0];
+      this->s_[3] ^= this->s_[1];
+      this->s_[1] ^= this->s_[2];
+      this->s_[0] ^= this->s_[3];
+      this->s_[2] ^= t;
+      this->s_[3] = Rotl(this->s_[3], 45);
+      return result;
+    }
+
+    /// \brief Uniform sample in [0, 1).
+    public: inline double Uniform()
+    {
+      return (this->Next() >> 11) * (1.0 / 9007199254740992.0);  // 2^-53
+    }
+
+    /// \brief Gaussian sample.  The second output of each Box-Muller
+    /// transform is kept for the next call.
+    /// \param[in] _mu Mean.
+    /// \param[in] _sigma Standard deviation.
+    public: double Gaussian(double _mu, double _sigma);
+
+    /// \brief Fill a buffer with Gaussian samples.
+    /// \param[out] _out Buffer of _count samples.
+    /// \param[in] _count Number of samples.
+    /// \param[in] _sigma Standard deviation.
+    /// \param[in] _mu Mean.
+    public: void FillGaussian(double *_out, size_t _count, double _sigma,
+                              double _mu = 0.0);
+
+    /// \brief Single precision version of FillGaussian.
+    public: void FillGaussian(float *_out, size_t _count, float _sigma,
+                              float _mu = 0.0f);
+
+    private: static inline uint64_t Rotl(uint64_t _x, int _k)
+    {
+      return (_x << _k) | (_x >> (64 - _k));
+    }
+
+    /// \brief Fill both halves of a block of Box-Muller pairs.
+    private: template <typename T>
+             void FillBlock(T *_out, size_t _count, double _sigma, double _mu);
+
+    /// \brief Generator state.
+    private: uint64_t s_[4];
+
+    /// \brief Unused second output of the last Box-Muller transform.
+    private: double spare_;
+    private: bool has_spare_;
+  };
+
+  /// \brief Sensor error made of a constant bias, a slowly varying drift
+  /// and white Gaussian noise.
+  ///
+  /// The bias is drawn once by Reset().  The drift is a random walk, or a
+  /// first order Gauss-Markov process when a correlation time is given,
+  /// and is advanced by the time elapsed between two Apply() calls.
+  class BiasDriftNoise
+  {
+    /// \brief Constructor, all terms disabled.
+    public: BiasDriftNoise();
+
+    /// \brief Set the error model.
+    /// \param[in] _sigma Standard deviation of the white noise.
+    /// \param[in] _biasMean Mean of the bias.
+    /// \param[in] _biasStddev Standard deviation of the bias.
+    /// \param[in] _driftStddev Drift intensity, in units per sqrt(second).
+    /// \param[in] _driftCorrelationTime Correlation time of the drift in
+    /// seconds, 0 for a random walk.
+    public: void Configure(double _sigma, double _biasMean, double _biasStddev,
+                           double _driftStddev,
+                           double _driftCorrelationTime = 0.0);
+
+    /// \brief Draw a new bias and clear the drift.
+    public: void Reset(NoiseGenerator &_gen);
+
+    /// \brief Add the error to a value.
+    /// \param[in] _value True value.
+    /// \param[in] _dt Seconds since the previous call.
+    /// \param[in] _gen Generator of the samples.
+    /// \return The value with bias, drift and noise added.
+    public: double Apply(double _value, double _dt, NoiseGenerator &_gen);
+
+    /// \brief Current bias.
+    public: double Bias() const;
+
+    /// \brief Current drift.
+    public: double Drift() const;
+
+    private: double sigma_;
+    private: double bias_mean_;
+    private: double bias_stddev_;
+    private: double drift_stddev_;
+    private: double drift_correlation_time_;
+    private: double bias_;
+    private: double drift_;
+  };
+}
+#endif
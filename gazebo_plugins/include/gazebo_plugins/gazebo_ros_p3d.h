@@ -33,6 +33,7 @@
 #include <nav_msgs/Odometry.h>
 
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 
 #include <gazebo/physics/physics.hh>
@@ -40,8 +41,10 @@
 #include <gazebo/common/Time.hh>
 #include <gazebo/common/Plugin.hh>
 #include <gazebo/common/Events.hh>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 
 #include <gazebo_plugins/PubQueue.h>
+#include <gazebo_plugins/gazebo_ros_noise.h>
 
 namespace gazebo
 {
@@ -74,6 +77,10 @@ namespace gazebo
     private: ros::Publisher pub_;
     private: PubQueue<nav_msgs::Odometry>::Ptr pub_Queue;
 
+    /// \brief <publishQueueSize> (64), <publishQueuePolicy> (drop_oldest)
+    /// and <publishQueueDiagnostics> (false) of pub_Queue
+    private: PubQueueOptions publish_queue_;
+
     /// \brief ros message
     private: nav_msgs::Odometry pose_msg_;
 
@@ -112,20 +119,18 @@ namespace gazebo
     private: double gaussian_noise_;
 
     /// \brief Gaussian noise generator
-    private: double GaussianKernel(double mu, double sigma);
+    private: NoiseGenerator noise_;
 
     /// \brief for setting ROS name space
     private: std::string robot_namespace_;
 
-    private: ros::CallbackQueue p3d_queue_;
+    private: SharedCallbackQueue p3d_queue_;
     private: void P3DQueueThread();
     private: boost::thread callback_queue_thread_;
 
     // Pointer to the update event connection
     private: event::ConnectionPtr update_connection_;
 
-    private: unsigned int seed;
-
     // ros publish multi queue, prevents publish() blocking
     private: PubMultiQueue pmq;
   };
@@ -31,6 +31,7 @@
 
 #include <gazebo/common/common.hh>
 #include <gazebo/physics/physics.hh>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 #include <sdf/sdf.hh>
 
 #include <geometry_msgs/Twist.h>
@@ -38,6 +39,7 @@
 #include <nav_msgs/Odometry.h>
 #include <ros/advertise_options.h>
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/ros.h>
 #include <tf/transform_broadcaster.h>
 #include <tf/transform_listener.h>
@@ -78,7 +80,7 @@ namespace gazebo {
       double odometry_rate_;
 
       // Custom Callback Queue
-      ros::CallbackQueue queue_;
+      SharedCallbackQueue queue_;
       boost::thread callback_queue_thread_;
       void QueueThread();
 
@@ -9,6 +9,7 @@
 
 // Custom Callback Queue
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/subscribe_options.h>
 
 #include <ros/ros.h>
@@ -109,7 +110,7 @@ class GazeboRosProjector : public ModelPlugin
   private: std::string robot_namespace_;
 
   // Custom Callback Queue
-  private: ros::CallbackQueue queue_;
+  private: SharedCallbackQueue queue_;
   private: void QueueThread();
   private: boost::thread callback_queue_thread_;
 
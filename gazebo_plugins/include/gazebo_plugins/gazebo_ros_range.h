@@ -46,6 +46,7 @@
 
 #include <ros/ros.h>
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 #include <sensor_msgs/Range.h>
 
@@ -60,6 +61,8 @@
 
 #include <sdf/Param.hh>
 
+#include <gazebo_plugins/gazebo_ros_noise.h>
+
 namespace gazebo
 {
 
@@ -115,7 +118,7 @@ class GazeboRosRange : public RayPlugin
     private: double gaussian_noise_;
 
     /// \brief Gaussian noise generator
-    private: double GaussianKernel(double mu, double sigma);
+    private: NoiseGenerator noise_;
 
     /// \brief mutex to lock access to fields that are used in message callbacks
     private: boost::mutex lock_;
@@ -131,7 +134,7 @@ class GazeboRosRange : public RayPlugin
     /// \brief for setting ROS name space
     private: std::string robot_namespace_;
 
-    private: ros::CallbackQueue range_queue_;
+    private: SharedCallbackQueue range_queue_;
     private: void RangeQueueThread();
     private: boost::thread callback_queue_thread_;
 
@@ -139,7 +142,6 @@ class GazeboRosRange : public RayPlugin
     private: sdf::ElementPtr sdf;
     private: void LoadThread();
     private: boost::thread deferred_load_thread_;
-    private: unsigned int seed;
 };
 }
 #endif // GAZEBO_ROS_RANGE_H
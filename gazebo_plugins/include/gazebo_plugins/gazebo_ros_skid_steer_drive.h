@@ -43,6 +43,7 @@
 
 #include <gazebo/common/common.hh>
 #include <gazebo/physics/physics.hh>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 
 // ROS
 #include <ros/ros.h>
@@ -54,6 +55,7 @@
 
 // Custom Callback Queue
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 
 // Boost
@@ -114,7 +116,7 @@ namespace gazebo {
       std::string robot_base_frame_;
 
       // Custom Callback Queue
-      ros::CallbackQueue queue_;
+      SharedCallbackQueue queue_;
       boost::thread callback_queue_thread_;
       void QueueThread();
 
@@ -31,6 +31,7 @@
 
 #include <ros/ros.h>
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/rate.h>
 #include <std_msgs/String.h>
 
@@ -88,7 +89,7 @@ namespace gazebo
       protected: ros::Subscriber string_subscriber_;
 
       /// \brief Custom Callback Queue
-      private: ros::CallbackQueue queue_;
+      private: SharedCallbackQueue queue_;
 
       /// \brief Thead object for the running callback Thread.
       private: boost::thread callback_queue_thread_;
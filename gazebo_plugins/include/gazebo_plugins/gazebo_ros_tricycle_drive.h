@@ -58,11 +58,13 @@
 
 // Custom Callback Queue
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 
 // Boost
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 
 namespace gazebo {
 
@@ -138,7 +140,7 @@ private:
 
 
     // Custom Callback Queue
-    ros::CallbackQueue queue_;
+    SharedCallbackQueue queue_;
     boost::thread callback_queue_thread_;
     void QueueThread();
 
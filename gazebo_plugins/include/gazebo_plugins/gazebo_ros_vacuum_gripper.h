@@ -27,6 +27,7 @@
 
 // Custom Callback Queue
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
 #include <ros/advertise_options.h>
 #include <ros/advertise_service_options.h>
 #include <std_srvs/Empty.h>
@@ -39,6 +40,7 @@
 #include <gazebo/transport/TransportTypes.hh>
 #include <gazebo/common/Plugin.hh>
 #include <gazebo/common/Events.hh>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 
 
 namespace gazebo
@@ -143,7 +145,7 @@ class GazeboRosVacuumGripper : public ModelPlugin
   private: std::string robot_namespace_;
 
   // Custom Callback Queue
-  private: ros::CallbackQueue queue_;
+  private: SharedCallbackQueue queue_;
   /// \brief Thead object for the running callback Thread.
   private: boost::thread callback_queue_thread_;
 
@@ -33,6 +33,8 @@
 #include <opencv2/opencv.hpp>
 #include <ros/advertise_options.h>
 #include <ros/callback_queue.h>
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
+#include <gazebo_plugins/gazebo_ros_video_stream.h>
 #include <ros/ros.h>
 #include <ros/rate.h>
 #include <sensor_msgs/Image.h>
@@ -84,6 +86,7 @@ namespace gazebo
       void processVideoSeekMsg(const std_msgs::Float64ConstPtr &msg);
       void processVideoPauseMsg(const std_msgs::BoolConstPtr &msg);
       void updateImage(const cv::Mat& image);
+      void updateVideoFrame(cv::Mat& frame);
       void clearImage();
 
     protected:
@@ -111,7 +114,7 @@ namespace gazebo
       ros::Subscriber video_seek_subscriber_;
       ros::Subscriber video_pause_subscriber_;
 
-      ros::CallbackQueue queue_;
+      SharedCallbackQueue queue_;
       boost::thread callback_queue_thread_;
       void QueueThread();
 
@@ -129,6 +132,9 @@ namespace gazebo
       bool buffer_all_frames_for_fast_seek_;
       size_t current_buffered_frame_;
       std::vector<cv::Mat> video_frames_;
+      // decode ahead into a bounded ring of display-ready frames instead
+      bool stream_video_;
+      size_t video_buffer_bytes_;
 
   };
 
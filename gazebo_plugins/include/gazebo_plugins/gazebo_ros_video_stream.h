@@ -0,0 +1,141 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+/*
+ * Desc: Bounded-memory video decoding for the video plugin, frames are
+ *       prefetched by a decoder thread into a ring of display-ready images.
+ */
+
+#ifndef GAZEBO_ROS_VIDEO_STREAM_H
+#define GAZEBO_ROS_VIDEO_STREAM_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <opencv2/opencv.hpp>
+
+namespace gazebo
+{
+  /// \brief Plays a video file from a bounded ring of decoded frames.
+  ///
+  /// A decoder thread reads ahead of the playhead and stores each frame
+  /// resized to the display size and converted to BGRA, so a frame can go
+  /// to the texture as is.  The ring is sized once from a byte budget and
+  /// never grows, whatever the length of the video.
+  ///
+  /// Besides the frames ahead of the playhead the ring keeps up to a
+  /// quarter of its size of played frames.  Seeks into the ring only move
+  /// the playhead, short seeks ahead are decoded forward, and longer ones
+  /// reposition the decoder by frame number, which the container resolves
+  /// through its keyframe index.  A video that fits in the ring loops
+  /// without decoding again.
+  class VideoFrameStream
+  {
+    /// \brief Constructor
+    /// \param[in] _width Width of the frames handed out.
+    /// \param[in] _height Height of the frames handed out.
+    /// \param[in] _max_bytes Memory budget of the ring and the decoder
+    /// buffers, at least two frames are kept whatever the budget.
+    public: VideoFrameStream(int _width, int _height, size_t _max_bytes);
+
+    /// \brief Destructor, stops the decoder thread.
+    public: ~VideoFrameStream();
+
+    /// \brief Open a video and start decoding from its first frame.
+    /// \param[in] _path Video file.
+    /// \return False if the video could not be opened.
+    public: bool Open(const std::string &_path);
+
+    /// \brief Stop decoding and close the video.
+    public: void Close();
+
+    /// \brief Whether a video is open.
+    public: bool IsOpen() const;
+
+    /// \brief Frame rate of the open video, from its container.
+    public: double Fps() const;
+
+    /// \brief Number of frames of the open video, 0 if the container does
+    /// not tell.
+    public: int64_t FrameCount() const;
+
+    /// \brief Move the playhead.
+    /// \param[in] _position Position in [0, 1], 0 is the first frame and 1
+    /// the last one.
+    public: void Seek(double _position);
+
+    /// \brief Take the frame at the playhead and advance it.
+    /// \param[out] _frame BGRA frame of the display size, reallocated only
+    /// if it has another size or type.
+    /// \return False if the decoder has not caught up with the playhead yet
+    /// or the video is finished.
+    public: bool Next(cv::Mat &_frame);
+
+    /// \brief Whether every frame up to the end of the video was taken.
+    public: bool Finished() const;
+
+    /// \brief Number of frames the ring holds.
+    public: size_t Capacity() const;
+
+    /// \brief Memory used by the ring and the decoder buffers, in bytes.
+    public: size_t Bytes() const;
+
+    /// \brief Frame number of the playhead.
+    public: int64_t Playhead() const;
+
+    /// \brief Decode frames ahead of the playhead until closed.
+    private: void DecodeThread();
+
+    /// \brief Frame ring, frame f is in slot f % slots_.size() while it is
+    /// in [window_begin_, decoded_end_).
+    private: std::vector<cv::Mat> slots_;
+
+    private: const int width_;
+    private: const int height_;
+    private: const size_t max_bytes_;
+
+    /// \brief Used by the decoder thread only, once open.
+    private: cv::VideoCapture capture_;
+    private: cv::Mat decoded_;
+    private: cv::Mat resized_;
+    /// \brief Size of decoded_ and resized_ for the open video.
+    private: size_t buffer_bytes_;
+
+    private: mutable boost::mutex mutex_;
+    private: boost::condition_variable wake_decoder_;
+    private: boost::thread thread_;
+
+    /// \brief State shared with the decoder thread, under mutex_.
+    private: bool open_;
+    private: bool stop_;
+    private: double fps_;
+    private: int64_t frame_count_;
+    private: int64_t playhead_;
+    private: int64_t window_begin_;
+    private: int64_t decoded_end_;
+    private: bool end_of_video_;
+    /// \brief Frame the decoder has to restart from, -1 if none.
+    private: int64_t restart_at_;
+    /// \brief Incremented by each restart, frames decoded before are dropped.
+    private: uint64_t generation_;
+  };
+}
+#endif
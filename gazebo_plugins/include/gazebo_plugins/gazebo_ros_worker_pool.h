@@ -0,0 +1,89 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef GAZEBO_ROS_WORKER_POOL_H
+#define GAZEBO_ROS_WORKER_POOL_H
+
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+namespace gazebo
+{
+  /// \brief A small pool of persistent threads used by sensor plugins to
+  /// split per-frame loops (rows of a depth image, rays of a laser, ...).
+  /// Threads sleep on a condition variable between frames, so an idle pool
+  /// costs nothing.  The calling thread always takes part in the work.
+  class WorkerPool
+  {
+    /// \brief Range functor, called with a half-open [begin, end) range.
+    public: typedef boost::function<void(unsigned int, unsigned int)>
+              RangeFunc;
+
+    /// \brief Constructor
+    /// \param[in] _threads Total number of threads working on a
+    /// ParallelFor call, including the caller.  0 picks a default based on
+    /// the number of hardware threads.
+    public: explicit WorkerPool(unsigned int _threads = 0);
+
+    /// \brief Destructor, joins all worker threads.
+    public: ~WorkerPool();
+
+    /// \brief Number of threads taking part in a ParallelFor call,
+    /// including the caller.
+    public: unsigned int Size() const;
+
+    /// \brief Split [0, _count) into contiguous chunks and run _func on
+    /// each of them, blocking until all chunks are done.  Calls from
+    /// different threads are serialized.
+    /// \param[in] _count Number of items to process.
+    /// \param[in] _func Functor processing a [begin, end) range.
+    public: void ParallelFor(unsigned int _count, const RangeFunc &_func);
+
+    /// \brief Worker thread main loop.
+    private: void Run();
+
+    /// \brief Grab and process chunks of the current job until none remain.
+    private: void Drain();
+
+    private: std::vector<boost::thread*> threads_;
+
+    /// \brief Serializes concurrent ParallelFor calls.
+    private: boost::mutex dispatch_mutex_;
+
+    /// \brief Protects the job state below.
+    private: boost::mutex mutex_;
+    private: boost::condition_variable work_cond_;
+    private: boost::condition_variable done_cond_;
+
+    /// \brief Current job.
+    private: const RangeFunc *func_;
+    private: unsigned int count_;
+    private: unsigned int chunks_;
+    private: unsigned int next_chunk_;
+    private: unsigned int pending_chunks_;
+
+    /// \brief Incremented for every new job so workers can tell it apart
+    /// from the one they already drained.
+    private: unsigned long generation_;
+    private: bool shutdown_;
+  };
+}
+#endif
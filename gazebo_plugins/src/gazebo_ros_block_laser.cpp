@@ -63,6 +63,7 @@ GazeboRosBlockLaser::~GazeboRosBlockLaser()
   this->laser_queue_.clear();
   this->laser_queue_.disable();
   this->rosnode_->shutdown();
+  this->laser_queue_.Detach();
   this->callback_laser_queue_thread_.join();
 
   delete this->rosnode_;
@@ -125,6 +126,13 @@ void GazeboRosBlockLaser::Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf)
   else
     this->gaussian_noise_ = _sdf->GetElement("gaussianNoise")->Get<double>();
 
+  uint64_t noise_seed;
+  if (!_sdf->HasElement("noiseSeed"))
+    noise_seed = NoiseGenerator::SeedFromName(this->topic_name_);
+  else
+    noise_seed = _sdf->GetElement("noiseSeed")->Get<unsigned int>();
+  this->noise_.Seed(noise_seed);
+
   if (!_sdf->HasElement("hokuyoMinIntensity"))
   {
     ROS_INFO_NAMED("block_laser", "Block laser plugin missing <hokuyoMinIntensity>, defaults to 101");
@@ -133,6 +141,20 @@ void GazeboRosBlockLaser::Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf)
   else
     this->hokuyo_min_intensity_ = _sdf->GetElement("hokuyoMinIntensity")->Get<double>();
 
+  // organized xyz+intensity PointCloud2 instead of the legacy PointCloud
+  if (!_sdf->HasElement("pointCloud2"))
+    this->point_cloud2_ = false;
+  else
+    this->point_cloud2_ = _sdf->GetElement("pointCloud2")->Get<bool>();
+
+  // number of threads converting scans to PointCloud2, 0 = auto
+  if (_sdf->HasElement("pointCloudThreads"))
+    this->projection_.SetThreads(
+      _sdf->GetElement("pointCloudThreads")->Get<unsigned int>());
+  else
+    this->projection_.SetThreads(0);
+  this->projection_.SetNoise(this->gaussian_noise_, noise_seed);
+
   ROS_DEBUG_NAMED("block_laser", "gazebo_ros_laser plugin should set minimum intensity to %f due to cutoff in hokuyo filters." , this->hokuyo_min_intensity_);
 
   if (!_sdf->HasElement("updateRate"))
@@ -167,7 +189,16 @@ void GazeboRosBlockLaser::Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf)
   this->cloud_msg_.channels.clear();
   this->cloud_msg_.channels.push_back(sensor_msgs::ChannelFloat32());
 
-  if (this->topic_name_ != "")
+  if (this->topic_name_ != "" && this->point_cloud2_)
+  {
+    // Custom Callback Queue
+    ros::AdvertiseOptions ao = ros::AdvertiseOptions::create<sensor_msgs::PointCloud2>(
+      this->topic_name_,1,
+      boost::bind( &GazeboRosBlockLaser::LaserConnect,this),
+      boost::bind( &GazeboRosBlockLaser::LaserDisconnect,this), ros::VoidPtr(), &this->laser_queue_);
+    this->pub_ = this->rosnode_->advertise(ao);
+  }
+  else if (this->topic_name_ != "")
   {
     // Custom Callback Queue
     ros::AdvertiseOptions ao = ros::AdvertiseOptions::create<sensor_msgs::PointCloud>(
@@ -183,7 +214,8 @@ void GazeboRosBlockLaser::Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf)
   // sensor generation off by default
   this->parent_ray_sensor_->SetActive(false);
   // start custom queue for laser
-  this->callback_laser_queue_thread_ = boost::thread( boost::bind( &GazeboRosBlockLaser::LaserQueueThread,this ) );
+  if (!this->laser_queue_.Attach(_sdf))
+    this->callback_laser_queue_thread_ = boost::thread( boost::bind( &GazeboRosBlockLaser::LaserQueueThread,this ) );
 
 }
 
@@ -219,7 +251,10 @@ void GazeboRosBlockLaser::OnNewLaserScans()
 
     if (last_update_time_ < sensor_update_time)
     {
-      this->PutLaserData(sensor_update_time);
+      if (this->point_cloud2_)
+        this->PutLaserData2(sensor_update_time);
+      else
+        this->PutLaserData(sensor_update_time);
       last_update_time_ = sensor_update_time;
     }
   }
@@ -353,13 +388,13 @@ void GazeboRosBlockLaser::PutLaserData(common::Time &_updateTime)
       {
         geometry_msgs::Point32 point;
         //pAngle is rotated by yAngle:
-        point.x = r * cos(pAngle) * cos(yAngle) + this->GaussianKernel(0,this->gaussian_noise_);
-        point.y = r * cos(pAngle) * sin(yAngle) + this->GaussianKernel(0,this->gaussian_noise_);
-        point.z = r * sin(pAngle) + this->GaussianKernel(0,this->gaussian_noise_);
+        point.x = r * cos(pAngle) * cos(yAngle) + this->noise_.Gaussian(0,this->gaussian_noise_);
+        point.y = r * cos(pAngle) * sin(yAngle) + this->noise_.Gaussian(0,this->gaussian_noise_);
+        point.z = r * sin(pAngle) + this->noise_.Gaussian(0,this->gaussian_noise_);
         this->cloud_msg_.points.push_back(point);
       } // only 1 channel
 
-      this->cloud_msg_.channels[0].values.push_back(intensity + this->GaussianKernel(0,this->gaussian_noise_)) ;
+      this->cloud_msg_.channels[0].values.push_back(intensity + this->noise_.Gaussian(0,this->gaussian_noise_)) ;
     }
   }
   this->parent_ray_sensor_->SetActive(true);
@@ -371,21 +406,48 @@ void GazeboRosBlockLaser::PutLaserData(common::Time &_updateTime)
 
 }
 
-
-//////////////////////////////////////////////////////////////////////////////
-// Utility for adding noise
-double GazeboRosBlockLaser::GaussianKernel(double mu,double sigma)
+////////////////////////////////////////////////////////////////////////////////
+// Put laser data to the interface as a PointCloud2
+void GazeboRosBlockLaser::PutLaserData2(common::Time &_updateTime)
 {
-  // using Box-Muller transform to generate two independent standard normally disbributed normal variables
-  // see wikipedia
-  double U = (double)rand()/(double)RAND_MAX; // normalized uniform random variable
-  double V = (double)rand()/(double)RAND_MAX; // normalized uniform random variable
-  double X = sqrt(-2.0 * ::log(U)) * cos( 2.0*M_PI * V);
-  //double Y = sqrt(-2.0 * ::log(U)) * sin( 2.0*M_PI * V); // the other indep. normal variable
-  // we'll just use X
-  // scale to our mu and sigma
-  X = sigma * X + mu;
-  return X;
+  this->parent_ray_sensor_->SetActive(false);
+
+  int rayCount = this->parent_ray_sensor_->RayCount();
+  int verticalRayCount = this->parent_ray_sensor_->VerticalRayCount();
+
+  // read every ray once, the projection interpolates from these arrays
+  // instead of calling into the laser shape four times per point
+  physics::MultiRayShapePtr laserShape = this->parent_ray_sensor_->LaserShape();
+  int rays = rayCount * verticalRayCount;
+  this->ranges_.resize(rays);
+  this->retros_.resize(rays);
+  for (int k = 0; k < rays; ++k)
+  {
+    this->ranges_[k] = laserShape->GetRange(k);
+    this->retros_[k] = laserShape->GetRetro(k);
+  }
+  this->parent_ray_sensor_->SetActive(true);
+
+  this->projection_.SetRange(this->parent_ray_sensor_->RangeMin(),
+                             this->parent_ray_sensor_->RangeMax());
+  this->projection_.SetGeometry(rayCount, this->parent_ray_sensor_->RangeCount(),
+                                verticalRayCount, this->parent_ray_sensor_->VerticalRangeCount(),
+                                this->parent_ray_sensor_->AngleMin().Radian(),
+                                this->parent_ray_sensor_->AngleMax().Radian(),
+                                this->parent_ray_sensor_->VerticalAngleMin().Radian(),
+                                this->parent_ray_sensor_->VerticalAngleMax().Radian());
+
+  boost::mutex::scoped_lock sclock(this->lock);
+  // Add Frame Name
+  this->cloud2_msg_.header.frame_id = this->frame_name_;
+  this->cloud2_msg_.header.stamp.sec = _updateTime.sec;
+  this->cloud2_msg_.header.stamp.nsec = _updateTime.nsec;
+
+  if (rays > 0)
+    this->projection_.Fill(this->cloud2_msg_, &this->ranges_[0], &this->retros_[0]);
+
+  // send data out via ros message
+  this->pub_.publish(this->cloud2_msg_);
 }
 
 // Custom Callback Queue
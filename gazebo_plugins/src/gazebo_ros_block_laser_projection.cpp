@@ -0,0 +1,244 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include <boost/bind.hpp>
+
+#include <sensor_msgs/point_cloud2_iterator.h>
+
+#include <gazebo_plugins/gazebo_ros_block_laser_projection.h>
+#include <gazebo_plugins/gazebo_ros_noise.h>
+
+#define EPSILON_DIFF 0.000001
+
+namespace gazebo
+{
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+BlockLaserProjection::BlockLaserProjection()
+  : ray_count_(0), range_count_(0), vertical_ray_count_(0),
+    vertical_range_count_(0), min_angle_(0.0), max_angle_(0.0),
+    vertical_min_angle_(0.0), vertical_max_angle_(0.0),
+    min_range_(0.0), max_range_(0.0), sigma_(0.0), seed_(0), scan_count_(0),
+    ranges_(NULL), retros_(NULL), cloud_(NULL)
+{
+  this->fill_rows_func_ = boost::bind(&BlockLaserProjection::FillRows, this, _1, _2);
+  this->pool_.reset(new WorkerPool(1));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destructor
+BlockLaserProjection::~BlockLaserProjection()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Set the number of threads
+void BlockLaserProjection::SetThreads(unsigned int _threads)
+{
+  this->pool_.reset(new WorkerPool(_threads));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Set the noise
+void BlockLaserProjection::SetNoise(double _sigma, uint64_t _seed)
+{
+  this->sigma_ = _sigma;
+  this->seed_ = _seed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Set the range limits
+void BlockLaserProjection::SetRange(double _min, double _max)
+{
+  this->min_range_ = _min;
+  this->max_range_ = _max;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Rebuild the tables if needed
+void BlockLaserProjection::SetGeometry(int _rayCount, int _rangeCount,
+                                       int _verticalRayCount, int _verticalRangeCount,
+                                       double _minAngle, double _maxAngle,
+                                       double _verticalMinAngle, double _verticalMaxAngle)
+{
+  if (_rayCount == this->ray_count_ && _rangeCount == this->range_count_ &&
+      _verticalRayCount == this->vertical_ray_count_ &&
+      _verticalRangeCount == this->vertical_range_count_ &&
+      _minAngle == this->min_angle_ && _maxAngle == this->max_angle_ &&
+      _verticalMinAngle == this->vertical_min_angle_ &&
+      _verticalMaxAngle == this->vertical_max_angle_)
+    return;
+
+  this->ray_count_ = _rayCount;
+  this->range_count_ = _rangeCount;
+  this->vertical_ray_count_ = _verticalRayCount;
+  this->vertical_range_count_ = _verticalRangeCount;
+  this->min_angle_ = _minAngle;
+  this->max_angle_ = _maxAngle;
+  this->vertical_min_angle_ = _verticalMinAngle;
+  this->vertical_max_angle_ = _verticalMaxAngle;
+
+  // interpolating in horizontal direction
+  double yDiff = _maxAngle - _minAngle;
+  this->col_a_.resize(_rangeCount);
+  this->col_b_.resize(_rangeCount);
+  this->col_frac_.resize(_rangeCount);
+  this->col_cos_.resize(_rangeCount);
+  this->col_sin_.resize(_rangeCount);
+  for (int i = 0; i < _rangeCount; ++i)
+  {
+    double hb = (_rangeCount == 1) ? 0 : (double) i * (_rayCount - 1) / (_rangeCount - 1);
+    int hja = (int) floor(hb);
+    int hjb = std::min(hja + 1, _rayCount - 1);
+    this->col_a_[i] = hja;
+    this->col_b_[i] = hjb;
+    this->col_frac_[i] = hb - floor(hb);
+    double yAngle = (_rayCount == 1) ? _minAngle :
+      0.5 * (hja + hjb) * yDiff / (_rayCount - 1) + _minAngle;
+    this->col_cos_[i] = cos(yAngle);
+    this->col_sin_[i] = sin(yAngle);
+  }
+
+  // interpolating in vertical direction
+  double pDiff = _verticalMaxAngle - _verticalMinAngle;
+  this->row_a_.resize(_verticalRangeCount);
+  this->row_b_.resize(_verticalRangeCount);
+  this->row_frac_.resize(_verticalRangeCount);
+  this->row_cos_.resize(_verticalRangeCount);
+  this->row_sin_.resize(_verticalRangeCount);
+  for (int j = 0; j < _verticalRangeCount; ++j)
+  {
+    double vb = (_verticalRangeCount == 1) ? 0 : (double) j * (_verticalRayCount - 1) / (_verticalRangeCount - 1);
+    int vja = (int) floor(vb);
+    int vjb = std::min(vja + 1, _verticalRayCount - 1);
+    this->row_a_[j] = vja * _rayCount;
+    this->row_b_[j] = vjb * _rayCount;
+    this->row_frac_[j] = vb - floor(vb);
+    double pAngle = (_verticalRayCount == 1) ? _verticalMinAngle :
+      0.5 * (vja + vjb) * pDiff / (_verticalRayCount - 1) + _verticalMinAngle;
+    this->row_cos_[j] = cos(pAngle);
+    this->row_sin_[j] = sin(pAngle);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Fill the point cloud of one scan
+void BlockLaserProjection::Fill(sensor_msgs::PointCloud2 &_msg, const double *_ranges,
+                                const double *_retros)
+{
+  if (_msg.fields.size() != 4 || _msg.fields[3].name != "intensity")
+  {
+    sensor_msgs::PointCloud2Modifier pcd_modifier(_msg);
+    pcd_modifier.setPointCloud2Fields(4,
+      "x", 1, sensor_msgs::PointField::FLOAT32,
+      "y", 1, sensor_msgs::PointField::FLOAT32,
+      "z", 1, sensor_msgs::PointField::FLOAT32,
+      "intensity", 1, sensor_msgs::PointField::FLOAT32);
+  }
+  _msg.height = this->vertical_range_count_;
+  _msg.width = this->range_count_;
+  _msg.row_step = _msg.width * _msg.point_step;
+  _msg.data.resize(static_cast<size_t>(_msg.height) * _msg.row_step);
+  // points at maximum range are kept, there are no invalid ones
+  _msg.is_dense = true;
+
+  ++this->scan_count_;
+  if (_msg.data.empty())
+    return;
+
+  this->ranges_ = _ranges;
+  this->retros_ = _retros;
+  this->cloud_ = &_msg.data[0];
+  this->pool_->ParallelFor(this->vertical_range_count_, this->fill_rows_func_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Fill a range of rows
+void BlockLaserProjection::FillRows(unsigned int _begin, unsigned int _end)
+{
+  const int cols = this->range_count_;
+  const double diffRange = this->max_range_ - this->min_range_;
+  const bool noisy = this->sigma_ > 0.0;
+
+  // x y z intensity noise of one row, generated in one batch
+  std::vector<float> noise(noisy ? 4 * static_cast<size_t>(cols) : 0);
+
+  for (unsigned int j = _begin; j < _end; ++j)
+  {
+    float *out = reinterpret_cast<float *>(this->cloud_) + 4 * static_cast<size_t>(j) * cols;
+    if (noisy)
+    {
+      NoiseGenerator gen(NoiseGenerator::SplitMix64(this->seed_ + this->scan_count_) + j);
+      gen.FillGaussian(&noise[0], noise.size(), static_cast<float>(this->sigma_));
+    }
+
+    const double *ra_ranges = this->ranges_ + this->row_a_[j];
+    const double *rb_ranges = this->ranges_ + this->row_b_[j];
+    const double *ra_retros = this->retros_ + this->row_a_[j];
+    const double *rb_retros = this->retros_ + this->row_b_[j];
+    const double vb = this->row_frac_[j];
+    const double cos_p = this->row_cos_[j];
+    const double sin_p = this->row_sin_[j];
+
+    for (int i = 0; i < cols; ++i, out += 4)
+    {
+      const int hja = this->col_a_[i];
+      const int hjb = this->col_b_[i];
+      const double hb = this->col_frac_[i];
+
+      // range readings of 4 corners
+      double r1 = std::min(ra_ranges[hja], diffRange);
+      double r2 = std::min(ra_ranges[hjb], diffRange);
+      double r3 = std::min(rb_ranges[hja], diffRange);
+      double r4 = std::min(rb_ranges[hjb], diffRange);
+
+      // Range is bilinearly interpolated between the four neighbouring
+      // rays, each clamped to the maximum range
+      double r = (1-vb)*((1 - hb) * r1 + hb * r2)
+                +   vb *((1 - hb) * r3 + hb * r4);
+
+      // Intensity is averaged
+      double intensity = 0.25*(ra_retros[hja] + ra_retros[hjb] +
+                               rb_retros[hja] + rb_retros[hjb]);
+
+      //pAngle is rotated by yAngle:
+      float x = r * cos_p * this->col_cos_[i];
+      float y = r * cos_p * this->col_sin_[i];
+      float z = r * sin_p;
+      float v = intensity;
+      if (noisy)
+      {
+        // no noise if at max range
+        if (fabs(diffRange - r) >= EPSILON_DIFF)
+        {
+          x += noise[4 * i];
+          y += noise[4 * i + 1];
+          z += noise[4 * i + 2];
+        }
+        v += noise[4 * i + 3];
+      }
+      out[0] = x;
+      out[1] = y;
+      out[2] = z;
+      out[3] = v;
+    }
+  }
+}
+}
@@ -57,6 +57,7 @@ GazeboRosBumper::GazeboRosBumper() : SensorPlugin()
 GazeboRosBumper::~GazeboRosBumper()
 {
   this->rosnode_->shutdown();
+  this->contact_queue_.Detach();
   this->callback_queue_thread_.join();
 
   delete this->rosnode_;
@@ -96,6 +97,22 @@ void GazeboRosBumper::Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf)
   else
     this->frame_name_ = _sdf->GetElement("frameName")->Get<std::string>();
 
+  this->summary_ = false;
+  if (_sdf->HasElement("contactSummary"))
+    this->summary_ = _sdf->GetElement("contactSummary")->Get<bool>();
+
+  if (_sdf->HasElement("debugInfo"))
+    this->contacts_.SetDebugInfo(_sdf->GetElement("debugInfo")->Get<bool>());
+
+  if (_sdf->HasElement("otherCollisionName"))
+    this->contacts_.SetOtherCollisionFilter(
+      _sdf->GetElement("otherCollisionName")->Get<std::string>());
+
+  std::vector<std::string> collision_names;
+  for (unsigned int i = 0; i < this->parentSensor->GetCollisionCount(); ++i)
+    collision_names.push_back(this->parentSensor->GetCollisionName(i));
+  this->contacts_.SetCollisionNames(collision_names);
+
   // Make sure the ROS node for Gazebo has already been initialized
   if (!ros::isInitialized())
   {
@@ -110,14 +127,21 @@ void GazeboRosBumper::Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf)
   std::string prefix;
   this->rosnode_->getParam(std::string("tf_prefix"), prefix);
   this->frame_name_ = tf::resolve(prefix, this->frame_name_);
+  this->contact_state_msg_.header.frame_id = this->frame_name_;
+  this->contact_summary_msg_.header.frame_id = this->frame_name_;
 
-  this->contact_pub_ = this->rosnode_->advertise<gazebo_msgs::ContactsState>(
-    std::string(this->bumper_topic_name_), 1);
+  if (this->summary_)
+    this->contact_pub_ = this->rosnode_->advertise<gazebo_msgs::ContactsSummary>(
+      std::string(this->bumper_topic_name_), 1);
+  else
+    this->contact_pub_ = this->rosnode_->advertise<gazebo_msgs::ContactsState>(
+      std::string(this->bumper_topic_name_), 1);
 
   // Initialize
   // start custom queue for contact bumper
-  this->callback_queue_thread_ = boost::thread(
-      boost::bind(&GazeboRosBumper::ContactQueueThread, this));
+  if (!this->contact_queue_.Attach(_sdf))
+    this->callback_queue_thread_ = boost::thread(
+        boost::bind(&GazeboRosBumper::ContactQueueThread, this));
 
   // Listen to the update event. This event is broadcast every
   // simulation iteration.
@@ -135,12 +159,8 @@ void GazeboRosBumper::OnContact()
   if (this->contact_pub_.getNumSubscribers() <= 0)
     return;
 
-  msgs::Contacts contacts;
-  contacts = this->parentSensor->Contacts();
-  /// \TODO: need a time for each Contact in i-loop, they may differ
-  this->contact_state_msg_.header.frame_id = this->frame_name_;
-  this->contact_state_msg_.header.stamp = ros::Time(contacts.time().sec(),
-                               contacts.time().nsec());
+  // the sensor hands out a copy, keep it the only one
+  const msgs::Contacts contacts = this->parentSensor->Contacts();
 
 /*
   /// \TODO: get frame_name_ transforms from tf or gazebo
@@ -199,119 +219,14 @@ void GazeboRosBumper::OnContact()
 
 
 
-  // set contact states size
-  this->contact_state_msg_.states.clear();
-
-  // GetContacts returns all contacts on the collision body
-  unsigned int contactsPacketSize = contacts.contact_size();
-  for (unsigned int i = 0; i < contactsPacketSize; ++i)
+  if (this->summary_)
   {
-
-    // For each collision contact
-    // Create a ContactState
-    gazebo_msgs::ContactState state;
-    /// \TODO:
-    gazebo::msgs::Contact contact = contacts.contact(i);
-
-    state.collision1_name = contact.collision1();
-    state.collision2_name = contact.collision2();
-    std::ostringstream stream;
-    stream << "Debug:  i:(" << i << "/" << contactsPacketSize
-      << ")     my geom:" << state.collision1_name
-      << "   other geom:" << state.collision2_name
-      << "         time:" << ros::Time(contact.time().sec(), contact.time().nsec())
-      << std::endl;
-    state.info = stream.str();
-
-    state.wrenches.clear();
-    state.contact_positions.clear();
-    state.contact_normals.clear();
-    state.depths.clear();
-
-    // sum up all wrenches for each DOF
-    geometry_msgs::Wrench total_wrench;
-    total_wrench.force.x = 0;
-    total_wrench.force.y = 0;
-    total_wrench.force.z = 0;
-    total_wrench.torque.x = 0;
-    total_wrench.torque.y = 0;
-    total_wrench.torque.z = 0;
-
-    unsigned int contactGroupSize = contact.position_size();
-    for (unsigned int j = 0; j < contactGroupSize; ++j)
-    {
-      // loop through individual contacts between collision1 and collision2
-      // gzerr << j << "  Position:"
-      //       << contact.position(j).x() << " "
-      //       << contact.position(j).y() << " "
-      //       << contact.position(j).z() << "\n";
-      // gzerr << "   Normal:"
-      //       << contact.normal(j).x() << " "
-      //       << contact.normal(j).y() << " "
-      //       << contact.normal(j).z() << "\n";
-      // gzerr << "   Depth:" << contact.depth(j) << "\n";
-
-      // Get force, torque and rotate into user specified frame.
-      // frame_rot is identity if world is used (default for now)
-      ignition::math::Vector3d force = frame_rot.RotateVectorReverse(ignition::math::Vector3d(
-                              contact.wrench(j).body_1_wrench().force().x(),
-                            contact.wrench(j).body_1_wrench().force().y(),
-                            contact.wrench(j).body_1_wrench().force().z()));
-      ignition::math::Vector3d torque = frame_rot.RotateVectorReverse(ignition::math::Vector3d(
-                            contact.wrench(j).body_1_wrench().torque().x(),
-                            contact.wrench(j).body_1_wrench().torque().y(),
-                            contact.wrench(j).body_1_wrench().torque().z()));
-
-      // set wrenches
-      geometry_msgs::Wrench wrench;
-      wrench.force.x  = force.X();
-      wrench.force.y  = force.Y();
-      wrench.force.z  = force.Z();
-      wrench.torque.x = torque.X();
-      wrench.torque.y = torque.Y();
-      wrench.torque.z = torque.Z();
-      state.wrenches.push_back(wrench);
-
-      total_wrench.force.x  += wrench.force.x;
-      total_wrench.force.y  += wrench.force.y;
-      total_wrench.force.z  += wrench.force.z;
-      total_wrench.torque.x += wrench.torque.x;
-      total_wrench.torque.y += wrench.torque.y;
-      total_wrench.torque.z += wrench.torque.z;
-
-      // transform contact positions into relative frame
-      // set contact positions
-      ignition::math::Vector3d position = frame_rot.RotateVectorReverse(
-          ignition::math::Vector3d(contact.position(j).x(),
-                                   contact.position(j).y(),
-                                   contact.position(j).z()) - frame_pos);
-      geometry_msgs::Vector3 contact_position;
-      contact_position.x = position.X();
-      contact_position.y = position.Y();
-      contact_position.z = position.Z();
-      state.contact_positions.push_back(contact_position);
-
-      // rotate normal into user specified frame.
-      // frame_rot is identity if world is used.
-      ignition::math::Vector3d normal = frame_rot.RotateVectorReverse(
-          ignition::math::Vector3d(contact.normal(j).x(),
-                                   contact.normal(j).y(),
-                                   contact.normal(j).z()));
-      // set contact normals
-      geometry_msgs::Vector3 contact_normal;
-      contact_normal.x = normal.X();
-      contact_normal.y = normal.Y();
-      contact_normal.z = normal.Z();
-      state.contact_normals.push_back(contact_normal);
-
-      // set contact depth, interpenetration
-      state.depths.push_back(contact.depth(j));
-    }
-
-    state.total_wrench = total_wrench;
-    this->contact_state_msg_.states.push_back(state);
+    this->contacts_.FillSummary(this->contact_summary_msg_, contacts, frame_pos, frame_rot);
+    this->contact_pub_.publish(this->contact_summary_msg_);
+    return;
   }
 
+  this->contacts_.Fill(this->contact_state_msg_, contacts, frame_pos, frame_rot);
   this->contact_pub_.publish(this->contact_state_msg_);
 }
 
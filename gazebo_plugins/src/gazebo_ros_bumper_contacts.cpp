@@ -0,0 +1,322 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gazebo_plugins/gazebo_ros_bumper_contacts.h>
+
+namespace gazebo
+{
+////////////////////////////////////////////////////////////////////////////////
+// Next state of the message, growing it with a state set aside if any
+template <typename State>
+static State &NextState(std::vector<State> &_states, size_t &_count,
+                        std::vector<State> &_spare)
+{
+  if (_count == _states.size())
+  {
+    _states.resize(_count + 1);
+    if (!_spare.empty())
+    {
+      std::swap(_states.back(), _spare.back());
+      _spare.pop_back();
+    }
+  }
+  return _states[_count++];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Shrink the message to _count states, setting the others aside
+template <typename State>
+static void Truncate(std::vector<State> &_states, size_t _count,
+                     std::vector<State> &_spare)
+{
+  while (_states.size() > _count)
+  {
+    _spare.push_back(State());
+    std::swap(_spare.back(), _states.back());
+    _states.pop_back();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+BumperContacts::BumperContacts()
+  : debug_info_(false)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BumperContacts::SetCollisionNames(const std::vector<std::string> &_names)
+{
+  this->collision_names_ = _names;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BumperContacts::SetOtherCollisionFilter(const std::string &_filter)
+{
+  this->other_collision_filter_ = _filter;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void BumperContacts::SetDebugInfo(bool _debug_info)
+{
+  this->debug_info_ = _debug_info;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Fill a state per contact
+void BumperContacts::Fill(gazebo_msgs::ContactsState &_msg,
+    const msgs::Contacts &_contacts,
+    const ignition::math::Vector3d &_frame_pos,
+    const ignition::math::Quaterniond &_frame_rot)
+{
+  /// \TODO: need a time for each Contact in i-loop, they may differ
+  _msg.header.stamp = ros::Time(_contacts.time().sec(), _contacts.time().nsec());
+
+  std::vector<gazebo_msgs::ContactState> &states = _msg.states;
+  size_t state_count = 0;
+
+  // GetContacts returns all contacts on the collision body
+  unsigned int contactsPacketSize = _contacts.contact_size();
+  for (unsigned int i = 0; i < contactsPacketSize; ++i)
+  {
+    const gazebo::msgs::Contact &contact = _contacts.contact(i);
+    if (!this->Accept(contact))
+      continue;
+
+    // For each collision contact
+    // Create a ContactState
+    gazebo_msgs::ContactState &state =
+      NextState(states, state_count, this->spare_states_);
+
+    state.collision1_name = contact.collision1();
+    state.collision2_name = contact.collision2();
+    if (this->debug_info_)
+    {
+      std::ostringstream stream;
+      stream << "Debug:  i:(" << i << "/" << contactsPacketSize
+        << ")     my geom:" << state.collision1_name
+        << "   other geom:" << state.collision2_name
+        << "         time:" << ros::Time(contact.time().sec(), contact.time().nsec())
+        << std::endl;
+      state.info = stream.str();
+    }
+    else
+      state.info.clear();
+
+    unsigned int contactGroupSize = contact.position_size();
+    state.wrenches.resize(contactGroupSize);
+    state.contact_positions.resize(contactGroupSize);
+    state.contact_normals.resize(contactGroupSize);
+    state.depths.resize(contactGroupSize);
+
+    // sum up all wrenches for each DOF
+    geometry_msgs::Wrench &total_wrench = state.total_wrench;
+    total_wrench.force.x = 0;
+    total_wrench.force.y = 0;
+    total_wrench.force.z = 0;
+    total_wrench.torque.x = 0;
+    total_wrench.torque.y = 0;
+    total_wrench.torque.z = 0;
+
+    for (unsigned int j = 0; j < contactGroupSize; ++j)
+    {
+      // loop through individual contacts between collision1 and collision2
+      // gzerr << j << "  Position:"
+      //       << contact.position(j).x() << " "
+      //       << contact.position(j).y() << " "
+      //       << contact.position(j).z() << "\n";
+      // gzerr << "   Normal:"
+      //       << contact.normal(j).x() << " "
+      //       << contact.normal(j).y() << " "
+      //       << contact.normal(j).z() << "\n";
+      // gzerr << "   Depth:" << contact.depth(j) << "\n";
+
+      // Get force, torque and rotate into user specified frame.
+      // frame_rot is identity if world is used (default for now)
+      const msgs::Wrench &body_1_wrench = contact.wrench(j).body_1_wrench();
+      ignition::math::Vector3d force = _frame_rot.RotateVectorReverse(ignition::math::Vector3d(
+                            body_1_wrench.force().x(),
+                            body_1_wrench.force().y(),
+                            body_1_wrench.force().z()));
+      ignition::math::Vector3d torque = _frame_rot.RotateVectorReverse(ignition::math::Vector3d(
+                            body_1_wrench.torque().x(),
+                            body_1_wrench.torque().y(),
+                            body_1_wrench.torque().z()));
+
+      // set wrenches
+      geometry_msgs::Wrench &wrench = state.wrenches[j];
+      wrench.force.x  = force.X();
+      wrench.force.y  = force.Y();
+      wrench.force.z  = force.Z();
+      wrench.torque.x = torque.X();
+      wrench.torque.y = torque.Y();
+      wrench.torque.z = torque.Z();
+
+      total_wrench.force.x  += wrench.force.x;
+      total_wrench.force.y  += wrench.force.y;
+      total_wrench.force.z  += wrench.force.z;
+      total_wrench.torque.x += wrench.torque.x;
+      total_wrench.torque.y += wrench.torque.y;
+      total_wrench.torque.z += wrench.torque.z;
+
+      // transform contact positions into relative frame
+      // set contact positions
+      ignition::math::Vector3d position = _frame_rot.RotateVectorReverse(
+          ignition::math::Vector3d(contact.position(j).x(),
+                                   contact.position(j).y(),
+                                   contact.position(j).z()) - _frame_pos);
+      geometry_msgs::Vector3 &contact_position = state.contact_positions[j];
+      contact_position.x = position.X();
+      contact_position.y = position.Y();
+      contact_position.z = position.Z();
+
+      // rotate normal into user specified frame.
+      // frame_rot is identity if world is used.
+      ignition::math::Vector3d normal = _frame_rot.RotateVectorReverse(
+          ignition::math::Vector3d(contact.normal(j).x(),
+                                   contact.normal(j).y(),
+                                   contact.normal(j).z()));
+      // set contact normals
+      geometry_msgs::Vector3 &contact_normal = state.contact_normals[j];
+      contact_normal.x = normal.X();
+      contact_normal.y = normal.Y();
+      contact_normal.z = normal.Z();
+
+      // set contact depth, interpenetration
+      state.depths[j] = contact.depth(j);
+    }
+  }
+  Truncate(states, state_count, this->spare_states_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Fill the totals and the deepest point of each collision pair
+void BumperContacts::FillSummary(gazebo_msgs::ContactsSummary &_msg,
+    const msgs::Contacts &_contacts,
+    const ignition::math::Vector3d &_frame_pos,
+    const ignition::math::Quaterniond &_frame_rot)
+{
+  _msg.header.stamp = ros::Time(_contacts.time().sec(), _contacts.time().nsec());
+
+  std::vector<gazebo_msgs::ContactSummary> &states = _msg.states;
+  size_t state_count = 0;
+
+  for (int i = 0; i < _contacts.contact_size(); ++i)
+  {
+    const gazebo::msgs::Contact &contact = _contacts.contact(i);
+    if (!this->Accept(contact))
+      continue;
+
+    // The sensor reports every physics step since its last update, a pair
+    // can come up once per step.  Its summary is that of the latest step,
+    // a scan is enough for the few pairs of a bumper.
+    const ros::Time time(contact.time().sec(), contact.time().nsec());
+    size_t k = 0;
+    while (k < state_count &&
+           (states[k].collision1_name != contact.collision1() ||
+            states[k].collision2_name != contact.collision2()))
+      ++k;
+    if (k < state_count && time < this->summary_stamps_[k])
+      continue;
+    if (k == state_count)
+    {
+      NextState(states, state_count, this->spare_summaries_);
+      if (this->summary_stamps_.size() < state_count)
+        this->summary_stamps_.resize(state_count);
+      states[k].collision1_name = contact.collision1();
+      states[k].collision2_name = contact.collision2();
+    }
+    this->summary_stamps_[k] = time;
+
+    gazebo_msgs::ContactSummary &state = states[k];
+    state.contact_count = contact.position_size();
+    ignition::math::Vector3d force, torque;
+    int deepest = -1;
+    for (int j = 0; j < contact.position_size(); ++j)
+    {
+      const msgs::Wrench &body_1_wrench = contact.wrench(j).body_1_wrench();
+      force += ignition::math::Vector3d(body_1_wrench.force().x(),
+                                        body_1_wrench.force().y(),
+                                        body_1_wrench.force().z());
+      torque += ignition::math::Vector3d(body_1_wrench.torque().x(),
+                                         body_1_wrench.torque().y(),
+                                         body_1_wrench.torque().z());
+      if (deepest < 0 || contact.depth(j) > contact.depth(deepest))
+        deepest = j;
+    }
+
+    // the rotation is linear, rotate the sums rather than every wrench
+    force = _frame_rot.RotateVectorReverse(force);
+    torque = _frame_rot.RotateVectorReverse(torque);
+    state.total_wrench.force.x = force.X();
+    state.total_wrench.force.y = force.Y();
+    state.total_wrench.force.z = force.Z();
+    state.total_wrench.torque.x = torque.X();
+    state.total_wrench.torque.y = torque.Y();
+    state.total_wrench.torque.z = torque.Z();
+
+    if (deepest < 0)
+    {
+      state.deepest_position = geometry_msgs::Vector3();
+      state.deepest_normal = geometry_msgs::Vector3();
+      state.deepest_depth = 0;
+      continue;
+    }
+    ignition::math::Vector3d position = _frame_rot.RotateVectorReverse(
+        ignition::math::Vector3d(contact.position(deepest).x(),
+                                 contact.position(deepest).y(),
+                                 contact.position(deepest).z()) - _frame_pos);
+    ignition::math::Vector3d normal = _frame_rot.RotateVectorReverse(
+        ignition::math::Vector3d(contact.normal(deepest).x(),
+                                 contact.normal(deepest).y(),
+                                 contact.normal(deepest).z()));
+    state.deepest_position.x = position.X();
+    state.deepest_position.y = position.Y();
+    state.deepest_position.z = position.Z();
+    state.deepest_normal.x = normal.X();
+    state.deepest_normal.y = normal.Y();
+    state.deepest_normal.z = normal.Z();
+    state.deepest_depth = contact.depth(deepest);
+  }
+  Truncate(states, state_count, this->spare_summaries_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Filter contacts on the name of the collision the sensor touches
+bool BumperContacts::Accept(const msgs::Contact &_contact) const
+{
+  if (this->other_collision_filter_.empty())
+    return true;
+
+  // either side of a contact may be the sensor collision
+  const std::string *other = &_contact.collision2();
+  for (size_t i = 0; i < this->collision_names_.size(); ++i)
+  {
+    if (this->collision_names_[i] == *other)
+    {
+      other = &_contact.collision1();
+      break;
+    }
+  }
+  return other->compare(0, this->other_collision_filter_.size(),
+                        this->other_collision_filter_) == 0;
+}
+}
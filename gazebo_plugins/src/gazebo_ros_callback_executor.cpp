@@ -0,0 +1,288 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <boost/bind.hpp>
+
+#include <gazebo_plugins/gazebo_ros_callback_executor.h>
+
+namespace gazebo
+{
+/// \brief Back off of a queue whose callbacks returned TryAgain, the 1 ms
+/// the queue threads used to poll with.
+static const boost::posix_time::milliseconds TRY_AGAIN_DELAY(1);
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+SharedCallbackQueue::SharedCallbackQueue()
+  : executor_(NULL), scheduled_(false), running_(false), dirty_(false),
+    retry_(false), removed_(false)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destructor
+SharedCallbackQueue::~SharedCallbackQueue()
+{
+  this->Detach();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Attach to the shared executor unless the plugin opts out
+bool SharedCallbackQueue::Attach(sdf::ElementPtr _sdf)
+{
+  if (_sdf && _sdf->HasElement("callbackQueueThread") &&
+      _sdf->Get<bool>("callbackQueueThread"))
+    return false;
+
+  this->Attach(CallbackQueueExecutor::Instance());
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Attach to an executor
+void SharedCallbackQueue::Attach(CallbackQueueExecutor &_executor)
+{
+  this->Detach();
+
+  boost::mutex::scoped_lock lock(this->attach_mutex_);
+  this->executor_ = &_executor;
+  // callbacks may have arrived before
+  if (!this->isEmpty())
+    _executor.Notify(this);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Detach from the executor
+void SharedCallbackQueue::Detach()
+{
+  CallbackQueueExecutor *executor;
+  {
+    boost::mutex::scoped_lock lock(this->attach_mutex_);
+    executor = this->executor_;
+    this->executor_ = NULL;
+  }
+
+  // not under attach_mutex_, the running callbacks may add new ones
+  if (executor)
+    executor->Remove(this);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Queue a callback and wake the executor
+void SharedCallbackQueue::addCallback(const ros::CallbackInterfacePtr &_callback,
+                                      uint64_t _removal_id)
+{
+  ros::CallbackQueue::addCallback(_callback, _removal_id);
+
+  boost::mutex::scoped_lock lock(this->attach_mutex_);
+  if (this->executor_)
+    this->executor_->Notify(this);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+CallbackQueueExecutor::CallbackQueueExecutor(unsigned int _threads)
+  : dispatches_(0), shutdown_(false)
+{
+  if (_threads == 0)
+  {
+    // callbacks are short, a few threads serve many plugins
+    _threads = std::max(1u, std::min(4u, boost::thread::hardware_concurrency()));
+  }
+
+  for (unsigned int i = 0; i < _threads; ++i)
+    this->threads_.push_back(
+      new boost::thread(boost::bind(&CallbackQueueExecutor::Run, this)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destructor
+CallbackQueueExecutor::~CallbackQueueExecutor()
+{
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    this->shutdown_ = true;
+  }
+  this->work_cond_.notify_all();
+
+  for (unsigned int i = 0; i < this->threads_.size(); ++i)
+  {
+    this->threads_[i]->join();
+    delete this->threads_[i];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Executor shared by all plugins
+CallbackQueueExecutor &CallbackQueueExecutor::Instance()
+{
+  static CallbackQueueExecutor executor(
+    getenv("GAZEBO_ROS_CALLBACK_THREADS") ?
+    std::max(0, atoi(getenv("GAZEBO_ROS_CALLBACK_THREADS"))) : 0);
+  return executor;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Number of threads
+unsigned int CallbackQueueExecutor::Size() const
+{
+  return this->threads_.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Number of times a queue was served
+unsigned long CallbackQueueExecutor::Dispatches() const
+{
+  boost::mutex::scoped_lock lock(this->mutex_);
+  return this->dispatches_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Schedule a queue that got callbacks
+void CallbackQueueExecutor::Notify(SharedCallbackQueue *_queue)
+{
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    // attached again
+    _queue->removed_ = false;
+    if (_queue->running_)
+    {
+      // the thread serving it schedules it again when done
+      _queue->dirty_ = true;
+      return;
+    }
+    if (_queue->scheduled_ && !_queue->retry_)
+      return;
+    if (_queue->retry_)
+    {
+      // new callbacks do not wait for the back off
+      this->delayed_.erase(std::remove(this->delayed_.begin(), this->delayed_.end(),
+                                       _queue), this->delayed_.end());
+      _queue->retry_ = false;
+    }
+    _queue->scheduled_ = true;
+    this->ready_.push_back(_queue);
+  }
+  this->work_cond_.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Stop scheduling a queue
+void CallbackQueueExecutor::Remove(SharedCallbackQueue *_queue)
+{
+  boost::mutex::scoped_lock lock(this->mutex_);
+  if (_queue->running_ && _queue->runner_ == boost::this_thread::get_id())
+  {
+    // called from one of its own callbacks, which we would wait for forever;
+    // the thread running it leaves it unscheduled instead
+    _queue->removed_ = true;
+    _queue->dirty_ = false;
+    return;
+  }
+  while (_queue->running_)
+    this->done_cond_.wait(lock);
+  // after the wait, the thread which ran it may have scheduled it again
+  this->ready_.erase(std::remove(this->ready_.begin(), this->ready_.end(),
+                                 _queue), this->ready_.end());
+  this->delayed_.erase(std::remove(this->delayed_.begin(), this->delayed_.end(),
+                                   _queue), this->delayed_.end());
+  _queue->scheduled_ = false;
+  _queue->dirty_ = false;
+  _queue->retry_ = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Move the queues whose back off is over to the ready queues
+void CallbackQueueExecutor::PromoteDelayed()
+{
+  if (this->delayed_.empty())
+    return;
+  boost::system_time now = boost::get_system_time();
+  while (!this->delayed_.empty() && this->delayed_.front()->retry_time_ <= now)
+  {
+    this->delayed_.front()->retry_ = false;
+    this->ready_.push_back(this->delayed_.front());
+    this->delayed_.pop_front();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Thread main loop
+void CallbackQueueExecutor::Run()
+{
+  boost::mutex::scoped_lock lock(this->mutex_);
+  while (true)
+  {
+    while (!this->shutdown_)
+    {
+      this->PromoteDelayed();
+      if (!this->ready_.empty())
+        break;
+      if (this->delayed_.empty())
+        this->work_cond_.wait(lock);
+      else
+        this->work_cond_.timed_wait(lock, this->delayed_.front()->retry_time_);
+    }
+    if (this->shutdown_)
+      return;
+
+    SharedCallbackQueue *queue = this->ready_.front();
+    this->ready_.pop_front();
+    queue->running_ = true;
+    queue->runner_ = boost::this_thread::get_id();
+    queue->dirty_ = false;
+
+    // callbacks present now, without waiting for more
+    lock.unlock();
+    queue->callAvailable(ros::WallDuration());
+    lock.lock();
+
+    queue->running_ = false;
+    queue->runner_ = boost::thread::id();
+    ++this->dispatches_;
+
+    if (queue->removed_)
+    {
+      // detached by one of its callbacks
+      queue->removed_ = false;
+      queue->scheduled_ = false;
+    }
+    else if (queue->dirty_)
+    {
+      // new callbacks arrived meanwhile, behind the other ready queues
+      queue->dirty_ = false;
+      this->ready_.push_back(queue);
+    }
+    else if (!queue->isEmpty() && queue->isEnabled())
+    {
+      // only callbacks that asked to be tried again are left, serving them
+      // right away would spin until they succeed
+      queue->retry_ = true;
+      queue->retry_time_ = boost::get_system_time() + TRY_AGAIN_DELAY;
+      this->delayed_.push_back(queue);
+    }
+    else
+    {
+      queue->scheduled_ = false;
+    }
+    this->done_cond_.notify_all();
+  }
+}
+}
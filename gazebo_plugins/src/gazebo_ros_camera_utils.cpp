@@ -77,6 +77,7 @@ GazeboRosCameraUtils::~GazeboRosCameraUtils()
   this->rosnode_->shutdown();
   this->camera_queue_.clear();
   this->camera_queue_.disable();
+  this->camera_queue_.Detach();
   this->callback_queue_thread_.join();
   delete this->rosnode_;
 }
@@ -648,8 +649,9 @@ void GazeboRosCameraUtils::Init()
   this->camera_info_manager_->setCameraInfo(camera_info_msg);
 
   // start custom queue for camera_
-  this->callback_queue_thread_ = boost::thread(
-    boost::bind(&GazeboRosCameraUtils::CameraQueueThread, this));
+  if (!this->camera_queue_.Attach(this->sdf))
+    this->callback_queue_thread_ = boost::thread(
+      boost::bind(&GazeboRosCameraUtils::CameraQueueThread, this));
 
   load_event_();
   this->initialized_ = true;
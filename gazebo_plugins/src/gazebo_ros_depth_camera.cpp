@@ -46,6 +46,7 @@ GazeboRosDepthCamera::GazeboRosDepthCamera()
 {
   this->point_cloud_connect_count_ = 0;
   this->depth_image_connect_count_ = 0;
+  this->depth_image_zero_copy_ = false;
   this->depth_info_connect_count_ = 0;
   this->last_depth_image_camera_info_update_time_ = common::Time(0);
 }
@@ -106,6 +107,22 @@ void GazeboRosDepthCamera::Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf
   else
     this->point_cloud_cutoff_ = _sdf->GetElement("pointCloudCutoff")->Get<double>();
 
+  // publish depth images from a recycled message pool by pointer, so that
+  // intraprocess subscribers receive them without serialization
+  if (!_sdf->HasElement("depthImageZeroCopy"))
+    this->depth_image_zero_copy_ = false;
+  else
+    this->depth_image_zero_copy_ = _sdf->GetElement("depthImageZeroCopy")->Get<bool>();
+
+  // number of threads converting depth frames to point clouds, 0 = auto
+  if (_sdf->HasElement("pointCloudThreads"))
+    this->depth_projection_.SetThreads(
+      _sdf->GetElement("pointCloudThreads")->Get<unsigned int>());
+  else
+    this->depth_projection_.SetThreads(0);
+  this->depth_projection_.SetCutoff(this->point_cloud_cutoff_,
+                                    std::numeric_limits<double>::infinity());
+
   load_connection_ = GazeboRosCameraUtils::OnLoad(boost::bind(&GazeboRosDepthCamera::Advertise, this));
   GazeboRosCameraUtils::Load(_parent, _sdf);
 }
@@ -344,6 +361,25 @@ void GazeboRosDepthCamera::FillPointdCloud(const float *_src)
 // Put depth image data to the interface
 void GazeboRosDepthCamera::FillDepthImage(const float *_src)
 {
+  if (this->depth_image_zero_copy_)
+  {
+    // the pooled message is not shared with anyone until it is published,
+    // so it can be filled without holding lock_
+    sensor_msgs::ImagePtr depth_image_msg = this->depth_image_pool_.Acquire();
+    depth_image_msg->header.frame_id = this->frame_name_;
+    depth_image_msg->header.stamp.sec = this->depth_sensor_update_time_.sec;
+    depth_image_msg->header.stamp.nsec = this->depth_sensor_update_time_.nsec;
+
+    FillDepthImageHelper(*depth_image_msg,
+                   this->height,
+                   this->width,
+                   this->skip_,
+                   (void*)_src );
+
+    this->depth_image_pub_.publish(depth_image_msg);
+    return;
+  }
+
   this->lock_.lock();
   // copy data into image
   this->depth_image_msg_.header.frame_id = this->frame_name_;
@@ -369,79 +405,13 @@ bool GazeboRosDepthCamera::FillPointCloudHelper(
     uint32_t rows_arg, uint32_t cols_arg,
     uint32_t step_arg, void* data_arg)
 {
-  sensor_msgs::PointCloud2Modifier pcd_modifier(point_cloud_msg);
-  pcd_modifier.setPointCloud2FieldsByString(2, "xyz", "rgb");
-  pcd_modifier.resize(rows_arg*cols_arg);
-
-  sensor_msgs::PointCloud2Iterator<float> iter_x(point_cloud_msg_, "x");
-  sensor_msgs::PointCloud2Iterator<float> iter_y(point_cloud_msg_, "y");
-  sensor_msgs::PointCloud2Iterator<float> iter_z(point_cloud_msg_, "z");
-  sensor_msgs::PointCloud2Iterator<uint8_t> iter_rgb(point_cloud_msg_, "rgb");
+  // ray tables are only rebuilt when the resolution or hfov changes
+  this->depth_projection_.SetGeometry(rows_arg, cols_arg,
+    this->parentSensor->DepthCamera()->HFOV().Radian());
 
-  point_cloud_msg.is_dense = true;
-
-  float* toCopyFrom = (float*)data_arg;
-  int index = 0;
-
-  double hfov = this->parentSensor->DepthCamera()->HFOV().Radian();
-  double fl = ((double)this->width) / (2.0 *tan(hfov/2.0));
-
-  // convert depth to point cloud
-  for (uint32_t j=0; j<rows_arg; j++)
-  {
-    double pAngle;
-    if (rows_arg>1) pAngle = atan2( (double)j - 0.5*(double)(rows_arg-1), fl);
-    else            pAngle = 0.0;
-
-    for (uint32_t i=0; i<cols_arg; i++, ++iter_x, ++iter_y, ++iter_z, ++iter_rgb)
-    {
-      double yAngle;
-      if (cols_arg>1) yAngle = atan2( (double)i - 0.5*(double)(cols_arg-1), fl);
-      else            yAngle = 0.0;
-
-      double depth = toCopyFrom[index++];
-
-      // in optical frame
-      // hardcoded rotation rpy(-M_PI/2, 0, -M_PI/2) is built-in
-      // to urdf, where the *_optical_frame should have above relative
-      // rotation from the physical camera *_frame
-      *iter_x      = depth * tan(yAngle);
-      *iter_y      = depth * tan(pAngle);
-      if(depth > this->point_cloud_cutoff_)
-      {
-        *iter_z    = depth;
-      }
-      else //point in the unseeable range
-      {
-        *iter_x = *iter_y = *iter_z = std::numeric_limits<float>::quiet_NaN ();
-        point_cloud_msg.is_dense = false;
-      }
-
-      // put image color data for each point
-      uint8_t*  image_src = (uint8_t*)(&(this->image_msg_.data[0]));
-      if (this->image_msg_.data.size() == rows_arg*cols_arg*3)
-      {
-        // color
-        iter_rgb[0] = image_src[i*3+j*cols_arg*3+0];
-        iter_rgb[1] = image_src[i*3+j*cols_arg*3+1];
-        iter_rgb[2] = image_src[i*3+j*cols_arg*3+2];
-      }
-      else if (this->image_msg_.data.size() == rows_arg*cols_arg)
-      {
-        // mono (or bayer?  @todo; fix for bayer)
-        iter_rgb[0] = image_src[i+j*cols_arg];
-        iter_rgb[1] = image_src[i+j*cols_arg];
-        iter_rgb[2] = image_src[i+j*cols_arg];
-      }
-      else
-      {
-        // no image
-        iter_rgb[0] = 0;
-        iter_rgb[1] = 0;
-        iter_rgb[2] = 0;
-      }
-    }
-  }
+  point_cloud_msg.is_dense = this->depth_projection_.Fill(point_cloud_msg,
+                                        (const float*)data_arg,
+                                        this->image_msg_.data);
 
   return true;
 }
@@ -462,25 +432,16 @@ bool GazeboRosDepthCamera::FillDepthImageHelper(
   const float bad_point = std::numeric_limits<float>::quiet_NaN();
 
   float* dest = (float*)(&(image_msg.data[0]));
-  float* toCopyFrom = (float*)data_arg;
-  int index = 0;
+  const float* toCopyFrom = (const float*)data_arg;
+  const float cutoff = this->point_cloud_cutoff_;
+  const uint32_t size = rows_arg * cols_arg;
 
-  // convert depth to point cloud
-  for (uint32_t j = 0; j < rows_arg; j++)
+  // single pass with a select instead of a branch so it vectorizes,
+  // points in the unseeable range become NaN
+  for (uint32_t index = 0; index < size; index++)
   {
-    for (uint32_t i = 0; i < cols_arg; i++)
-    {
-      float depth = toCopyFrom[index++];
-
-      if (depth > this->point_cloud_cutoff_)
-      {
-        dest[i + j * cols_arg] = depth;
-      }
-      else //point in the unseeable range
-      {
-        dest[i + j * cols_arg] = bad_point;
-      }
-    }
+    const float depth = toCopyFrom[index];
+    dest[index] = depth > cutoff ? depth : bad_point;
   }
   return true;
 }
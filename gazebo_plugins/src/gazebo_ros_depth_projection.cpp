@@ -0,0 +1,281 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <boost/bind.hpp>
+
+#include <sensor_msgs/point_cloud2_iterator.h>
+
+#include <gazebo_plugins/gazebo_ros_depth_projection.h>
+
+namespace gazebo
+{
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+DepthProjection::DepthProjection()
+  : rows_(0), cols_(0), hfov_(0.0), depth_(NULL), image_(NULL),
+    image_channels_(0), cloud_(NULL), point_step_(0), rgb_offset_(0)
+{
+  this->SetCutoff(0.0, std::numeric_limits<double>::infinity());
+  this->fill_rows_func_ = boost::bind(&DepthProjection::FillRows, this, _1, _2);
+  this->pool_.reset(new WorkerPool(1));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destructor
+DepthProjection::~DepthProjection()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Set the number of threads
+void DepthProjection::SetThreads(unsigned int _threads)
+{
+  this->pool_.reset(new WorkerPool(_threads));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Set the valid depth range
+void DepthProjection::SetCutoff(double _min, double _max)
+{
+  this->cutoff_min_ = static_cast<float>(_min);
+  // the kernels test depth <= cutoff_max_ so that an infinite maximum still
+  // accepts infinite depths, step down one float to keep the bound exclusive
+  if (std::isinf(_max))
+    this->cutoff_max_ = std::numeric_limits<float>::infinity();
+  else
+    this->cutoff_max_ = std::nextafter(static_cast<float>(_max),
+                                       -std::numeric_limits<float>::infinity());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Rebuild the ray tables if needed
+void DepthProjection::SetGeometry(uint32_t _rows, uint32_t _cols, double _hfov)
+{
+  if (_rows == this->rows_ && _cols == this->cols_ && _hfov == this->hfov_)
+    return;
+
+  this->rows_ = _rows;
+  this->cols_ = _cols;
+  this->hfov_ = _hfov;
+
+  // tan(atan2(p, fl)) == p / fl, so the tables hold the ray slope directly
+  double fl = static_cast<double>(_cols) / (2.0 * tan(_hfov / 2.0));
+
+  this->row_tan_.resize(_rows);
+  for (uint32_t j = 0; j < _rows; ++j)
+  {
+    if (_rows > 1)
+      this->row_tan_[j] = (static_cast<double>(j) - 0.5 * (_rows - 1)) / fl;
+    else
+      this->row_tan_[j] = 0.0f;
+  }
+
+  this->col_tan_.resize(_cols);
+  for (uint32_t i = 0; i < _cols; ++i)
+  {
+    if (_cols > 1)
+      this->col_tan_[i] = (static_cast<double>(i) - 0.5 * (_cols - 1)) / fl;
+    else
+      this->col_tan_[i] = 0.0f;
+  }
+
+  this->row_dense_.resize(_rows);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Fill a point cloud from a depth frame
+bool DepthProjection::Fill(sensor_msgs::PointCloud2 &_msg, const float *_depth,
+                           const std::vector<uint8_t> &_image)
+{
+  sensor_msgs::PointCloud2Modifier pcd_modifier(_msg);
+  if (_msg.fields.size() != 4 || _msg.fields[3].name != "rgb")
+    pcd_modifier.setPointCloud2FieldsByString(2, "xyz", "rgb");
+  // flat array shape, callers reshape the cloud if they want it organized
+  pcd_modifier.resize(this->rows_ * this->cols_);
+
+  size_t pixels = static_cast<size_t>(this->rows_) * this->cols_;
+  if (pixels == 0)
+    return true;
+
+  // the image layout is resolved once per frame instead of once per pixel
+  this->image_ = _image.empty() ? NULL : &_image[0];
+  if (_image.size() == pixels * 3)
+    this->image_channels_ = 3;
+  else if (_image.size() == pixels)
+    this->image_channels_ = 1;
+  else
+    this->image_channels_ = 0;
+
+  this->depth_ = _depth;
+  this->cloud_ = &_msg.data[0];
+  this->point_step_ = _msg.point_step;
+  this->rgb_offset_ = _msg.fields[3].offset;
+
+  this->pool_->ParallelFor(this->rows_, this->fill_rows_func_);
+
+  for (uint32_t j = 0; j < this->rows_; ++j)
+  {
+    if (!this->row_dense_[j])
+      return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Fill a range of rows
+void DepthProjection::FillRows(unsigned int _begin, unsigned int _end)
+{
+  const float bad_point = std::numeric_limits<float>::quiet_NaN();
+  const float *col_tan = &this->col_tan_[0];
+  const uint32_t cols = this->cols_;
+
+  // the SIMD kernels store [x y z pad] as one 16 byte vector per point
+  const bool packed_xyz = this->point_step_ == 8 * sizeof(float);
+
+  for (unsigned int j = _begin; j < _end; ++j)
+  {
+    const float *depth = this->depth_ + static_cast<size_t>(j) * cols;
+    uint8_t *row = this->cloud_ + static_cast<size_t>(j) * cols *
+      this->point_step_;
+    const float row_tan = this->row_tan_[j];
+    bool dense = true;
+    uint32_t i = 0;
+
+    // in optical frame
+    // hardcoded rotation rpy(-M_PI/2, 0, -M_PI/2) is built-in
+    // to urdf, where the *_optical_frame should have above relative
+    // rotation from the physical camera *_frame
+    if (packed_xyz)
+    {
+      float *out = reinterpret_cast<float *>(row);
+#if defined(__AVX__)
+      const __m256 vmin = _mm256_set1_ps(this->cutoff_min_);
+      const __m256 vmax = _mm256_set1_ps(this->cutoff_max_);
+      const __m256 vnan = _mm256_set1_ps(bad_point);
+      const __m256 vty = _mm256_set1_ps(row_tan);
+      for (; i + 8 <= cols; i += 8)
+      {
+        __m256 d = _mm256_loadu_ps(depth + i);
+        __m256 valid = _mm256_and_ps(_mm256_cmp_ps(d, vmin, _CMP_GT_OQ),
+                                     _mm256_cmp_ps(d, vmax, _CMP_LE_OQ));
+        dense = dense && _mm256_movemask_ps(valid) == 0xFF;
+
+        __m256 x = _mm256_mul_ps(d, _mm256_loadu_ps(col_tan + i));
+        __m256 y = _mm256_mul_ps(d, vty);
+        x = _mm256_blendv_ps(vnan, x, valid);
+        y = _mm256_blendv_ps(vnan, y, valid);
+        __m256 z = _mm256_blendv_ps(vnan, d, valid);
+
+        for (int half = 0; half < 2; ++half)
+        {
+          __m128 px = half ? _mm256_extractf128_ps(x, 1) : _mm256_castps256_ps128(x);
+          __m128 py = half ? _mm256_extractf128_ps(y, 1) : _mm256_castps256_ps128(y);
+          __m128 pz = half ? _mm256_extractf128_ps(z, 1) : _mm256_castps256_ps128(z);
+          __m128 pw = _mm_setzero_ps();
+          _MM_TRANSPOSE4_PS(px, py, pz, pw);
+          float *p = out + 8 * (i + 4 * half);
+          _mm_storeu_ps(p, px);
+          _mm_storeu_ps(p + 8, py);
+          _mm_storeu_ps(p + 16, pz);
+          _mm_storeu_ps(p + 24, pw);
+        }
+      }
+#elif defined(__SSE2__)
+      const __m128 vmin = _mm_set1_ps(this->cutoff_min_);
+      const __m128 vmax = _mm_set1_ps(this->cutoff_max_);
+      const __m128 vnan = _mm_set1_ps(bad_point);
+      const __m128 vty = _mm_set1_ps(row_tan);
+      for (; i + 4 <= cols; i += 4)
+      {
+        __m128 d = _mm_loadu_ps(depth + i);
+        __m128 valid = _mm_and_ps(_mm_cmpgt_ps(d, vmin), _mm_cmple_ps(d, vmax));
+        dense = dense && _mm_movemask_ps(valid) == 0xF;
+
+        __m128 x = _mm_mul_ps(d, _mm_loadu_ps(col_tan + i));
+        __m128 y = _mm_mul_ps(d, vty);
+        x = _mm_or_ps(_mm_and_ps(valid, x), _mm_andnot_ps(valid, vnan));
+        y = _mm_or_ps(_mm_and_ps(valid, y), _mm_andnot_ps(valid, vnan));
+        __m128 z = _mm_or_ps(_mm_and_ps(valid, d), _mm_andnot_ps(valid, vnan));
+        __m128 w = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        float *p = out + 8 * i;
+        _mm_storeu_ps(p, x);
+        _mm_storeu_ps(p + 8, y);
+        _mm_storeu_ps(p + 16, z);
+        _mm_storeu_ps(p + 24, w);
+      }
+#endif
+    }
+
+    // scalar tail, or the whole row without SIMD support
+    for (; i < cols; ++i)
+    {
+      float d = depth[i];
+      float *p = reinterpret_cast<float *>(row + i * this->point_step_);
+      if (d > this->cutoff_min_ && d <= this->cutoff_max_)
+      {
+        p[0] = d * col_tan[i];
+        p[1] = d * row_tan;
+        p[2] = d;
+      }
+      else  // point in the unseeable range
+      {
+        p[0] = p[1] = p[2] = bad_point;
+        dense = false;
+      }
+    }
+
+    // put image color data for each point
+    uint8_t *rgb = row + this->rgb_offset_;
+    if (this->image_channels_ == 3)
+    {
+      const uint8_t *src = this->image_ + static_cast<size_t>(j) * cols * 3;
+      for (i = 0; i < cols; ++i, rgb += this->point_step_, src += 3)
+      {
+        rgb[0] = src[0];
+        rgb[1] = src[1];
+        rgb[2] = src[2];
+      }
+    }
+    else if (this->image_channels_ == 1)
+    {
+      // mono (or bayer?  @todo; fix for bayer)
+      const uint8_t *src = this->image_ + static_cast<size_t>(j) * cols;
+      for (i = 0; i < cols; ++i, rgb += this->point_step_)
+        rgb[0] = rgb[1] = rgb[2] = src[i];
+    }
+    else
+    {
+      // no image
+      for (i = 0; i < cols; ++i, rgb += this->point_step_)
+        rgb[0] = rgb[1] = rgb[2] = 0;
+    }
+
+    this->row_dense_[j] = dense;
+  }
+}
+}
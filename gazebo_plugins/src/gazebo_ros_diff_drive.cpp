@@ -177,12 +177,14 @@ void GazeboRosDiffDrive::Load ( physics::ModelPtr _parent, sdf::ElementPtr _sdf
     }
 
     // start custom queue for diff drive
-    this->callback_queue_thread_ =
-        boost::thread ( boost::bind ( &GazeboRosDiffDrive::QueueThread, this ) );
+    if (!queue_.Attach(_sdf))
+      this->callback_queue_thread_ =
+          boost::thread ( boost::bind ( &GazeboRosDiffDrive::QueueThread, this ) );
 
     // listen to the update event (broadcast every simulation iteration)
     this->update_connection_ =
-        event::Events::ConnectWorldUpdateBegin ( boost::bind ( &GazeboRosDiffDrive::UpdateChild, this ) );
+        event::Events::ConnectWorldUpdateBegin ( ProfiledUpdate ( "diff_drive/" + this->parent->GetName(),
+            boost::bind ( &GazeboRosDiffDrive::UpdateChild, this ) ) );
 
 }
 
@@ -318,6 +320,7 @@ void GazeboRosDiffDrive::FiniChild()
     queue_.clear();
     queue_.disable();
     gazebo_ros_->node()->shutdown();
+    queue_.Detach();
     callback_queue_thread_.join();
 }
 
@@ -31,6 +31,7 @@ GazeboRosElevator::~GazeboRosElevator()
   this->queue_.clear();
   this->queue_.disable();
   this->rosnode_->shutdown();
+  this->queue_.Detach();
   this->callbackQueueThread_.join();
 
   delete this->rosnode_;
@@ -72,8 +73,9 @@ void GazeboRosElevator::Load(physics::ModelPtr _parent, sdf::ElementPtr _sdf)
   this->elevatorSub_ = this->rosnode_->subscribe(so);
 
   // start custom queue for elevator
-  this->callbackQueueThread_ =
-    boost::thread(boost::bind(&GazeboRosElevator::QueueThread, this));
+  if (!this->queue_.Attach(_sdf))
+    this->callbackQueueThread_ =
+      boost::thread(boost::bind(&GazeboRosElevator::QueueThread, this));
 }
 
 /////////////////////////////////////////////////
@@ -44,6 +44,7 @@ GazeboRosF3D::~GazeboRosF3D()
   this->queue_.clear();
   this->queue_.disable();
   this->rosnode_->shutdown();
+  this->queue_.Detach();
   this->callback_queue_thread_.join();
   delete this->rosnode_;
 }
@@ -119,13 +120,15 @@ void GazeboRosF3D::Load( physics::ModelPtr _parent, sdf::ElementPtr _sdf )
   this->pub_ = this->rosnode_->advertise(ao);
 
   // Custom Callback Queue
-  this->callback_queue_thread_ = boost::thread( boost::bind( &GazeboRosF3D::QueueThread,this ) );
+  if (!this->queue_.Attach(_sdf))
+    this->callback_queue_thread_ = boost::thread( boost::bind( &GazeboRosF3D::QueueThread,this ) );
 
   // New Mechanism for Updating every World Cycle
   // Listen to the update event. This event is broadcast every
   // simulation iteration.
   this->update_connection_ = event::Events::ConnectWorldUpdateBegin(
-      boost::bind(&GazeboRosF3D::UpdateChild, this));
+      ProfiledUpdate("f3d/" + this->robot_namespace_ + "/" + this->topic_name_,
+        boost::bind(&GazeboRosF3D::UpdateChild, this)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
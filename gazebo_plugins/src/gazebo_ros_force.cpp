@@ -52,6 +52,7 @@ GazeboRosForce::~GazeboRosForce()
   this->queue_.clear();
   this->queue_.disable();
   this->rosnode_->shutdown();
+  this->queue_.Detach();
   this->callback_queue_thread_.join();
 
   delete this->rosnode_;
@@ -111,13 +112,15 @@ void GazeboRosForce::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf)
   this->sub_ = this->rosnode_->subscribe(so);
 
   // Custom Callback Queue
-  this->callback_queue_thread_ = boost::thread( boost::bind( &GazeboRosForce::QueueThread,this ) );
+  if (!this->queue_.Attach(_sdf))
+    this->callback_queue_thread_ = boost::thread( boost::bind( &GazeboRosForce::QueueThread,this ) );
 
   // New Mechanism for Updating every World Cycle
   // Listen to the update event. This event is broadcast every
   // simulation iteration.
   this->update_connection_ = event::Events::ConnectWorldUpdateBegin(
-      boost::bind(&GazeboRosForce::UpdateChild, this));
+      ProfiledUpdate("force/" + this->robot_namespace_ + "/" + this->topic_name_,
+        boost::bind(&GazeboRosForce::UpdateChild, this)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
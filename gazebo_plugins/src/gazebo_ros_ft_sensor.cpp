@@ -32,7 +32,6 @@ GZ_REGISTER_MODEL_PLUGIN(GazeboRosFT);
 GazeboRosFT::GazeboRosFT()
 {
   this->ft_connect_count_ = 0;
-  this->seed = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -44,6 +43,7 @@ GazeboRosFT::~GazeboRosFT()
   this->queue_.clear();
   this->queue_.disable();
   this->rosnode_->shutdown();
+  this->queue_.Detach();
   this->callback_queue_thread_.join();
   delete this->rosnode_;
 }
@@ -107,6 +107,11 @@ void GazeboRosFT::Load( physics::ModelPtr _model, sdf::ElementPtr _sdf )
   else
     this->update_rate_ = _sdf->GetElement("updateRate")->Get<double>();
 
+  if (!_sdf->HasElement("noiseSeed"))
+    this->noise_.Seed(NoiseGenerator::SeedFromName(this->topic_name_));
+  else
+    this->noise_.Seed(_sdf->GetElement("noiseSeed")->Get<unsigned int>());
+
   // Make sure the ROS node for Gazebo has already been initialized
   if (!ros::isInitialized())
   {
@@ -130,13 +135,15 @@ void GazeboRosFT::Load( physics::ModelPtr _model, sdf::ElementPtr _sdf )
   this->pub_ = this->rosnode_->advertise(ao);
 
   // Custom Callback Queue
-  this->callback_queue_thread_ = boost::thread( boost::bind( &GazeboRosFT::QueueThread,this ) );
+  if (!this->queue_.Attach(_sdf))
+    this->callback_queue_thread_ = boost::thread( boost::bind( &GazeboRosFT::QueueThread,this ) );
 
   // New Mechanism for Updating every World Cycle
   // Listen to the update event. This event is broadcast every
   // simulation iteration.
   this->update_connection_ = event::Events::ConnectWorldUpdateBegin(
-      boost::bind(&GazeboRosFT::UpdateChild, this));
+      ProfiledUpdate("ft_sensor/" + this->robot_namespace_ + "/" + this->topic_name_,
+        boost::bind(&GazeboRosFT::UpdateChild, this)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -201,12 +208,14 @@ void GazeboRosFT::UpdateChild()
   this->wrench_msg_.header.stamp.nsec = (this->world_->GetSimTime()).nsec;
 #endif
 
-  this->wrench_msg_.wrench.force.x = force.X() + this->GaussianKernel(0, this->gaussian_noise_);
-  this->wrench_msg_.wrench.force.y = force.Y() + this->GaussianKernel(0, this->gaussian_noise_);
-  this->wrench_msg_.wrench.force.z = force.Z() + this->GaussianKernel(0, this->gaussian_noise_);
-  this->wrench_msg_.wrench.torque.x = torque.X() + this->GaussianKernel(0, this->gaussian_noise_);
-  this->wrench_msg_.wrench.torque.y = torque.Y() + this->GaussianKernel(0, this->gaussian_noise_);
-  this->wrench_msg_.wrench.torque.z = torque.Z() + this->GaussianKernel(0, this->gaussian_noise_);
+  double noise[6];
+  this->noise_.FillGaussian(noise, 6, this->gaussian_noise_);
+  this->wrench_msg_.wrench.force.x = force.X() + noise[0];
+  this->wrench_msg_.wrench.force.y = force.Y() + noise[1];
+  this->wrench_msg_.wrench.force.z = force.Z() + noise[2];
+  this->wrench_msg_.wrench.torque.x = torque.X() + noise[3];
+  this->wrench_msg_.wrench.torque.y = torque.Y() + noise[4];
+  this->wrench_msg_.wrench.torque.z = torque.Z() + noise[5];
 
   this->pub_.publish(this->wrench_msg_);
   this->lock_.unlock();
@@ -215,30 +224,6 @@ void GazeboRosFT::UpdateChild()
   this->last_time_ = cur_time;
 }
 
-//////////////////////////////////////////////////////////////////////////////
-// Utility for adding noise
-double GazeboRosFT::GaussianKernel(double mu, double sigma)
-{
-  // using Box-Muller transform to generate two independent standard
-  // normally disbributed normal variables see wikipedia
-
-  // normalized uniform random variable
-  double U = static_cast<double>(rand_r(&this->seed)) /
-             static_cast<double>(RAND_MAX);
-
-  // normalized uniform random variable
-  double V = static_cast<double>(rand_r(&this->seed)) /
-             static_cast<double>(RAND_MAX);
-
-  double X = sqrt(-2.0 * ::log(U)) * cos(2.0*M_PI * V);
-  // double Y = sqrt(-2.0 * ::log(U)) * sin(2.0*M_PI * V);
-
-  // there are 2 indep. vars, we'll just use X
-  // scale to our mu and sigma
-  X = sigma * X + mu;
-  return X;
-}
-
 // Custom Callback Queue
 ////////////////////////////////////////////////////////////////////////////////
 // custom callback queue thread
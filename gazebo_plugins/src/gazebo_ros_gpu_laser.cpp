@@ -39,6 +39,7 @@
 #include <tf/transform_listener.h>
 
 #include "gazebo_plugins/gazebo_ros_gpu_laser.h"
+#include <gazebo_plugins/gazebo_ros_laser_scan.h>
 #include <gazebo_plugins/gazebo_ros_utils.h>
 
 namespace gazebo
@@ -49,8 +50,10 @@ GZ_REGISTER_SENSOR_PLUGIN(GazeboRosLaser)
 ////////////////////////////////////////////////////////////////////////////////
 // Constructor
 GazeboRosLaser::GazeboRosLaser()
+  : scan_latency_("scan latency")
 {
   this->seed = 0;
+  this->direct_scan_ = false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -58,6 +61,7 @@ GazeboRosLaser::GazeboRosLaser()
 GazeboRosLaser::~GazeboRosLaser()
 {
   ROS_DEBUG_STREAM_NAMED("gpu_laser","Shutting down GPU Laser");
+  this->sensor_update_connection_.reset();
   this->rosnode_->shutdown();
   delete this->rosnode_;
   ROS_DEBUG_STREAM_NAMED("gpu_laser","Unloaded");
@@ -102,6 +106,16 @@ void GazeboRosLaser::Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf)
 
   this->laser_connect_count_ = 0;
 
+  // how many scans may wait for the publisher thread, what happens once
+  // that many are waiting, and whether the queue reports on /diagnostics
+  this->publish_queue_ = PubQueueOptionsFromSDF(this->sdf, "gpu_laser");
+
+  // read scans from the sensor update event into pooled messages instead of
+  // its gazebo transport topic, saving the serialization and three copies
+  if (!this->sdf->HasElement("directScan"))
+    this->direct_scan_ = false;
+  else
+    this->direct_scan_ = this->sdf->Get<bool>("directScan");
 
   // Make sure the ROS node for Gazebo has already been initialized
   if (!ros::isInitialized())
@@ -149,7 +163,20 @@ void GazeboRosLaser::LoadThread()
       boost::bind(&GazeboRosLaser::LaserDisconnect, this),
       ros::VoidPtr(), NULL);
     this->pub_ = this->rosnode_->advertise(ao);
-    this->pub_queue_ = this->pmq.addPub<sensor_msgs::LaserScan>();
+    if (this->direct_scan_)
+      this->scan_ptr_queue_ = this->pmq.addPub<sensor_msgs::LaserScanPtr>(
+        this->publish_queue_.capacity, this->publish_queue_.policy);
+    else
+      this->pub_queue_ = this->pmq.addPub<sensor_msgs::LaserScan>(
+        this->publish_queue_.capacity, this->publish_queue_.policy);
+  }
+
+  if (this->publish_queue_.diagnostics)
+  {
+    this->pmq.addStatus(boost::bind(&LatencyHistogram::FillStatus,
+                                    &this->scan_latency_, _1));
+    this->pmq.startDiagnostics(*this->rosnode_,
+      "gpu_laser " + this->rosnode_->resolveName(this->topic_name_));
   }
 
   // Initialize the controller
@@ -166,9 +193,18 @@ void GazeboRosLaser::LaserConnect()
 {
   this->laser_connect_count_++;
   if (this->laser_connect_count_ == 1)
-    this->laser_scan_sub_ =
-      this->gazebo_node_->Subscribe(this->parent_ray_sensor_->Topic(),
-                                    &GazeboRosLaser::OnScan, this);
+  {
+    // the update event also stamps scans for the latency histogram
+    if (this->direct_scan_ || this->publish_queue_.diagnostics)
+      this->sensor_update_connection_ = this->parent_ray_sensor_->ConnectUpdated(
+        boost::bind(&GazeboRosLaser::OnSensorUpdate, this));
+    if (this->direct_scan_)
+      this->parent_ray_sensor_->SetActive(true);
+    else
+      this->laser_scan_sub_ =
+        this->gazebo_node_->Subscribe(this->parent_ray_sensor_->Topic(),
+                                      &GazeboRosLaser::OnScan, this);
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -177,7 +213,32 @@ void GazeboRosLaser::LaserDisconnect()
 {
   this->laser_connect_count_--;
   if (this->laser_connect_count_ == 0)
-    this->laser_scan_sub_.reset();
+  {
+    this->sensor_update_connection_.reset();
+    if (this->direct_scan_)
+      this->parent_ray_sensor_->SetActive(false);
+    else
+      this->laser_scan_sub_.reset();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Read a new scan straight from the sensor and publish it
+void GazeboRosLaser::OnSensorUpdate()
+{
+  uint64_t key = LaserScanKey(this->parent_ray_sensor_->LastMeasurementTime());
+  if (this->publish_queue_.diagnostics)
+    this->scan_latency_.Start(key);
+  if (!this->direct_scan_)
+    return;
+
+  sensor_msgs::LaserScanPtr laser_msg = this->scan_pool_.Acquire();
+  FillLaserScan(*this->parent_ray_sensor_, this->frame_name_, this->ranges_,
+                *laser_msg);
+  // swapped with the message the queue slot held, which goes back to the pool
+  this->scan_ptr_queue_->push(std::move(laser_msg), this->pub_);
+  if (this->publish_queue_.diagnostics)
+    this->scan_latency_.Stop(key);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -204,6 +265,10 @@ void GazeboRosLaser::OnScan(ConstLaserScanStampedPtr &_msg)
   std::copy(_msg->scan().intensities().begin(),
             _msg->scan().intensities().end(),
             laser_msg.intensities.begin());
-  this->pub_queue_->push(laser_msg, this->pub_);
+  // laser_msg is not used after this, hand its buffers over to the queue
+  this->pub_queue_->push(std::move(laser_msg), this->pub_);
+  if (this->publish_queue_.diagnostics)
+    this->scan_latency_.Stop(LaserScanKey(
+      common::Time(_msg->time().sec(), _msg->time().nsec())));
 }
 }
@@ -130,7 +130,8 @@ namespace gazebo
 
     // Register update event handler
     this->update_connection_ = event::Events::ConnectWorldUpdateBegin(
-        boost::bind(&GazeboRosHandOfGod::GazeboUpdate, this));
+        ProfiledUpdate("hand_of_god/" + this->model_->GetName(),
+          boost::bind(&GazeboRosHandOfGod::GazeboUpdate, this)));
   }
 
   ////////////////////////////////////////////////////////////////////////////////
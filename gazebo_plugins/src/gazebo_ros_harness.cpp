@@ -37,6 +37,7 @@ GazeboRosHarness::~GazeboRosHarness()
   // Custom Callback Queue
   this->queue_.clear();
   this->queue_.disable();
+  this->queue_.Detach();
 
   this->rosnode_->shutdown();
   delete this->rosnode_;
@@ -77,8 +78,9 @@ void GazeboRosHarness::Load(physics::ModelPtr _parent, sdf::ElementPtr _sdf)
   this->detachSub_ = this->rosnode_->subscribe(so);
 
   // Custom Callback Queue
-  this->callbackQueueThread_ =
-    boost::thread(boost::bind(&GazeboRosHarness::QueueThread, this));
+  if (!this->queue_.Attach(_sdf))
+    this->callbackQueueThread_ =
+      boost::thread(boost::bind(&GazeboRosHarness::QueueThread, this));
 }
 
 /////////////////////////////////////////////////
@@ -31,7 +31,6 @@ GZ_REGISTER_MODEL_PLUGIN(GazeboRosIMU)
 // Constructor
 GazeboRosIMU::GazeboRosIMU()
 {
-  this->seed = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -41,6 +40,7 @@ GazeboRosIMU::~GazeboRosIMU()
   this->update_connection_.reset();
   // Finalize the controller
   this->rosnode_->shutdown();
+  this->imu_queue_.Detach();
   this->callback_queue_thread_.join();
   delete this->rosnode_;
 }
@@ -91,6 +91,17 @@ void GazeboRosIMU::LoadThread()
   else
     this->gaussian_noise_ = this->sdf->Get<double>("gaussianNoise");
 
+  // optional per-axis bias and drift of the rates and accelerations
+  double bias_stddev = 0.0;
+  if (this->sdf->HasElement("biasStddev"))
+    bias_stddev = this->sdf->Get<double>("biasStddev");
+  double drift_stddev = 0.0;
+  if (this->sdf->HasElement("driftStddev"))
+    drift_stddev = this->sdf->Get<double>("driftStddev");
+  double drift_correlation_time = 0.0;
+  if (this->sdf->HasElement("driftCorrelationTime"))
+    drift_correlation_time = this->sdf->Get<double>("driftCorrelationTime");
+
   if (!this->sdf->HasElement("bodyName"))
   {
     ROS_FATAL_NAMED("imu", "imu plugin missing <bodyName>, cannot proceed");
@@ -132,6 +143,24 @@ void GazeboRosIMU::LoadThread()
   else
     this->frame_name_ = this->sdf->Get<std::string>("frameName");
 
+  if (!this->sdf->HasElement("noiseSeed"))
+    this->noise_.Seed(NoiseGenerator::SeedFromName(this->topic_name_));
+  else
+    this->noise_.Seed(this->sdf->Get<unsigned int>("noiseSeed"));
+
+  // how many messages may wait for the publisher thread, what happens once
+  // that many are waiting, and whether the queue reports on /diagnostics
+  this->publish_queue_ = PubQueueOptionsFromSDF(this->sdf, "imu");
+  for (unsigned int i = 0; i < 3; ++i)
+  {
+    this->rate_noise_[i].Configure(this->gaussian_noise_, 0.0, bias_stddev,
+                                   drift_stddev, drift_correlation_time);
+    this->rate_noise_[i].Reset(this->noise_);
+    this->accel_noise_[i].Configure(this->gaussian_noise_, 0.0, bias_stddev,
+                                    drift_stddev, drift_correlation_time);
+    this->accel_noise_[i].Reset(this->noise_);
+  }
+
   // Make sure the ROS node for Gazebo has already been initialized
   if (!ros::isInitialized())
   {
@@ -162,9 +191,13 @@ void GazeboRosIMU::LoadThread()
   // if topic name specified as empty, do not publish
   if (this->topic_name_ != "")
   {
-    this->pub_Queue = this->pmq.addPub<sensor_msgs::Imu>();
+    this->pub_Queue = this->pmq.addPub<sensor_msgs::Imu>(
+      this->publish_queue_.capacity, this->publish_queue_.policy);
     this->pub_ = this->rosnode_->advertise<sensor_msgs::Imu>(
       this->topic_name_, 1);
+    if (this->publish_queue_.diagnostics)
+      this->pmq.startDiagnostics(*this->rosnode_,
+        "imu " + this->rosnode_->resolveName(this->topic_name_));
 
     // advertise services on the custom queue
     ros::AdvertiseServiceOptions aso =
@@ -193,15 +226,17 @@ void GazeboRosIMU::LoadThread()
   this->aeul_ = 0;
 
   // start custom queue for imu
-  this->callback_queue_thread_ =
-    boost::thread(boost::bind(&GazeboRosIMU::IMUQueueThread, this));
+  if (!this->imu_queue_.Attach(this->sdf))
+    this->callback_queue_thread_ =
+      boost::thread(boost::bind(&GazeboRosIMU::IMUQueueThread, this));
 
 
   // New Mechanism for Updating every World Cycle
   // Listen to the update event. This event is broadcast every
   // simulation iteration.
   this->update_connection_ = event::Events::ConnectWorldUpdateBegin(
-      boost::bind(&GazeboRosIMU::UpdateChild, this));
+      ProfiledUpdate("imu/" + this->robot_namespace_ + "/" + this->topic_name_,
+        boost::bind(&GazeboRosIMU::UpdateChild, this)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -285,10 +320,11 @@ void GazeboRosIMU::UpdateChild()
     this->imu_msg_.orientation.w = rot.W();
 
     // pass euler angular rates
+    double noise_dt = (cur_time - this->last_time_).Double();
     ignition::math::Vector3d linear_velocity(
-      veul.X() + this->GaussianKernel(0, this->gaussian_noise_),
-      veul.Y() + this->GaussianKernel(0, this->gaussian_noise_),
-      veul.Z() + this->GaussianKernel(0, this->gaussian_noise_));
+      this->rate_noise_[0].Apply(veul.X(), noise_dt, this->noise_),
+      this->rate_noise_[1].Apply(veul.Y(), noise_dt, this->noise_),
+      this->rate_noise_[2].Apply(veul.Z(), noise_dt, this->noise_));
     // rotate into local frame
     // @todo: deal with offsets!
     linear_velocity = rot.RotateVector(linear_velocity);
@@ -298,9 +334,9 @@ void GazeboRosIMU::UpdateChild()
 
     // pass accelerations
     ignition::math::Vector3d linear_acceleration(
-      apos_.X() + this->GaussianKernel(0, this->gaussian_noise_),
-      apos_.Y() + this->GaussianKernel(0, this->gaussian_noise_),
-      apos_.Z() + this->GaussianKernel(0, this->gaussian_noise_));
+      this->accel_noise_[0].Apply(apos_.X(), noise_dt, this->noise_),
+      this->accel_noise_[1].Apply(apos_.Y(), noise_dt, this->noise_),
+      this->accel_noise_[2].Apply(apos_.Z(), noise_dt, this->noise_));
     // rotate into local frame
     // @todo: deal with offsets!
     linear_acceleration = rot.RotateVector(linear_acceleration);
@@ -335,30 +371,6 @@ void GazeboRosIMU::UpdateChild()
 }
 
 
-//////////////////////////////////////////////////////////////////////////////
-// Utility for adding noise
-double GazeboRosIMU::GaussianKernel(double mu, double sigma)
-{
-  // using Box-Muller transform to generate two independent standard
-  // normally disbributed normal variables see wikipedia
-
-  // normalized uniform random variable
-  double U = static_cast<double>(rand_r(&this->seed)) /
-             static_cast<double>(RAND_MAX);
-
-  // normalized uniform random variable
-  double V = static_cast<double>(rand_r(&this->seed)) /
-             static_cast<double>(RAND_MAX);
-
-  double X = sqrt(-2.0 * ::log(U)) * cos(2.0*M_PI * V);
-  // double Y = sqrt(-2.0 * ::log(U)) * sin(2.0*M_PI * V);
-
-  // there are 2 indep. vars, we'll just use X
-  // scale to our mu and sigma
-  X = sigma * X + mu;
-  return X;
-}
-
 ////////////////////////////////////////////////////////////////////////////////
 // Put laser data to the interface
 void GazeboRosIMU::IMUQueueThread()
@@ -26,7 +26,6 @@ gazebo::GazeboRosImuSensor::GazeboRosImuSensor(): SensorPlugin()
   accelerometer_data = ignition::math::Vector3d(0, 0, 0);
   gyroscope_data = ignition::math::Vector3d(0, 0, 0);
   orientation = ignition::math::Quaterniond(1,0,0,0);
-  seed=0;
   sensor=NULL;
 }
 
@@ -59,7 +58,9 @@ void gazebo::GazeboRosImuSensor::Load(gazebo::sensors::SensorPtr sensor_, sdf::E
 
   imu_data_publisher = node->advertise<sensor_msgs::Imu>(topic_name,1);
 
-  connection = gazebo::event::Events::ConnectWorldUpdateBegin(boost::bind(&GazeboRosImuSensor::UpdateChild, this, _1));
+  connection = gazebo::event::Events::ConnectWorldUpdateBegin(
+    gazebo::ProfiledUpdate("imu_sensor/" + robot_namespace + "/" + topic_name,
+                           boost::bind(&GazeboRosImuSensor::UpdateChild, this, _1)));
 
   last_time = sensor->LastUpdateTime();
 }
@@ -78,18 +79,20 @@ void gazebo::GazeboRosImuSensor::UpdateChild(const gazebo::common::UpdateInfo &/
     gyroscope_data = sensor->AngularVelocity();
 
     //Guassian noise is applied to all measurements
-    imu_msg.orientation.x = orientation.X() + GuassianKernel(0,gaussian_noise);
-    imu_msg.orientation.y = orientation.Y() + GuassianKernel(0,gaussian_noise);
-    imu_msg.orientation.z = orientation.Z() + GuassianKernel(0,gaussian_noise);
-    imu_msg.orientation.w = orientation.W() + GuassianKernel(0,gaussian_noise);
+    double noise[10];
+    noise_generator.FillGaussian(noise, 10, gaussian_noise);
+    imu_msg.orientation.x = orientation.X() + noise[0];
+    imu_msg.orientation.y = orientation.Y() + noise[1];
+    imu_msg.orientation.z = orientation.Z() + noise[2];
+    imu_msg.orientation.w = orientation.W() + noise[3];
 
-    imu_msg.linear_acceleration.x = accelerometer_data.X() + GuassianKernel(0,gaussian_noise);
-    imu_msg.linear_acceleration.y = accelerometer_data.Y() + GuassianKernel(0,gaussian_noise);
-    imu_msg.linear_acceleration.z = accelerometer_data.Z() + GuassianKernel(0,gaussian_noise);
+    imu_msg.linear_acceleration.x = accelerometer_data.X() + noise[4];
+    imu_msg.linear_acceleration.y = accelerometer_data.Y() + noise[5];
+    imu_msg.linear_acceleration.z = accelerometer_data.Z() + noise[6];
 
-    imu_msg.angular_velocity.x = gyroscope_data.X() + GuassianKernel(0,gaussian_noise);
-    imu_msg.angular_velocity.y = gyroscope_data.Y() + GuassianKernel(0,gaussian_noise);
-    imu_msg.angular_velocity.z = gyroscope_data.Z() + GuassianKernel(0,gaussian_noise);
+    imu_msg.angular_velocity.x = gyroscope_data.X() + noise[7];
+    imu_msg.angular_velocity.y = gyroscope_data.Y() + noise[8];
+    imu_msg.angular_velocity.z = gyroscope_data.Z() + noise[9];
 
     //covariance is related to the Gaussian noise
     double gn2 = gaussian_noise*gaussian_noise;
@@ -117,20 +120,6 @@ void gazebo::GazeboRosImuSensor::UpdateChild(const gazebo::common::UpdateInfo &/
   last_time = current_time;
 }
 
-double gazebo::GazeboRosImuSensor::GuassianKernel(double mu, double sigma)
-{
-  // generation of two normalized uniform random variables
-  double U1 = static_cast<double>(rand_r(&seed)) / static_cast<double>(RAND_MAX);
-  double U2 = static_cast<double>(rand_r(&seed)) / static_cast<double>(RAND_MAX);
-
-  // using Box-Muller transform to obtain a varaible with a standard normal distribution
-  double Z0 = sqrt(-2.0 * ::log(U1)) * cos(2.0*M_PI * U2);
-
-  // scaling
-  Z0 = sigma * Z0 + mu;
-  return Z0;
-}
-
 bool gazebo::GazeboRosImuSensor::LoadParameters()
 {
   //loading parameters from the sdf file
@@ -198,6 +187,12 @@ bool gazebo::GazeboRosImuSensor::LoadParameters()
     ROS_WARN_STREAM("missing <gaussianNoise>, set to default: " << gaussian_noise);
   }
 
+  //NOISE SEED
+  if (sdf->HasElement("noiseSeed"))
+    noise_generator.Seed(sdf->Get<unsigned int>("noiseSeed"));
+  else
+    noise_generator.Seed(NoiseGenerator::SeedFromName(topic_name));
+
   //POSITION OFFSET, UNUSED
   if (sdf->HasElement("xyzOffset"))
   {
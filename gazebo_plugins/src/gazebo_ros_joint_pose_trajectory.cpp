@@ -52,6 +52,7 @@ GazeboRosJointPoseTrajectory::~GazeboRosJointPoseTrajectory()
   this->rosnode_->shutdown();
   this->queue_.clear();
   this->queue_.disable();
+  this->queue_.Detach();
   this->callback_queue_thread_.join();
   delete this->rosnode_;
 }
@@ -150,14 +151,16 @@ void GazeboRosJointPoseTrajectory::LoadThread()
 #endif
 
   // start custom queue for joint trajectory plugin ros topics
-  this->callback_queue_thread_ =
-    boost::thread(boost::bind(&GazeboRosJointPoseTrajectory::QueueThread, this));
+  if (!this->queue_.Attach(this->sdf))
+    this->callback_queue_thread_ =
+      boost::thread(boost::bind(&GazeboRosJointPoseTrajectory::QueueThread, this));
 
   // New Mechanism for Updating every World Cycle
   // Listen to the update event. This event is broadcast every
   // simulation iteration.
   this->update_connection_ = event::Events::ConnectWorldUpdateBegin(
-      boost::bind(&GazeboRosJointPoseTrajectory::UpdateStates, this));
+      ProfiledUpdate("joint_pose_trajectory/" + this->robot_namespace_ + "/" + this->topic_name_,
+        boost::bind(&GazeboRosJointPoseTrajectory::UpdateStates, this)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
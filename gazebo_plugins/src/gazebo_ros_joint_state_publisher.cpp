@@ -102,7 +102,8 @@ void GazeboRosJointStatePublisher::Load ( physics::ModelPtr _parent, sdf::Elemen
     // Listen to the update event. This event is broadcast every
     // simulation iteration.
     this->updateConnection = event::Events::ConnectWorldUpdateBegin (
-                                 boost::bind ( &GazeboRosJointStatePublisher::OnUpdate, this, _1 ) );
+                                 ProfiledUpdate ( "joint_state_publisher/" + this->parent_->GetName(),
+                                   boost::bind ( &GazeboRosJointStatePublisher::OnUpdate, this, _1 ) ) );
 }
 
 void GazeboRosJointStatePublisher::OnUpdate ( const common::UpdateInfo & _info ) {
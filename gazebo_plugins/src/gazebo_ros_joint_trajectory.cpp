@@ -53,6 +53,7 @@ GazeboRosJointTrajectory::~GazeboRosJointTrajectory()
   this->rosnode_->shutdown();
   this->queue_.clear();
   this->queue_.disable();
+  this->queue_.Detach();
   this->callback_queue_thread_.join();
   delete this->rosnode_;
 }
@@ -152,14 +153,16 @@ void GazeboRosJointTrajectory::LoadThread()
 #endif
 
   // start custom queue for joint trajectory plugin ros topics
-  this->callback_queue_thread_ =
-    boost::thread(boost::bind(&GazeboRosJointTrajectory::QueueThread, this));
+  if (!this->queue_.Attach(this->sdf))
+    this->callback_queue_thread_ =
+      boost::thread(boost::bind(&GazeboRosJointTrajectory::QueueThread, this));
 
   // New Mechanism for Updating every World Cycle
   // Listen to the update event. This event is broadcast every
   // simulation iteration.
   this->update_connection_ = event::Events::ConnectWorldUpdateBegin(
-      boost::bind(&GazeboRosJointTrajectory::UpdateStates, this));
+      ProfiledUpdate("joint_trajectory/" + this->robot_namespace_ + "/" + this->topic_name_,
+        boost::bind(&GazeboRosJointTrajectory::UpdateStates, this)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
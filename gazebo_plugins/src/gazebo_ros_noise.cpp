@@ -0,0 +1,232 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include <gazebo_plugins/gazebo_ros_noise.h>
+
+namespace gazebo
+{
+// Box-Muller pairs computed per block by FillGaussian
+static const size_t kBlockPairs = 64;
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+NoiseGenerator::NoiseGenerator(uint64_t _seed)
+{
+  this->Seed(_seed);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Seed the generator
+void NoiseGenerator::Seed(uint64_t _seed)
+{
+  // splitmix64 outputs are never all zero, which xoshiro requires
+  for (int k = 0; k < 4; ++k)
+    this->s_[k] = SplitMix64(_seed + k * 0x9e3779b97f4a7c15ULL);
+  this->spare_ = 0.0;
+  this->has_spare_ = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Seed from a name, FNV-1a
+uint64_t NoiseGenerator::SeedFromName(const std::string &_name)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t k = 0; k < _name.size(); ++k)
+  {
+    hash ^= static_cast<unsigned char>(_name[k]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// splitmix64 step
+uint64_t NoiseGenerator::SplitMix64(uint64_t _x)
+{
+  _x += 0x9e3779b97f4a7c15ULL;
+  _x = (_x ^ (_x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  _x = (_x ^ (_x >> 27)) * 0x94d049bb133111ebULL;
+  return _x ^ (_x >> 31);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// One Gaussian sample
+double NoiseGenerator::Gaussian(double _mu, double _sigma)
+{
+  if (this->has_spare_)
+  {
+    this->has_spare_ = false;
+    return _sigma * this->spare_ + _mu;
+  }
+
+  // (0, 1], log() must not see 0
+  double u = 1.0 - this->Uniform();
+  double v = this->Uniform();
+  double radius = std::sqrt(-2.0 * std::log(u));
+  double angle = 2.0 * M_PI * v;
+  this->spare_ = radius * std::sin(angle);
+  this->has_spare_ = true;
+  return _sigma * radius * std::cos(angle) + _mu;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Batch of Gaussian samples
+void NoiseGenerator::FillGaussian(double *_out, size_t _count, double _sigma,
+                                  double _mu)
+{
+  this->FillBlock(_out, _count, _sigma, _mu);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Batch of Gaussian samples, single precision
+void NoiseGenerator::FillGaussian(float *_out, size_t _count, float _sigma,
+                                  float _mu)
+{
+  this->FillBlock(_out, _count, _sigma, _mu);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Batch of Gaussian samples
+template <typename T>
+void NoiseGenerator::FillBlock(T *_out, size_t _count, double _sigma, double _mu)
+{
+  if (_count == 0)
+    return;
+
+  // start with the spare of a previous Gaussian() call
+  if (this->has_spare_)
+  {
+    this->has_spare_ = false;
+    *_out++ = static_cast<T>(_sigma * this->spare_ + _mu);
+    --_count;
+  }
+
+  // The generator is sequential, the transform is not: draw the uniforms
+  // of a block first, then transform the whole block in a loop without
+  // dependencies between iterations, which the compiler can vectorize.
+  double radius[kBlockPairs];
+  double angle[kBlockPairs];
+  while (_count > 0)
+  {
+    size_t pairs = std::min(kBlockPairs, (_count + 1) / 2);
+    for (size_t k = 0; k < pairs; ++k)
+    {
+      radius[k] = 1.0 - this->Uniform();
+      angle[k] = this->Uniform();
+    }
+    for (size_t k = 0; k < pairs; ++k)
+    {
+      radius[k] = std::sqrt(-2.0 * std::log(radius[k]));
+      angle[k] = 2.0 * M_PI * angle[k];
+    }
+
+    size_t full = std::min(pairs, _count / 2);
+    for (size_t k = 0; k < full; ++k)
+    {
+      _out[2 * k] = static_cast<T>(_sigma * radius[k] * std::cos(angle[k]) + _mu);
+      _out[2 * k + 1] = static_cast<T>(_sigma * radius[k] * std::sin(angle[k]) + _mu);
+    }
+    _out += 2 * full;
+    _count -= 2 * full;
+
+    // odd count, the sine of the last pair is kept for later
+    if (full < pairs)
+    {
+      *_out++ = static_cast<T>(_sigma * radius[full] * std::cos(angle[full]) + _mu);
+      --_count;
+      this->spare_ = radius[full] * std::sin(angle[full]);
+      this->has_spare_ = true;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+BiasDriftNoise::BiasDriftNoise()
+  : sigma_(0.0), bias_mean_(0.0), bias_stddev_(0.0), drift_stddev_(0.0),
+    drift_correlation_time_(0.0), bias_(0.0), drift_(0.0)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Set the error model
+void BiasDriftNoise::Configure(double _sigma, double _biasMean,
+                               double _biasStddev, double _driftStddev,
+                               double _driftCorrelationTime)
+{
+  this->sigma_ = _sigma;
+  this->bias_mean_ = _biasMean;
+  this->bias_stddev_ = _biasStddev;
+  this->drift_stddev_ = _driftStddev;
+  this->drift_correlation_time_ = _driftCorrelationTime;
+  this->bias_ = _biasMean;
+  this->drift_ = 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Draw a new bias
+void BiasDriftNoise::Reset(NoiseGenerator &_gen)
+{
+  this->bias_ = this->bias_stddev_ > 0.0 ?
+    _gen.Gaussian(this->bias_mean_, this->bias_stddev_) : this->bias_mean_;
+  this->drift_ = 0.0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Add the error to a value
+double BiasDriftNoise::Apply(double _value, double _dt, NoiseGenerator &_gen)
+{
+  if (this->drift_stddev_ > 0.0 && _dt > 0.0)
+  {
+    if (this->drift_correlation_time_ > 0.0)
+    {
+      // exact discretization of the Gauss-Markov process, its steady state
+      // standard deviation is drift_stddev * sqrt(tau / 2)
+      double tau = this->drift_correlation_time_;
+      double a = std::exp(-_dt / tau);
+      double stddev = this->drift_stddev_ * std::sqrt(0.5 * tau * (1.0 - a * a));
+      this->drift_ = a * this->drift_ + _gen.Gaussian(0.0, stddev);
+    }
+    else
+    {
+      this->drift_ += _gen.Gaussian(0.0, this->drift_stddev_ * std::sqrt(_dt));
+    }
+  }
+
+  double value = _value + this->bias_ + this->drift_;
+  if (this->sigma_ > 0.0)
+    value += _gen.Gaussian(0.0, this->sigma_);
+  return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Current bias
+double BiasDriftNoise::Bias() const
+{
+  return this->bias_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Current drift
+double BiasDriftNoise::Drift() const
+{
+  return this->drift_;
+}
+}
@@ -29,7 +29,6 @@ GZ_REGISTER_MODEL_PLUGIN(GazeboRosP3D);
 // Constructor
 GazeboRosP3D::GazeboRosP3D()
 {
-  this->seed = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -41,6 +40,7 @@ GazeboRosP3D::~GazeboRosP3D()
   this->rosnode_->shutdown();
   this->p3d_queue_.clear();
   this->p3d_queue_.disable();
+  this->p3d_queue_.Detach();
   this->callback_queue_thread_.join();
   delete this->rosnode_;
 }
@@ -124,6 +124,15 @@ void GazeboRosP3D::Load(physics::ModelPtr _parent, sdf::ElementPtr _sdf)
   else
     this->update_rate_ = _sdf->GetElement("updateRate")->Get<double>();
 
+  if (!_sdf->HasElement("noiseSeed"))
+    this->noise_.Seed(NoiseGenerator::SeedFromName(this->topic_name_));
+  else
+    this->noise_.Seed(_sdf->GetElement("noiseSeed")->Get<unsigned int>());
+
+  // how many messages may wait for the publisher thread, what happens once
+  // that many are waiting, and whether the queue reports on /diagnostics
+  this->publish_queue_ = PubQueueOptionsFromSDF(_sdf, "p3d");
+
   // Make sure the ROS node for Gazebo has already been initialized
   if (!ros::isInitialized())
   {
@@ -144,9 +153,13 @@ void GazeboRosP3D::Load(physics::ModelPtr _parent, sdf::ElementPtr _sdf)
 
   if (this->topic_name_ != "")
   {
-    this->pub_Queue = this->pmq.addPub<nav_msgs::Odometry>();
+    this->pub_Queue = this->pmq.addPub<nav_msgs::Odometry>(
+      this->publish_queue_.capacity, this->publish_queue_.policy);
     this->pub_ =
       this->rosnode_->advertise<nav_msgs::Odometry>(this->topic_name_, 1);
+    if (this->publish_queue_.diagnostics)
+      this->pmq.startDiagnostics(*this->rosnode_,
+        "p3d " + this->rosnode_->resolveName(this->topic_name_));
   }
 
 #if GAZEBO_MAJOR_VERSION >= 8
@@ -198,14 +211,16 @@ void GazeboRosP3D::Load(physics::ModelPtr _parent, sdf::ElementPtr _sdf)
 
 
   // start custom queue for p3d
-  this->callback_queue_thread_ = boost::thread(
-    boost::bind(&GazeboRosP3D::P3DQueueThread, this));
+  if (!this->p3d_queue_.Attach(_sdf))
+    this->callback_queue_thread_ = boost::thread(
+      boost::bind(&GazeboRosP3D::P3DQueueThread, this));
 
   // New Mechanism for Updating every World Cycle
   // Listen to the update event. This event is broadcast every
   // simulation iteration.
   this->update_connection_ = event::Events::ConnectWorldUpdateBegin(
-      boost::bind(&GazeboRosP3D::UpdateChild, this));
+      ProfiledUpdate("p3d/" + this->robot_namespace_ + "/" + this->topic_name_,
+        boost::bind(&GazeboRosP3D::UpdateChild, this)));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -316,19 +331,15 @@ void GazeboRosP3D::UpdateChild()
         this->pose_msg_.pose.pose.orientation.z = pose.Rot().Z();
         this->pose_msg_.pose.pose.orientation.w = pose.Rot().W();
 
-        this->pose_msg_.twist.twist.linear.x  = vpos.X() +
-          this->GaussianKernel(0, this->gaussian_noise_);
-        this->pose_msg_.twist.twist.linear.y  = vpos.Y() +
-          this->GaussianKernel(0, this->gaussian_noise_);
-        this->pose_msg_.twist.twist.linear.z  = vpos.Z() +
-          this->GaussianKernel(0, this->gaussian_noise_);
+        double noise[6];
+        this->noise_.FillGaussian(noise, 6, this->gaussian_noise_);
+        this->pose_msg_.twist.twist.linear.x  = vpos.X() + noise[0];
+        this->pose_msg_.twist.twist.linear.y  = vpos.Y() + noise[1];
+        this->pose_msg_.twist.twist.linear.z  = vpos.Z() + noise[2];
         // pass euler angular rates
-        this->pose_msg_.twist.twist.angular.x = veul.X() +
-          this->GaussianKernel(0, this->gaussian_noise_);
-        this->pose_msg_.twist.twist.angular.y = veul.Y() +
-          this->GaussianKernel(0, this->gaussian_noise_);
-        this->pose_msg_.twist.twist.angular.z = veul.Z() +
-          this->GaussianKernel(0, this->gaussian_noise_);
+        this->pose_msg_.twist.twist.angular.x = veul.X() + noise[3];
+        this->pose_msg_.twist.twist.angular.y = veul.Y() + noise[4];
+        this->pose_msg_.twist.twist.angular.z = veul.Z() + noise[5];
 
         // fill in covariance matrix
         /// @todo: let user set separate linear and angular covariance values.
@@ -359,30 +370,6 @@ void GazeboRosP3D::UpdateChild()
   }
 }
 
-//////////////////////////////////////////////////////////////////////////////
-// Utility for adding noise
-double GazeboRosP3D::GaussianKernel(double mu, double sigma)
-{
-  // using Box-Muller transform to generate two independent standard
-  // normally disbributed normal variables see wikipedia
-
-  // normalized uniform random variable
-  double U = static_cast<double>(rand_r(&this->seed)) /
-             static_cast<double>(RAND_MAX);
-
-  // normalized uniform random variable
-  double V = static_cast<double>(rand_r(&this->seed)) /
-             static_cast<double>(RAND_MAX);
-
-  double X = sqrt(-2.0 * ::log(U)) * cos(2.0*M_PI * V);
-  // double Y = sqrt(-2.0 * ::log(U)) * sin(2.0*M_PI * V);
-
-  // there are 2 indep. vars, we'll just use X
-  // scale to our mu and sigma
-  X = sigma * X + mu;
-  return X;
-}
-
 ////////////////////////////////////////////////////////////////////////////////
 // Put laser data to the interface
 void GazeboRosP3D::P3DQueueThread()
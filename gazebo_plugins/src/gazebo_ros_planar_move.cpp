@@ -154,13 +154,15 @@ namespace gazebo
     odometry_pub_ = rosnode_->advertise<nav_msgs::Odometry>(odometry_topic_, 1);
 
     // start custom queue for diff drive
-    callback_queue_thread_ =
-      boost::thread(boost::bind(&GazeboRosPlanarMove::QueueThread, this));
+    if (!queue_.Attach(sdf))
+      callback_queue_thread_ =
+        boost::thread(boost::bind(&GazeboRosPlanarMove::QueueThread, this));
 
     // listen to the update event (broadcast every simulation iteration)
     update_connection_ =
       event::Events::ConnectWorldUpdateBegin(
-          boost::bind(&GazeboRosPlanarMove::UpdateChild, this));
+          ProfiledUpdate("planar_move/" + parent_->GetName(),
+            boost::bind(&GazeboRosPlanarMove::UpdateChild, this)));
 
   }
 
@@ -200,6 +202,7 @@ namespace gazebo
     queue_.clear();
     queue_.disable();
     rosnode_->shutdown();
+    queue_.Detach();
     callback_queue_thread_.join();
   }
 
@@ -65,6 +65,7 @@ GazeboRosProjector::~GazeboRosProjector()
   this->queue_.clear();
   this->queue_.disable();
   this->rosnode_->shutdown();
+  this->queue_.Detach();
   this->callback_queue_thread_.join();
 
   delete this->rosnode_;
@@ -135,7 +136,8 @@ void GazeboRosProjector::Load( physics::ModelPtr _parent, sdf::ElementPtr _sdf )
 
 
   // Custom Callback Queue
-  this->callback_queue_thread_ = boost::thread( boost::bind( &GazeboRosProjector::QueueThread,this ) );
+  if (!this->queue_.Attach(_sdf))
+    this->callback_queue_thread_ = boost::thread( boost::bind( &GazeboRosProjector::QueueThread,this ) );
 
 }
 
@@ -62,7 +62,6 @@ GZ_REGISTER_SENSOR_PLUGIN(GazeboRosRange)
 // Constructor
 GazeboRosRange::GazeboRosRange()
 {
-  this->seed = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -72,6 +71,7 @@ GazeboRosRange::~GazeboRosRange()
   this->range_queue_.clear();
   this->range_queue_.disable();
   this->rosnode_->shutdown();
+  this->range_queue_.Detach();
   this->callback_queue_thread_.join();
 
   delete this->rosnode_;
@@ -152,6 +152,11 @@ void GazeboRosRange::Load(sensors::SensorPtr _parent, sdf::ElementPtr _sdf)
   else
     this->update_rate_ = this->sdf->Get<double>("updateRate");
 
+  if (!this->sdf->HasElement("noiseSeed"))
+    this->noise_.Seed(NoiseGenerator::SeedFromName(this->topic_name_));
+  else
+    this->noise_.Seed(this->sdf->Get<unsigned int>("noiseSeed"));
+
   // prepare to throttle this plugin at the same rate
   // ideally, we should invoke a plugin update when the sensor updates,
   // have to think about how to do that properly later
@@ -215,8 +220,9 @@ void GazeboRosRange::LoadThread()
   // sensor generation off by default
   this->parent_ray_sensor_->SetActive(false);
   // start custom queue for range
-  this->callback_queue_thread_ =
-    boost::thread(boost::bind(&GazeboRosRange::RangeQueueThread, this));
+  if (!this->range_queue_.Attach(this->sdf))
+    this->callback_queue_thread_ =
+      boost::thread(boost::bind(&GazeboRosRange::RangeQueueThread, this));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -300,7 +306,7 @@ void GazeboRosRange::PutRangeData(common::Time &_updateTime)
 
     // add Gaussian noise and limit to min/max range
     if (range_msg_.range < range_msg_.max_range)
-        range_msg_.range = std::min(range_msg_.range + this->GaussianKernel(0,gaussian_noise_), parent_ray_sensor_->RangeMax());
+        range_msg_.range = std::min(range_msg_.range + this->noise_.Gaussian(0,gaussian_noise_), parent_ray_sensor_->RangeMax());
 
     this->parent_ray_sensor_->SetActive(true);
 
@@ -310,30 +316,6 @@ void GazeboRosRange::PutRangeData(common::Time &_updateTime)
   }
 }
 
-//////////////////////////////////////////////////////////////////////////////
-// Utility for adding noise
-double GazeboRosRange::GaussianKernel(double mu, double sigma)
-{
-  // using Box-Muller transform to generate two independent standard
-  // normally disbributed normal variables see wikipedia
-
-  // normalized uniform random variable
-  double U = static_cast<double>(rand_r(&this->seed)) /
-             static_cast<double>(RAND_MAX);
-
-  // normalized uniform random variable
-  double V = static_cast<double>(rand_r(&this->seed)) /
-             static_cast<double>(RAND_MAX);
-
-  double X = sqrt(-2.0 * ::log(U)) * cos(2.0*M_PI * V);
-  // double Y = sqrt(-2.0 * ::log(U)) * sin(2.0*M_PI * V);
-
-  // there are 2 indep. vars, we'll just use X
-  // scale to our mu and sigma
-  X = sigma * X + mu;
-  return X;
-}
-
 ////////////////////////////////////////////////////////////////////////////////
 // Put range data to the interface
 void GazeboRosRange::RangeQueueThread()
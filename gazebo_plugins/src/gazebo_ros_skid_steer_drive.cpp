@@ -323,13 +323,15 @@ namespace gazebo {
     odometry_publisher_ = rosnode_->advertise<nav_msgs::Odometry>(odometry_topic_, 1);
 
     // start custom queue for diff drive
-    this->callback_queue_thread_ =
-      boost::thread(boost::bind(&GazeboRosSkidSteerDrive::QueueThread, this));
+    if (!this->queue_.Attach(_sdf))
+      this->callback_queue_thread_ =
+        boost::thread(boost::bind(&GazeboRosSkidSteerDrive::QueueThread, this));
 
     // listen to the update event (broadcast every simulation iteration)
     this->update_connection_ =
       event::Events::ConnectWorldUpdateBegin(
-          boost::bind(&GazeboRosSkidSteerDrive::UpdateChild, this));
+          ProfiledUpdate("skid_steer_drive/" + this->parent->GetName(),
+            boost::bind(&GazeboRosSkidSteerDrive::UpdateChild, this)));
 
   }
 
@@ -371,6 +373,7 @@ namespace gazebo {
     queue_.clear();
     queue_.disable();
     rosnode_->shutdown();
+    this->queue_.Detach();
     callback_queue_thread_.join();
   }
 
@@ -47,7 +47,10 @@ namespace gazebo
 GazeboRosText::GazeboRosText() {}
 
 ////////////////////////////////////////////////////////////////////////////////
-GazeboRosText::~GazeboRosText() {}
+GazeboRosText::~GazeboRosText()
+{
+  this->queue_.Detach();
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 void GazeboRosText::Load(rendering::VisualPtr _parent, sdf::ElementPtr _sdf)
@@ -177,8 +180,9 @@ void GazeboRosText::Load(rendering::VisualPtr _parent, sdf::ElementPtr _sdf)
 
   string_subscriber_ = rosnode_->subscribe(so);
 
-  this->callback_queue_thread_ =
-      boost::thread(boost::bind(&GazeboRosText::QueueThread, this));
+  if (!this->queue_.Attach(_sdf))
+    this->callback_queue_thread_ =
+        boost::thread(boost::bind(&GazeboRosText::QueueThread, this));
 
   this->update_connection_ =
     event::Events::ConnectPreRender(
@@ -147,10 +147,12 @@ void GazeboRosTricycleDrive::Load ( physics::ModelPtr _parent, sdf::ElementPtr _
     ROS_INFO_NAMED("tricycle_drive", "%s: Advertise odom on %s ", gazebo_ros_->info(), odometry_topic_.c_str() );
 
     // start custom queue for diff drive
-    this->callback_queue_thread_ = boost::thread ( boost::bind ( &GazeboRosTricycleDrive::QueueThread, this ) );
+    if (!this->queue_.Attach(_sdf))
+      this->callback_queue_thread_ = boost::thread ( boost::bind ( &GazeboRosTricycleDrive::QueueThread, this ) );
 
     // listen to the update event (broadcast every simulation iteration)
-    this->update_connection_ = event::Events::ConnectWorldUpdateBegin ( boost::bind ( &GazeboRosTricycleDrive::UpdateChild, this ) );
+    this->update_connection_ = event::Events::ConnectWorldUpdateBegin ( ProfiledUpdate ( "tricycle_drive/" + this->parent->GetName(),
+        boost::bind ( &GazeboRosTricycleDrive::UpdateChild, this ) ) );
 
 }
 
@@ -338,6 +340,7 @@ void GazeboRosTricycleDrive::FiniChild()
     queue_.clear();
     queue_.disable();
     gazebo_ros_->node()->shutdown();
+    this->queue_.Detach();
     callback_queue_thread_.join();
 }
 
@@ -50,6 +50,7 @@ GazeboRosVacuumGripper::~GazeboRosVacuumGripper()
   queue_.clear();
   queue_.disable();
   rosnode_->shutdown();
+  queue_.Detach();
   callback_queue_thread_.join();
 
   delete rosnode_;
@@ -133,13 +134,15 @@ void GazeboRosVacuumGripper::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf
   srv2_ = rosnode_->advertiseService(aso2);
 
   // Custom Callback Queue
-  callback_queue_thread_ = boost::thread( boost::bind( &GazeboRosVacuumGripper::QueueThread,this ) );
+  if (!queue_.Attach(_sdf))
+    callback_queue_thread_ = boost::thread( boost::bind( &GazeboRosVacuumGripper::QueueThread,this ) );
 
   // New Mechanism for Updating every World Cycle
   // Listen to the update event. This event is broadcast every
   // simulation iteration.
   update_connection_ = event::Events::ConnectWorldUpdateBegin(
-      boost::bind(&GazeboRosVacuumGripper::UpdateChild, this));
+      ProfiledUpdate("vacuum_gripper/" + robot_namespace_ + "/" + topic_name_,
+        boost::bind(&GazeboRosVacuumGripper::UpdateChild, this)));
 
   ROS_INFO_NAMED("vacuum_gripper", "Loaded gazebo_ros_vacuum_gripper");
 }
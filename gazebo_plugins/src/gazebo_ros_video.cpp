@@ -23,6 +23,7 @@
 
 #include <gazebo_plugins/gazebo_ros_video.h>
 #include <boost/lexical_cast.hpp>
+#include <algorithm>
 
 namespace gazebo
 {
@@ -157,6 +158,7 @@ namespace gazebo
     queue_.clear();
     queue_.disable();
     rosnode_->shutdown();
+    queue_.Detach();
     callback_queue_thread_.join();
 
     delete rosnode_;
@@ -223,6 +225,19 @@ namespace gazebo
       buffer_all_frames_for_fast_seek_ = p_sdf->GetElement("bufferAllFramesForFastSeek")->Get<bool>();
     }
 
+    stream_video_ = false;
+    if (p_sdf->HasElement("streamVideo"))
+    {
+      stream_video_ = p_sdf->GetElement("streamVideo")->Get<bool>();
+    }
+
+    double video_buffer_megabytes = 64;
+    if (p_sdf->HasElement("videoBufferMegabytes"))
+    {
+      video_buffer_megabytes = p_sdf->GetElement("videoBufferMegabytes")->Get<double>();
+    }
+    video_buffer_bytes_ = std::max(0.0, video_buffer_megabytes) * 1024 * 1024;
+
     std::string topic_name_video_paused = "set_video_paused";
     if (p_sdf->HasElement("topicVideoPaused"))
     {
@@ -355,8 +370,9 @@ namespace gazebo
     ROS_INFO("GazeboRosVideo (%s, ns = %s) has started!", 
         gazebo_source.c_str(), robot_namespace.c_str());
 
-    callback_queue_thread_ =
-      boost::thread(boost::bind(&GazeboRosVideo::QueueThread, this));
+    if (!queue_.Attach(p_sdf))
+      callback_queue_thread_ =
+        boost::thread(boost::bind(&GazeboRosVideo::QueueThread, this));
 
     video_thread_ =
       boost::thread(boost::bind(&GazeboRosVideo::VideoThread, this));
@@ -472,6 +488,17 @@ namespace gazebo
     new_image_available_ = true;
   }
 
+  void GazeboRosVideo::updateVideoFrame(cv::Mat& frame)
+  {
+    // frames of the stream are already display-ready, swap the buffers
+    // rather than copying and hand the previous one back for reuse
+    boost::mutex::scoped_lock scoped_lock(m_image_);
+    if (!image_)
+      image_ = boost::make_shared<cv_bridge::CvImage>();
+    cv::swap(image_->image, frame);
+    new_image_available_ = true;
+  }
+
   void GazeboRosVideo::clearImage()
   {
     cv::Mat empty_image;
@@ -492,13 +519,30 @@ namespace gazebo
     ros::WallRate wall_rate(video_fps_ <= 0 ? 24 : video_fps_);
     ros::Rate simulation_rate(video_fps_ <= 0 ? 24 : video_fps_);
     cv::VideoCapture cap;
+    VideoFrameStream stream(video_visual_->getWidth(), video_visual_->getHeight(),
+                            video_buffer_bytes_);
+    bool stream_seek_pending = false;
     cv::Mat frame;
     while (rosnode_->ok())
     {
       m_video_.lock();
       if (!stop_video_)
       {
-        if (new_video_available_ && !video_path_.empty())
+        if (stream_video_ && new_video_available_ && !video_path_.empty())
+        {
+          clearImage();
+          // the decoder thread of the stream reads ahead, opening does not decode
+          if (!stream.Open(video_path_))
+            ROS_WARN_NAMED("video", "GazeboRosVideo could not open %s", video_path_.c_str());
+          else if (video_fps_ <= 0 && stream.Fps() > 0)
+          {
+            wall_rate = ros::WallRate(stream.Fps());
+            simulation_rate = ros::Rate(stream.Fps());
+          }
+          stream_seek_pending = false;
+          new_video_available_ = false;
+        }
+        else if (new_video_available_ && !video_path_.empty())
         {
           clearImage();
           cap.open(video_path_);
@@ -535,7 +579,35 @@ namespace gazebo
 
         bool seek_performed = false;
 
-        if (buffer_all_frames_for_fast_seek_ && !video_frames_.empty())
+        if (stream_video_ && stream.IsOpen())
+        {
+          if (video_seek_position_ >= 0 && video_seek_position_ <= 1)
+          {
+            stream.Seek(video_seek_position_);
+            video_seek_position_ = -1;
+            stream_seek_pending = true;
+          }
+
+          if (stream.Finished())
+          {
+            if (loop_video_)
+              stream.Seek(0.0);
+            else
+            {
+              stop_video_ = true;
+              stream.Close();
+              clearImage();
+            }
+          }
+          // a frame the decoder has not caught up with yet is shown on a
+          // later tick, the ring is never waited for
+          else if ((stream_seek_pending || !video_paused_) && stream.Next(frame))
+          {
+            stream_seek_pending = false;
+            updateVideoFrame(frame);
+          }
+        }
+        else if (buffer_all_frames_for_fast_seek_ && !video_frames_.empty())
         {
           if (video_seek_position_ >= 0 && video_seek_position_ <= 1)
           {
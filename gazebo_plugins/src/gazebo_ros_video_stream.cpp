@@ -0,0 +1,269 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include <gazebo_plugins/gazebo_ros_video_stream.h>
+
+namespace gazebo
+{
+  /// \brief Seeks at most this many frames ahead of the decoder are decoded
+  /// forward rather than repositioning it, which decodes from a keyframe.
+  static const int64_t kForwardSeekFrames = 32;
+
+  VideoFrameStream::VideoFrameStream(int _width, int _height, size_t _max_bytes)
+    : width_(_width), height_(_height), max_bytes_(_max_bytes),
+      buffer_bytes_(0), open_(false), stop_(false), fps_(0), frame_count_(0),
+      playhead_(0), window_begin_(0), decoded_end_(0), end_of_video_(false),
+      restart_at_(-1), generation_(0)
+  {
+  }
+
+  VideoFrameStream::~VideoFrameStream()
+  {
+    this->Close();
+  }
+
+  bool VideoFrameStream::Open(const std::string &_path)
+  {
+    this->Close();
+    if (!this->capture_.open(_path) || !this->capture_.isOpened())
+      return false;
+
+    const double fps = this->capture_.get(CV_CAP_PROP_FPS);
+    const int64_t frame_count =
+      std::max(0.0, this->capture_.get(CV_CAP_PROP_FRAME_COUNT));
+    const size_t source_pixels =
+      this->capture_.get(CV_CAP_PROP_FRAME_WIDTH) *
+      this->capture_.get(CV_CAP_PROP_FRAME_HEIGHT);
+    const size_t pixels = this->width_ * this->height_;
+
+    // The decoder keeps a decoded frame and a resized one, the ring gets
+    // the rest of the budget
+    this->buffer_bytes_ = source_pixels * 3 + pixels * 3;
+    size_t slots = 0;
+    if (this->max_bytes_ > this->buffer_bytes_)
+      slots = (this->max_bytes_ - this->buffer_bytes_) / (pixels * 4);
+    if (frame_count > 0)
+      slots = std::min(slots, static_cast<size_t>(frame_count));
+    slots = std::max(slots, static_cast<size_t>(2));
+
+    boost::mutex::scoped_lock lock(this->mutex_);
+    this->slots_.resize(slots);
+    for (size_t i = 0; i < slots; ++i)
+      this->slots_[i].create(this->height_, this->width_, CV_8UC4);
+
+    this->open_ = true;
+    this->stop_ = false;
+    this->fps_ = fps;
+    this->frame_count_ = frame_count;
+    this->playhead_ = 0;
+    this->window_begin_ = 0;
+    this->decoded_end_ = 0;
+    this->end_of_video_ = false;
+    this->restart_at_ = -1;
+    ++this->generation_;
+    this->thread_ = boost::thread(
+        boost::bind(&VideoFrameStream::DecodeThread, this));
+    return true;
+  }
+
+  void VideoFrameStream::Close()
+  {
+    {
+      boost::mutex::scoped_lock lock(this->mutex_);
+      if (!this->open_)
+        return;
+      this->stop_ = true;
+    }
+    this->wake_decoder_.notify_all();
+    this->thread_.join();
+    this->capture_.release();
+
+    boost::mutex::scoped_lock lock(this->mutex_);
+    this->open_ = false;
+  }
+
+  bool VideoFrameStream::IsOpen() const
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    return this->open_;
+  }
+
+  double VideoFrameStream::Fps() const
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    return this->fps_;
+  }
+
+  int64_t VideoFrameStream::FrameCount() const
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    return this->frame_count_;
+  }
+
+  void VideoFrameStream::Seek(double _position)
+  {
+    {
+      boost::mutex::scoped_lock lock(this->mutex_);
+      if (!this->open_)
+        return;
+
+      _position = std::min(std::max(_position, 0.0), 1.0);
+      const int64_t target = this->frame_count_ > 0 ?
+        static_cast<int64_t>((this->frame_count_ - 1) * _position) : 0;
+      this->playhead_ = target;
+
+      // In the ring, or the next frame the decoder delivers
+      if (target >= this->window_begin_ && target <= this->decoded_end_)
+        return;
+
+      this->restart_at_ = target;
+      ++this->generation_;
+      this->window_begin_ = target;
+      this->decoded_end_ = target;
+      this->end_of_video_ = false;
+    }
+    this->wake_decoder_.notify_all();
+  }
+
+  bool VideoFrameStream::Next(cv::Mat &_frame)
+  {
+    {
+      boost::mutex::scoped_lock lock(this->mutex_);
+      if (!this->open_ || this->playhead_ < this->window_begin_ ||
+          this->playhead_ >= this->decoded_end_)
+        return false;
+
+      // The decoder only writes the slot of decoded_end_, never this one
+      this->slots_[this->playhead_ % this->slots_.size()].copyTo(_frame);
+      ++this->playhead_;
+    }
+    // the played frame may make room for the next one
+    this->wake_decoder_.notify_all();
+    return true;
+  }
+
+  bool VideoFrameStream::Finished() const
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    return this->open_ && this->end_of_video_ &&
+           this->playhead_ >= this->decoded_end_;
+  }
+
+  size_t VideoFrameStream::Capacity() const
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    return this->slots_.size();
+  }
+
+  size_t VideoFrameStream::Bytes() const
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    return this->slots_.size() * this->width_ * this->height_ * 4 +
+           this->buffer_bytes_;
+  }
+
+  int64_t VideoFrameStream::Playhead() const
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    return this->playhead_;
+  }
+
+  void VideoFrameStream::DecodeThread()
+  {
+    const int64_t slots = this->slots_.size();
+    // played frames kept for short seeks back
+    const int64_t history = slots / 4;
+    // frame the capture reads next
+    int64_t position = 0;
+
+    while (true)
+    {
+      int64_t frame;
+      int64_t restart;
+      uint64_t generation;
+      {
+        boost::mutex::scoped_lock lock(this->mutex_);
+        // wait for a seek or for room in the ring
+        while (!this->stop_ && this->restart_at_ < 0 &&
+               (this->end_of_video_ ||
+                (this->decoded_end_ - this->window_begin_ >= slots &&
+                 this->window_begin_ + history >= this->playhead_)))
+        {
+          this->wake_decoder_.wait(lock);
+        }
+        if (this->stop_)
+          return;
+
+        restart = this->restart_at_;
+        this->restart_at_ = -1;
+        if (this->decoded_end_ - this->window_begin_ >= slots)
+          ++this->window_begin_;
+        frame = this->decoded_end_;
+        generation = this->generation_;
+      }
+
+      if (restart >= 0 && restart != position)
+      {
+        if (restart > position && restart - position <= kForwardSeekFrames)
+        {
+          while (position < restart && this->capture_.grab())
+            ++position;
+        }
+        else
+        {
+          this->capture_.set(CV_CAP_PROP_POS_FRAMES, restart);
+        }
+        position = restart;
+      }
+
+      // Decode, resize and convert without the lock, Next() and Seek() go on
+      cv::Mat &slot = this->slots_[frame % slots];
+      const bool decoded =
+        this->capture_.read(this->decoded_) && !this->decoded_.empty();
+      if (decoded)
+      {
+        ++position;
+        cv::resize(this->decoded_, this->resized_,
+                   cv::Size(this->width_, this->height_));
+        cv::cvtColor(this->resized_, slot, CV_BGR2BGRA, 4);
+      }
+
+      boost::mutex::scoped_lock lock(this->mutex_);
+      if (generation != this->generation_)
+      {
+        // a seek moved the window while decoding, the frame is not needed
+        continue;
+      }
+      if (decoded)
+      {
+        ++this->decoded_end_;
+      }
+      else
+      {
+        this->end_of_video_ = true;
+        // containers may only estimate the frame count, the decoder knows
+        // it once it read up to the end
+        if (restart < 0 && frame > 0)
+          this->frame_count_ = frame;
+      }
+    }
+  }
+}
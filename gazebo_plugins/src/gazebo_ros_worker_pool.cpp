@@ -0,0 +1,142 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+
+#include <gazebo_plugins/gazebo_ros_worker_pool.h>
+
+namespace gazebo
+{
+////////////////////////////////////////////////////////////////////////////////
+// Constructor
+WorkerPool::WorkerPool(unsigned int _threads)
+  : func_(NULL), count_(0), chunks_(0), next_chunk_(0), pending_chunks_(0),
+    generation_(0), shutdown_(false)
+{
+  if (_threads == 0)
+  {
+    // leave some headroom for the physics and rendering threads
+    _threads = std::max(1u, std::min(4u, boost::thread::hardware_concurrency()));
+  }
+
+  // the caller of ParallelFor is one of the threads
+  for (unsigned int i = 1; i < _threads; ++i)
+    this->threads_.push_back(
+      new boost::thread(boost::bind(&WorkerPool::Run, this)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Destructor
+WorkerPool::~WorkerPool()
+{
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    this->shutdown_ = true;
+  }
+  this->work_cond_.notify_all();
+
+  for (unsigned int i = 0; i < this->threads_.size(); ++i)
+  {
+    this->threads_[i]->join();
+    delete this->threads_[i];
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Number of threads
+unsigned int WorkerPool::Size() const
+{
+  return this->threads_.size() + 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Run a job on all threads
+void WorkerPool::ParallelFor(unsigned int _count, const RangeFunc &_func)
+{
+  if (_count == 0)
+    return;
+
+  if (this->threads_.empty() || _count == 1)
+  {
+    _func(0, _count);
+    return;
+  }
+
+  boost::mutex::scoped_lock dispatch_lock(this->dispatch_mutex_);
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    this->func_ = &_func;
+    this->count_ = _count;
+    this->chunks_ = std::min(_count, this->Size());
+    this->next_chunk_ = 0;
+    this->pending_chunks_ = this->chunks_;
+    ++this->generation_;
+  }
+  this->work_cond_.notify_all();
+
+  this->Drain();
+
+  boost::mutex::scoped_lock lock(this->mutex_);
+  while (this->pending_chunks_ > 0)
+    this->done_cond_.wait(lock);
+  this->func_ = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Process chunks of the current job
+void WorkerPool::Drain()
+{
+  boost::mutex::scoped_lock lock(this->mutex_);
+  while (this->next_chunk_ < this->chunks_)
+  {
+    unsigned int chunk = this->next_chunk_++;
+    const RangeFunc &func = *this->func_;
+    unsigned int begin = static_cast<unsigned long>(this->count_) * chunk /
+      this->chunks_;
+    unsigned int end = static_cast<unsigned long>(this->count_) * (chunk + 1) /
+      this->chunks_;
+
+    lock.unlock();
+    func(begin, end);
+    lock.lock();
+
+    if (--this->pending_chunks_ == 0)
+      this->done_cond_.notify_all();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Worker thread main loop
+void WorkerPool::Run()
+{
+  unsigned long seen_generation = 0;
+  while (true)
+  {
+    {
+      boost::mutex::scoped_lock lock(this->mutex_);
+      while (!this->shutdown_ && this->generation_ == seen_generation)
+        this->work_cond_.wait(lock);
+      if (this->shutdown_)
+        return;
+      seen_generation = this->generation_;
+    }
+    this->Drain();
+  }
+}
+}
@@ -0,0 +1,267 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Compares BlockLaserProjection against the PointCloud loop of
+// GazeboRosBlockLaser::PutLaserData, both for output and for speed, on a
+// 64 x 2048 scan.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <gtest/gtest.h>
+
+#include <geometry_msgs/Point32.h>
+#include <sensor_msgs/ChannelFloat32.h>
+#include <sensor_msgs/PointCloud.h>
+#include <sensor_msgs/point_cloud2_iterator.h>
+
+#include <gazebo_plugins/gazebo_ros_block_laser_projection.h>
+
+static const double kMinAngle = -M_PI;
+static const double kMaxAngle = M_PI;
+static const double kVerticalMinAngle = -0.4;
+static const double kVerticalMaxAngle = 0.2;
+static const double kMinRange = 0.1;
+static const double kMaxRange = 100.0;
+
+/// \brief Stand-in for the laser shape, one virtual call per reading.
+class Shape
+{
+  public: Shape(const std::vector<double> &_ranges, const std::vector<double> &_retros)
+    : ranges_(_ranges), retros_(_retros) {}
+  public: virtual ~Shape() {}
+  public: virtual double GetRange(unsigned int _index) { return this->ranges_.at(_index); }
+  public: virtual double GetRetro(unsigned int _index) { return this->retros_.at(_index); }
+  private: const std::vector<double> &ranges_;
+  private: const std::vector<double> &retros_;
+};
+
+static double GaussianKernel(double mu, double sigma)
+{
+  double U = (double)rand()/(double)RAND_MAX; // normalized uniform random variable
+  double V = (double)rand()/(double)RAND_MAX; // normalized uniform random variable
+  double X = sqrt(-2.0 * ::log(U)) * cos( 2.0*M_PI * V);
+  X = sigma * X + mu;
+  return X;
+}
+
+/// \brief The original GazeboRosBlockLaser::PutLaserData loop.
+static void LegacyFill(sensor_msgs::PointCloud &cloud_msg, Shape *shape,
+                       int rayCount, int rangeCount,
+                       int verticalRayCount, int verticalRangeCount, double noise)
+{
+  double yDiff = kMaxAngle - kMinAngle;
+  double pDiff = kVerticalMaxAngle - kVerticalMinAngle;
+  double maxRange = kMaxRange;
+  double minRange = kMinRange;
+
+  cloud_msg.points.clear();
+  cloud_msg.channels.clear();
+  cloud_msg.channels.push_back(sensor_msgs::ChannelFloat32());
+
+  for (int j = 0; j<verticalRangeCount; j++)
+  {
+    double vb = (verticalRangeCount == 1) ? 0 : (double) j * (verticalRayCount - 1) / (verticalRangeCount - 1);
+    int vja = (int) floor(vb);
+    int vjb = std::min(vja + 1, verticalRayCount - 1);
+    vb = vb - floor(vb);
+
+    for (int i = 0; i<rangeCount; i++)
+    {
+      double hb = (rangeCount == 1)? 0 : (double) i * (rayCount - 1) / (rangeCount - 1);
+      int hja = (int) floor(hb);
+      int hjb = std::min(hja + 1, rayCount - 1);
+      hb = hb - floor(hb);
+
+      int j1 = hja + vja * rayCount;
+      int j2 = hjb + vja * rayCount;
+      int j3 = hja + vjb * rayCount;
+      int j4 = hjb + vjb * rayCount;
+      double r1 = std::min(shape->GetRange(j1) , maxRange-minRange);
+      double r2 = std::min(shape->GetRange(j2) , maxRange-minRange);
+      double r3 = std::min(shape->GetRange(j3) , maxRange-minRange);
+      double r4 = std::min(shape->GetRange(j4) , maxRange-minRange);
+
+      double r = (1-vb)*((1 - hb) * r1 + hb * r2)
+                +   vb *((1 - hb) * r3 + hb * r4);
+
+      double intensity = 0.25*(shape->GetRetro(j1) + shape->GetRetro(j2) +
+                               shape->GetRetro(j3) + shape->GetRetro(j4));
+
+      double yAngle = 0.5*(hja+hjb) * yDiff / (rayCount -1) + kMinAngle;
+      double pAngle = 0.5*(vja+vjb) * pDiff / (verticalRayCount -1) + kVerticalMinAngle;
+
+      double diffRange = maxRange - minRange;
+      double diff  = diffRange - r;
+      geometry_msgs::Point32 point;
+      if (fabs(diff) < 0.000001)
+      {
+        point.x = r * cos(pAngle) * cos(yAngle);
+        point.y = r * cos(pAngle) * sin(yAngle);
+        point.z = r * sin(pAngle);
+      }
+      else
+      {
+        point.x = r * cos(pAngle) * cos(yAngle) + GaussianKernel(0,noise);
+        point.y = r * cos(pAngle) * sin(yAngle) + GaussianKernel(0,noise);
+        point.z = r * sin(pAngle) + GaussianKernel(0,noise);
+      }
+      cloud_msg.points.push_back(point);
+      cloud_msg.channels[0].values.push_back(intensity + GaussianKernel(0,noise));
+    }
+  }
+}
+
+static double ElapsedMs(const boost::posix_time::ptime &start)
+{
+  return (boost::posix_time::microsec_clock::universal_time() - start)
+    .total_microseconds() / 1000.0;
+}
+
+TEST(BlockLaserProjectionBenchmark, matchesLegacyAndTime)
+{
+  const int rayCount = 2048;
+  const int verticalRayCount = 64;
+  const int frames = 10;
+
+  srand(42);
+  std::vector<double> ranges(rayCount * verticalRayCount);
+  std::vector<double> retros(ranges.size());
+  for (size_t k = 0; k < ranges.size(); ++k)
+  {
+    // about 10% of the rays see nothing
+    ranges[k] = (k % 10 == 0) ? kMaxRange : 0.5 + 50.0 * (rand() / static_cast<double>(RAND_MAX));
+    retros[k] = 200.0 * (rand() / static_cast<double>(RAND_MAX));
+  }
+  Shape shape(ranges, retros);
+
+  gazebo::BlockLaserProjection projection;
+  projection.SetRange(kMinRange, kMaxRange);
+  projection.SetGeometry(rayCount, rayCount, verticalRayCount, verticalRayCount,
+                         kMinAngle, kMaxAngle, kVerticalMinAngle, kVerticalMaxAngle);
+
+  // without noise both produce the same cloud, also when points
+  // interpolate between rays
+  const int counts[][2] = {{rayCount, verticalRayCount}, {1500, 40}};
+  for (int c = 0; c < 2; ++c)
+  {
+    sensor_msgs::PointCloud legacy_msg;
+    LegacyFill(legacy_msg, &shape, rayCount, counts[c][0], verticalRayCount, counts[c][1], 0.0);
+
+    sensor_msgs::PointCloud2 msg;
+    projection.SetGeometry(rayCount, counts[c][0], verticalRayCount, counts[c][1],
+                           kMinAngle, kMaxAngle, kVerticalMinAngle, kVerticalMaxAngle);
+    projection.Fill(msg, &ranges[0], &retros[0]);
+
+    ASSERT_EQ(static_cast<uint32_t>(counts[c][1]), msg.height);
+    ASSERT_EQ(static_cast<uint32_t>(counts[c][0]), msg.width);
+    ASSERT_EQ(legacy_msg.points.size(), msg.width * msg.height);
+
+    sensor_msgs::PointCloud2ConstIterator<float> x(msg, "x");
+    sensor_msgs::PointCloud2ConstIterator<float> intensity(msg, "intensity");
+    for (size_t k = 0; k < legacy_msg.points.size(); ++k, ++x, ++intensity)
+    {
+      const geometry_msgs::Point32 &p = legacy_msg.points[k];
+      EXPECT_NEAR(p.x, x[0], 1e-4);
+      EXPECT_NEAR(p.y, x[1], 1e-4);
+      EXPECT_NEAR(p.z, x[2], 1e-4);
+      EXPECT_NEAR(legacy_msg.channels[0].values[k], *intensity, 1e-4);
+    }
+  }
+  projection.SetGeometry(rayCount, rayCount, verticalRayCount, verticalRayCount,
+                         kMinAngle, kMaxAngle, kVerticalMinAngle, kVerticalMaxAngle);
+
+  // the noise is zero mean with the requested deviation
+  const double sigma = 0.01;
+  projection.SetNoise(sigma, 7);
+  sensor_msgs::PointCloud2 clean_msg;
+  sensor_msgs::PointCloud2 noisy_msg;
+  projection.SetNoise(0.0);
+  projection.Fill(clean_msg, &ranges[0], &retros[0]);
+  projection.SetNoise(sigma, 7);
+  projection.Fill(noisy_msg, &ranges[0], &retros[0]);
+  {
+    sensor_msgs::PointCloud2ConstIterator<float> clean(clean_msg, "intensity");
+    sensor_msgs::PointCloud2ConstIterator<float> noisy(noisy_msg, "intensity");
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    size_t n = clean_msg.width * clean_msg.height;
+    for (size_t k = 0; k < n; ++k, ++clean, ++noisy)
+    {
+      double d = *noisy - *clean;
+      sum += d;
+      sum_sq += d * d;
+    }
+    double mean = sum / n;
+    EXPECT_NEAR(0.0, mean, 0.05 * sigma);
+    EXPECT_NEAR(sigma, std::sqrt(sum_sq / n - mean * mean), 0.05 * sigma);
+  }
+
+  // the same seed gives the same noise with any number of threads
+  gazebo::BlockLaserProjection single;
+  gazebo::BlockLaserProjection pooled;
+  pooled.SetThreads(0);
+  gazebo::BlockLaserProjection *projections[] = {&single, &pooled};
+  sensor_msgs::PointCloud2 msgs[2];
+  for (int p = 0; p < 2; ++p)
+  {
+    projections[p]->SetRange(kMinRange, kMaxRange);
+    projections[p]->SetGeometry(rayCount, rayCount, verticalRayCount, verticalRayCount,
+                                kMinAngle, kMaxAngle, kVerticalMinAngle, kVerticalMaxAngle);
+    projections[p]->SetNoise(sigma, 7);
+    projections[p]->Fill(msgs[p], &ranges[0], &retros[0]);
+  }
+  EXPECT_TRUE(msgs[0].data == msgs[1].data);
+
+  sensor_msgs::PointCloud legacy_msg;
+  boost::posix_time::ptime start =
+    boost::posix_time::microsec_clock::universal_time();
+  for (int f = 0; f < frames; ++f)
+    LegacyFill(legacy_msg, &shape, rayCount, rayCount, verticalRayCount, verticalRayCount, sigma);
+  double legacy_ms = ElapsedMs(start) / frames;
+
+  sensor_msgs::PointCloud2 msg;
+  start = boost::posix_time::microsec_clock::universal_time();
+  for (int f = 0; f < frames; ++f)
+  {
+    // the plugin reads every ray once per scan
+    for (size_t k = 0; k < ranges.size(); ++k)
+    {
+      ranges[k] = shape.GetRange(k);
+      retros[k] = shape.GetRetro(k);
+    }
+    projection.Fill(msg, &ranges[0], &retros[0]);
+  }
+  double single_ms = ElapsedMs(start) / frames;
+
+  start = boost::posix_time::microsec_clock::universal_time();
+  for (int f = 0; f < frames; ++f)
+    pooled.Fill(msg, &ranges[0], &retros[0]);
+  double pool_ms = ElapsedMs(start) / frames;
+
+  printf("%dx%d with noise: legacy PointCloud %.3f ms, PointCloud2 %.3f ms, "
+         "PointCloud2 (pool) %.3f ms per scan\n",
+         rayCount, verticalRayCount, legacy_ms, single_ms, pool_ms);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,358 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Drops boxes carrying bumpers in the full, debug, summary and filtered
+// modes onto the ground plane, checks what each mode reports once they
+// rest, and compares the size of the full and summary messages.  Then
+// fills the messages from made up contacts, counting the allocations of
+// the filling thread: once the buffers have grown to the largest contact
+// set, an update allocates nothing, whether the contact set stays or
+// shrinks and grows back.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+#include <gazebo_msgs/ContactsState.h>
+#include <gazebo_msgs/ContactsSummary.h>
+#include <gazebo_msgs/SpawnModel.h>
+
+#include <gazebo_plugins/gazebo_ros_bumper_contacts.h>
+
+/// \brief Allocations of this thread while counting
+static thread_local bool g_counting = false;
+static thread_local unsigned int g_allocations = 0;
+
+void *operator new(std::size_t _size)
+{
+  if (g_counting)
+    ++g_allocations;
+  void *p = std::malloc(_size ? _size : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *_p) noexcept
+{
+  std::free(_p);
+}
+
+/// \brief Allocations of this thread during _func
+template <typename Func>
+static unsigned int Allocations(const Func &_func)
+{
+  g_allocations = 0;
+  g_counting = true;
+  _func();
+  g_counting = false;
+  return g_allocations;
+}
+
+static const double kMass = 2.0;
+static const double kGravity = 9.81;
+
+/// \brief A box resting on the ground with a contact sensor and a bumper
+static std::string BumperBoxSDF(const std::string &_name, double _x,
+                                const std::string &_plugin_sdf)
+{
+  return "<?xml version='1.0'?><sdf version='1.4'><model name='" + _name + "'>"
+         "<pose>" + std::to_string(_x) + " 0 0.26 0 0 0</pose>"
+         "<link name='link'><inertial><mass>" + std::to_string(kMass) + "</mass></inertial>"
+         "<collision name='collision'><geometry><box><size>0.5 0.5 0.5</size></box></geometry></collision>"
+         "<sensor name='bumper' type='contact'><always_on>true</always_on><update_rate>10</update_rate>"
+         "<contact><collision>collision</collision></contact>"
+         "<plugin name='bumper' filename='libgazebo_ros_bumper.so'>"
+         "<bumperTopicName>" + _name + "_bumper</bumperTopicName><frameName>world</frameName>" +
+         _plugin_sdf + "</plugin></sensor>"
+         "</link></model></sdf>";
+}
+
+template <typename M>
+class Latest
+{
+public:
+  Latest(ros::NodeHandle &_nh, const std::string &_topic)
+  {
+    sub_ = _nh.subscribe(_topic, 1, &Latest::Callback, this);
+  }
+
+  /// \brief Wait for a message with at least _min_states states
+  bool Wait(size_t _min_states)
+  {
+    msg_.reset();
+    ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(30.0);
+    while (ros::WallTime::now() < deadline)
+    {
+      ros::spinOnce();
+      if (msg_ && msg_->states.size() >= _min_states)
+        return true;
+      msg_.reset();
+      ros::WallDuration(0.01).sleep();
+    }
+    return false;
+  }
+
+  void Callback(const boost::shared_ptr<const M> &_msg)
+  {
+    msg_ = _msg;
+  }
+
+  ros::Subscriber sub_;
+  boost::shared_ptr<const M> msg_;
+};
+
+class BumperSummaryBenchmark : public testing::Test
+{
+protected:
+  static void SetUpTestCase()
+  {
+    ros::NodeHandle nh;
+    ASSERT_TRUE(ros::service::waitForService("/gazebo/spawn_sdf_model", ros::Duration(60.0)));
+    ros::ServiceClient spawn_model = nh.serviceClient<gazebo_msgs::SpawnModel>("/gazebo/spawn_sdf_model");
+    const char *names[] = {"full", "debug", "summary", "filtered", "ground"};
+    const char *plugin_sdf[] = {
+      "",
+      "<debugInfo>true</debugInfo>",
+      "<contactSummary>true</contactSummary>",
+      "<contactSummary>true</contactSummary><otherCollisionName>no_such_model</otherCollisionName>",
+      "<otherCollisionName>ground_plane::</otherCollisionName>"};
+    for (int i = 0; i < 5; ++i)
+    {
+      gazebo_msgs::SpawnModel spawn;
+      spawn.request.model_name = names[i];
+      spawn.request.model_xml = BumperBoxSDF(names[i], 2.0 * i, plugin_sdf[i]);
+      spawn.request.initial_pose.orientation.w = 1.0;
+      ASSERT_TRUE(spawn_model.call(spawn));
+      ASSERT_TRUE(spawn.response.success) << spawn.response.status_message;
+    }
+    // let the boxes settle on the ground
+    ros::WallDuration(2.0).sleep();
+  }
+
+  ros::NodeHandle nh_;
+};
+
+/// \brief Magnitude of the vertical force of a wrench, whichever body it is on
+static double Weight(const geometry_msgs::Wrench &_wrench)
+{
+  return std::fabs(_wrench.force.z);
+}
+
+TEST_F(BumperSummaryBenchmark, fullReportsEveryPoint)
+{
+  Latest<gazebo_msgs::ContactsState> full(nh_, "/full_bumper");
+  ASSERT_TRUE(full.Wait(1));
+  for (size_t i = 0; i < full.msg_->states.size(); ++i)
+  {
+    const gazebo_msgs::ContactState &state = full.msg_->states[i];
+    EXPECT_TRUE(state.info.empty());
+    ASSERT_FALSE(state.depths.empty());
+    EXPECT_EQ(state.depths.size(), state.wrenches.size());
+    EXPECT_EQ(state.depths.size(), state.contact_positions.size());
+    EXPECT_EQ(state.depths.size(), state.contact_normals.size());
+  }
+  EXPECT_NEAR(kMass * kGravity, Weight(full.msg_->states.back().total_wrench), 0.2 * kMass * kGravity);
+
+  Latest<gazebo_msgs::ContactsState> debug(nh_, "/debug_bumper");
+  ASSERT_TRUE(debug.Wait(1));
+  EXPECT_NE(std::string::npos, debug.msg_->states[0].info.find("other geom"));
+}
+
+TEST_F(BumperSummaryBenchmark, summaryKeepsOnePerPair)
+{
+  Latest<gazebo_msgs::ContactsSummary> summary(nh_, "/summary_bumper");
+  ASSERT_TRUE(summary.Wait(1));
+  ASSERT_EQ(1u, summary.msg_->states.size());
+  const gazebo_msgs::ContactSummary &state = summary.msg_->states[0];
+  EXPECT_NE(std::string::npos, (state.collision1_name + state.collision2_name).find("ground_plane"));
+  EXPECT_GT(state.contact_count, 0u);
+  EXPECT_GE(state.deepest_depth, 0.0);
+  EXPECT_NEAR(0.0, state.deepest_position.z, 0.05);
+  EXPECT_NEAR(1.0, std::fabs(state.deepest_normal.z), 1e-3);
+  EXPECT_NEAR(kMass * kGravity, Weight(state.total_wrench), 0.2 * kMass * kGravity);
+}
+
+TEST_F(BumperSummaryBenchmark, filtersOnOtherCollision)
+{
+  Latest<gazebo_msgs::ContactsState> ground(nh_, "/ground_bumper");
+  ASSERT_TRUE(ground.Wait(1));
+
+  Latest<gazebo_msgs::ContactsSummary> filtered(nh_, "/filtered_bumper");
+  ASSERT_TRUE(filtered.Wait(0));
+  EXPECT_TRUE(filtered.msg_->states.empty());
+}
+
+TEST_F(BumperSummaryBenchmark, messageSizes)
+{
+  Latest<gazebo_msgs::ContactsState> full(nh_, "/full_bumper");
+  Latest<gazebo_msgs::ContactsState> debug(nh_, "/debug_bumper");
+  Latest<gazebo_msgs::ContactsSummary> summary(nh_, "/summary_bumper");
+  ASSERT_TRUE(full.Wait(1));
+  ASSERT_TRUE(debug.Wait(1));
+  ASSERT_TRUE(summary.Wait(1));
+
+  const uint32_t full_bytes = ros::serialization::serializationLength(*full.msg_);
+  const uint32_t debug_bytes = ros::serialization::serializationLength(*debug.msg_);
+  const uint32_t summary_bytes = ros::serialization::serializationLength(*summary.msg_);
+  EXPECT_LT(summary_bytes, full_bytes);
+
+  printf("full: %lu states, %u bytes per update\n", (unsigned long)full.msg_->states.size(), full_bytes);
+  printf("full with debug info: %lu states, %u bytes per update\n",
+         (unsigned long)debug.msg_->states.size(), debug_bytes);
+  printf("summary: %lu states, %u bytes per update\n", (unsigned long)summary.msg_->states.size(), summary_bytes);
+}
+
+/// \brief Add the contacts of a step with _pairs obstacles touching a box,
+/// each in _points points pushing the box up by 1 N
+static void AddStep(gazebo::msgs::Contacts &_contacts, int _step,
+                    unsigned int _pairs, unsigned int _points)
+{
+  _contacts.mutable_time()->set_sec(_step);
+  _contacts.mutable_time()->set_nsec(0);
+  for (unsigned int p = 0; p < _pairs; ++p)
+  {
+    gazebo::msgs::Contact *contact = _contacts.add_contact();
+    contact->set_collision1("box::link::collision");
+    contact->set_collision2("obstacle_" + std::to_string(p) + "::link::collision");
+    contact->set_world("default");
+    contact->mutable_time()->set_sec(_step);
+    contact->mutable_time()->set_nsec(0);
+    for (unsigned int j = 0; j < _points; ++j)
+    {
+      gazebo::msgs::Set(contact->add_position(), ignition::math::Vector3d(p, j, 0));
+      gazebo::msgs::Set(contact->add_normal(), ignition::math::Vector3d(0, 0, 1));
+      contact->add_depth(0.001 * (j + 1));
+      gazebo::msgs::JointWrench *wrench = contact->add_wrench();
+      wrench->set_body_1_name(contact->collision1());
+      wrench->set_body_1_id(1);
+      wrench->set_body_2_name(contact->collision2());
+      wrench->set_body_2_id(2);
+      gazebo::msgs::Set(wrench->mutable_body_1_wrench()->mutable_force(), ignition::math::Vector3d(0, 0, 1));
+      gazebo::msgs::Set(wrench->mutable_body_1_wrench()->mutable_torque(), ignition::math::Vector3d::Zero);
+      gazebo::msgs::Set(wrench->mutable_body_2_wrench()->mutable_force(), ignition::math::Vector3d(0, 0, -1));
+      gazebo::msgs::Set(wrench->mutable_body_2_wrench()->mutable_torque(), ignition::math::Vector3d::Zero);
+    }
+  }
+}
+
+TEST(BumperContacts, fillReusesBuffers)
+{
+  gazebo::BumperContacts filler;
+  filler.SetCollisionNames(std::vector<std::string>(1, "box::link::collision"));
+  filler.SetOtherCollisionFilter("obstacle_");
+  const ignition::math::Vector3d frame_pos;
+  const ignition::math::Quaterniond frame_rot;
+
+  gazebo::msgs::Contacts many, few;
+  AddStep(many, 1, 3, 4);
+  AddStep(few, 2, 1, 2);
+
+  gazebo_msgs::ContactsState msg;
+  const unsigned int first = Allocations([&]() { filler.Fill(msg, many, frame_pos, frame_rot); });
+  EXPECT_GT(first, 0u);
+  ASSERT_EQ(3u, msg.states.size());
+  const gazebo_msgs::ContactState *states = &msg.states[0];
+  const geometry_msgs::Wrench *wrenches = &msg.states[2].wrenches[0];
+
+  // a steady contact set is filled into the same buffers
+  EXPECT_EQ(0u, Allocations([&]() { filler.Fill(msg, many, frame_pos, frame_rot); }));
+  EXPECT_EQ(states, &msg.states[0]);
+  EXPECT_EQ(wrenches, &msg.states[2].wrenches[0]);
+
+  // the states dropped by a smaller set keep their buffers for the next
+  // larger one, once the spare states have room for them
+  filler.Fill(msg, few, frame_pos, frame_rot);
+  filler.Fill(msg, many, frame_pos, frame_rot);
+  unsigned int steady = 0;
+  for (int i = 0; i < 10; ++i)
+  {
+    steady += Allocations([&]() { filler.Fill(msg, few, frame_pos, frame_rot); });
+    ASSERT_EQ(1u, msg.states.size());
+    EXPECT_EQ(2u, msg.states[0].depths.size());
+    steady += Allocations([&]() { filler.Fill(msg, many, frame_pos, frame_rot); });
+    ASSERT_EQ(3u, msg.states.size());
+  }
+  EXPECT_EQ(0u, steady);
+  EXPECT_EQ(states, &msg.states[0]);
+  EXPECT_EQ(wrenches, &msg.states[2].wrenches[0]);
+
+  EXPECT_EQ("obstacle_2::link::collision", msg.states[2].collision2_name);
+  EXPECT_TRUE(msg.states[2].info.empty());
+  ASSERT_EQ(4u, msg.states[2].depths.size());
+  EXPECT_DOUBLE_EQ(0.004, msg.states[2].depths[3]);
+  EXPECT_DOUBLE_EQ(3.0, msg.states[2].contact_positions[3].y);
+  EXPECT_DOUBLE_EQ(4.0, msg.states[2].total_wrench.force.z);
+  EXPECT_EQ(ros::Time(1, 0), msg.header.stamp);
+
+  printf("full: %u allocations on the first update, %u per update after\n", first, steady / 20);
+}
+
+TEST(BumperContacts, summaryReusesBuffers)
+{
+  gazebo::BumperContacts filler;
+  const ignition::math::Vector3d frame_pos;
+  const ignition::math::Quaterniond frame_rot;
+
+  // the sensor reports every physics step since its last update, the pairs
+  // of the latest step are summarized
+  gazebo::msgs::Contacts many, few;
+  AddStep(many, 1, 3, 4);
+  AddStep(many, 2, 3, 5);
+  AddStep(few, 3, 1, 2);
+
+  gazebo_msgs::ContactsSummary msg;
+  const unsigned int first = Allocations([&]() { filler.FillSummary(msg, many, frame_pos, frame_rot); });
+  ASSERT_EQ(3u, msg.states.size());
+  const gazebo_msgs::ContactSummary *states = &msg.states[0];
+
+  filler.FillSummary(msg, few, frame_pos, frame_rot);
+  filler.FillSummary(msg, many, frame_pos, frame_rot);
+  unsigned int steady = 0;
+  for (int i = 0; i < 10; ++i)
+  {
+    steady += Allocations([&]() { filler.FillSummary(msg, few, frame_pos, frame_rot); });
+    ASSERT_EQ(1u, msg.states.size());
+    EXPECT_EQ(2u, msg.states[0].contact_count);
+    steady += Allocations([&]() { filler.FillSummary(msg, many, frame_pos, frame_rot); });
+    ASSERT_EQ(3u, msg.states.size());
+  }
+  EXPECT_EQ(0u, steady);
+  EXPECT_EQ(states, &msg.states[0]);
+
+  const gazebo_msgs::ContactSummary &state = msg.states[2];
+  EXPECT_EQ("obstacle_2::link::collision", state.collision2_name);
+  EXPECT_EQ(5u, state.contact_count);
+  EXPECT_DOUBLE_EQ(5.0, state.total_wrench.force.z);
+  EXPECT_DOUBLE_EQ(0.005, state.deepest_depth);
+  EXPECT_DOUBLE_EQ(4.0, state.deepest_position.y);
+
+  printf("summary: %u allocations on the first update, %u per update after\n", first, steady / 20);
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "bumper_summary_benchmark");
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,220 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Latency and throughput of the two depth image publishing paths of the
+// depth camera plugins, as seen by an intraprocess subscriber:
+//  - copy: fill a member sensor_msgs::Image, then publish it by value, which
+//    makes roscpp serialize it and the subscriber deserialize it again
+//  - pool: fill a MessagePool image in place and hand over the pointer
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <limits>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/thread.hpp>
+#include <gtest/gtest.h>
+
+#include <ros/serialization.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/image_encodings.h>
+
+#include <gazebo_plugins/gazebo_ros_message_pool.h>
+
+using boost::posix_time::ptime;
+using boost::posix_time::microsec_clock;
+
+static const uint32_t kRows = 480;
+static const uint32_t kCols = 640;
+static const float kCutoff = 0.4f;
+
+static ptime Now()
+{
+  return microsec_clock::universal_time();
+}
+
+/// \brief Same single pass as FillDepthImageHelper.
+static void FillDepth(sensor_msgs::Image &image_msg, const float *src)
+{
+  image_msg.encoding = sensor_msgs::image_encodings::TYPE_32FC1;
+  image_msg.height = kRows;
+  image_msg.width = kCols;
+  image_msg.step = sizeof(float) * kCols;
+  image_msg.data.resize(kRows * kCols * sizeof(float));
+  image_msg.is_bigendian = 0;
+
+  const float bad_point = std::numeric_limits<float>::quiet_NaN();
+  float *dest = reinterpret_cast<float*>(&image_msg.data[0]);
+  for (uint32_t index = 0; index < kRows * kCols; index++)
+    dest[index] = src[index] > kCutoff ? src[index] : bad_point;
+}
+
+/// \brief Stand-in for an intraprocess subscriber thread.
+class Subscriber
+{
+  public: Subscriber(size_t frames) : start_(frames), latency_us_(frames, 0),
+                                      received_(0), running_(true)
+  {
+    this->thread_ = boost::thread(boost::bind(&Subscriber::Run, this));
+  }
+
+  public: ~Subscriber()
+  {
+    {
+      boost::mutex::scoped_lock lock(this->mutex_);
+      this->running_ = false;
+    }
+    this->cond_.notify_one();
+    this->thread_.join();
+  }
+
+  public: void Deliver(const sensor_msgs::ImageConstPtr &msg)
+  {
+    {
+      boost::mutex::scoped_lock lock(this->mutex_);
+      this->queue_.push_back(msg);
+    }
+    this->cond_.notify_one();
+  }
+
+  public: void WaitFor(size_t frames)
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    while (this->received_ < frames)
+      this->done_cond_.wait(lock);
+  }
+
+  private: void Run()
+  {
+    boost::mutex::scoped_lock lock(this->mutex_);
+    while (this->running_)
+    {
+      if (this->queue_.empty())
+      {
+        this->cond_.wait(lock);
+        continue;
+      }
+      sensor_msgs::ImageConstPtr msg = this->queue_.front();
+      this->queue_.pop_front();
+      ptime now = Now();
+      this->latency_us_[msg->header.seq] =
+        (now - this->start_[msg->header.seq]).total_microseconds();
+      ++this->received_;
+      this->done_cond_.notify_all();
+    }
+  }
+
+  public: std::vector<ptime> start_;
+  public: std::vector<long> latency_us_;
+  private: size_t received_;
+  private: bool running_;
+  private: std::deque<sensor_msgs::ImageConstPtr> queue_;
+  private: boost::mutex mutex_;
+  private: boost::condition_variable cond_;
+  private: boost::condition_variable done_cond_;
+  private: boost::thread thread_;
+};
+
+/// \brief Publish frames at _rate Hz (0 = as fast as possible).
+/// \return Achieved frames per second.
+static double Run(bool pooled, double rate, size_t frames,
+                  double &mean_us, long &max_us)
+{
+  std::vector<float> depth(kRows * kCols);
+  for (size_t k = 0; k < depth.size(); ++k)
+    depth[k] = 0.1f + 0.001f * (k % 5000);
+
+  Subscriber sub(frames);
+  sensor_msgs::Image member_msg;
+  gazebo::MessagePool<sensor_msgs::Image> pool;
+
+  ptime begin = Now();
+  for (size_t f = 0; f < frames; ++f)
+  {
+    if (rate > 0)
+    {
+      ptime tick = begin + boost::posix_time::microseconds(
+        static_cast<long>(f * 1e6 / rate));
+      boost::this_thread::sleep(tick);
+    }
+
+    sub.start_[f] = Now();
+    if (pooled)
+    {
+      sensor_msgs::ImagePtr msg = pool.Acquire();
+      msg->header.seq = f;
+      FillDepth(*msg, &depth[0]);
+      sub.Deliver(msg);
+    }
+    else
+    {
+      member_msg.header.seq = f;
+      FillDepth(member_msg, &depth[0]);
+      // what roscpp does for publish(const M&) and the receiving side
+      ros::SerializedMessage serialized =
+        ros::serialization::serializeMessage(member_msg);
+      sensor_msgs::ImagePtr msg(new sensor_msgs::Image);
+      ros::serialization::IStream stream(serialized.message_start,
+        serialized.num_bytes - (serialized.message_start - serialized.buf.get()));
+      ros::serialization::deserialize(stream, *msg);
+      sub.Deliver(msg);
+    }
+  }
+  sub.WaitFor(frames);
+  double seconds = (Now() - begin).total_microseconds() / 1e6;
+
+  mean_us = 0;
+  max_us = 0;
+  for (size_t f = 0; f < frames; ++f)
+  {
+    mean_us += sub.latency_us_[f];
+    max_us = std::max(max_us, sub.latency_us_[f]);
+  }
+  mean_us /= frames;
+
+  // when paced, frames are consumed before the next one is produced
+  if (pooled && rate > 0)
+    EXPECT_LE(pool.Allocated(), 4u);
+  return frames / seconds;
+}
+
+TEST(DepthImagePoolBenchmark, latencyAndThroughput)
+{
+  const double rates[] = {30.0, 60.0, 0.0};
+  for (int r = 0; r < 3; ++r)
+  {
+    size_t frames = rates[r] > 0 ? static_cast<size_t>(rates[r] * 2) : 300;
+    for (int pooled = 0; pooled < 2; ++pooled)
+    {
+      double mean_us;
+      long max_us;
+      double fps = Run(pooled, rates[r], frames, mean_us, max_us);
+      printf("%s @ %s: %.1f fps, latency mean %.1f us, max %ld us\n",
+             pooled ? "pool" : "copy",
+             rates[r] > 0 ? (rates[r] > 30 ? "60 Hz" : "30 Hz") : "max rate",
+             fps, mean_us, max_us);
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
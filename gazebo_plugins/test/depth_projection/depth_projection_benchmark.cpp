@@ -0,0 +1,192 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Compares DepthProjection against the per-pixel atan2/tan loop that the
+// depth camera plugins used before, both for output and for speed.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <gtest/gtest.h>
+
+#include <sensor_msgs/point_cloud2_iterator.h>
+
+#include <gazebo_plugins/gazebo_ros_depth_projection.h>
+
+static const double kHfov = 1.047;
+static const double kCutoff = 0.4;
+static const double kCutoffMax = 5.0;
+
+/// \brief The original GazeboRosOpenniKinect::FillPointCloudHelper loop.
+bool LegacyFill(sensor_msgs::PointCloud2 &point_cloud_msg,
+                uint32_t rows_arg, uint32_t cols_arg, const float *toCopyFrom,
+                const std::vector<uint8_t> &image)
+{
+  sensor_msgs::PointCloud2Modifier pcd_modifier(point_cloud_msg);
+  pcd_modifier.setPointCloud2FieldsByString(2, "xyz", "rgb");
+  pcd_modifier.resize(rows_arg*cols_arg);
+  bool is_dense = true;
+
+  sensor_msgs::PointCloud2Iterator<float> iter_x(point_cloud_msg, "x");
+  sensor_msgs::PointCloud2Iterator<float> iter_y(point_cloud_msg, "y");
+  sensor_msgs::PointCloud2Iterator<float> iter_z(point_cloud_msg, "z");
+  sensor_msgs::PointCloud2Iterator<uint8_t> iter_rgb(point_cloud_msg, "rgb");
+
+  int index = 0;
+  double fl = ((double)cols_arg) / (2.0 *tan(kHfov/2.0));
+
+  for (uint32_t j=0; j<rows_arg; j++)
+  {
+    double pAngle;
+    if (rows_arg>1) pAngle = atan2( (double)j - 0.5*(double)(rows_arg-1), fl);
+    else            pAngle = 0.0;
+
+    for (uint32_t i=0; i<cols_arg; i++, ++iter_x, ++iter_y, ++iter_z, ++iter_rgb)
+    {
+      double yAngle;
+      if (cols_arg>1) yAngle = atan2( (double)i - 0.5*(double)(cols_arg-1), fl);
+      else            yAngle = 0.0;
+
+      double depth = toCopyFrom[index++];
+
+      if(depth > kCutoff && depth < kCutoffMax)
+      {
+        *iter_x = depth * tan(yAngle);
+        *iter_y = depth * tan(pAngle);
+        *iter_z = depth;
+      }
+      else
+      {
+        *iter_x = *iter_y = *iter_z = std::numeric_limits<float>::quiet_NaN ();
+        is_dense = false;
+      }
+
+      const uint8_t* image_src = image.empty() ? NULL : &image[0];
+      if (image.size() == rows_arg*cols_arg*3)
+      {
+        iter_rgb[0] = image_src[i*3+j*cols_arg*3+0];
+        iter_rgb[1] = image_src[i*3+j*cols_arg*3+1];
+        iter_rgb[2] = image_src[i*3+j*cols_arg*3+2];
+      }
+      else
+      {
+        iter_rgb[0] = 0;
+        iter_rgb[1] = 0;
+        iter_rgb[2] = 0;
+      }
+    }
+  }
+  return is_dense;
+}
+
+class DepthProjectionBenchmark : public ::testing::TestWithParam<int>
+{
+  protected: void MakeFrame(uint32_t rows, uint32_t cols)
+  {
+    srand(42);
+    depth_.resize(rows * cols);
+    image_.resize(rows * cols * 3);
+    for (size_t k = 0; k < depth_.size(); ++k)
+    {
+      // about 10% of the points fall outside of the cutoff range
+      depth_[k] = 0.2f + 5.3f * (rand() / static_cast<float>(RAND_MAX));
+      image_[3 * k] = k;
+      image_[3 * k + 1] = k >> 8;
+      image_[3 * k + 2] = k >> 16;
+    }
+  }
+
+  protected: std::vector<float> depth_;
+  protected: std::vector<uint8_t> image_;
+};
+
+static double ElapsedMs(const boost::posix_time::ptime &start)
+{
+  return (boost::posix_time::microsec_clock::universal_time() - start)
+    .total_microseconds() / 1000.0;
+}
+
+TEST_P(DepthProjectionBenchmark, matchesLegacyAndTime)
+{
+  const uint32_t cols = GetParam();
+  const uint32_t rows = cols == 1280 ? 720 : 480;
+  const int frames = 30;
+  MakeFrame(rows, cols);
+
+  sensor_msgs::PointCloud2 legacy_msg;
+  bool legacy_dense = LegacyFill(legacy_msg, rows, cols, &depth_[0], image_);
+
+  gazebo::DepthProjection projection;
+  projection.SetCutoff(kCutoff, kCutoffMax);
+  projection.SetGeometry(rows, cols, kHfov);
+
+  sensor_msgs::PointCloud2 msg;
+  bool dense = projection.Fill(msg, &depth_[0], image_);
+
+  EXPECT_EQ(legacy_dense, dense);
+  ASSERT_EQ(legacy_msg.data.size(), msg.data.size());
+  ASSERT_EQ(legacy_msg.point_step, msg.point_step);
+
+  sensor_msgs::PointCloud2ConstIterator<float> lx(legacy_msg, "x");
+  sensor_msgs::PointCloud2ConstIterator<float> x(msg, "x");
+  sensor_msgs::PointCloud2ConstIterator<uint8_t> lrgb(legacy_msg, "rgb");
+  sensor_msgs::PointCloud2ConstIterator<uint8_t> rgb(msg, "rgb");
+  for (size_t k = 0; k < depth_.size(); ++k, ++lx, ++x, ++lrgb, ++rgb)
+  {
+    for (int c = 0; c < 3; ++c)
+    {
+      if (std::isnan(lx[c]))
+        EXPECT_TRUE(std::isnan(x[c]));
+      else
+        EXPECT_NEAR(lx[c], x[c], 1e-5 * std::fabs(lx[c]) + 1e-6);
+      EXPECT_EQ(lrgb[c], rgb[c]);
+    }
+  }
+
+  boost::posix_time::ptime start =
+    boost::posix_time::microsec_clock::universal_time();
+  for (int f = 0; f < frames; ++f)
+    LegacyFill(legacy_msg, rows, cols, &depth_[0], image_);
+  double legacy_ms = ElapsedMs(start) / frames;
+
+  start = boost::posix_time::microsec_clock::universal_time();
+  for (int f = 0; f < frames; ++f)
+    projection.Fill(msg, &depth_[0], image_);
+  double single_ms = ElapsedMs(start) / frames;
+
+  projection.SetThreads(0);
+  start = boost::posix_time::microsec_clock::universal_time();
+  for (int f = 0; f < frames; ++f)
+    projection.Fill(msg, &depth_[0], image_);
+  double pool_ms = ElapsedMs(start) / frames;
+
+  printf("%ux%u: legacy %.3f ms, projection %.3f ms, "
+         "projection (pool) %.3f ms per frame\n",
+         cols, rows, legacy_ms, single_ms, pool_ms);
+}
+
+INSTANTIATE_TEST_CASE_P(Resolutions, DepthProjectionBenchmark,
+                        ::testing::Values(640, 1280));
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Checks the start order, expiry and clearing of the body wrench / joint
+// effort job scheduler of the api plugin, without a ROS master or Gazebo.
+
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+#include <gtest/gtest.h>
+
+#include <gazebo_ros/gazebo_ros_job_scheduler.h>
+
+using namespace gazebo;
+
+/// \brief Records every apply in a shared log.
+class FakeJob
+{
+public:
+  FakeJob() : log(NULL), alive(NULL) {}
+
+  FakeJob(const std::string &_name, double _start, double _duration,
+          std::vector<std::string> *_log, const bool *_alive = NULL)
+    : start_time(_start), duration(_duration), log(_log), alive(_alive), name_(_name) {}
+
+  bool apply()
+  {
+    if (this->alive && !*this->alive)
+      return false;
+    this->log->push_back(this->name_);
+    return true;
+  }
+
+  std::string name() const
+  {
+    return this->name_;
+  }
+
+  ros::Time start_time;
+  ros::Duration duration;
+  std::vector<std::string> *log;
+  const bool *alive;
+
+private:
+  std::string name_;
+};
+
+TEST(JobScheduler, startsInTimeOrder)
+{
+  JobScheduler<FakeJob> scheduler;
+  std::vector<std::string> log;
+  // submitted out of order, the heap has to sort them
+  scheduler.submit(FakeJob("c", 3.0, -1.0, &log));
+  scheduler.submit(FakeJob("a", 1.0, -1.0, &log));
+  scheduler.submit(FakeJob("d", 4.0, -1.0, &log));
+  scheduler.submit(FakeJob("b", 2.0, -1.0, &log));
+
+  scheduler.update(ros::Time(0.5));
+  EXPECT_TRUE(log.empty());
+  EXPECT_EQ(4u, scheduler.size());
+
+  scheduler.update(ros::Time(2.5));
+  ASSERT_EQ(2u, log.size());
+  EXPECT_EQ("a", log[0]);
+  EXPECT_EQ("b", log[1]);
+
+  // started jobs are applied in start order, whatever the submission order
+  log.clear();
+  scheduler.update(ros::Time(10.0));
+  ASSERT_EQ(4u, log.size());
+  EXPECT_EQ("a", log[0]);
+  EXPECT_EQ("b", log[1]);
+  EXPECT_EQ("c", log[2]);
+  EXPECT_EQ("d", log[3]);
+}
+
+TEST(JobScheduler, expires)
+{
+  JobScheduler<FakeJob> scheduler;
+  std::vector<std::string> log;
+  scheduler.submit(FakeJob("short", 1.0, 0.5, &log));
+  scheduler.submit(FakeJob("forever", 1.0, -1.0, &log));
+
+  scheduler.update(ros::Time(1.0));
+  EXPECT_EQ(2u, log.size());
+
+  // the end of the duration is still applied
+  log.clear();
+  scheduler.update(ros::Time(1.5));
+  EXPECT_EQ(2u, log.size());
+
+  log.clear();
+  scheduler.update(ros::Time(1.501));
+  ASSERT_EQ(1u, log.size());
+  EXPECT_EQ("forever", log[0]);
+  EXPECT_EQ(1u, scheduler.size());
+
+  log.clear();
+  scheduler.update(ros::Time(1000.0));
+  ASSERT_EQ(1u, log.size());
+  EXPECT_EQ("forever", log[0]);
+}
+
+TEST(JobScheduler, dropsJobsOfMissingTargets)
+{
+  JobScheduler<FakeJob> scheduler;
+  std::vector<std::string> log;
+  bool alive = true;
+  scheduler.submit(FakeJob("target", 0.0, -1.0, &log, &alive));
+
+  scheduler.update(ros::Time(1.0));
+  EXPECT_EQ(1u, log.size());
+
+  alive = false;
+  scheduler.update(ros::Time(2.0));
+  EXPECT_EQ(1u, log.size());
+  EXPECT_EQ(0u, scheduler.size());
+}
+
+TEST(JobScheduler, clear)
+{
+  JobScheduler<FakeJob> scheduler;
+  std::vector<std::string> log;
+  scheduler.submit(FakeJob("body", 0.0, -1.0, &log));
+  scheduler.submit(FakeJob("body", 5.0, -1.0, &log));
+  scheduler.submit(FakeJob("other", 0.0, -1.0, &log));
+  scheduler.submit(FakeJob("other", 5.0, -1.0, &log));
+  scheduler.update(ros::Time(1.0));
+  EXPECT_EQ(4u, scheduler.size());
+
+  // both the started and the pending jobs of the name go
+  log.clear();
+  scheduler.clear("body");
+  scheduler.update(ros::Time(10.0));
+  ASSERT_EQ(2u, log.size());
+  EXPECT_EQ("other", log[0]);
+  EXPECT_EQ("other", log[1]);
+  EXPECT_EQ(2u, scheduler.size());
+}
+
+TEST(JobScheduler, clearIsOrderedWithSubmit)
+{
+  JobScheduler<FakeJob> scheduler;
+  std::vector<std::string> log;
+
+  // a job submitted after a clear survives it
+  scheduler.submit(FakeJob("body", 0.0, -1.0, &log));
+  scheduler.clear("body");
+  scheduler.submit(FakeJob("body", 0.0, -1.0, &log));
+  scheduler.update(ros::Time(1.0));
+  EXPECT_EQ(1u, log.size());
+  EXPECT_EQ(1u, scheduler.size());
+}
+
+TEST(JobScheduler, clearBeforeDeleteWhilePaused)
+{
+  JobScheduler<FakeJob> scheduler;
+  std::vector<std::string> log;
+  bool alive = true;
+  scheduler.submit(FakeJob("body", 0.0, -1.0, &log, &alive));
+  scheduler.update(ros::Time(1.0));
+  EXPECT_EQ(1u, log.size());
+
+  // deleteModel queues the clear and then deletes the model while the world
+  // is paused, so no update runs in between.  The next update processes the
+  // clear before it applies anything.
+  scheduler.clear("body");
+  alive = false;
+  log.clear();
+  scheduler.update(ros::Time(1.0));
+  EXPECT_TRUE(log.empty());
+  EXPECT_EQ(0u, scheduler.size());
+}
+
+TEST(JobScheduler, concurrentSubmit)
+{
+  JobScheduler<FakeJob> scheduler;
+  const unsigned int threads = 4;
+  const unsigned int jobs = 1000;
+  const double start = 1e6;
+  std::vector<std::vector<std::string> > logs(threads);
+  boost::thread_group group;
+  for (unsigned int t = 0; t < threads; ++t)
+  {
+    group.create_thread([&scheduler, &logs, t, jobs, start]()
+    {
+      for (unsigned int i = 0; i < jobs; ++i)
+        scheduler.submit(FakeJob("job", start, 0.0, &logs[t]));
+    });
+  }
+
+  // the physics thread drains the stack while the services push to it
+  for (unsigned int i = 0; i < 1000; ++i)
+    scheduler.update(ros::Time(1.0 + i));
+  group.join_all();
+
+  scheduler.update(ros::Time(start));
+  // none is lost or taken twice from the stack
+  for (unsigned int t = 0; t < threads; ++t)
+    EXPECT_EQ(jobs, logs[t].size());
+
+  scheduler.update(ros::Time(start + 1.0));
+  EXPECT_EQ(0u, scheduler.size());
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
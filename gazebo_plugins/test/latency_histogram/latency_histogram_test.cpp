@@ -0,0 +1,89 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstdlib>
+#include <string>
+
+#include <boost/thread/thread.hpp>
+#include <gtest/gtest.h>
+
+#include <gazebo_plugins/gazebo_ros_latency_histogram.h>
+
+static std::string Value(const diagnostic_msgs::DiagnosticStatus &_status,
+                         const std::string &_key)
+{
+  for (size_t i = 0; i < _status.values.size(); ++i)
+    if (_status.values[i].key == _key)
+      return _status.values[i].value;
+  return "";
+}
+
+TEST(LatencyHistogram, buckets)
+{
+  gazebo::LatencyHistogram histogram("scan latency");
+  histogram.Record(0.0);        // < 1 us
+  histogram.Record(1.5e-6);     // < 2 us
+  histogram.Record(100e-6);     // < 128 us
+  histogram.Record(130e-6);     // < 256 us
+  histogram.Record(10.0);       // overflow
+  histogram.Record(-1.0);       // clamped to 0
+
+  EXPECT_EQ(6u, histogram.Count());
+  EXPECT_EQ(2u, histogram.Bucket(0));
+  EXPECT_EQ(1u, histogram.Bucket(1));
+  EXPECT_EQ(1u, histogram.Bucket(7));
+  EXPECT_EQ(1u, histogram.Bucket(8));
+  EXPECT_EQ(1u, histogram.Bucket(gazebo::LatencyHistogram::kBuckets - 1));
+
+  diagnostic_msgs::DiagnosticStatus status;
+  histogram.FillStatus(status);
+  EXPECT_EQ("scan latency", status.name);
+  EXPECT_EQ("6", Value(status, "Samples"));
+  EXPECT_EQ("2", Value(status, "< 1 us"));
+  EXPECT_EQ("1", Value(status, "< 128 us"));
+  EXPECT_EQ("1", Value(status, ">= 16384 us"));
+  EXPECT_EQ("10000", Value(status, "Max latency (ms)"));
+
+  // counters restart after each report
+  EXPECT_EQ(0u, histogram.Count());
+}
+
+TEST(LatencyHistogram, startStop)
+{
+  gazebo::LatencyHistogram histogram;
+
+  histogram.Start(1000);
+  histogram.Start(2000);
+  boost::this_thread::sleep(boost::posix_time::milliseconds(5));
+  histogram.Stop(1000);
+  histogram.Stop(2000);
+  // stopped twice, or never started
+  histogram.Stop(2000);
+  histogram.Stop(3000);
+
+  EXPECT_EQ(2u, histogram.Count());
+  diagnostic_msgs::DiagnosticStatus status;
+  histogram.FillStatus(status);
+  EXPECT_EQ("2", Value(status, "Unmatched"));
+  EXPECT_GE(atof(Value(status, "Mean latency (ms)").c_str()), 5.0);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Reads and moves 400 models per tick, once with one get_model_state and
+// one set_model_state call per model and once with a single
+// get_model_states and set_model_states call.  The boxes are static so
+// that the states read back are exactly the ones that were set.  Also
+// replaces a model and checks that the batch calls do not use a stale index.
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+#include <gazebo_msgs/DeleteModel.h>
+#include <gazebo_msgs/GetModelState.h>
+#include <gazebo_msgs/GetModelStates.h>
+#include <gazebo_msgs/SetModelState.h>
+#include <gazebo_msgs/SetModelStates.h>
+#include <gazebo_msgs/SpawnModel.h>
+#include <gazebo_msgs/SpawnModels.h>
+
+static const unsigned int kModels = 400;
+static const unsigned int kTicks = 5;
+
+static std::string BoxSDF()
+{
+  return "<?xml version='1.0'?><sdf version='1.4'><model name='box'>"
+         "<static>true</static><link name='link'>"
+         "<collision name='collision'><geometry><box><size>0.2 0.2 0.2</size></box></geometry></collision>"
+         "<visual name='visual'><geometry><box><size>0.2 0.2 0.2</size></box></geometry></visual>"
+         "</link></model></sdf>";
+}
+
+static std::string BoxName(unsigned int i)
+{
+  return "box_" + std::to_string(i);
+}
+
+static gazebo_msgs::ModelState BoxState(unsigned int i, unsigned int tick)
+{
+  gazebo_msgs::ModelState state;
+  state.model_name = BoxName(i);
+  state.pose.position.x = 0.5 * (i % 20);
+  state.pose.position.y = 0.5 * (i / 20);
+  state.pose.position.z = 0.1 * tick;
+  state.pose.orientation.w = 1.0;
+  state.reference_frame = "world";
+  return state;
+}
+
+class ModelStatesBatchBenchmark : public testing::Test
+{
+protected:
+  virtual void SetUp()
+  {
+    ASSERT_TRUE(ros::service::waitForService("/gazebo/spawn_models", ros::Duration(60.0)));
+    get_model_state_ = nh_.serviceClient<gazebo_msgs::GetModelState>("/gazebo/get_model_state", true);
+    set_model_state_ = nh_.serviceClient<gazebo_msgs::SetModelState>("/gazebo/set_model_state", true);
+    get_model_states_ = nh_.serviceClient<gazebo_msgs::GetModelStates>("/gazebo/get_model_states", true);
+    set_model_states_ = nh_.serviceClient<gazebo_msgs::SetModelStates>("/gazebo/set_model_states", true);
+
+    // the boxes are shared by the tests
+    if (spawned_)
+      return;
+    gazebo_msgs::SpawnModels spawn;
+    for (unsigned int i = 0; i < kModels; ++i)
+    {
+      spawn.request.model_names.push_back(BoxName(i));
+      spawn.request.model_xmls.push_back(BoxSDF());
+      spawn.request.initial_poses.push_back(BoxState(i, 0).pose);
+    }
+    ros::ServiceClient spawn_models = nh_.serviceClient<gazebo_msgs::SpawnModels>("/gazebo/spawn_models");
+    ASSERT_TRUE(spawn_models.call(spawn));
+    ASSERT_TRUE(spawn.response.success) << spawn.response.status_message;
+    spawned_ = true;
+  }
+
+  /// \brief Expect every box at its pose of the given tick
+  void ExpectPoses(unsigned int tick)
+  {
+    gazebo_msgs::GetModelStates get;
+    for (unsigned int i = 0; i < kModels; ++i)
+      get.request.model_names.push_back(BoxName(i));
+    ASSERT_TRUE(get_model_states_.call(get));
+    ASSERT_TRUE(get.response.success) << get.response.status_message;
+    ASSERT_EQ(kModels, get.response.pose.size());
+    for (unsigned int i = 0; i < kModels; ++i)
+    {
+      gazebo_msgs::ModelState expected = BoxState(i, tick);
+      EXPECT_NEAR(expected.pose.position.x, get.response.pose[i].position.x, 1e-6) << BoxName(i);
+      EXPECT_NEAR(expected.pose.position.y, get.response.pose[i].position.y, 1e-6) << BoxName(i);
+      EXPECT_NEAR(expected.pose.position.z, get.response.pose[i].position.z, 1e-6) << BoxName(i);
+    }
+  }
+
+  ros::NodeHandle nh_;
+  ros::ServiceClient get_model_state_;
+  ros::ServiceClient set_model_state_;
+  ros::ServiceClient get_model_states_;
+  ros::ServiceClient set_model_states_;
+  static bool spawned_;
+};
+
+bool ModelStatesBatchBenchmark::spawned_ = false;
+
+TEST_F(ModelStatesBatchBenchmark, batchAgainstSingle)
+{
+  // one round trip per model and call
+  ros::WallTime start = ros::WallTime::now();
+  for (unsigned int tick = 1; tick <= kTicks; ++tick)
+  {
+    for (unsigned int i = 0; i < kModels; ++i)
+    {
+      gazebo_msgs::GetModelState get;
+      get.request.model_name = BoxName(i);
+      ASSERT_TRUE(get_model_state_.call(get));
+      EXPECT_TRUE(get.response.success) << get.response.status_message;
+    }
+    for (unsigned int i = 0; i < kModels; ++i)
+    {
+      gazebo_msgs::SetModelState set;
+      set.request.model_state = BoxState(i, tick);
+      ASSERT_TRUE(set_model_state_.call(set));
+      EXPECT_TRUE(set.response.success) << set.response.status_message;
+    }
+  }
+  double single_s = (ros::WallTime::now() - start).toSec() / kTicks;
+  ExpectPoses(kTicks);
+
+  // one round trip per tick and call
+  start = ros::WallTime::now();
+  for (unsigned int tick = kTicks + 1; tick <= 2 * kTicks; ++tick)
+  {
+    gazebo_msgs::GetModelStates get;
+    for (unsigned int i = 0; i < kModels; ++i)
+      get.request.model_names.push_back(BoxName(i));
+    ASSERT_TRUE(get_model_states_.call(get));
+    EXPECT_TRUE(get.response.success) << get.response.status_message;
+
+    gazebo_msgs::SetModelStates set;
+    for (unsigned int i = 0; i < kModels; ++i)
+      set.request.model_states.push_back(BoxState(i, tick));
+    ASSERT_TRUE(set_model_states_.call(set));
+    EXPECT_TRUE(set.response.success) << set.response.status_message;
+  }
+  double batch_s = (ros::WallTime::now() - start).toSec() / kTicks;
+  ExpectPoses(2 * kTicks);
+
+  // one indexed lookup per model and a single pause instead of one round trip each
+  EXPECT_LT(batch_s, 0.5 * single_s);
+
+  printf("get/set_model_state: %u models in %.2f ms per tick\n", kModels, 1000.0 * single_s);
+  printf("get/set_model_states: %u models in %.2f ms per tick\n", kModels, 1000.0 * batch_s);
+}
+
+TEST_F(ModelStatesBatchBenchmark, failedBatchSetsNothing)
+{
+  gazebo_msgs::SetModelStates set;
+  for (unsigned int i = 0; i < kModels; ++i)
+    set.request.model_states.push_back(BoxState(i, 1));
+  ASSERT_TRUE(set_model_states_.call(set));
+  ASSERT_TRUE(set.response.success) << set.response.status_message;
+
+  set.request.model_states.clear();
+  for (unsigned int i = 0; i < kModels; ++i)
+    set.request.model_states.push_back(BoxState(i, 2));
+  set.request.model_states.back().model_name = "no_such_model";
+  ASSERT_TRUE(set_model_states_.call(set));
+  EXPECT_FALSE(set.response.success);
+  ASSERT_EQ(kModels, set.response.model_success.size());
+  EXPECT_FALSE(set.response.model_success.back());
+
+  ExpectPoses(1);
+}
+
+TEST_F(ModelStatesBatchBenchmark, replacedModelIsFound)
+{
+  // warm the index
+  ExpectPoses(1);
+
+  // same name and model count, only the model behind the name changes
+  gazebo_msgs::DeleteModel del;
+  del.request.model_name = BoxName(0);
+  ros::ServiceClient delete_model = nh_.serviceClient<gazebo_msgs::DeleteModel>("/gazebo/delete_model");
+  ASSERT_TRUE(delete_model.call(del));
+  ASSERT_TRUE(del.response.success) << del.response.status_message;
+
+  gazebo_msgs::SpawnModel spawn;
+  spawn.request.model_name = BoxName(0);
+  spawn.request.model_xml = BoxSDF();
+  spawn.request.initial_pose.position.x = -3.0;
+  spawn.request.initial_pose.orientation.w = 1.0;
+  ros::ServiceClient spawn_model = nh_.serviceClient<gazebo_msgs::SpawnModel>("/gazebo/spawn_sdf_model");
+  ASSERT_TRUE(spawn_model.call(spawn));
+  ASSERT_TRUE(spawn.response.success) << spawn.response.status_message;
+
+  gazebo_msgs::GetModelStates get;
+  get.request.model_names.push_back(BoxName(0));
+  ASSERT_TRUE(get_model_states_.call(get));
+  ASSERT_TRUE(get.response.success) << get.response.status_message;
+  EXPECT_NEAR(-3.0, get.response.pose[0].position.x, 1e-6);
+
+  // a set on the deleted model would not show up in the new one
+  gazebo_msgs::SetModelStates set;
+  set.request.model_states.push_back(BoxState(0, 3));
+  ASSERT_TRUE(set_model_states_.call(set));
+  ASSERT_TRUE(set.response.success) << set.response.status_message;
+  ASSERT_TRUE(get_model_states_.call(get));
+  EXPECT_NEAR(BoxState(0, 3).pose.position.x, get.response.pose[0].position.x, 1e-6);
+  EXPECT_NEAR(BoxState(0, 3).pose.position.z, get.response.pose[0].position.z, 1e-6);
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "model_states_batch_benchmark");
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Checks the statistics of NoiseGenerator and BiasDriftNoise, and compares
+// the sample rate of NoiseGenerator against the rand() based GaussianKernel
+// the sensor plugins used to carry.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <gtest/gtest.h>
+
+#include <gazebo_plugins/gazebo_ros_noise.h>
+
+static const size_t kSamples = 4000000;
+
+/// \brief The GaussianKernel of the sensor plugins.
+static double GaussianKernel(double mu, double sigma)
+{
+  double U = (double)rand()/(double)RAND_MAX; // normalized uniform random variable
+  double V = (double)rand()/(double)RAND_MAX; // normalized uniform random variable
+  double X = sqrt(-2.0 * ::log(U)) * cos( 2.0*M_PI * V);
+  X = sigma * X + mu;
+  return X;
+}
+
+static double ElapsedMs(const boost::posix_time::ptime &start)
+{
+  return (boost::posix_time::microsec_clock::universal_time() - start)
+    .total_microseconds() / 1000.0;
+}
+
+template <typename T>
+static void ExpectMoments(const std::vector<T> &_samples, double _mu, double _sigma)
+{
+  double sum = 0.0;
+  double sum_sq = 0.0;
+  for (size_t k = 0; k < _samples.size(); ++k)
+  {
+    sum += _samples[k];
+    sum_sq += static_cast<double>(_samples[k]) * _samples[k];
+  }
+  double mean = sum / _samples.size();
+  EXPECT_NEAR(_mu, mean, 0.01 * _sigma);
+  EXPECT_NEAR(_sigma, std::sqrt(sum_sq / _samples.size() - mean * mean), 0.01 * _sigma);
+}
+
+TEST(NoiseBenchmark, gaussianMoments)
+{
+  gazebo::NoiseGenerator gen(1);
+
+  std::vector<double> samples(kSamples);
+  for (size_t k = 0; k < samples.size(); ++k)
+    samples[k] = gen.Gaussian(0.5, 2.0);
+  ExpectMoments(samples, 0.5, 2.0);
+
+  // odd counts leave a spare behind, which the next batch starts with
+  for (size_t k = 0; k < samples.size(); k += 1001)
+    gen.FillGaussian(&samples[k], std::min<size_t>(1001, samples.size() - k), 2.0, 0.5);
+  ExpectMoments(samples, 0.5, 2.0);
+
+  std::vector<float> floats(kSamples);
+  gen.FillGaussian(&floats[0], floats.size(), 0.1f);
+  ExpectMoments(floats, 0.0, 0.1);
+
+  // about 4.55% of the samples are more than two sigmas away
+  size_t tails = 0;
+  for (size_t k = 0; k < floats.size(); ++k)
+    tails += std::fabs(floats[k]) > 0.2f;
+  EXPECT_NEAR(0.0455, tails / static_cast<double>(floats.size()), 0.001);
+}
+
+TEST(NoiseBenchmark, reproducible)
+{
+  gazebo::NoiseGenerator a(42);
+  gazebo::NoiseGenerator b(42);
+  gazebo::NoiseGenerator c(43);
+  std::vector<double> sa(1000);
+  std::vector<double> sb(1000);
+  std::vector<double> sc(1000);
+  a.FillGaussian(&sa[0], sa.size(), 1.0);
+  b.FillGaussian(&sb[0], sb.size(), 1.0);
+  c.FillGaussian(&sc[0], sc.size(), 1.0);
+  EXPECT_TRUE(sa == sb);
+  EXPECT_FALSE(sa == sc);
+
+  // a batch yields the same samples as single calls
+  a.Seed(7);
+  b.Seed(7);
+  a.FillGaussian(&sa[0], sa.size(), 1.0);
+  for (size_t k = 0; k < sb.size(); ++k)
+    sb[k] = b.Gaussian(0.0, 1.0);
+  for (size_t k = 0; k < sa.size(); ++k)
+    EXPECT_NEAR(sa[k], sb[k], 1e-12);
+
+  EXPECT_EQ(gazebo::NoiseGenerator::SeedFromName("/imu"),
+            gazebo::NoiseGenerator::SeedFromName("/imu"));
+  EXPECT_NE(gazebo::NoiseGenerator::SeedFromName("/imu"),
+            gazebo::NoiseGenerator::SeedFromName("/imu2"));
+}
+
+TEST(NoiseBenchmark, biasDrift)
+{
+  const size_t runs = 4000;
+  const size_t steps = 100;
+  const double dt = 0.01;
+  gazebo::NoiseGenerator gen(3);
+
+  // bias only: constant within a run, spread across runs
+  std::vector<double> biases(runs);
+  for (size_t r = 0; r < runs; ++r)
+  {
+    gazebo::BiasDriftNoise noise;
+    noise.Configure(0.0, 1.0, 0.2, 0.0);
+    noise.Reset(gen);
+    biases[r] = noise.Apply(0.0, dt, gen);
+    EXPECT_DOUBLE_EQ(biases[r], noise.Apply(0.0, dt, gen));
+  }
+  {
+    SCOPED_TRACE("bias");
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    for (size_t r = 0; r < runs; ++r)
+    {
+      sum += biases[r];
+      sum_sq += biases[r] * biases[r];
+    }
+    double mean = sum / runs;
+    EXPECT_NEAR(1.0, mean, 0.02);
+    EXPECT_NEAR(0.2, std::sqrt(sum_sq / runs - mean * mean), 0.01);
+  }
+
+  // random walk: variance grows as drift_stddev^2 * t
+  // Gauss-Markov: variance settles at drift_stddev^2 * tau / 2
+  const double drift_stddev = 0.5;
+  const double tau = 0.05;
+  double walk_sq = 0.0;
+  double markov_sq = 0.0;
+  for (size_t r = 0; r < runs; ++r)
+  {
+    gazebo::BiasDriftNoise walk;
+    walk.Configure(0.0, 0.0, 0.0, drift_stddev);
+    walk.Reset(gen);
+    gazebo::BiasDriftNoise markov;
+    markov.Configure(0.0, 0.0, 0.0, drift_stddev, tau);
+    markov.Reset(gen);
+    for (size_t s = 0; s < steps; ++s)
+    {
+      walk.Apply(0.0, dt, gen);
+      markov.Apply(0.0, dt, gen);
+    }
+    walk_sq += walk.Drift() * walk.Drift();
+    markov_sq += markov.Drift() * markov.Drift();
+  }
+  double t = steps * dt;
+  EXPECT_NEAR(drift_stddev * drift_stddev * t, walk_sq / runs, 0.1 * drift_stddev * drift_stddev * t);
+  EXPECT_NEAR(drift_stddev * drift_stddev * tau / 2, markov_sq / runs,
+              0.1 * drift_stddev * drift_stddev * tau / 2);
+}
+
+TEST(NoiseBenchmark, sampleRate)
+{
+  std::vector<double> samples(kSamples);
+
+  srand(1);
+  boost::posix_time::ptime start =
+    boost::posix_time::microsec_clock::universal_time();
+  for (size_t k = 0; k < samples.size(); ++k)
+    samples[k] = GaussianKernel(0.0, 1.0);
+  double legacy_ms = ElapsedMs(start);
+
+  gazebo::NoiseGenerator gen(1);
+  start = boost::posix_time::microsec_clock::universal_time();
+  for (size_t k = 0; k < samples.size(); ++k)
+    samples[k] = gen.Gaussian(0.0, 1.0);
+  double scalar_ms = ElapsedMs(start);
+
+  start = boost::posix_time::microsec_clock::universal_time();
+  gen.FillGaussian(&samples[0], samples.size(), 1.0);
+  double batch_ms = ElapsedMs(start);
+
+  std::vector<float> floats(kSamples);
+  start = boost::posix_time::microsec_clock::universal_time();
+  gen.FillGaussian(&floats[0], floats.size(), 1.0f);
+  double float_ms = ElapsedMs(start);
+
+  printf("Gaussian samples: GaussianKernel %.1f M/s, Gaussian() %.1f M/s, "
+         "FillGaussian %.1f M/s, FillGaussian (float) %.1f M/s\n",
+         kSamples / legacy_ms / 1000.0, kSamples / scalar_ms / 1000.0,
+         kSamples / batch_ms / 1000.0, kSamples / float_ms / 1000.0);
+
+  // both outputs of each transform are used and there is no libc lock
+  EXPECT_LT(batch_ms, legacy_ms);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Stress test for PubQueue: 50 simulated laser plugins, each with its own
+// PubMultiQueue like GazeboRosLaser, pushing 1080 ray scans at 40 Hz.
+// Reports the cost of push() on the sensor thread and the latency until an
+// in-process subscriber receives the scan.  A second case checks that a
+// keep_latest queue never makes push() wait for a slow publish.
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <gtest/gtest.h>
+
+#include <ros/ros.h>
+#include <sensor_msgs/LaserScan.h>
+
+#include <gazebo_plugins/PubQueue.h>
+
+static const int kLasers = 50;
+static const double kRate = 40.0;
+static const int kScans = 200;
+static const int kRays = 1080;
+
+/// \brief One simulated GazeboRosLaser.
+struct FakeLaser
+{
+  PubMultiQueue pmq;
+  PubQueue<sensor_msgs::LaserScan>::Ptr pub_queue;
+  ros::Publisher pub;
+  std::vector<double> push_us;
+};
+
+class PubQueueStress : public ::testing::Test
+{
+  public: void OnScan(const sensor_msgs::LaserScanConstPtr &msg)
+  {
+    double latency = (ros::WallTime::now().toSec() - msg->header.stamp.toSec());
+    boost::mutex::scoped_lock lock(this->mutex_);
+    this->latency_us_.push_back(latency * 1e6);
+  }
+
+  public: void Produce(FakeLaser *laser)
+  {
+    ros::WallTime start = ros::WallTime::now();
+    for (int s = 0; s < kScans; ++s)
+    {
+      ros::WallTime::sleepUntil(start + ros::WallDuration(s / kRate));
+
+      // same as GazeboRosLaser::OnScan
+      sensor_msgs::LaserScan laser_msg;
+      laser_msg.ranges.resize(kRays, 1.0f);
+      laser_msg.intensities.resize(kRays, 0.0f);
+      ros::WallTime now = ros::WallTime::now();
+      laser_msg.header.stamp = ros::Time(now.sec, now.nsec);
+
+      laser->pub_queue->push(std::move(laser_msg), laser->pub);
+      laser->push_us.push_back(
+        (ros::WallTime::now() - now).toSec() * 1e6);
+    }
+  }
+
+  protected: boost::mutex mutex_;
+  protected: std::vector<double> latency_us_;
+};
+
+static double Percentile(std::vector<double> v, double p)
+{
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, static_cast<size_t>(p * v.size()))];
+}
+
+TEST_F(PubQueueStress, fiftyLasersAt40Hz)
+{
+  ros::NodeHandle nh;
+  ros::AsyncSpinner spinner(2);
+  spinner.start();
+
+  std::vector<boost::shared_ptr<FakeLaser> > lasers;
+  std::vector<ros::Subscriber> subs;
+  for (int i = 0; i < kLasers; ++i)
+  {
+    boost::shared_ptr<FakeLaser> laser(new FakeLaser);
+    char topic[32];
+    snprintf(topic, sizeof(topic), "scan_%d", i);
+    laser->pmq.startServiceThread();
+    laser->pub = nh.advertise<sensor_msgs::LaserScan>(topic, 100);
+    laser->pub_queue = laser->pmq.addPub<sensor_msgs::LaserScan>();
+    subs.push_back(nh.subscribe(topic, 100, &PubQueueStress::OnScan, this));
+    lasers.push_back(laser);
+  }
+
+  // give the subscriptions time to connect
+  ros::WallDuration(1.0).sleep();
+
+  boost::thread_group producers;
+  for (int i = 0; i < kLasers; ++i)
+    producers.create_thread(
+      boost::bind(&PubQueueStress::Produce, this, lasers[i].get()));
+  producers.join_all();
+
+  // let the last scans drain
+  ros::WallDuration(1.0).sleep();
+
+  std::vector<double> push_us;
+  unsigned long dropped = 0;
+  for (int i = 0; i < kLasers; ++i)
+  {
+    push_us.insert(push_us.end(), lasers[i]->push_us.begin(),
+                   lasers[i]->push_us.end());
+    dropped += lasers[i]->pub_queue->dropped();
+  }
+
+  boost::mutex::scoped_lock lock(this->mutex_);
+  printf("push(): p50 %.1f us, p99 %.1f us, max %.1f us\n",
+         Percentile(push_us, 0.5), Percentile(push_us, 0.99),
+         Percentile(push_us, 1.0));
+  printf("push to receive: p50 %.1f us, p99 %.1f us, max %.1f us\n",
+         Percentile(this->latency_us_, 0.5),
+         Percentile(this->latency_us_, 0.99),
+         Percentile(this->latency_us_, 1.0));
+  printf("received %zu of %d scans, %lu dropped by the queues\n",
+         this->latency_us_.size(), kLasers * kScans, dropped);
+
+  EXPECT_EQ(0u, dropped);
+  EXPECT_EQ(static_cast<size_t>(kLasers * kScans), this->latency_us_.size());
+}
+
+/// \brief Counts the scans of a subscriber slower than the sensor.
+struct SlowSubscriber
+{
+  SlowSubscriber() : received(0), last_seq(0) {}
+
+  void OnScan(const sensor_msgs::LaserScanConstPtr &msg)
+  {
+    ros::WallDuration(0.02).sleep();
+    boost::mutex::scoped_lock lock(this->mutex);
+    ++this->received;
+    this->last_seq = msg->header.seq;
+  }
+
+  boost::mutex mutex;
+  int received;
+  uint32_t last_seq;
+};
+
+TEST_F(PubQueueStress, keepLatestWithSlowSubscriber)
+{
+  // scans large enough that publish() takes milliseconds to serialize them,
+  // while push() only swaps buffers
+  static const int kLargeRays = 4 * 1024 * 1024;
+  static const int kPushes = 500;
+
+  ros::NodeHandle nh;
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  SlowSubscriber subscriber;
+  PubMultiQueue pmq;
+  pmq.startServiceThread();
+  ros::Publisher pub = nh.advertise<sensor_msgs::LaserScan>("slow_scan", 1);
+  PubQueue<sensor_msgs::LaserScan>::Ptr queue =
+    pmq.addPub<sensor_msgs::LaserScan>(64, PUB_QUEUE_KEEP_LATEST);
+  ros::Subscriber sub =
+    nh.subscribe("slow_scan", 1, &SlowSubscriber::OnScan, &subscriber);
+  ros::WallDuration(1.0).sleep();
+
+  std::vector<double> push_us;
+  sensor_msgs::LaserScan laser_msg;
+  for (int s = 0; s < kPushes; ++s)
+  {
+    // push() hands back the buffers of an older scan, only the first few
+    // scans are allocated here
+    if (laser_msg.ranges.size() != static_cast<size_t>(kLargeRays))
+      laser_msg.ranges.resize(kLargeRays, 1.0f);
+    laser_msg.header.seq = s;
+
+    ros::WallTime now = ros::WallTime::now();
+    EXPECT_TRUE(queue->push(std::move(laser_msg), pub));
+    push_us.push_back((ros::WallTime::now() - now).toSec() * 1e6);
+    ros::WallDuration(0.0001).sleep();
+  }
+
+  // the newest scan is always published eventually
+  ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(10.0);
+  while (ros::WallTime::now() < deadline)
+  {
+    {
+      boost::mutex::scoped_lock lock(subscriber.mutex);
+      if (subscriber.received > 0 &&
+          subscriber.last_seq == static_cast<uint32_t>(kPushes - 1))
+        break;
+    }
+    ros::WallDuration(0.01).sleep();
+  }
+
+  boost::mutex::scoped_lock lock(subscriber.mutex);
+  printf("keep_latest: push() p50 %.1f us, p99 %.1f us, max %.1f us, "
+         "%d of %d scans received, %lu coalesced\n",
+         Percentile(push_us, 0.5), Percentile(push_us, 0.99),
+         Percentile(push_us, 1.0), subscriber.received, kPushes,
+         queue->dropped());
+
+  EXPECT_EQ(static_cast<uint32_t>(kPushes - 1), subscriber.last_seq);
+  EXPECT_GT(queue->dropped(), 0u);
+  // push() must not wait for the scan being published, which takes
+  // milliseconds
+  EXPECT_LT(Percentile(push_us, 0.99), 1000.0);
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "pub_queue_stress");
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
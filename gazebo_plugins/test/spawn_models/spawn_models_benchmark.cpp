@@ -0,0 +1,190 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Spawns 1000 boxes through one spawn_models call and compares the time
+// per model with single spawn_sdf_model calls.  All boxes share one xml,
+// the model name and pose come from the requests, so every spawn after the
+// first one is conformed from the model template cache.
+//
+// Also spawns lights, which Gazebo adds without an addEntity event, and
+// checks that they are not left to the 500 ms lookup fallback.
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+#include <gazebo_msgs/GetWorldProperties.h>
+#include <gazebo_msgs/SpawnModel.h>
+#include <gazebo_msgs/SpawnModels.h>
+
+static const unsigned int kBatchModels = 1000;
+static const unsigned int kSingleModels = 50;
+static const unsigned int kLights = 10;
+
+// interval of the lookup that catches entities without an addEntity event
+static const double kLookUpFallbackS = 0.5;
+
+static std::string BoxSDF()
+{
+  std::ostringstream sdf;
+  sdf << "<?xml version='1.0'?><sdf version='1.4'><model name='box'>"
+      << "<static>true</static><link name='link'>"
+      << "<collision name='collision'><geometry><box><size>0.2 0.2 0.2</size></box></geometry></collision>"
+      << "<visual name='visual'><geometry><box><size>0.2 0.2 0.2</size></box></geometry></visual>"
+      << "</link></model></sdf>";
+  return sdf.str();
+}
+
+static std::string LightSDF()
+{
+  std::ostringstream sdf;
+  sdf << "<?xml version='1.0'?><sdf version='1.4'><light type='point' name='light'>"
+      << "<diffuse>0.5 0.5 0.5 1</diffuse><attenuation><range>10</range></attenuation>"
+      << "</light></sdf>";
+  return sdf.str();
+}
+
+static double Median(std::vector<double> values)
+{
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+TEST(SpawnModelsBenchmark, lightsWithoutLookUpFallback)
+{
+  ros::NodeHandle nh;
+  ASSERT_TRUE(ros::service::waitForService("/gazebo/spawn_models", ros::Duration(60.0)));
+  ASSERT_TRUE(ros::service::waitForService("/gazebo/spawn_sdf_model", ros::Duration(60.0)));
+  ros::ServiceClient spawn_models = nh.serviceClient<gazebo_msgs::SpawnModels>("/gazebo/spawn_models");
+  ros::ServiceClient spawn_model = nh.serviceClient<gazebo_msgs::SpawnModel>("/gazebo/spawn_sdf_model");
+
+  // one box first, so both kinds are compared with a warm factory
+  gazebo_msgs::SpawnModel box;
+  box.request.model_name = "light_reference_box";
+  box.request.model_xml = BoxSDF();
+  box.request.initial_pose.position.y = -5.0;
+  box.request.initial_pose.orientation.w = 1.0;
+  ASSERT_TRUE(spawn_model.call(box));
+  ASSERT_TRUE(box.response.success) << box.response.status_message;
+
+  std::vector<double> light_s;
+  for (unsigned int i = 0; i < kLights; ++i)
+  {
+    gazebo_msgs::SpawnModel srv;
+    srv.request.model_name = "single_light_" + std::to_string(i);
+    srv.request.model_xml = LightSDF();
+    srv.request.initial_pose.position.x = 1.0 * i;
+    srv.request.initial_pose.position.z = 3.0;
+    srv.request.initial_pose.orientation.w = 1.0;
+    ros::WallTime start = ros::WallTime::now();
+    ASSERT_TRUE(spawn_model.call(srv));
+    light_s.push_back((ros::WallTime::now() - start).toSec());
+    EXPECT_TRUE(srv.response.success) << srv.response.status_message;
+  }
+  // a light found by the fallback would take up to its full interval
+  EXPECT_LT(Median(light_s), 0.5 * kLookUpFallbackS);
+
+  gazebo_msgs::SpawnModels batch;
+  for (unsigned int i = 0; i < kLights; ++i)
+  {
+    batch.request.model_names.push_back("batch_light_" + std::to_string(i));
+    batch.request.model_xmls.push_back(LightSDF());
+  }
+  ros::WallTime start = ros::WallTime::now();
+  ASSERT_TRUE(spawn_models.call(batch));
+  double batch_s = (ros::WallTime::now() - start).toSec();
+  EXPECT_TRUE(batch.response.success) << batch.response.status_message;
+  EXPECT_LT(batch_s, kLookUpFallbackS);
+
+  printf("spawn_sdf_model light: median %.1f ms\n", 1000.0 * Median(light_s));
+  printf("spawn_models: %u lights in %.1f ms\n", kLights, 1000.0 * batch_s);
+}
+
+TEST(SpawnModelsBenchmark, batchAgainstSingle)
+{
+  ros::NodeHandle nh;
+  ASSERT_TRUE(ros::service::waitForService("/gazebo/spawn_models", ros::Duration(60.0)));
+  ASSERT_TRUE(ros::service::waitForService("/gazebo/spawn_sdf_model", ros::Duration(60.0)));
+  ros::ServiceClient spawn_models = nh.serviceClient<gazebo_msgs::SpawnModels>("/gazebo/spawn_models");
+  ros::ServiceClient spawn_model = nh.serviceClient<gazebo_msgs::SpawnModel>("/gazebo/spawn_sdf_model");
+  ros::ServiceClient world_properties =
+    nh.serviceClient<gazebo_msgs::GetWorldProperties>("/gazebo/get_world_properties");
+
+  // single calls, one round trip and one wait per model
+  ros::WallTime start = ros::WallTime::now();
+  for (unsigned int i = 0; i < kSingleModels; ++i)
+  {
+    gazebo_msgs::SpawnModel srv;
+    srv.request.model_name = "single_box_" + std::to_string(i);
+    srv.request.model_xml = BoxSDF();
+    srv.request.initial_pose.position.x = 0.5 * i;
+    srv.request.initial_pose.position.y = -1.0;
+    srv.request.initial_pose.orientation.w = 1.0;
+    ASSERT_TRUE(spawn_model.call(srv));
+    EXPECT_TRUE(srv.response.success) << srv.response.status_message;
+  }
+  double single_s = (ros::WallTime::now() - start).toSec();
+
+  // one batch
+  gazebo_msgs::SpawnModels srv;
+  for (unsigned int i = 0; i < kBatchModels; ++i)
+  {
+    std::string name = "batch_box_" + std::to_string(i);
+    srv.request.model_names.push_back(name);
+    srv.request.model_xmls.push_back(BoxSDF());
+    geometry_msgs::Pose pose;
+    pose.position.x = 0.5 * (i % 40);
+    pose.position.y = 0.5 * (i / 40);
+    pose.orientation.w = 1.0;
+    srv.request.initial_poses.push_back(pose);
+  }
+  start = ros::WallTime::now();
+  ASSERT_TRUE(spawn_models.call(srv));
+  double batch_s = (ros::WallTime::now() - start).toSec();
+
+  EXPECT_TRUE(srv.response.success) << srv.response.status_message;
+  ASSERT_EQ(kBatchModels, srv.response.model_success.size());
+  for (unsigned int i = 0; i < kBatchModels; ++i)
+    EXPECT_TRUE(srv.response.model_success[i]) << srv.response.model_status_messages[i];
+
+  // the single spawns already parsed the box
+  EXPECT_EQ(kBatchModels, srv.response.template_cache_hits);
+
+  gazebo_msgs::GetWorldProperties properties;
+  ASSERT_TRUE(world_properties.call(properties));
+  // ground plane, light reference box, single and batch boxes
+  EXPECT_EQ(2 + kSingleModels + kBatchModels, properties.response.model_names.size());
+
+  printf("spawn_sdf_model: %u models in %.2f s, %.2f ms per model\n",
+         kSingleModels, single_s, 1000.0 * single_s / kSingleModels);
+  printf("spawn_models: %u models in %.2f s, %.2f ms per model\n",
+         kBatchModels, batch_s, 1000.0 * batch_s / kBatchModels);
+  printf("model template cache hit rate: %.1f%%\n",
+         100.0 * srv.response.template_cache_hit_rate);
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "spawn_models_benchmark");
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
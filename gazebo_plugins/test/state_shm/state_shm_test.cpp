@@ -0,0 +1,221 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Writes link states to a shared memory segment and reads them back, once
+// in turns and once with a writer overwriting the slots while the reader
+// copies them, which has to make the reader retry rather than return a
+// torn copy.
+
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <boost/thread.hpp>
+#include <gtest/gtest.h>
+
+#include <gazebo_ros/gazebo_ros_state_shm.h>
+
+using namespace gazebo;
+
+static std::string SegmentName(const std::string &test)
+{
+  return "/gazebo_ros_state_shm_test_" + test + "_" + std::to_string(getpid());
+}
+
+static std::vector<std::string> Names(unsigned int count, const std::string &prefix)
+{
+  std::vector<std::string> names;
+  for (unsigned int i = 0; i < count; ++i)
+    names.push_back(prefix + std::to_string(i));
+  return names;
+}
+
+/// \brief States where every value of entity i of write k is k * 1000 + i
+static void Fill(uint64_t k, unsigned int count, std::vector<double> &poses, std::vector<double> &twists)
+{
+  poses.resize(count * 7);
+  twists.resize(count * 6);
+  for (unsigned int i = 0; i < count; ++i)
+  {
+    for (unsigned int j = 0; j < 7; ++j)
+      poses[i * 7 + j] = k * 1000.0 + i;
+    for (unsigned int j = 0; j < 6; ++j)
+      twists[i * 6 + j] = k * 1000.0 + i;
+  }
+}
+
+TEST(StateShm, roundTrip)
+{
+  const std::string name = SegmentName("round_trip");
+  StateShmWriter writer;
+  ASSERT_TRUE(writer.create(name, 8));
+
+  StateShmReader reader;
+  ASSERT_TRUE(reader.open(name));
+  StateShmState state;
+  // nothing written yet
+  EXPECT_FALSE(reader.read(state));
+  EXPECT_EQ(0u, reader.writeCount());
+
+  std::vector<std::string> names = Names(5, "model::link_");
+  std::vector<double> poses, twists;
+  Fill(1, 5, poses, twists);
+  writer.write(12, 345, 1, names, &poses[0], &twists[0]);
+
+  ASSERT_TRUE(reader.read(state));
+  EXPECT_EQ(1u, reader.writeCount());
+  EXPECT_EQ(1u, state.write_count);
+  EXPECT_EQ(1u, state.generation);
+  EXPECT_EQ(12, state.sec);
+  EXPECT_EQ(345, state.nsec);
+  EXPECT_EQ(names, state.names);
+  EXPECT_EQ(poses, state.poses);
+  EXPECT_EQ(twists, state.twists);
+
+  // a new generation brings new names, the slots cycle
+  names = Names(3, "other::link_");
+  for (uint64_t k = 2; k < 10; ++k)
+  {
+    Fill(k, 3, poses, twists);
+    writer.write(12 + k, 0, 2, names, &poses[0], &twists[0]);
+    ASSERT_TRUE(reader.read(state));
+    EXPECT_EQ(k, state.write_count);
+    EXPECT_EQ(2u, state.generation);
+    EXPECT_EQ(names, state.names);
+    EXPECT_EQ(poses, state.poses);
+    EXPECT_EQ(twists, state.twists);
+  }
+}
+
+TEST(StateShm, capacityAndNameSize)
+{
+  const std::string name = SegmentName("capacity");
+  StateShmWriter writer;
+  ASSERT_TRUE(writer.create(name, 2, 2, 8));
+  StateShmReader reader;
+  ASSERT_TRUE(reader.open(name));
+
+  // entities beyond the capacity are not exported, long names are cut
+  std::vector<std::string> names;
+  names.push_back("a");
+  names.push_back("a_rather_long_name");
+  names.push_back("c");
+  std::vector<double> poses, twists;
+  Fill(1, 3, poses, twists);
+  writer.write(0, 0, 1, names, &poses[0], &twists[0]);
+
+  StateShmState state;
+  ASSERT_TRUE(reader.read(state));
+  ASSERT_EQ(2u, state.size());
+  EXPECT_EQ("a", state.names[0]);
+  EXPECT_EQ("a_rathe", state.names[1]);
+  EXPECT_EQ(std::vector<double>(poses.begin(), poses.begin() + 14), state.poses);
+}
+
+TEST(StateShm, readerOfReplacedSegment)
+{
+  const std::string name = SegmentName("replaced");
+  StateShmReader reader;
+  EXPECT_FALSE(reader.open(name));
+
+  StateShmWriter writer;
+  ASSERT_TRUE(writer.create(name, 4));
+  ASSERT_TRUE(reader.open(name));
+  writer.close();
+  EXPECT_FALSE(StateShmReader().open(name));
+}
+
+TEST(StateShm, concurrentWrites)
+{
+  const std::string name = SegmentName("concurrent");
+  const unsigned int count = 200;
+  StateShmWriter writer;
+  // two slots, so the writer comes back to the slot being read right away
+  ASSERT_TRUE(writer.create(name, count, 2));
+  StateShmReader reader;
+  ASSERT_TRUE(reader.open(name));
+
+  std::atomic<bool> stop(false);
+  boost::thread writer_thread([&writer, &stop, count]()
+  {
+    std::vector<std::string> names[2] = { Names(count, "even_"), Names(count, "odd_") };
+    std::vector<double> poses, twists;
+    for (uint64_t k = 1; !stop; ++k)
+    {
+      Fill(k, count, poses, twists);
+      // the names change every 64 writes
+      uint32_t generation = k / 64;
+      writer.write(k, 0, generation, names[generation % 2], &poses[0], &twists[0]);
+    }
+  });
+
+  while (reader.writeCount() == 0)
+    boost::this_thread::yield();
+
+  StateShmState state;
+  unsigned int reads = 0;
+  unsigned int failed = 0;
+  unsigned int torn = 0;
+  uint64_t last_write_count = 0;
+  for (unsigned int attempt = 0; attempt < 20000 && !torn; ++attempt)
+  {
+    if (!reader.read(state))
+    {
+      ++failed;
+      continue;
+    }
+    ++reads;
+    if (state.size() != count)
+    {
+      ++torn;
+      break;
+    }
+    // the latest slot only moves forward
+    EXPECT_GE(state.write_count, last_write_count);
+    last_write_count = state.write_count;
+
+    // every value of a copy comes from the same write
+    const uint64_t k = state.sec;
+    for (unsigned int i = 0; i < count; ++i)
+    {
+      if (state.poses[i * 7] != k * 1000.0 + i ||
+          state.poses[i * 7 + 6] != k * 1000.0 + i ||
+          state.twists[i * 6 + 5] != k * 1000.0 + i)
+        ++torn;
+    }
+    // and the names from the generation of that write
+    const std::string prefix = (state.generation % 2) ? "odd_" : "even_";
+    if (state.names[0] != prefix + "0" ||
+        state.names[count - 1] != prefix + std::to_string(count - 1))
+      ++torn;
+  }
+  stop = true;
+  writer_thread.join();
+
+  EXPECT_EQ(0u, torn) << "in " << reads << " reads";
+  // retries hide the overwritten slots, almost every read succeeds
+  EXPECT_GT(reads, 0u);
+  EXPECT_LT(failed, reads);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
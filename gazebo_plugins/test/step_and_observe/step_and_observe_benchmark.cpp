@@ -0,0 +1,215 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Runs short episodes of a driven pendulum, once the way RL loops used to
+// (apply_joint_effort, unpause, sleep, pause, get_model_state per step) and
+// once with one step_and_observe call per episode.  Checks that a call
+// advances exactly the requested iterations, applies the effort on every
+// one of them, leaves the world paused, is reproducible, and is faster than
+// the polling loop.
+
+#include <cstdio>
+#include <string>
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include <std_srvs/Empty.h>
+
+#include <gazebo_msgs/ApplyJointEffort.h>
+#include <gazebo_msgs/GetModelState.h>
+#include <gazebo_msgs/GetPhysicsProperties.h>
+#include <gazebo_msgs/SpawnModel.h>
+#include <gazebo_msgs/StepAndObserve.h>
+
+static const unsigned int kSteps = 100;
+static const unsigned int kEpisodes = 5;
+
+static std::string PendulumSDF()
+{
+  return "<?xml version='1.0'?><sdf version='1.4'><model name='pendulum'>"
+         "<link name='base'><inertial><mass>10</mass></inertial></link>"
+         "<joint name='fixed' type='fixed'><parent>world</parent><child>base</child></joint>"
+         "<link name='arm'><pose>0 0 0.5 0 0 0</pose><inertial><mass>1</mass></inertial>"
+         "<collision name='collision'><geometry><box><size>0.05 0.05 1</size></box></geometry></collision>"
+         "</link>"
+         "<joint name='hinge' type='revolute'><pose>0 0 -0.5 0 0 0</pose><parent>base</parent><child>arm</child>"
+         "<axis><xyz>1 0 0</xyz></axis></joint>"
+         "</model></sdf>";
+}
+
+class StepAndObserveBenchmark : public testing::Test
+{
+protected:
+  virtual void SetUp()
+  {
+    ASSERT_TRUE(ros::service::waitForService("/gazebo/step_and_observe", ros::Duration(60.0)));
+    step_and_observe_ = nh_.serviceClient<gazebo_msgs::StepAndObserve>("/gazebo/step_and_observe", true);
+    apply_joint_effort_ = nh_.serviceClient<gazebo_msgs::ApplyJointEffort>("/gazebo/apply_joint_effort", true);
+    get_model_state_ = nh_.serviceClient<gazebo_msgs::GetModelState>("/gazebo/get_model_state", true);
+    pause_ = nh_.serviceClient<std_srvs::Empty>("/gazebo/pause_physics", true);
+    unpause_ = nh_.serviceClient<std_srvs::Empty>("/gazebo/unpause_physics", true);
+    reset_world_ = nh_.serviceClient<std_srvs::Empty>("/gazebo/reset_world", true);
+    get_physics_properties_ =
+      nh_.serviceClient<gazebo_msgs::GetPhysicsProperties>("/gazebo/get_physics_properties", true);
+
+    if (!spawned_)
+    {
+      gazebo_msgs::SpawnModel spawn;
+      spawn.request.model_name = "pendulum";
+      spawn.request.model_xml = PendulumSDF();
+      spawn.request.initial_pose.orientation.w = 1.0;
+      ros::ServiceClient spawn_model = nh_.serviceClient<gazebo_msgs::SpawnModel>("/gazebo/spawn_sdf_model");
+      ASSERT_TRUE(spawn_model.call(spawn));
+      ASSERT_TRUE(spawn.response.success) << spawn.response.status_message;
+      spawned_ = true;
+    }
+
+    std_srvs::Empty empty;
+    ASSERT_TRUE(pause_.call(empty));
+    ASSERT_TRUE(reset_world_.call(empty));
+  }
+
+  /// \brief One episode under a constant effort, observed after each step
+  gazebo_msgs::StepAndObserve::Response Episode()
+  {
+    gazebo_msgs::StepAndObserve step;
+    step.request.steps = kSteps;
+    step.request.joint_names.push_back("hinge");
+    step.request.joint_efforts.push_back(0.5);
+    step.request.model_names.push_back("pendulum");
+    step.request.observed_joint_names.push_back("hinge");
+    step.request.observe_every_step = true;
+    EXPECT_TRUE(step_and_observe_.call(step));
+    return step.response;
+  }
+
+  ros::NodeHandle nh_;
+  ros::ServiceClient step_and_observe_;
+  ros::ServiceClient apply_joint_effort_;
+  ros::ServiceClient get_model_state_;
+  ros::ServiceClient pause_;
+  ros::ServiceClient unpause_;
+  ros::ServiceClient reset_world_;
+  ros::ServiceClient get_physics_properties_;
+  static bool spawned_;
+};
+
+bool StepAndObserveBenchmark::spawned_ = false;
+
+TEST_F(StepAndObserveBenchmark, trajectory)
+{
+  gazebo_msgs::StepAndObserve::Response res = Episode();
+  ASSERT_TRUE(res.success) << res.status_message;
+  EXPECT_EQ(kSteps, res.iterations);
+  ASSERT_EQ(kSteps, res.stamps.size());
+  ASSERT_EQ(kSteps, res.pose.size());
+  ASSERT_EQ(kSteps, res.joint_position.size());
+
+  // exactly one physics step between two observations, none skipped or added
+  gazebo_msgs::GetPhysicsProperties physics;
+  ASSERT_TRUE(get_physics_properties_.call(physics));
+  ASSERT_TRUE(physics.response.success);
+  const double time_step = physics.response.time_step;
+  for (unsigned int i = 1; i < kSteps; ++i)
+    EXPECT_NEAR(time_step, (res.stamps[i] - res.stamps[i - 1]).toSec(), 1e-9) << i;
+
+  // the world is paused again once the call returns
+  EXPECT_TRUE(physics.response.pause);
+
+  // the effort is applied on every iteration, not just while unpaused
+  for (unsigned int i = 0; i < kSteps; ++i)
+    EXPECT_DOUBLE_EQ(0.5, res.joint_effort[i]) << i;
+  // driven by the effort, the hinge keeps turning the same way
+  EXPECT_GT(res.joint_velocity.back(), 0.0);
+  EXPECT_GT(res.joint_position.back(), res.joint_position.front());
+
+  // the same episode from the same state gives the same trajectory
+  std_srvs::Empty empty;
+  ASSERT_TRUE(reset_world_.call(empty));
+  gazebo_msgs::StepAndObserve::Response again = Episode();
+  ASSERT_TRUE(again.success) << again.status_message;
+  ASSERT_EQ(res.joint_position.size(), again.joint_position.size());
+  for (unsigned int i = 0; i < kSteps; ++i)
+    EXPECT_NEAR(res.joint_position[i], again.joint_position[i], 1e-9) << i;
+}
+
+TEST_F(StepAndObserveBenchmark, rejectsBadRequests)
+{
+  gazebo_msgs::StepAndObserve step;
+  step.request.steps = 1;
+  step.request.model_names.push_back("no_such_model");
+  ASSERT_TRUE(step_and_observe_.call(step));
+  EXPECT_FALSE(step.response.success);
+  EXPECT_EQ(0u, step.response.iterations);
+
+  std_srvs::Empty empty;
+  ASSERT_TRUE(unpause_.call(empty));
+  step.request.model_names.clear();
+  ASSERT_TRUE(step_and_observe_.call(step));
+  EXPECT_FALSE(step.response.success);
+  ASSERT_TRUE(pause_.call(empty));
+}
+
+TEST_F(StepAndObserveBenchmark, episodesAgainstPolling)
+{
+  std_srvs::Empty empty;
+
+  // one effort, unpause, sleep, pause and state round trip per step
+  ros::WallTime start = ros::WallTime::now();
+  for (unsigned int episode = 0; episode < kEpisodes; ++episode)
+  {
+    ASSERT_TRUE(reset_world_.call(empty));
+    for (unsigned int i = 0; i < kSteps; ++i)
+    {
+      gazebo_msgs::ApplyJointEffort effort;
+      effort.request.joint_name = "hinge";
+      effort.request.effort = 0.5;
+      effort.request.duration = ros::Duration(0.001);
+      ASSERT_TRUE(apply_joint_effort_.call(effort));
+      ASSERT_TRUE(unpause_.call(empty));
+      ros::WallDuration(0.001).sleep();
+      ASSERT_TRUE(pause_.call(empty));
+      gazebo_msgs::GetModelState get;
+      get.request.model_name = "pendulum";
+      ASSERT_TRUE(get_model_state_.call(get));
+    }
+  }
+  double polling_s = (ros::WallTime::now() - start).toSec() / kEpisodes;
+
+  // one call per episode
+  start = ros::WallTime::now();
+  for (unsigned int episode = 0; episode < kEpisodes; ++episode)
+  {
+    ASSERT_TRUE(reset_world_.call(empty));
+    gazebo_msgs::StepAndObserve::Response res = Episode();
+    ASSERT_TRUE(res.success) << res.status_message;
+  }
+  double stepped_s = (ros::WallTime::now() - start).toSec() / kEpisodes;
+
+  printf("unpause/sleep/pause/get_model_state: %u steps in %.2f ms per episode\n", kSteps, 1000.0 * polling_s);
+  printf("step_and_observe: %u steps in %.2f ms per episode\n", kSteps, 1000.0 * stepped_s);
+
+  // one round trip per episode instead of five per step
+  EXPECT_LT(stepped_s, polling_s);
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "step_and_observe_benchmark");
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
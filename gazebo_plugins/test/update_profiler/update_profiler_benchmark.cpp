@@ -0,0 +1,181 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Checks the histogram and the trace of the world update profiler, and
+// measures the cost the timer adds to a call, against the 20 us a plugin
+// update publishing a message typically takes.  Most of it is the two clock
+// reads.
+
+#include <cmath>
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
+
+using namespace gazebo;
+
+/// \brief Busy work standing in for a plugin update.
+struct WorkCallback
+{
+  WorkCallback(unsigned int _iterations, double &_sink)
+    : iterations(_iterations), sink(_sink) {}
+
+  void operator()(const common::UpdateInfo &)
+  {
+    double x = this->sink;
+    for (unsigned int i = 0; i < this->iterations; ++i)
+      x = x * 0.999999 + 1.0;
+    this->sink = x;
+  }
+
+  unsigned int iterations;
+  double &sink;
+};
+
+TEST(UpdateProfiler, buckets)
+{
+  // the middle of the bucket of a duration is within 1/16 of it
+  for (int64_t ns = 1; ns < 1000000000; ns = ns * 3 / 2 + 1)
+  {
+    unsigned int bucket = UpdateProfile::bucket(ns);
+    EXPECT_NEAR(UpdateProfile::bucketValue(bucket), ns, ns / 16.0 + 0.5) << ns;
+    EXPECT_LE(UpdateProfile::bucket(ns), UpdateProfile::bucket(ns + 1));
+  }
+}
+
+TEST(UpdateProfiler, percentiles)
+{
+  UpdateProfile profile("test");
+  // 98 calls of 10 us, one of 1 ms and one of 5 ms
+  for (int i = 0; i < 98; ++i)
+    profile.record(i * 100000, 10000);
+  profile.record(9800000, 1000000);
+  profile.record(9900000, 5000000);
+
+  gazebo_msgs::UpdateProfile msg;
+  profile.report(2.0, msg);
+  EXPECT_EQ(msg.name, "test");
+  EXPECT_EQ(msg.calls, 100u);
+  EXPECT_DOUBLE_EQ(msg.calls_per_second, 50.0);
+  EXPECT_NEAR(msg.mean, (98 * 10e-6 + 1e-3 + 5e-3) / 100, 1e-9);
+  EXPECT_NEAR(msg.p50, 10e-6, 10e-6 / 16);
+  EXPECT_NEAR(msg.p99, 1e-3, 1e-3 / 16);
+  EXPECT_DOUBLE_EQ(msg.max, 5e-3);
+
+  // the next report only covers the calls since this one
+  profile.record(10000000, 20000);
+  profile.report(1.0, msg);
+  EXPECT_EQ(msg.calls, 1u);
+  EXPECT_DOUBLE_EQ(msg.max, 20e-6);
+  EXPECT_NEAR(msg.p50, 20e-6, 20e-6 / 16);
+}
+
+TEST(UpdateProfiler, trace)
+{
+  UpdateProfile profile("model/\"quoted\"");
+  for (unsigned int i = 0; i < UpdateProfile::TRACE_SIZE + 10; ++i)
+    profile.record(1000 * i, 500);
+
+  std::string events;
+  profile.appendTrace(events);
+  // only the latest TRACE_SIZE calls are kept
+  size_t count = 0;
+  for (size_t pos = events.find("\"ph\":\"X\""); pos != std::string::npos;
+       pos = events.find("\"ph\":\"X\"", pos + 1))
+    ++count;
+  EXPECT_EQ(count, UpdateProfile::TRACE_SIZE);
+  EXPECT_EQ(events.find("\"ts\":9.000,"), std::string::npos);
+  EXPECT_NE(events.find("\"ts\":10.000,\"dur\":0.500}"), std::string::npos);
+  EXPECT_NE(events.find("\"name\":\"model/\\\"quoted\\\"\""), std::string::npos);
+}
+
+TEST(UpdateProfiler, disabled)
+{
+  UpdateProfiler &profiler = UpdateProfiler::instance();
+  profiler.setEnabled(false);
+  EXPECT_TRUE(profiler.registerProfile("disabled") == NULL);
+
+  double sink = 0.0;
+  std::function<void(const common::UpdateInfo &)> callback =
+    ProfiledUpdate("disabled", WorkCallback(1, sink));
+  // connected unchanged, without a timer around it
+  EXPECT_TRUE(callback.target<WorkCallback>() != NULL);
+
+  profiler.setEnabled(true);
+  callback = ProfiledUpdate("enabled", WorkCallback(1, sink));
+  EXPECT_TRUE(callback.target<WorkCallback>() == NULL);
+  EXPECT_EQ(profiler.registerProfile("enabled"), profiler.registerProfile("enabled"));
+  profiler.setEnabled(false);
+}
+
+TEST(UpdateProfiler, overhead)
+{
+  UpdateProfiler &profiler = UpdateProfiler::instance();
+  const unsigned int calls = 1000000;
+  double sink = 0.0;
+  common::UpdateInfo info;
+
+  // the cost of an empty callback with and without the timer around it
+  profiler.setEnabled(false);
+  std::function<void(const common::UpdateInfo &)> plain =
+    ProfiledUpdate("overhead", WorkCallback(1, sink));
+  profiler.setEnabled(true);
+  std::function<void(const common::UpdateInfo &)> profiled =
+    ProfiledUpdate("overhead", WorkCallback(1, sink));
+  profiler.setEnabled(false);
+
+  // interleave the runs and keep the best of each, against frequency changes
+  double best_plain = 1e9;
+  double best_profiled = 1e9;
+  for (int run = 0; run < 5; ++run)
+  {
+    int64_t start = UpdateProfile::now();
+    for (unsigned int i = 0; i < calls / 5; ++i)
+      plain(info);
+    best_plain = std::min(best_plain, 1e-9 * (UpdateProfile::now() - start));
+
+    start = UpdateProfile::now();
+    for (unsigned int i = 0; i < calls / 5; ++i)
+      profiled(info);
+    best_profiled = std::min(best_profiled, 1e-9 * (UpdateProfile::now() - start));
+  }
+
+  double overhead = (best_profiled - best_plain) / (calls / 5);
+  const double typical_update = 20e-6;
+  printf("profiling overhead %.1f ns per call, %.2f%% of a %.0f us update\n",
+         1e9 * overhead, 100.0 * overhead / typical_update, 1e6 * typical_update);
+  EXPECT_LT(overhead, 0.01 * typical_update);
+  EXPECT_TRUE(std::isfinite(sink));
+
+  gazebo_msgs::UpdateProfiles msg;
+  profiler.report(msg);
+  bool found = false;
+  for (size_t i = 0; i < msg.profiles.size(); ++i)
+    if (msg.profiles[i].name == "overhead")
+    {
+      found = true;
+      EXPECT_EQ(msg.profiles[i].calls, calls / 5 * 5);
+    }
+  EXPECT_TRUE(found);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
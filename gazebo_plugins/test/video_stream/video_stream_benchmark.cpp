@@ -0,0 +1,200 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Plays a generated MJPG clip through VideoFrameStream with a ring much
+// shorter than the clip, checks frame order, seeks and the memory budget,
+// and times the seeks.
+
+#include <cstdio>
+#include <string>
+
+#include <boost/thread/thread.hpp>
+#include <gtest/gtest.h>
+#include <opencv2/opencv.hpp>
+
+#include <gazebo_plugins/gazebo_ros_video_stream.h>
+
+using namespace gazebo;
+
+static const int kFrames = 60;
+static const int kSourceWidth = 320;
+static const int kSourceHeight = 240;
+static const int kWidth = 64;
+static const int kHeight = 48;
+
+/// \brief Decoder buffers plus a ring of 12 frames
+static const size_t kBudget = kSourceWidth * kSourceHeight * 3 +
+                              kWidth * kHeight * 3 + 12 * kWidth * kHeight * 4;
+
+/// \brief Clip of uniform gray frames, frame i has the value 4 * i
+static std::string WriteClip()
+{
+  const std::string path = "/tmp/video_stream_benchmark.avi";
+  cv::VideoWriter writer(path, CV_FOURCC('M', 'J', 'P', 'G'), 24,
+                         cv::Size(kSourceWidth, kSourceHeight));
+  for (int i = 0; i < kFrames; ++i)
+  {
+    cv::Mat frame(kSourceHeight, kSourceWidth, CV_8UC3, cv::Scalar::all(4 * i));
+    writer << frame;
+  }
+  return path;
+}
+
+/// \brief Index of a frame of the clip, from its gray value
+static int FrameIndex(const cv::Mat &_frame)
+{
+  return cvRound(cv::mean(_frame)[0] / 4.0);
+}
+
+/// \brief Wait for the decoder to deliver the frame at the playhead
+static bool WaitNext(VideoFrameStream &_stream, cv::Mat &_frame)
+{
+  for (int i = 0; i < 5000; ++i)
+  {
+    if (_stream.Next(_frame))
+      return true;
+    if (_stream.Finished())
+      return false;
+    boost::this_thread::sleep(boost::posix_time::microseconds(100));
+  }
+  return false;
+}
+
+class VideoStreamBenchmark : public testing::Test
+{
+  protected: static void SetUpTestCase()
+  {
+    path_ = WriteClip();
+  }
+
+  protected: static void TearDownTestCase()
+  {
+    remove(path_.c_str());
+  }
+
+  protected: static std::string path_;
+};
+
+std::string VideoStreamBenchmark::path_;
+
+TEST_F(VideoStreamBenchmark, playsInOrderWithinBudget)
+{
+  VideoFrameStream stream(kWidth, kHeight, kBudget);
+  ASSERT_TRUE(stream.Open(path_));
+  EXPECT_EQ(kFrames, stream.FrameCount());
+  EXPECT_EQ(12u, stream.Capacity());
+  EXPECT_LE(stream.Bytes(), kBudget);
+
+  cv::Mat frame;
+  int expected = 0;
+  while (WaitNext(stream, frame))
+  {
+    ASSERT_EQ(kHeight, frame.rows);
+    ASSERT_EQ(kWidth, frame.cols);
+    ASSERT_EQ(CV_8UC4, frame.type());
+    EXPECT_EQ(expected, FrameIndex(frame));
+    ++expected;
+  }
+  EXPECT_EQ(kFrames, expected);
+  EXPECT_TRUE(stream.Finished());
+}
+
+TEST_F(VideoStreamBenchmark, seeks)
+{
+  VideoFrameStream stream(kWidth, kHeight, kBudget);
+  ASSERT_TRUE(stream.Open(path_));
+  cv::Mat frame;
+
+  // outside of the ring, the decoder restarts
+  stream.Seek(0.5);
+  ASSERT_TRUE(WaitNext(stream, frame));
+  EXPECT_EQ((kFrames - 1) / 2, FrameIndex(frame));
+  ASSERT_TRUE(WaitNext(stream, frame));
+  ASSERT_TRUE(WaitNext(stream, frame));
+
+  // back into the played frames the ring keeps, no decoding needed
+  stream.Seek(0.5);
+  ASSERT_TRUE(stream.Next(frame));
+  EXPECT_EQ((kFrames - 1) / 2, FrameIndex(frame));
+
+  stream.Seek(1.0);
+  ASSERT_TRUE(WaitNext(stream, frame));
+  EXPECT_EQ(kFrames - 1, FrameIndex(frame));
+  EXPECT_FALSE(WaitNext(stream, frame));
+  EXPECT_TRUE(stream.Finished());
+
+  // looping restarts from the first frame
+  stream.Seek(0.0);
+  EXPECT_FALSE(stream.Finished());
+  ASSERT_TRUE(WaitNext(stream, frame));
+  EXPECT_EQ(0, FrameIndex(frame));
+}
+
+TEST_F(VideoStreamBenchmark, tinyBudgetKeepsTwoFrames)
+{
+  VideoFrameStream stream(kWidth, kHeight, 0);
+  ASSERT_TRUE(stream.Open(path_));
+  EXPECT_EQ(2u, stream.Capacity());
+
+  cv::Mat frame;
+  int expected = 0;
+  while (WaitNext(stream, frame))
+    EXPECT_EQ(expected++, FrameIndex(frame));
+  EXPECT_EQ(kFrames, expected);
+}
+
+TEST_F(VideoStreamBenchmark, closeWhileDecoding)
+{
+  VideoFrameStream stream(kWidth, kHeight, kBudget);
+  for (int i = 0; i < 10; ++i)
+  {
+    ASSERT_TRUE(stream.Open(path_));
+    stream.Seek(0.25 * (i % 4));
+    stream.Close();
+    EXPECT_FALSE(stream.IsOpen());
+  }
+  EXPECT_FALSE(stream.Open("/tmp/no_such_video.avi"));
+}
+
+TEST_F(VideoStreamBenchmark, seekLatency)
+{
+  VideoFrameStream stream(kWidth, kHeight, kBudget);
+  ASSERT_TRUE(stream.Open(path_));
+  cv::Mat frame;
+
+  const int seeks = 50;
+  boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+  for (int i = 0; i < seeks; ++i)
+  {
+    const double position = ((i * 37) % kFrames) / static_cast<double>(kFrames - 1);
+    stream.Seek(position);
+    ASSERT_TRUE(WaitNext(stream, frame));
+    EXPECT_EQ((i * 37) % kFrames, FrameIndex(frame));
+  }
+  const double seek_ms =
+    (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() * 1e-3 / seeks;
+
+  printf("%d frames of %dx%d in a ring of %lu frames (%.1f kB): %.2f ms per seek\n",
+         kFrames, kSourceWidth, kSourceHeight, (unsigned long)stream.Capacity(),
+         stream.Bytes() / 1024.0, seek_ms);
+}
+
+int main(int argc, char **argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+// Drops 50 boxes, saves the world mid-fall and restores it, checking that
+// the boxes are back where they were saved without rewinding the clock,
+// that a restore with a deleted model changes nothing, that the least
+// recently used snapshot is evicted, and that a restore is faster than one
+// set_model_state call per box.
+
+#include <cstdio>
+#include <string>
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include <std_srvs/Empty.h>
+
+#include <gazebo_msgs/DeleteModel.h>
+#include <gazebo_msgs/GetModelStates.h>
+#include <gazebo_msgs/RestoreWorldSnapshot.h>
+#include <gazebo_msgs/SaveWorldSnapshot.h>
+#include <gazebo_msgs/SetModelState.h>
+#include <gazebo_msgs/SpawnModel.h>
+#include <gazebo_msgs/SpawnModels.h>
+
+static const unsigned int kModels = 50;
+static const unsigned int kResets = 20;
+// default world_snapshot_capacity
+static const unsigned int kCapacity = 16;
+
+static std::string BoxSDF()
+{
+  return "<?xml version='1.0'?><sdf version='1.4'><model name='box'><link name='link'>"
+         "<collision name='collision'><geometry><box><size>0.2 0.2 0.2</size></box></geometry></collision>"
+         "<visual name='visual'><geometry><box><size>0.2 0.2 0.2</size></box></geometry></visual>"
+         "</link></model></sdf>";
+}
+
+static std::string BoxName(unsigned int i)
+{
+  return "box_" + std::to_string(i);
+}
+
+class WorldSnapshotBenchmark : public testing::Test
+{
+protected:
+  virtual void SetUp()
+  {
+    ASSERT_TRUE(ros::service::waitForService("/gazebo/save_world_snapshot", ros::Duration(60.0)));
+    save_ = nh_.serviceClient<gazebo_msgs::SaveWorldSnapshot>("/gazebo/save_world_snapshot", true);
+    restore_ = nh_.serviceClient<gazebo_msgs::RestoreWorldSnapshot>("/gazebo/restore_world_snapshot", true);
+    get_model_states_ = nh_.serviceClient<gazebo_msgs::GetModelStates>("/gazebo/get_model_states", true);
+    set_model_state_ = nh_.serviceClient<gazebo_msgs::SetModelState>("/gazebo/set_model_state", true);
+    pause_ = nh_.serviceClient<std_srvs::Empty>("/gazebo/pause_physics", true);
+    unpause_ = nh_.serviceClient<std_srvs::Empty>("/gazebo/unpause_physics", true);
+
+    if (spawned_)
+      return;
+    gazebo_msgs::SpawnModels spawn;
+    for (unsigned int i = 0; i < kModels; ++i)
+    {
+      geometry_msgs::Pose pose;
+      pose.position.x = 0.5 * (i % 10);
+      pose.position.y = 0.5 * (i / 10);
+      pose.position.z = 5.0;
+      pose.orientation.w = 1.0;
+      spawn.request.model_names.push_back(BoxName(i));
+      spawn.request.model_xmls.push_back(BoxSDF());
+      spawn.request.initial_poses.push_back(pose);
+    }
+    ros::ServiceClient spawn_models = nh_.serviceClient<gazebo_msgs::SpawnModels>("/gazebo/spawn_models");
+    ASSERT_TRUE(spawn_models.call(spawn));
+    ASSERT_TRUE(spawn.response.success) << spawn.response.status_message;
+    spawned_ = true;
+  }
+
+  gazebo_msgs::GetModelStates::Response States()
+  {
+    gazebo_msgs::GetModelStates get;
+    for (unsigned int i = 0; i < kModels; ++i)
+      get.request.model_names.push_back(BoxName(i));
+    EXPECT_TRUE(get_model_states_.call(get));
+    EXPECT_TRUE(get.response.success) << get.response.status_message;
+    return get.response;
+  }
+
+  void ExpectStates(const gazebo_msgs::GetModelStates::Response &expected,
+                    const gazebo_msgs::GetModelStates::Response &actual)
+  {
+    ASSERT_EQ(expected.pose.size(), actual.pose.size());
+    for (unsigned int i = 0; i < expected.pose.size(); ++i)
+    {
+      EXPECT_NEAR(expected.pose[i].position.x, actual.pose[i].position.x, 1e-6) << BoxName(i);
+      EXPECT_NEAR(expected.pose[i].position.y, actual.pose[i].position.y, 1e-6) << BoxName(i);
+      EXPECT_NEAR(expected.pose[i].position.z, actual.pose[i].position.z, 1e-6) << BoxName(i);
+      EXPECT_NEAR(expected.pose[i].orientation.w, actual.pose[i].orientation.w, 1e-6) << BoxName(i);
+      EXPECT_NEAR(expected.twist[i].linear.z, actual.twist[i].linear.z, 1e-6) << BoxName(i);
+      EXPECT_NEAR(expected.twist[i].angular.x, actual.twist[i].angular.x, 1e-6) << BoxName(i);
+    }
+  }
+
+  bool Save(const std::string &id)
+  {
+    gazebo_msgs::SaveWorldSnapshot save;
+    save.request.snapshot_id = id;
+    return save_.call(save) && save.response.success;
+  }
+
+  bool Restore(const std::string &id)
+  {
+    gazebo_msgs::RestoreWorldSnapshot restore;
+    restore.request.snapshot_id = id;
+    return restore_.call(restore) && restore.response.success;
+  }
+
+  ros::NodeHandle nh_;
+  ros::ServiceClient save_;
+  ros::ServiceClient restore_;
+  ros::ServiceClient get_model_states_;
+  ros::ServiceClient set_model_state_;
+  ros::ServiceClient pause_;
+  ros::ServiceClient unpause_;
+  static bool spawned_;
+};
+
+bool WorldSnapshotBenchmark::spawned_ = false;
+
+TEST_F(WorldSnapshotBenchmark, restoreMidFall)
+{
+  std_srvs::Empty empty;
+  ASSERT_TRUE(unpause_.call(empty));
+  ros::WallDuration(0.2).sleep();
+  ASSERT_TRUE(pause_.call(empty));
+
+  gazebo_msgs::SaveWorldSnapshot save;
+  save.request.snapshot_id = "mid_fall";
+  save.request.return_state = true;
+  ASSERT_TRUE(save_.call(save));
+  ASSERT_TRUE(save.response.success) << save.response.status_message;
+  EXPECT_GE(save.response.model_count, kModels);
+  EXPECT_EQ(save.response.link_count, save.response.state.name.size());
+  gazebo_msgs::GetModelStates::Response saved = States();
+
+  ASSERT_TRUE(unpause_.call(empty));
+  ros::WallDuration(0.5).sleep();
+  ASSERT_TRUE(pause_.call(empty));
+  // the boxes kept falling, or the restore below would prove nothing
+  gazebo_msgs::GetModelStates::Response fallen = States();
+  ASSERT_EQ(saved.pose.size(), fallen.pose.size());
+  EXPECT_LT(fallen.pose[0].position.z, saved.pose[0].position.z - 0.01);
+  ros::Time before_restore = ros::Time::now();
+
+  gazebo_msgs::RestoreWorldSnapshot restore;
+  restore.request.snapshot_id = "mid_fall";
+  ASSERT_TRUE(restore_.call(restore));
+  ASSERT_TRUE(restore.response.success) << restore.response.status_message;
+  printf("%s\n", restore.response.status_message.c_str());
+
+  ExpectStates(saved, States());
+
+  // the simulation time is not rewound to the save
+  EXPECT_LT(restore.response.sim_time, before_restore);
+  EXPECT_GE(ros::Time::now(), before_restore);
+
+  restore.request.snapshot_id = "no_such_snapshot";
+  ASSERT_TRUE(restore_.call(restore));
+  EXPECT_FALSE(restore.response.success);
+}
+
+TEST_F(WorldSnapshotBenchmark, restoreAgainstSetModelState)
+{
+  std_srvs::Empty empty;
+  ASSERT_TRUE(pause_.call(empty));
+  gazebo_msgs::SaveWorldSnapshot save;
+  save.request.snapshot_id = "episode_start";
+  ASSERT_TRUE(save_.call(save));
+  ASSERT_TRUE(save.response.success) << save.response.status_message;
+  gazebo_msgs::GetModelStates::Response start_states = States();
+
+  // one round trip per box
+  ros::WallTime start = ros::WallTime::now();
+  for (unsigned int reset = 0; reset < kResets; ++reset)
+  {
+    for (unsigned int i = 0; i < kModels; ++i)
+    {
+      gazebo_msgs::SetModelState set;
+      set.request.model_state.model_name = BoxName(i);
+      set.request.model_state.pose = start_states.pose[i];
+      set.request.model_state.twist = start_states.twist[i];
+      ASSERT_TRUE(set_model_state_.call(set));
+    }
+  }
+  double single_s = (ros::WallTime::now() - start).toSec() / kResets;
+
+  // one round trip per reset
+  start = ros::WallTime::now();
+  for (unsigned int reset = 0; reset < kResets; ++reset)
+  {
+    gazebo_msgs::RestoreWorldSnapshot restore;
+    restore.request.snapshot_id = "episode_start";
+    ASSERT_TRUE(restore_.call(restore));
+    ASSERT_TRUE(restore.response.success) << restore.response.status_message;
+  }
+  double snapshot_s = (ros::WallTime::now() - start).toSec() / kResets;
+
+  printf("set_model_state: %u models in %.3f ms per reset\n", kModels, 1000.0 * single_s);
+  printf("restore_world_snapshot: %u models in %.3f ms per reset\n", kModels, 1000.0 * snapshot_s);
+
+  ExpectStates(start_states, States());
+  // one round trip and one physics lock per reset instead of fifty
+  EXPECT_LT(snapshot_s, single_s);
+}
+
+TEST_F(WorldSnapshotBenchmark, deletedModelRestoresNothing)
+{
+  std_srvs::Empty empty;
+  ASSERT_TRUE(pause_.call(empty));
+
+  gazebo_msgs::SpawnModel spawn;
+  spawn.request.model_name = "doomed_box";
+  spawn.request.model_xml = BoxSDF();
+  spawn.request.initial_pose.position.x = -3.0;
+  spawn.request.initial_pose.position.z = 5.0;
+  spawn.request.initial_pose.orientation.w = 1.0;
+  ros::ServiceClient spawn_model = nh_.serviceClient<gazebo_msgs::SpawnModel>("/gazebo/spawn_sdf_model");
+  ASSERT_TRUE(spawn_model.call(spawn));
+  ASSERT_TRUE(spawn.response.success) << spawn.response.status_message;
+  ASSERT_TRUE(Save("with_doomed_box"));
+
+  // move the boxes away from the saved states
+  ASSERT_TRUE(unpause_.call(empty));
+  ros::WallDuration(0.2).sleep();
+  ASSERT_TRUE(pause_.call(empty));
+
+  gazebo_msgs::DeleteModel del;
+  del.request.model_name = "doomed_box";
+  ros::ServiceClient delete_model = nh_.serviceClient<gazebo_msgs::DeleteModel>("/gazebo/delete_model");
+  ASSERT_TRUE(delete_model.call(del));
+  ASSERT_TRUE(del.response.success) << del.response.status_message;
+  gazebo_msgs::GetModelStates::Response before = States();
+
+  gazebo_msgs::RestoreWorldSnapshot restore;
+  restore.request.snapshot_id = "with_doomed_box";
+  ASSERT_TRUE(restore_.call(restore));
+  EXPECT_FALSE(restore.response.success);
+  EXPECT_NE(std::string::npos, restore.response.status_message.find("doomed_box"))
+    << restore.response.status_message;
+  // not even the boxes that still exist were moved
+  ExpectStates(before, States());
+}
+
+TEST_F(WorldSnapshotBenchmark, evictsLeastRecentlyUsed)
+{
+  std_srvs::Empty empty;
+  ASSERT_TRUE(pause_.call(empty));
+  // fills the store, every snapshot of the other tests goes
+  for (unsigned int i = 0; i < kCapacity; ++i)
+    ASSERT_TRUE(Save("lru_" + std::to_string(i)));
+  EXPECT_FALSE(Restore("episode_start"));
+
+  // a restore counts as a use, lru_1 is now the oldest
+  EXPECT_TRUE(Restore("lru_0"));
+  ASSERT_TRUE(Save("lru_" + std::to_string(kCapacity)));
+  EXPECT_FALSE(Restore("lru_1"));
+  EXPECT_TRUE(Restore("lru_0"));
+  EXPECT_TRUE(Restore("lru_2"));
+  EXPECT_TRUE(Restore("lru_" + std::to_string(kCapacity)));
+
+  // saving an existing id replaces it without evicting another one
+  ASSERT_TRUE(Save("lru_0"));
+  for (unsigned int i = 2; i <= kCapacity; ++i)
+    EXPECT_TRUE(Restore("lru_" + std::to_string(i))) << i;
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "world_snapshot_benchmark");
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -27,7 +27,10 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <errno.h>
+#include <atomic>
 #include <iostream>
+#include <map>
+#include <set>
 
 #include <tinyxml.h>
 
@@ -45,10 +48,13 @@
 // Services
 #include "std_srvs/Empty.h"
 
+#include "gazebo_msgs/AddStateStream.h"
+
 #include "gazebo_msgs/JointRequest.h"
 #include "gazebo_msgs/BodyRequest.h"
 
 #include "gazebo_msgs/SpawnModel.h"
+#include "gazebo_msgs/SpawnModels.h"
 #include "gazebo_msgs/DeleteModel.h"
 #include "gazebo_msgs/DeleteLight.h"
 
@@ -63,7 +69,13 @@
 
 #include "gazebo_msgs/GetModelProperties.h"
 #include "gazebo_msgs/GetModelState.h"
+#include "gazebo_msgs/GetModelStates.h"
+#include "gazebo_msgs/GetUpdateTrace.h"
 #include "gazebo_msgs/SetModelState.h"
+#include "gazebo_msgs/SetModelStates.h"
+#include "gazebo_msgs/SaveWorldSnapshot.h"
+#include "gazebo_msgs/RestoreWorldSnapshot.h"
+#include "gazebo_msgs/StepAndObserve.h"
 
 #include "gazebo_msgs/GetJointProperties.h"
 #include "gazebo_msgs/ApplyJointEffort.h"
@@ -99,6 +111,17 @@
 #include "gazebo_msgs/GetPhysicsProperties.h"
 
 #include <boost/algorithm/string.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <gazebo_ros/gazebo_ros_job_scheduler.h>
+#include <gazebo_ros/gazebo_ros_model_descriptions.h>
+#include <gazebo_ros/gazebo_ros_state_shm.h>
+#include <gazebo_ros/gazebo_ros_state_snapshot.h>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
+#include <gazebo_ros/gazebo_ros_world_snapshot.h>
 
 namespace gazebo
 {
@@ -131,16 +154,19 @@ public:
   void advertiseServices();
 
   /// \brief
-  void onLinkStatesConnect();
+  void onLinkStatesConnect(unsigned int stream);
 
   /// \brief
-  void onModelStatesConnect();
+  void onModelStatesConnect(unsigned int stream);
 
   /// \brief
-  void onLinkStatesDisconnect();
+  void onLinkStatesDisconnect(unsigned int stream);
 
   /// \brief
-  void onModelStatesDisconnect();
+  void onModelStatesDisconnect(unsigned int stream);
+
+  /// \brief add a link or model states topic restricted to the entities matching a name filter
+  bool addStateStream(gazebo_msgs::AddStateStream::Request &req,gazebo_msgs::AddStateStream::Response &res);
 
   /// \brief Function for inserting a URDF into Gazebo from ROS Service Call
   bool spawnURDFModel(gazebo_msgs::SpawnModel::Request &req,
@@ -150,6 +176,10 @@ public:
   bool spawnSDFModel(gazebo_msgs::SpawnModel::Request &req,
                      gazebo_msgs::SpawnModel::Response &res);
 
+  /// \brief Spawn several URDF or SDF models at once, waiting for all of them together
+  bool spawnModels(gazebo_msgs::SpawnModels::Request &req,
+                   gazebo_msgs::SpawnModels::Response &res);
+
   /// \brief delete model given name
   bool deleteModel(gazebo_msgs::DeleteModel::Request &req,gazebo_msgs::DeleteModel::Response &res);
 
@@ -159,6 +189,12 @@ public:
   /// \brief
   bool getModelState(gazebo_msgs::GetModelState::Request &req,gazebo_msgs::GetModelState::Response &res);
 
+  /// \brief get the states of many models, all read at the same physics step
+  bool getModelStates(gazebo_msgs::GetModelStates::Request &req,gazebo_msgs::GetModelStates::Response &res);
+
+  /// \brief recent calls of the profiled world update callbacks, as a Chrome trace
+  bool getUpdateTrace(gazebo_msgs::GetUpdateTrace::Request &req,gazebo_msgs::GetUpdateTrace::Response &res);
+
   /// \brief
   bool getModelProperties(gazebo_msgs::GetModelProperties::Request &req,gazebo_msgs::GetModelProperties::Response &res);
 
@@ -195,6 +231,9 @@ public:
   /// \brief
   bool setModelState(gazebo_msgs::SetModelState::Request &req,gazebo_msgs::SetModelState::Response &res);
 
+  /// \brief set the states of many models between the same two physics steps, all or none
+  bool setModelStates(gazebo_msgs::SetModelStates::Request &req,gazebo_msgs::SetModelStates::Response &res);
+
   /// \brief
   void updateModelState(const gazebo_msgs::ModelState::ConstPtr& model_state);
 
@@ -233,23 +272,122 @@ public:
   /// \brief
   bool applyBodyWrench(gazebo_msgs::ApplyBodyWrench::Request &req,gazebo_msgs::ApplyBodyWrench::Response &res);
 
+  /// \brief advance the paused world by a number of iterations under constant efforts and wrenches,
+  /// returning the model and joint states after each of them or after the last one
+  bool stepAndObserve(gazebo_msgs::StepAndObserve::Request &req,gazebo_msgs::StepAndObserve::Response &res);
+
+  /// \brief keep the states of all links and joints in memory under an id
+  bool saveWorldSnapshot(gazebo_msgs::SaveWorldSnapshot::Request &req,gazebo_msgs::SaveWorldSnapshot::Response &res);
+
+  /// \brief move all links and joints back to the states saved under an id
+  bool restoreWorldSnapshot(gazebo_msgs::RestoreWorldSnapshot::Request &req,gazebo_msgs::RestoreWorldSnapshot::Response &res);
+
 private:
 
+  /// \brief A model or light ready to be sent to the factory
+  class SpawnJob
+  {
+  public:
+    std::string model_name;
+    std::string xml;
+    bool is_light;
+    bool is_urdf;
+  };
+
+  /// \brief A parsed model xml, reused by spawns of the same xml
+  class ModelTemplate
+  {
+  public:
+    /// \brief xml as received
+    std::string source;
+    /// \brief package:// paths of URDFs were resolved
+    bool resolve_urdf;
+    /// \brief parsed xml, without declaration
+    TiXmlDocument document;
+    bool is_sdf;
+    bool is_urdf;
+  };
+
+  class ModelTemplateEntry
+  {
+  public:
+    boost::shared_ptr<const ModelTemplate> model_template;
+    uint64_t last_use;
+  };
+
+  /// \brief Maximum number of factory messages in flight, and so models in one spawn_models batch
+  static const unsigned int SPAWN_QUEUE_LIMIT = 10000;
+
+  /// \brief Maximum number of model or joint observations in one step_and_observe response,
+  /// the number of stamps times the number of models or observed joints
+  static const size_t STEP_OBSERVATION_LIMIT = 1000000;
+
+  /// \brief look up a model through the entity index
+  gazebo::physics::ModelPtr modelByName(const std::string &name);
+
+  /// \brief look up an entity through the entity index, falls back to the world for entities
+  /// that are not part of a model
+  gazebo::physics::EntityPtr entityByName(const std::string &name);
+
+  /// \brief look up a joint in all models, as apply_joint_effort does
+  gazebo::physics::JointPtr jointByName(const std::string &name);
+
+  /// \brief rebuild the entity index if models were added or removed, entity_index_mutex_ must be held
+  void updateEntityIndex();
+
+  /// \brief add an entity and its descendants to the entity index
+  void indexEntity(const gazebo::physics::EntityPtr &entity);
+
+  /// \brief mark the entity index and the state snapshots stale after a spawn or delete
+  void entitiesChanged();
+
   /// \brief
   void wrenchBodySchedulerSlot();
 
   /// \brief
   void forceJointSchedulerSlot();
 
+  /// \brief apply the efforts and wrenches of the running step_and_observe call, if any
+  void stepBatchBeginSlot();
+
+  /// \brief record the states of the running step_and_observe call, if any
+  void stepBatchEndSlot();
+
   /// \brief
   void publishSimTime(const boost::shared_ptr<gazebo::msgs::WorldStatistics const> &msg);
   void publishSimTime();
 
-  /// \brief
-  void publishLinkStates();
+  /// \brief publish the world update profiles on ~profiling
+  void publishUpdateProfiles(const ros::WallTimerEvent &event);
 
-  /// \brief
-  void publishModelStates();
+  /// \brief advertise a link states topic published at most at rate Hz, 0 for every update
+  /// \return snapshot stream of the topic, -1 if there are too many streams
+  int advertiseLinkStates(const std::string &topic, double rate,
+                          const boost::shared_ptr<const StateStreamFilter> &filter = boost::shared_ptr<const StateStreamFilter>());
+
+  /// \brief advertise a model states topic published at most at rate Hz, 0 for every update
+  /// \return snapshot stream of the topic, -1 if there are too many streams
+  int advertiseModelStates(const std::string &topic, double rate,
+                           const boost::shared_ptr<const StateStreamFilter> &filter = boost::shared_ptr<const StateStreamFilter>());
+
+  /// \brief export link states to a shared memory segment at most at rate Hz, 0 for every update,
+  /// on the snapshot stream link_states_shm_stream_
+  /// \return false if the export could not be set up
+  bool exportLinkStates(const std::string &shm_name, double rate, int capacity);
+
+  /// \brief export model states to a shared memory segment at most at rate Hz, 0 for every update,
+  /// on the snapshot stream model_states_shm_stream_
+  /// \return false if the export could not be set up
+  bool exportModelStates(const std::string &shm_name, double rate, int capacity);
+
+  /// \brief write a snapshot to a shared memory segment
+  static void exportSnapshot(StateShmWriter &writer, const StateSnapshot &snapshot);
+
+  /// \brief publish a link states snapshot, called on the snapshot engine thread
+  void publishLinkStates(const StateSnapshot &snapshot);
+
+  /// \brief publish a model states snapshot, called on the snapshot engine thread
+  void publishModelStates(const StateSnapshot &snapshot);
 
   /// \brief
   void stripXmlDeclaration(std::string &model_xml);
@@ -268,12 +406,42 @@ private:
   /// \brief Update the model name of the URDF file before sending to Gazebo
   void updateURDFName(TiXmlDocument &gazebo_model_xml, const std::string &model_name);
 
-  /// \brief
-  void walkChildAddRobotNamespace(TiXmlNode* model_xml);
+  /// \brief add robot_namespace as <robotNamespace> to the plugins of a model that have none
+  void walkChildAddRobotNamespace(TiXmlNode* model_xml, const std::string &robot_namespace);
+
+  /// \brief strip the declaration and comments of an URDF and resolve its package:// paths
+  bool preprocessURDF(std::string &model_xml, std::string &status_message);
+
+  /// \brief parsed model xml, from the template cache if the same xml was spawned before
+  /// \param resolve_urdf resolve package:// paths if the model is an URDF
+  /// \return NULL if a package can not be found
+  boost::shared_ptr<const ModelTemplate> modelTemplate(const std::string &model_xml, bool resolve_urdf,
+                                                       std::string &status_message);
+
+  /// \brief apply the name, initial pose and robot namespace of a spawn request to a copy of its model template
+  bool conformModel(const gazebo_msgs::SpawnModel::Request &req, const ModelTemplate &model_template,
+                    SpawnJob &job, std::string &status_message);
+
+  /// \brief check that no entity of the same name exists yet
+  bool checkSpawnable(const SpawnJob &job, std::string &status_message);
+
+  /// \brief send a model or light to the factory
+  void publishSpawn(const SpawnJob &job);
+
+  /// \brief record entities added to the world while spawn requests wait for them
+  void onAddEntity(std::string name);
+
+  /// \brief invalidate the entity indices and forget the URDF when an entity
+  /// is deleted by any client
+  void onDeleteEntity(std::string name);
+
+  /// \brief wait until the entities appear in the world
+  /// \param pending names of the entities, mapped to true for lights; the ones
+  ///        that did not appear before the timeout are left
+  void waitForEntities(std::map<std::string, bool> &pending, const ros::WallDuration &timeout);
 
   /// \brief
-  bool spawnAndConform(TiXmlDocument &gazebo_model_xml, const std::string &model_name,
-                       gazebo_msgs::SpawnModel::Response &res);
+  bool spawnAndConform(const SpawnJob &job, gazebo_msgs::SpawnModel::Response &res);
 
   /// \brief helper function for applyBodyWrench
   ///        shift wrench from reference frame to target frame
@@ -313,8 +481,6 @@ private:
   bool stop_;
   gazebo::event::ConnectionPtr sigint_event_;
 
-  std::string robot_namespace_;
-
   gazebo::transport::NodePtr gazebonode_;
   gazebo::transport::SubscriberPtr stat_sub_;
   gazebo::transport::PublisherPtr factory_pub_;
@@ -334,12 +500,19 @@ private:
   gazebo::event::ConnectionPtr pub_link_states_event_;
   gazebo::event::ConnectionPtr pub_model_states_event_;
   gazebo::event::ConnectionPtr load_gazebo_ros_api_plugin_event_;
+  gazebo::event::ConnectionPtr add_entity_event_;
+  gazebo::event::ConnectionPtr delete_entity_event_;
+  gazebo::event::ConnectionPtr step_batch_begin_event_;
+  gazebo::event::ConnectionPtr step_batch_end_event_;
 
+  ros::ServiceServer add_state_stream_service_;
   ros::ServiceServer spawn_sdf_model_service_;
   ros::ServiceServer spawn_urdf_model_service_;
+  ros::ServiceServer spawn_models_service_;
   ros::ServiceServer delete_model_service_;
   ros::ServiceServer delete_light_service_;
   ros::ServiceServer get_model_state_service_;
+  ros::ServiceServer get_model_states_service_;
   ros::ServiceServer get_model_properties_service_;
   ros::ServiceServer get_world_properties_service_;
   ros::ServiceServer get_joint_properties_service_;
@@ -353,6 +526,7 @@ private:
   ros::ServiceServer apply_body_wrench_service_;
   ros::ServiceServer set_joint_properties_service_;
   ros::ServiceServer set_model_state_service_;
+  ros::ServiceServer set_model_states_service_;
   ros::ServiceServer apply_joint_effort_service_;
   ros::ServiceServer set_model_configuration_service_;
   ros::ServiceServer set_link_state_service_;
@@ -362,12 +536,43 @@ private:
   ros::ServiceServer unpause_physics_service_;
   ros::ServiceServer clear_joint_forces_service_;
   ros::ServiceServer clear_body_wrenches_service_;
+  ros::ServiceServer get_update_trace_service_;
+  ros::ServiceServer step_and_observe_service_;
+  ros::ServiceServer save_world_snapshot_service_;
+  ros::ServiceServer restore_world_snapshot_service_;
   ros::Subscriber    set_link_state_topic_;
   ros::Subscriber    set_model_state_topic_;
-  ros::Publisher     pub_link_states_;
-  ros::Publisher     pub_model_states_;
+  std::vector<ros::Publisher> pub_link_states_; // indexed by snapshot stream
+  std::vector<ros::Publisher> pub_model_states_; // indexed by snapshot stream
+  // written by the service threads, read by the snapshot engine threads
+  boost::mutex       pub_link_states_mutex_;
+  boost::mutex       pub_model_states_mutex_;
   int                pub_link_states_connection_count_;
   int                pub_model_states_connection_count_;
+  ros::Publisher     pub_update_profiles_;
+  ros::WallTimer     update_profiles_timer_;
+
+  // world state snapshots captured on the physics thread, published on their own threads
+  boost::scoped_ptr<StateSnapshotEngine> link_states_engine_;
+  boost::scoped_ptr<StateSnapshotEngine> model_states_engine_;
+  gazebo_msgs::LinkStates link_states_msg_;
+  gazebo_msgs::ModelStates model_states_msg_;
+  unsigned int link_states_msg_generation_;
+  unsigned int model_states_msg_generation_;
+  // messages of the filtered streams, indexed by snapshot stream
+  std::vector<gazebo_msgs::LinkStates> link_states_stream_msgs_;
+  std::vector<gazebo_msgs::ModelStates> model_states_stream_msgs_;
+  std::vector<unsigned int> link_states_stream_msg_generations_;
+  std::vector<unsigned int> model_states_stream_msg_generations_;
+  // number of the next filtered stream added without a topic name, counted apart from the
+  // other publishers so the numbers do not depend on which streams the launch file set up
+  unsigned int link_states_filtered_count_;
+  unsigned int model_states_filtered_count_;
+  // same host export of the states, written on the snapshot engine threads
+  StateShmWriter link_states_shm_;
+  StateShmWriter model_states_shm_;
+  int link_states_shm_stream_;
+  int model_states_shm_stream_;
 
   // ROS comm
   boost::shared_ptr<ros::AsyncSpinner> async_ros_spin_;
@@ -389,6 +594,28 @@ private:
 
   bool world_created_;
 
+  /// \brief entities added while spawn services are waiting, cleared when none is
+  boost::mutex spawn_mutex_;
+  boost::condition_variable spawn_cond_;
+  std::vector<std::string> added_entities_;
+  unsigned int spawn_waiters_;
+
+  /// \brief models by name and entities by scoped and unscoped name, rebuilt when the models change.
+  /// Weak, so that the index neither keeps deleted models alive nor hands them out.
+  boost::mutex entity_index_mutex_;
+  boost::unordered_map<std::string, boost::weak_ptr<gazebo::physics::Model> > model_index_;
+  boost::unordered_map<std::string, boost::weak_ptr<gazebo::physics::Entity> > entity_index_;
+  unsigned int entity_index_model_count_;
+  std::atomic<bool> entity_index_stale_;
+  unsigned int get_model_states_count_;
+
+  /// \brief parsed model xmls by content hash, least recently used ones are evicted
+  boost::mutex model_templates_mutex_;
+  std::multimap<size_t, ModelTemplateEntry> model_templates_;
+  int model_template_cache_size_;
+  uint64_t model_template_uses_;
+  uint64_t model_template_hits_;
+
   class WrenchBodyJob
   {
   public:
@@ -397,6 +624,22 @@ private:
     ignition::math::Vector3d torque;
     ros::Time start_time;
     ros::Duration duration;
+
+    /// \brief apply the wrench, false if the body does not exist
+    bool apply()
+    {
+      if (!body)
+        return false;
+      body->SetForce(force);
+      body->SetTorque(torque);
+      return true;
+    }
+
+    /// \brief name matched by clearBodyWrenches
+    std::string name() const
+    {
+      return body ? body->GetScopedName() : std::string();
+    }
   };
 
   class ForceJointJob
@@ -406,10 +649,50 @@ private:
     double force; // should this be a array?
     ros::Time start_time;
     ros::Duration duration;
+
+    /// \brief apply the effort, false if the joint does not exist
+    bool apply()
+    {
+      if (!joint)
+        return false;
+      joint->SetForce(0,force);
+      return true;
+    }
+
+    /// \brief name matched by clearJointForces
+    std::string name() const
+    {
+      return joint ? joint->GetName() : std::string();
+    }
   };
 
-  std::vector<GazeboRosApiPlugin::WrenchBodyJob*> wrench_body_jobs_;
-  std::vector<GazeboRosApiPlugin::ForceJointJob*> force_joint_jobs_;
+  /// \brief world snapshots by id, the least recently used ones are evicted
+  WorldSnapshotStore world_snapshots_;
+
+  /// \brief commands and observations of a step_and_observe call, resolved before stepping
+  class StepBatch
+  {
+  public:
+    std::vector<gazebo::physics::JointPtr> effort_joints;
+    std::vector<double> efforts;
+    std::vector<gazebo::physics::LinkPtr> wrench_bodies;
+    std::vector<ignition::math::Vector3d> forces;
+    std::vector<ignition::math::Vector3d> torques;
+    std::vector<gazebo::physics::ModelPtr> models;
+    std::vector<gazebo::physics::JointPtr> joints;
+    unsigned int steps;
+    bool every_step;
+    /// \brief iterations completed so far, only touched by the physics thread while stepping
+    unsigned int iterations;
+    gazebo_msgs::StepAndObserve::Response *res;
+  };
+
+  /// \brief running step_and_observe call, NULL otherwise, checked by the world update slots
+  std::atomic<StepBatch*> step_batch_;
+
+  /// \brief jobs submitted by the services without locking, applied on world update
+  JobScheduler<GazeboRosApiPlugin::WrenchBodyJob> wrench_body_jobs_;
+  JobScheduler<GazeboRosApiPlugin::ForceJointJob> force_joint_jobs_;
 
   /// \brief index counters to count the accesses on models via GetModelState
   std::map<std::string, unsigned int> access_count_get_model_state_;
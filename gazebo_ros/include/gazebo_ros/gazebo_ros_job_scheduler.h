@@ -0,0 +1,208 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+/*
+ * Desc: Sim time scheduler for the body wrench and joint effort jobs of the
+ *       Gazebo ROS API plugin
+ */
+
+#ifndef __GAZEBO_ROS_JOB_SCHEDULER_HH__
+#define __GAZEBO_ROS_JOB_SCHEDULER_HH__
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+
+namespace gazebo
+{
+
+/// \brief Applies timed jobs on the physics thread.
+///
+/// Jobs wait in a min-heap keyed on their start time and move to an active
+/// set once started, so a physics step only touches the started jobs and
+/// the top of the heap instead of every pending job.  Service threads
+/// submit and clear jobs through a lock-free stack that the physics thread
+/// drains at the start of each update, so neither side ever blocks on the
+/// other.
+///
+/// A Job provides
+///  - ros::Time start_time and ros::Duration duration, a negative duration
+///    runs the job until it is cleared
+///  - bool apply(), applies the job, false if its target is gone
+///  - std::string name(), the name clear() is matched against
+template <class Job>
+class JobScheduler
+{
+public:
+  JobScheduler() : submitted_(NULL) {}
+
+  ~JobScheduler()
+  {
+    Command *command = submitted_.exchange(NULL);
+    while (command)
+    {
+      Command *next = command->next;
+      delete command;
+      command = next;
+    }
+  }
+
+  /// \brief Schedule a job, can be called from any thread
+  void submit(const Job &job)
+  {
+    Command *command = new Command;
+    command->job = job;
+    command->clear = false;
+    push(command);
+  }
+
+  /// \brief Remove all jobs of the given name, can be called from any thread.
+  /// Takes effect at the start of the next update(), before any job is
+  /// applied, and does not affect jobs submitted after it.
+  void clear(const std::string &name)
+  {
+    Command *command = new Command;
+    command->name = name;
+    command->clear = true;
+    push(command);
+  }
+
+  /// \brief Apply the jobs running at the given time, to be called on the
+  /// physics thread on every world update
+  void update(const ros::Time &now)
+  {
+    processCommands();
+
+    // start the jobs that are due
+    while (!pending_.empty() && pending_.front().start_time <= now)
+    {
+      std::pop_heap(pending_.begin(), pending_.end(), LaterStart());
+      active_.push_back(pending_.back());
+      pending_.pop_back();
+    }
+
+    // apply the started jobs and drop the expired ones, keeping their order
+    size_t kept = 0;
+    for (size_t i = 0; i < active_.size(); ++i)
+    {
+      Job &job = active_[i];
+      bool forever = job.duration.toSec() < 0.0;
+      bool expired = !forever && now > job.start_time + job.duration;
+      bool keep = !expired;
+      // the world may have been reset to before the start of the job
+      if (!expired && now >= job.start_time && !job.apply())
+        keep = false;
+      if (!keep)
+        continue;
+      if (kept != i)
+        active_[kept] = active_[i];
+      ++kept;
+    }
+    active_.erase(active_.begin() + kept, active_.end());
+  }
+
+  /// \brief Number of scheduled jobs as of the last update
+  size_t size() const
+  {
+    return pending_.size() + active_.size();
+  }
+
+private:
+  class Command
+  {
+  public:
+    Job job;
+    std::string name;
+    bool clear;
+    Command *next;
+  };
+
+  class LaterStart
+  {
+  public:
+    bool operator()(const Job &a, const Job &b) const
+    {
+      return a.start_time > b.start_time;
+    }
+  };
+
+  class NameIs
+  {
+  public:
+    explicit NameIs(const std::string &name) : name_(name) {}
+    bool operator()(const Job &job) const
+    {
+      return job.name() == name_;
+    }
+  private:
+    const std::string &name_;
+  };
+
+  void push(Command *command)
+  {
+    command->next = submitted_.load();
+    while (!submitted_.compare_exchange_weak(command->next, command))
+      ;
+  }
+
+  void processCommands()
+  {
+    // take the whole stack and restore submission order
+    Command *command = submitted_.exchange(NULL);
+    Command *ordered = NULL;
+    while (command)
+    {
+      Command *next = command->next;
+      command->next = ordered;
+      ordered = command;
+      command = next;
+    }
+
+    while (ordered)
+    {
+      Command *next = ordered->next;
+      if (ordered->clear)
+      {
+        NameIs matches(ordered->name);
+        pending_.erase(std::remove_if(pending_.begin(), pending_.end(), matches), pending_.end());
+        std::make_heap(pending_.begin(), pending_.end(), LaterStart());
+        active_.erase(std::remove_if(active_.begin(), active_.end(), matches), active_.end());
+      }
+      else
+      {
+        pending_.push_back(ordered->job);
+        std::push_heap(pending_.begin(), pending_.end(), LaterStart());
+      }
+      delete ordered;
+      ordered = next;
+    }
+  }
+
+  /// \brief Not yet started jobs, min-heap on start time
+  std::vector<Job> pending_;
+
+  /// \brief Started jobs, in start order
+  std::vector<Job> active_;
+
+  /// \brief Submitted commands, most recent first
+  std::atomic<Command*> submitted_;
+};
+
+}
+#endif
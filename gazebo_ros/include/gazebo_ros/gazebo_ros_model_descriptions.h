@@ -0,0 +1,63 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+/*
+ * Desc: URDFs of the models spawned by the Gazebo ROS API plugin, for the
+ *       model plugins of the same process
+ */
+
+#ifndef __GAZEBO_ROS_MODEL_DESCRIPTIONS_HH__
+#define __GAZEBO_ROS_MODEL_DESCRIPTIONS_HH__
+
+#include <map>
+#include <string>
+
+#include <boost/thread/mutex.hpp>
+
+namespace gazebo
+{
+
+/// \brief URDF of each model spawned from a URDF, by model name.
+///
+/// The API plugin records the URDF before it hands the model to the
+/// factory, so the plugins of the model find it when they load, without
+/// a parameter server round trip.  It forgets the URDF on Gazebo's delete
+/// event, whichever client deleted the model, so a model of the same name
+/// spawned later from an SDF or through gz does not pick it up.
+class ModelDescriptions
+{
+public:
+  static ModelDescriptions &instance();
+
+  /// \brief Record the URDF of a model, replacing an older one
+  void set(const std::string &model_name, const std::string &urdf);
+
+  /// \brief Forget the URDF of a deleted model
+  void erase(const std::string &model_name);
+
+  /// \brief URDF of a model
+  /// \return false if the model was not spawned from a URDF
+  bool get(const std::string &model_name, std::string &urdf) const;
+
+private:
+  ModelDescriptions() {}
+
+  mutable boost::mutex mutex_;
+  std::map<std::string, std::string> descriptions_;
+};
+
+}
+#endif
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+/*
+ * Desc: Link and model states exported to POSIX shared memory, for readers
+ *       on the same host as gzserver
+ */
+
+#ifndef __GAZEBO_ROS_STATE_SHM_HH__
+#define __GAZEBO_ROS_STATE_SHM_HH__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace gazebo
+{
+
+/// \brief Segment layout.
+///
+/// A segment starts with a StateShmHeader, followed by the name table and
+/// by slot_count slots.  The name table is a StateShmNames followed by
+/// capacity zero terminated names of name_size bytes.  A slot is a
+/// StateShmSlot followed by capacity poses (x y z qx qy qz qw, in the world
+/// frame) and capacity twists (vx vy vz wx wy wz, in the world frame), all
+/// doubles in host byte order.  Entity i of a slot is entry i of the name
+/// table of the same generation.
+///
+/// The name table and every slot are guarded by a seqlock: the sequence is
+/// odd while the writer changes the data behind it, and a reader that sees
+/// the same even sequence before and after its copy got a consistent copy.
+/// The writer cycles through the slots, so a reader copying the latest slot
+/// is only disturbed if it takes longer than slot_count - 1 writes.
+class StateShmHeader
+{
+public:
+  /// \brief STATE_SHM_MAGIC once the segment is initialized
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  /// \brief Maximum number of entities
+  uint32_t capacity;
+  uint32_t slot_count;
+  /// \brief Bytes per name, including the terminating zero
+  uint32_t name_size;
+  uint32_t reserved;
+  /// \brief Byte offsets from the start of the segment
+  uint64_t names_offset;
+  uint64_t slots_offset;
+  /// \brief Bytes per slot
+  uint64_t slot_size;
+  /// \brief Number of completed slot writes, the latest slot is
+  /// (write_count - 1) % slot_count
+  std::atomic<uint64_t> write_count;
+};
+
+class StateShmNames
+{
+public:
+  std::atomic<uint64_t> seq;
+  /// \brief Generation of the entity index the names were taken from
+  uint32_t generation;
+  uint32_t count;
+};
+
+class StateShmSlot
+{
+public:
+  std::atomic<uint64_t> seq;
+  /// \brief Generation of the name table the entities belong to
+  uint32_t generation;
+  uint32_t count;
+  /// \brief Simulation time of the states
+  int32_t sec;
+  int32_t nsec;
+  uint64_t reserved;
+};
+
+/// \brief "GZSS"
+static const uint32_t STATE_SHM_MAGIC = 0x53535a47;
+static const uint32_t STATE_SHM_VERSION = 1;
+
+/// \brief A copy of the latest states of a segment
+class StateShmState
+{
+public:
+  StateShmState() : write_count(0), generation(0), sec(0), nsec(0) {}
+
+  /// \brief Number of entities
+  size_t size() const { return names.size(); }
+
+  /// \brief Number of writes to the segment up to this state
+  uint64_t write_count;
+  uint32_t generation;
+  int32_t sec;
+  int32_t nsec;
+  std::vector<std::string> names;
+  /// \brief x y z qx qy qz qw of each entity
+  std::vector<double> poses;
+  /// \brief vx vy vz wx wy wz of each entity
+  std::vector<double> twists;
+};
+
+/// \brief Creates a segment and writes states to it, used by gzserver
+class StateShmWriter
+{
+public:
+  StateShmWriter();
+
+  /// \brief Destructor, removes the segment
+  ~StateShmWriter();
+
+  /// \brief Create or replace the segment
+  /// \param name POSIX shared memory name, e.g. "/gazebo_model_states"
+  /// \param capacity maximum number of entities, further ones are not exported
+  /// \param slot_count number of slots the writer cycles through
+  /// \param name_size bytes per name, longer names are truncated
+  /// \return false if the segment could not be created
+  bool create(const std::string &name, uint32_t capacity,
+              uint32_t slot_count = 4, uint32_t name_size = 128);
+
+  /// \brief Remove the segment
+  void close();
+
+  bool isOpen() const { return base_ != NULL; }
+
+  /// \brief Publish the states of count entities
+  /// \param generation changes whenever names changes, the names are only
+  /// copied to the segment when it does
+  /// \param poses 7 doubles per entity
+  /// \param twists 6 doubles per entity
+  void write(int32_t sec, int32_t nsec, uint32_t generation,
+             const std::vector<std::string> &names,
+             const double *poses, const double *twists);
+
+private:
+  void writeNames(uint32_t generation, const std::vector<std::string> &names, uint32_t count);
+
+  std::string name_;
+  char *base_;
+  size_t size_;
+  uint64_t write_count_;
+  uint32_t names_generation_;
+  bool names_written_;
+};
+
+/// \brief Opens a segment and copies the latest states out of it
+class StateShmReader
+{
+public:
+  StateShmReader();
+  ~StateShmReader();
+
+  /// \brief Map an existing segment
+  /// \return false if it does not exist yet or has an unknown layout
+  bool open(const std::string &name);
+
+  /// \brief Unmap the segment
+  void close();
+
+  bool isOpen() const { return base_ != NULL; }
+
+  /// \brief Copy the latest states, names are only copied when their
+  /// generation differs from the one already in state
+  /// \return false if nothing was written yet, or the writer kept
+  /// overwriting the slot during every attempt
+  bool read(StateShmState &state) const;
+
+  /// \brief Number of writes to the segment so far, cheap to poll for new states
+  uint64_t writeCount() const;
+
+private:
+  bool readNames(uint32_t generation, StateShmState &state) const;
+
+  const char *base_;
+  size_t size_;
+};
+
+}
+#endif
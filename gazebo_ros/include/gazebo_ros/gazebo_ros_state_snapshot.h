@@ -0,0 +1,298 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+/*
+ * Desc: Link and model state snapshots for the link_states and model_states
+ *       topics of the Gazebo ROS API plugin
+ */
+
+#ifndef __GAZEBO_ROS_STATE_SNAPSHOT_HH__
+#define __GAZEBO_ROS_STATE_SNAPSHOT_HH__
+
+#include <atomic>
+#include <regex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <gazebo/physics/physics.hh>
+#include <gazebo/common/common.hh>
+
+#include "geometry_msgs/Pose.h"
+#include "geometry_msgs/Twist.h"
+
+namespace gazebo
+{
+
+/// \brief Selects the entities of a filtered state stream by name
+class StateStreamFilter
+{
+public:
+  /// \brief Constructor
+  /// \param name_regex entities whose name matches, ignored if empty
+  /// \param names entities with one of these names
+  /// \throws std::regex_error if name_regex is not a valid regular expression
+  StateStreamFilter(const std::string &name_regex, const std::vector<std::string> &names);
+
+  /// \brief True if the entity is part of the stream
+  bool matches(const std::string &name) const;
+
+private:
+  bool has_regex_;
+  std::regex regex_;
+  std::set<std::string> names_;
+};
+
+/// \brief Entities of a filtered stream, resolved against an entity index
+class StateStreamSelection
+{
+public:
+  /// \brief Positions in the snapshot arrays
+  std::vector<unsigned int> indices;
+
+  /// \brief Names of the selected entities
+  std::vector<std::string> names;
+};
+
+/// \brief Selection of each stream, NULL for streams that are not filtered
+typedef std::vector<boost::shared_ptr<const StateStreamSelection> > StateStreamSelections;
+
+/// \brief States of all links or all models of the world at one simulation
+/// time, stored as flat arrays.
+class StateSnapshot
+{
+public:
+  StateSnapshot() : generation(0), streams(0) {}
+
+  /// \brief Number of entities in the snapshot
+  size_t size() const { return names ? names->size() : 0; }
+
+  /// \brief Entities of a filtered stream, NULL if the stream is not filtered
+  const StateStreamSelection *selection(unsigned int stream) const
+  {
+    if (!selections || stream >= selections->size())
+      return NULL;
+    return (*selections)[stream].get();
+  }
+
+  /// \brief Simulation time the states were captured at
+  gazebo::common::Time sim_time;
+
+  /// \brief Entity index generation, changes whenever the index is rebuilt
+  unsigned int generation;
+
+  /// \brief Bit mask of the output streams this snapshot is due on
+  unsigned int streams;
+
+  /// \brief Entity names, shared by all snapshots of the same generation
+  boost::shared_ptr<const std::vector<std::string> > names;
+
+  /// \brief Filtered stream selections, shared by all snapshots of the same generation
+  boost::shared_ptr<const StateStreamSelections> selections;
+
+  /// \brief x y z qx qy qz qw of each entity, in the world frame
+  std::vector<double> poses;
+
+  /// \brief vx vy vz wx wy wz of each entity, in the world frame
+  std::vector<double> twists;
+};
+
+/// \brief Captures link or model states on the physics thread and hands them
+/// to a publisher thread.
+///
+/// The entities are looked up once and kept in an index that is only rebuilt
+/// after spawn / delete, so a capture is a copy of the poses and twists into
+/// pre-sized arrays.  The snapshot is then swapped with the publisher thread,
+/// which builds and serializes the ROS message.  If the publisher falls
+/// behind, intermediate snapshots are overwritten rather than queued, so the
+/// physics thread never waits on it.
+///
+/// A snapshot is fanned out to output streams, each decimated to its own
+/// rate in simulation time and optionally restricted to the entities
+/// matching a StateStreamFilter.  Filters are resolved together with the
+/// entity index.  States are only captured when at least one stream with
+/// subscribers is due.
+class StateSnapshotEngine
+{
+public:
+  enum Kind
+  {
+    LINKS,
+    MODELS
+  };
+
+  typedef boost::function<void (const StateSnapshot&)> PublishFunc;
+
+  /// \brief Constructor, the publisher thread starts with the first subscriber
+  /// \param kind capture the links or the models of the world
+  /// \param world world to capture
+  /// \param publish_func called on the publisher thread for each snapshot
+  StateSnapshotEngine(Kind kind, gazebo::physics::WorldPtr world,
+                      const PublishFunc &publish_func);
+
+  /// \brief Destructor, stops the publisher thread
+  ~StateSnapshotEngine();
+
+  /// \brief Mark the entity index stale, the next capture rebuilds it
+  void invalidate();
+
+  /// \brief Maximum number of output streams
+  static const unsigned int MAX_STREAMS = sizeof(unsigned int) * 8;
+
+  /// \brief Add an output stream
+  /// \param rate maximum publish rate in Hz of simulation time, 0 for every update
+  /// \param filter entities of the stream, all of them if NULL
+  /// \return stream index, used as bit of StateSnapshot::streams, -1 if
+  /// there are already MAX_STREAMS streams
+  int addStream(double rate,
+                const boost::shared_ptr<const StateStreamFilter> &filter = boost::shared_ptr<const StateStreamFilter>());
+
+  /// \brief Count a subscriber of a stream, streams without subscribers are
+  /// skipped.  Starts the publisher thread on the first call.
+  void addSubscriber(unsigned int stream);
+
+  /// \brief Remove a subscriber of a stream
+  void removeSubscriber(unsigned int stream);
+
+  /// \brief Capture the states if a stream is due, to be called on the
+  /// physics thread on every world update
+  void update();
+
+  /// \brief Fill a gazebo_msgs::LinkStates or gazebo_msgs::ModelStates
+  /// with all entities of a snapshot
+  /// \param snapshot states to convert
+  /// \param msg message to fill, reused from the previous call
+  /// \param msg_generation generation the names of msg were copied from
+  template <class M>
+  static void toMsg(const StateSnapshot &snapshot, M &msg, unsigned int &msg_generation);
+
+  /// \brief Fill a gazebo_msgs::LinkStates or gazebo_msgs::ModelStates
+  /// with the entities of one stream
+  template <class M>
+  static void toMsg(const StateSnapshot &snapshot, unsigned int stream, M &msg,
+                    unsigned int &msg_generation);
+
+private:
+  /// \brief Look up the entities and their names
+  void rebuildIndex();
+
+  /// \brief Copy the current states and pass them to the publisher thread
+  /// \param streams streams the snapshot is due on
+  void capture(unsigned int streams);
+
+  /// \brief Copy the states of the indexed entities into the back snapshot
+  /// \param streams streams the snapshot is due on
+  /// \return false if an entity was deleted since the index was built
+  bool copyStates(unsigned int streams);
+
+  /// \brief Publishes the latest snapshot whenever a new one is captured
+  void publisherThread();
+
+  Kind kind_;
+  gazebo::physics::WorldPtr world_;
+  PublishFunc publish_func_;
+
+  /// \brief Entity index, only used on the physics thread.  Weak, so that
+  /// models deleted between two captures are not kept alive.
+  std::vector<boost::weak_ptr<gazebo::physics::Entity> > entities_;
+  boost::shared_ptr<const std::vector<std::string> > names_;
+  boost::shared_ptr<const StateStreamSelections> selections_;
+  unsigned int generation_;
+  unsigned int indexed_model_count_;
+  std::atomic<bool> stale_;
+
+  /// \brief Output stream decimation state
+  class Stream
+  {
+  public:
+    double period;
+    double next_time;
+    int subscribers;
+    boost::shared_ptr<const StateStreamFilter> filter;
+  };
+  std::vector<Stream> streams_;
+  boost::mutex streams_mutex_;
+
+  /// \brief Written by capture()
+  boost::shared_ptr<StateSnapshot> back_;
+  /// \brief Latest capture not yet taken by the publisher thread
+  boost::shared_ptr<StateSnapshot> pending_;
+  /// \brief Being published
+  boost::shared_ptr<StateSnapshot> front_;
+
+  bool pending_ready_;
+  bool stop_;
+  boost::mutex mutex_;
+  boost::condition_variable cond_;
+  boost::thread thread_;
+};
+
+template <class M>
+void StateSnapshotEngine::toMsg(const StateSnapshot &snapshot, M &msg, unsigned int &msg_generation)
+{
+  // stream bits beyond the selections are never filtered
+  toMsg(snapshot, MAX_STREAMS, msg, msg_generation);
+}
+
+template <class M>
+void StateSnapshotEngine::toMsg(const StateSnapshot &snapshot, unsigned int stream, M &msg,
+                                unsigned int &msg_generation)
+{
+  const StateStreamSelection *selection = snapshot.selection(stream);
+  const size_t count = selection ? selection->indices.size() : snapshot.size();
+  if (msg_generation != snapshot.generation)
+  {
+    if (selection)
+      msg.name = selection->names;
+    else if (snapshot.names)
+      msg.name = *snapshot.names;
+    else
+      msg.name.clear();
+    msg.pose.resize(count);
+    msg.twist.resize(count);
+    msg_generation = snapshot.generation;
+  }
+
+  for (size_t i = 0; i < count; ++i)
+  {
+    const size_t index = selection ? selection->indices[i] : i;
+    const double *p = &snapshot.poses[index * 7];
+    const double *t = &snapshot.twists[index * 6];
+    geometry_msgs::Pose &pose = msg.pose[i];
+    pose.position.x = p[0];
+    pose.position.y = p[1];
+    pose.position.z = p[2];
+    pose.orientation.x = p[3];
+    pose.orientation.y = p[4];
+    pose.orientation.z = p[5];
+    pose.orientation.w = p[6];
+    geometry_msgs::Twist &twist = msg.twist[i];
+    twist.linear.x = t[0];
+    twist.linear.y = t[1];
+    twist.linear.z = t[2];
+    twist.angular.x = t[3];
+    twist.angular.y = t[4];
+    twist.angular.z = t[5];
+  }
+}
+
+}
+#endif
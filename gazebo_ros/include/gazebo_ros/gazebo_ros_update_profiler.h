@@ -0,0 +1,209 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+/*
+ * Desc: Timing of the world update callbacks of the ROS plugins, reported on
+ *       the ~profiling topic of the Gazebo ROS API plugin
+ */
+
+#ifndef __GAZEBO_ROS_UPDATE_PROFILER_HH__
+#define __GAZEBO_ROS_UPDATE_PROFILER_HH__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <gazebo/common/UpdateInfo.hh>
+
+#include "gazebo_msgs/UpdateProfile.h"
+#include "gazebo_msgs/UpdateProfiles.h"
+
+namespace gazebo
+{
+
+/// \brief Durations of the calls of one instrumented callback.
+///
+/// Calls are recorded by the physics thread running the callback, without
+/// locks:
+/// a histogram with 8 buckets per power of two nanoseconds, a running
+/// maximum and a ring of the latest calls for the trace.  Reports are read
+/// from another thread and cover the calls since the previous report.
+class UpdateProfile
+{
+public:
+  /// \brief Calls kept for the trace
+  static const unsigned int TRACE_SIZE = 4096;
+
+  explicit UpdateProfile(const std::string &name);
+
+  const std::string &name() const { return name_; }
+
+  /// \brief Record one call, from the thread running the callback
+  /// \param start_ns start of the call, from now()
+  /// \param duration_ns duration of the call
+  void record(int64_t start_ns, int64_t duration_ns)
+  {
+    // world update callbacks all run on the physics thread, so there is a
+    // single writer and plain relaxed stores do, without locked increments
+    std::atomic<uint32_t> &count = buckets_[bucket(duration_ns)];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    total_ns_.store(total_ns_.load(std::memory_order_relaxed) + duration_ns,
+                    std::memory_order_relaxed);
+    // a report may reset max_ns_ in between, which loses at most this call
+    if (duration_ns > max_ns_.load(std::memory_order_relaxed))
+      max_ns_.store(duration_ns, std::memory_order_relaxed);
+
+    uint64_t head = trace_head_.load(std::memory_order_relaxed);
+    TraceEvent &event = trace_[head % TRACE_SIZE];
+    event.start_ns.store(start_ns, std::memory_order_relaxed);
+    event.duration_ns.store(duration_ns, std::memory_order_relaxed);
+    trace_head_.store(head + 1, std::memory_order_release);
+  }
+
+  /// \brief Fill a report of the calls since the previous one
+  /// \param period wall clock seconds since the previous report
+  void report(double period, gazebo_msgs::UpdateProfile &msg);
+
+  /// \brief Append the calls of the trace ring as Chrome trace events
+  /// \param out JSON array contents, a comma is added before each event if
+  /// out is not empty
+  void appendTrace(std::string &out) const;
+
+  /// \brief Monotonic clock in nanoseconds
+  static int64_t now();
+
+  /// \brief Histogram bucket of a duration
+  static unsigned int bucket(int64_t ns);
+
+  /// \brief Middle of the durations of a bucket
+  static double bucketValue(unsigned int bucket);
+
+private:
+  static const unsigned int BUCKETS = 512;
+
+  struct TraceEvent
+  {
+    std::atomic<int64_t> start_ns;
+    std::atomic<int64_t> duration_ns;
+  };
+
+  std::string name_;
+
+  /// \brief Written by the callback thread
+  std::atomic<uint32_t> buckets_[BUCKETS];
+  std::atomic<int64_t> total_ns_;
+  std::atomic<int64_t> max_ns_;
+  TraceEvent trace_[TRACE_SIZE];
+  std::atomic<uint64_t> trace_head_;
+
+  /// \brief Counts at the previous report, read side only
+  uint32_t reported_buckets_[BUCKETS];
+  int64_t reported_total_ns_;
+};
+
+/// \brief Times a call, records it when going out of scope
+class ScopedUpdateTimer
+{
+public:
+  explicit ScopedUpdateTimer(UpdateProfile *profile)
+    : profile_(profile), start_ns_(UpdateProfile::now()) {}
+
+  ~ScopedUpdateTimer()
+  {
+    profile_->record(start_ns_, UpdateProfile::now() - start_ns_);
+  }
+
+private:
+  UpdateProfile *profile_;
+  int64_t start_ns_;
+};
+
+/// \brief Registry of the instrumented callbacks of the process.
+///
+/// Profiling is enabled when the GAZEBO_ROS_PROFILE environment variable is
+/// set to a non zero value.  When it is not, registerProfile() returns NULL
+/// and ProfiledUpdate() connects the callbacks unchanged, so profiling costs
+/// nothing.
+class UpdateProfiler
+{
+public:
+  static UpdateProfiler &instance();
+
+  bool enabled() const { return enabled_; }
+
+  /// \brief Enable or disable profiling of the callbacks registered from now
+  /// on, e.g. for tests
+  void setEnabled(bool enabled) { enabled_ = enabled; }
+
+  /// \brief Profile of a callback, callbacks with the same name share it
+  /// \return NULL if profiling is disabled
+  UpdateProfile *registerProfile(const std::string &name);
+
+  /// \brief Report the calls of all profiles since the previous report
+  void report(gazebo_msgs::UpdateProfiles &msg);
+
+  /// \brief Latest calls of all profiles, in Chrome trace event JSON
+  std::string chromeTrace() const;
+
+private:
+  UpdateProfiler();
+
+  bool enabled_;
+  mutable boost::mutex mutex_;
+  std::vector<boost::shared_ptr<UpdateProfile> > profiles_;
+  int64_t last_report_ns_;
+};
+
+/// \brief Calls a world update callback under a ScopedUpdateTimer
+template <typename Func>
+class ProfiledUpdateCallback
+{
+public:
+  ProfiledUpdateCallback(UpdateProfile *profile, const Func &func)
+    : profile_(profile), func_(func) {}
+
+  void operator()(const common::UpdateInfo &info)
+  {
+    ScopedUpdateTimer timer(profile_);
+    func_(info);
+  }
+
+private:
+  UpdateProfile *profile_;
+  Func func_;
+};
+
+/// \brief Wrap a world update callback for the profiler, e.g.
+///   ConnectWorldUpdateBegin(ProfiledUpdate("p3d/" + link_name, boost::bind(...)))
+/// \return func itself if profiling is disabled
+template <typename Func>
+std::function<void(const common::UpdateInfo &)> ProfiledUpdate(const std::string &name,
+                                                                const Func &func)
+{
+  UpdateProfile *profile = UpdateProfiler::instance().registerProfile(name);
+  if (!profile)
+    return func;
+  return ProfiledUpdateCallback<Func>(profile, func);
+}
+
+}
+#endif
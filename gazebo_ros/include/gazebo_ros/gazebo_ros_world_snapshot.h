@@ -0,0 +1,130 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+/*
+ * Desc: In-memory world snapshots for the save_world_snapshot and
+ *       restore_world_snapshot services of the Gazebo ROS API plugin
+ */
+
+#ifndef __GAZEBO_ROS_WORLD_SNAPSHOT_HH__
+#define __GAZEBO_ROS_WORLD_SNAPSHOT_HH__
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <gazebo/physics/physics.hh>
+#include <gazebo/common/common.hh>
+
+#include "gazebo_msgs/WorldState.h"
+
+namespace gazebo
+{
+
+/// \brief States of all links and joints of a world, stored as flat arrays
+/// next to the entities they were read from.
+///
+/// Restoring writes the states straight back to the entities, there is no
+/// name lookup and no XML.  Link poses and twists define the state in
+/// maximal coordinate engines (ODE, Bullet), joint positions and velocities
+/// are only written back for the other engines.
+class WorldSnapshot
+{
+public:
+  WorldSnapshot() : model_count_(0), reduced_coordinates_(false) {}
+
+  /// \brief Read the states of all models, the physics update mutex must be held
+  void capture(const gazebo::physics::WorldPtr &world);
+
+  /// \brief Write the states back, the physics update mutex must be held
+  /// \param missing name of the first entity deleted since the capture
+  /// \return false if an entity was deleted since the capture, nothing is
+  /// written then
+  bool restore(std::string &missing) const;
+
+  /// \brief Fill a WorldState message with the link states
+  void toMsg(gazebo_msgs::WorldState &msg) const;
+
+  size_t modelCount() const { return model_count_; }
+  size_t linkCount() const { return links_.size(); }
+  size_t jointCount() const { return joints_.size(); }
+
+  /// \brief Simulation time the states were captured at
+  gazebo::common::Time sim_time;
+
+private:
+  size_t model_count_;
+  bool reduced_coordinates_;
+
+  /// \brief Weak, so that a snapshot does not keep deleted models alive
+  std::vector<boost::weak_ptr<gazebo::physics::Link> > links_;
+  std::vector<std::string> link_names_;
+  /// \brief x y z qx qy qz qw of each link, in the world frame
+  std::vector<double> link_poses_;
+  /// \brief vx vy vz wx wy wz of each link, in the world frame
+  std::vector<double> link_twists_;
+
+  std::vector<boost::weak_ptr<gazebo::physics::Joint> > joints_;
+  std::vector<std::string> joint_names_;
+  /// \brief Index of the first axis of each joint in the arrays below
+  std::vector<unsigned int> joint_axes_;
+  std::vector<double> joint_positions_;
+  std::vector<double> joint_velocities_;
+};
+
+/// \brief Snapshots by id, the least recently used one is evicted when the
+/// store is full
+class WorldSnapshotStore
+{
+public:
+  explicit WorldSnapshotStore(unsigned int capacity = 16) : capacity_(capacity), uses_(0) {}
+
+  /// \brief Maximum number of snapshots, 0 disables the store
+  void setCapacity(unsigned int capacity);
+
+  /// \brief Store a snapshot, replacing the one with the same id
+  /// \return false if the store is disabled
+  bool put(const std::string &id, const boost::shared_ptr<const WorldSnapshot> &snapshot);
+
+  /// \brief Snapshot of an id, NULL if there is none
+  boost::shared_ptr<const WorldSnapshot> get(const std::string &id);
+
+  size_t size() const;
+
+private:
+  class Entry
+  {
+  public:
+    boost::shared_ptr<const WorldSnapshot> snapshot;
+    uint64_t last_use;
+  };
+
+  void evict(size_t size);
+
+  mutable boost::mutex mutex_;
+  std::map<std::string, Entry> snapshots_;
+  unsigned int capacity_;
+  uint64_t uses_;
+};
+
+}
+#endif
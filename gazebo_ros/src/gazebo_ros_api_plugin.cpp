@@ -27,6 +27,9 @@
 namespace gazebo
 {
 
+const unsigned int GazeboRosApiPlugin::SPAWN_QUEUE_LIMIT;
+const size_t GazeboRosApiPlugin::STEP_OBSERVATION_LIMIT;
+
 GazeboRosApiPlugin::GazeboRosApiPlugin() :
   physics_reconfigure_initialized_(false),
   world_created_(false),
@@ -34,9 +37,22 @@ GazeboRosApiPlugin::GazeboRosApiPlugin() :
   plugin_loaded_(false),
   pub_link_states_connection_count_(0),
   pub_model_states_connection_count_(0),
-  pub_clock_frequency_(0)
+  link_states_msg_generation_(0),
+  model_states_msg_generation_(0),
+  link_states_filtered_count_(0),
+  model_states_filtered_count_(0),
+  link_states_shm_stream_(-1),
+  model_states_shm_stream_(-1),
+  spawn_waiters_(0),
+  entity_index_model_count_(0),
+  entity_index_stale_(true),
+  get_model_states_count_(0),
+  model_template_cache_size_(64),
+  model_template_uses_(0),
+  model_template_hits_(0),
+  pub_clock_frequency_(0),
+  step_batch_(NULL)
 {
-  robot_namespace_.clear();
 }
 
 GazeboRosApiPlugin::~GazeboRosApiPlugin()
@@ -59,6 +75,10 @@ GazeboRosApiPlugin::~GazeboRosApiPlugin()
   wrench_update_event_.reset();
   force_update_event_.reset();
   time_update_event_.reset();
+  step_batch_begin_event_.reset();
+  step_batch_end_event_.reset();
+  add_entity_event_.reset();
+  delete_entity_event_.reset();
   ROS_DEBUG_STREAM_NAMED("api_plugin","Slots disconnected");
 
   if (pub_link_states_connection_count_ > 0) // disconnect if there are subscribers on exit
@@ -67,6 +87,11 @@ GazeboRosApiPlugin::~GazeboRosApiPlugin()
     pub_model_states_event_.reset();
   ROS_DEBUG_STREAM_NAMED("api_plugin","Disconnected World Updates");
 
+  // Stop the state snapshot publisher threads
+  link_states_engine_.reset();
+  model_states_engine_.reset();
+  ROS_DEBUG_STREAM_NAMED("api_plugin","State snapshot engines stopped");
+
   // Stop the multi threaded ROS spinner
   async_ros_spin_->stop();
   ROS_DEBUG_STREAM_NAMED("api_plugin","Async ROS Spin Stopped");
@@ -75,7 +100,8 @@ GazeboRosApiPlugin::~GazeboRosApiPlugin()
   nh_->shutdown();
   ROS_DEBUG_STREAM_NAMED("api_plugin","Node Handle Shutdown");
 
-  // Shutdown ROS queue
+  // Shutdown ROS queue, disabling it wakes the thread from its wait
+  gazebo_queue_.disable();
   gazebo_callback_queue_thread_->join();
   ROS_DEBUG_STREAM_NAMED("api_plugin","Callback Queue Joined");
 
@@ -83,24 +109,6 @@ GazeboRosApiPlugin::~GazeboRosApiPlugin()
   physics_reconfigure_thread_->join();
   ROS_DEBUG_STREAM_NAMED("api_plugin","Physics reconfigure joined");
 
-  // Delete Force and Wrench Jobs
-  lock_.lock();
-  for (std::vector<GazeboRosApiPlugin::ForceJointJob*>::iterator iter=force_joint_jobs_.begin();iter!=force_joint_jobs_.end();)
-  {
-    delete (*iter);
-    iter = force_joint_jobs_.erase(iter);
-  }
-  force_joint_jobs_.clear();
-  ROS_DEBUG_STREAM_NAMED("api_plugin","ForceJointJobs deleted");
-  for (std::vector<GazeboRosApiPlugin::WrenchBodyJob*>::iterator iter=wrench_body_jobs_.begin();iter!=wrench_body_jobs_.end();)
-  {
-    delete (*iter);
-    iter = wrench_body_jobs_.erase(iter);
-  }
-  wrench_body_jobs_.clear();
-  lock_.unlock();
-  ROS_DEBUG_STREAM_NAMED("api_plugin","WrenchBodyJobs deleted");
-
   ROS_DEBUG_STREAM_NAMED("api_plugin","Unloaded");
 }
 
@@ -182,7 +190,7 @@ void GazeboRosApiPlugin::loadGazeboRosApiPlugin(std::string world_name)
   gazebonode_ = gazebo::transport::NodePtr(new gazebo::transport::Node());
   gazebonode_->Init(world_name);
   //stat_sub_ = gazebonode_->Subscribe("~/world_stats", &GazeboRosApiPlugin::publishSimTime, this); // TODO: does not work in server plugin?
-  factory_pub_ = gazebonode_->Advertise<gazebo::msgs::Factory>("~/factory");
+  factory_pub_ = gazebonode_->Advertise<gazebo::msgs::Factory>("~/factory", SPAWN_QUEUE_LIMIT);
   factory_light_pub_ = gazebonode_->Advertise<gazebo::msgs::Light>("~/factory/light");
   light_modify_pub_ = gazebonode_->Advertise<gazebo::msgs::Light>("~/light/modify");
   request_pub_ = gazebonode_->Advertise<gazebo::msgs::Request>("~/request");
@@ -192,13 +200,33 @@ void GazeboRosApiPlugin::loadGazeboRosApiPlugin(std::string world_name)
   pub_link_states_connection_count_ = 0;
   pub_model_states_connection_count_ = 0;
 
+  // link and model states are captured on world update and published from their own threads
+  link_states_engine_.reset(new StateSnapshotEngine(StateSnapshotEngine::LINKS, world_,
+    boost::bind(&GazeboRosApiPlugin::publishLinkStates,this,_1)));
+  model_states_engine_.reset(new StateSnapshotEngine(StateSnapshotEngine::MODELS, world_,
+    boost::bind(&GazeboRosApiPlugin::publishModelStates,this,_1)));
+
   /// \brief advertise all services
   advertiseServices();
 
+  // completes spawn requests, and with the delete event keeps the entity
+  // indices current when entities change outside of the ROS services
+  add_entity_event_ = gazebo::event::Events::ConnectAddEntity(boost::bind(&GazeboRosApiPlugin::onAddEntity,this,_1));
+  delete_entity_event_ = gazebo::event::Events::ConnectDeleteEntity(boost::bind(&GazeboRosApiPlugin::onDeleteEntity,this,_1));
+
   // hooks for applying forces, publishing simtime on /clock
-  wrench_update_event_ = gazebo::event::Events::ConnectWorldUpdateBegin(boost::bind(&GazeboRosApiPlugin::wrenchBodySchedulerSlot,this));
-  force_update_event_  = gazebo::event::Events::ConnectWorldUpdateBegin(boost::bind(&GazeboRosApiPlugin::forceJointSchedulerSlot,this));
-  time_update_event_   = gazebo::event::Events::ConnectWorldUpdateBegin(boost::bind(&GazeboRosApiPlugin::publishSimTime,this));
+  wrench_update_event_ = gazebo::event::Events::ConnectWorldUpdateBegin(
+    ProfiledUpdate("gazebo_ros_api/wrench_body_scheduler", boost::bind(&GazeboRosApiPlugin::wrenchBodySchedulerSlot,this)));
+  force_update_event_  = gazebo::event::Events::ConnectWorldUpdateBegin(
+    ProfiledUpdate("gazebo_ros_api/force_joint_scheduler", boost::bind(&GazeboRosApiPlugin::forceJointSchedulerSlot,this)));
+  time_update_event_   = gazebo::event::Events::ConnectWorldUpdateBegin(
+    ProfiledUpdate("gazebo_ros_api/publish_sim_time", boost::bind(&GazeboRosApiPlugin::publishSimTime,this)));
+
+  // efforts and observations of step_and_observe, around each physics iteration it steps
+  step_batch_begin_event_ = gazebo::event::Events::ConnectWorldUpdateBegin(
+    ProfiledUpdate("gazebo_ros_api/step_batch", boost::bind(&GazeboRosApiPlugin::stepBatchBeginSlot,this)));
+  step_batch_end_event_ = gazebo::event::Events::ConnectWorldUpdateEnd(
+    boost::bind(&GazeboRosApiPlugin::stepBatchEndSlot,this));
 }
 
 void GazeboRosApiPlugin::onResponse(ConstResponsePtr &response)
@@ -208,7 +236,12 @@ void GazeboRosApiPlugin::onResponse(ConstResponsePtr &response)
 
 void GazeboRosApiPlugin::gazeboQueueThread()
 {
-  static const double timeout = 0.001;
+  // callAvailable() waits on the condition variable addCallback() notifies,
+  // so the timeout does not delay callbacks.  It only sets how often an idle
+  // queue wakes up to check nh_, and the destructor disables the queue to
+  // end the wait, so 100 ms saves the 1000 idle wake ups per second of the
+  // 1 ms the loop used to poll with.
+  static const double timeout = 0.1;
   while (nh_->ok())
   {
     gazebo_queue_.callAvailable(ros::WallDuration(timeout));
@@ -238,6 +271,15 @@ void GazeboRosApiPlugin::advertiseServices()
                                                                   ros::VoidPtr(), &gazebo_queue_);
   spawn_urdf_model_service_ = nh_->advertiseService(spawn_urdf_model_aso);
 
+  // Advertise spawn services on the custom queue
+  std::string spawn_models_service_name("spawn_models");
+  ros::AdvertiseServiceOptions spawn_models_aso =
+    ros::AdvertiseServiceOptions::create<gazebo_msgs::SpawnModels>(
+                                                                   spawn_models_service_name,
+                                                                   boost::bind(&GazeboRosApiPlugin::spawnModels,this,_1,_2),
+                                                                   ros::VoidPtr(), &gazebo_queue_);
+  spawn_models_service_ = nh_->advertiseService(spawn_models_aso);
+
   // Advertise delete services on the custom queue
   std::string delete_model_service_name("delete_model");
   ros::AdvertiseServiceOptions delete_aso =
@@ -274,6 +316,15 @@ void GazeboRosApiPlugin::advertiseServices()
                                                                      ros::VoidPtr(), &gazebo_queue_);
   get_model_state_service_ = nh_->advertiseService(get_model_state_aso);
 
+  // Advertise more services on the custom queue
+  std::string get_model_states_service_name("get_model_states");
+  ros::AdvertiseServiceOptions get_model_states_aso =
+    ros::AdvertiseServiceOptions::create<gazebo_msgs::GetModelStates>(
+                                                                      get_model_states_service_name,
+                                                                      boost::bind(&GazeboRosApiPlugin::getModelStates,this,_1,_2),
+                                                                      ros::VoidPtr(), &gazebo_queue_);
+  get_model_states_service_ = nh_->advertiseService(get_model_states_aso);
+
   // Advertise more services on the custom queue
   std::string get_world_properties_service_name("get_world_properties");
   ros::AdvertiseServiceOptions get_world_properties_aso =
@@ -337,23 +388,70 @@ void GazeboRosApiPlugin::advertiseServices()
                                                                             ros::VoidPtr(), &gazebo_queue_);
   get_physics_properties_service_ = nh_->advertiseService(get_physics_properties_aso);
 
+  // link and model states are published on every world update, or at ~link_states_rate
+  // and ~model_states_rate, plus on a topic per rate in ~states_topic_rates (e.g. model_states/30hz)
+  // so low rate consumers do not need the full rate stream
+  double link_states_rate = 0.0;
+  double model_states_rate = 0.0;
+  std::vector<double> states_topic_rates;
+  nh_->getParam("link_states_rate", link_states_rate);
+  nh_->getParam("model_states_rate", model_states_rate);
+  nh_->getParam("states_topic_rates", states_topic_rates);
+
+  // sized up front, the snapshot publisher threads index them while later topics are advertised
+  pub_link_states_.resize(StateSnapshotEngine::MAX_STREAMS);
+  pub_model_states_.resize(StateSnapshotEngine::MAX_STREAMS);
+  link_states_stream_msgs_.resize(StateSnapshotEngine::MAX_STREAMS);
+  model_states_stream_msgs_.resize(StateSnapshotEngine::MAX_STREAMS);
+  link_states_stream_msg_generations_.resize(StateSnapshotEngine::MAX_STREAMS, 0);
+  model_states_stream_msg_generations_.resize(StateSnapshotEngine::MAX_STREAMS, 0);
+
   // publish complete link states in world frame
-  ros::AdvertiseOptions pub_link_states_ao =
-    ros::AdvertiseOptions::create<gazebo_msgs::LinkStates>(
-                                                           "link_states",10,
-                                                           boost::bind(&GazeboRosApiPlugin::onLinkStatesConnect,this),
-                                                           boost::bind(&GazeboRosApiPlugin::onLinkStatesDisconnect,this),
-                                                           ros::VoidPtr(), &gazebo_queue_);
-  pub_link_states_ = nh_->advertise(pub_link_states_ao);
+  advertiseLinkStates("link_states", link_states_rate);
 
   // publish complete model states in world frame
-  ros::AdvertiseOptions pub_model_states_ao =
-    ros::AdvertiseOptions::create<gazebo_msgs::ModelStates>(
-                                                            "model_states",10,
-                                                            boost::bind(&GazeboRosApiPlugin::onModelStatesConnect,this),
-                                                            boost::bind(&GazeboRosApiPlugin::onModelStatesDisconnect,this),
-                                                            ros::VoidPtr(), &gazebo_queue_);
-  pub_model_states_ = nh_->advertise(pub_model_states_ao);
+  advertiseModelStates("model_states", model_states_rate);
+
+  for (unsigned int i = 0; i < states_topic_rates.size(); ++i)
+  {
+    if (states_topic_rates[i] <= 0.0)
+    {
+      ROS_WARN_NAMED("api_plugin", "Ignoring states topic rate %g, must be positive", states_topic_rates[i]);
+      continue;
+    }
+    // topic names can not contain '.', 2.5 Hz is published on model_states/2_5hz
+    std::ostringstream suffix;
+    suffix << states_topic_rates[i];
+    std::string rate_name = suffix.str() + "hz";
+    std::replace(rate_name.begin(), rate_name.end(), '.', '_');
+    advertiseLinkStates("link_states/" + rate_name, states_topic_rates[i]);
+    advertiseModelStates("model_states/" + rate_name, states_topic_rates[i]);
+  }
+
+  // same host consumers can read the latest states from shared memory instead of the
+  // topics, see StateShmReader, e.g. ~model_states_shm:=/gazebo_model_states
+  std::string link_states_shm;
+  std::string model_states_shm;
+  double states_shm_rate = 0.0;
+  int states_shm_capacity = 4096;
+  nh_->getParam("link_states_shm", link_states_shm);
+  nh_->getParam("model_states_shm", model_states_shm);
+  nh_->getParam("states_shm_rate", states_shm_rate);
+  nh_->getParam("states_shm_capacity", states_shm_capacity);
+  if (!link_states_shm.empty())
+    exportLinkStates(link_states_shm, states_shm_rate, states_shm_capacity);
+  if (!model_states_shm.empty())
+    exportModelStates(model_states_shm, states_shm_rate, states_shm_capacity);
+
+  // Advertise more services on the custom queue, which also serializes them with the
+  // connection callbacks of the topics they advertise
+  std::string add_state_stream_service_name("add_state_stream");
+  ros::AdvertiseServiceOptions add_state_stream_aso =
+    ros::AdvertiseServiceOptions::create<gazebo_msgs::AddStateStream>(
+                                                                      add_state_stream_service_name,
+                                                                      boost::bind(&GazeboRosApiPlugin::addStateStream,this,_1,_2),
+                                                                      ros::VoidPtr(), &gazebo_queue_);
+  add_state_stream_service_ = nh_->advertiseService(add_state_stream_aso);
 
   // Advertise more services on the custom queue
   std::string set_link_properties_service_name("set_link_properties");
@@ -382,6 +480,15 @@ void GazeboRosApiPlugin::advertiseServices()
                                                                      ros::VoidPtr(), &gazebo_queue_);
   set_model_state_service_ = nh_->advertiseService(set_model_state_aso);
 
+  // Advertise more services on the custom queue
+  std::string set_model_states_service_name("set_model_states");
+  ros::AdvertiseServiceOptions set_model_states_aso =
+    ros::AdvertiseServiceOptions::create<gazebo_msgs::SetModelStates>(
+                                                                      set_model_states_service_name,
+                                                                      boost::bind(&GazeboRosApiPlugin::setModelStates,this,_1,_2),
+                                                                      ros::VoidPtr(), &gazebo_queue_);
+  set_model_states_service_ = nh_->advertiseService(set_model_states_aso);
+
   // Advertise more services on the custom queue
   std::string set_model_configuration_service_name("set_model_configuration");
   ros::AdvertiseServiceOptions set_model_configuration_aso =
@@ -498,6 +605,55 @@ void GazeboRosApiPlugin::advertiseServices()
                                                           ros::VoidPtr(), &gazebo_queue_);
   reset_world_service_ = nh_->advertiseService(reset_world_aso);
 
+  // Advertise more services on the custom queue
+  std::string get_update_trace_service_name("get_update_trace");
+  ros::AdvertiseServiceOptions get_update_trace_aso =
+    ros::AdvertiseServiceOptions::create<gazebo_msgs::GetUpdateTrace>(
+                                                                     get_update_trace_service_name,
+                                                                     boost::bind(&GazeboRosApiPlugin::getUpdateTrace,this,_1,_2),
+                                                                     ros::VoidPtr(), &gazebo_queue_);
+  get_update_trace_service_ = nh_->advertiseService(get_update_trace_aso);
+
+  // Advertise more services on the custom queue, which holds off the other services while
+  // the world is being stepped
+  std::string step_and_observe_service_name("step_and_observe");
+  ros::AdvertiseServiceOptions step_and_observe_aso =
+    ros::AdvertiseServiceOptions::create<gazebo_msgs::StepAndObserve>(
+                                                                      step_and_observe_service_name,
+                                                                      boost::bind(&GazeboRosApiPlugin::stepAndObserve,this,_1,_2),
+                                                                      ros::VoidPtr(), &gazebo_queue_);
+  step_and_observe_service_ = nh_->advertiseService(step_and_observe_aso);
+
+  // Advertise more services on the custom queue
+  std::string save_world_snapshot_service_name("save_world_snapshot");
+  ros::AdvertiseServiceOptions save_world_snapshot_aso =
+    ros::AdvertiseServiceOptions::create<gazebo_msgs::SaveWorldSnapshot>(
+                                                                         save_world_snapshot_service_name,
+                                                                         boost::bind(&GazeboRosApiPlugin::saveWorldSnapshot,this,_1,_2),
+                                                                         ros::VoidPtr(), &gazebo_queue_);
+  save_world_snapshot_service_ = nh_->advertiseService(save_world_snapshot_aso);
+
+  // Advertise more services on the custom queue
+  std::string restore_world_snapshot_service_name("restore_world_snapshot");
+  ros::AdvertiseServiceOptions restore_world_snapshot_aso =
+    ros::AdvertiseServiceOptions::create<gazebo_msgs::RestoreWorldSnapshot>(
+                                                                            restore_world_snapshot_service_name,
+                                                                            boost::bind(&GazeboRosApiPlugin::restoreWorldSnapshot,this,_1,_2),
+                                                                            ros::VoidPtr(), &gazebo_queue_);
+  restore_world_snapshot_service_ = nh_->advertiseService(restore_world_snapshot_aso);
+
+  // world update profiles, only when profiling is enabled (GAZEBO_ROS_PROFILE=1)
+  if (UpdateProfiler::instance().enabled())
+  {
+    double profiling_rate = 1.0;
+    nh_->getParam("profiling_rate", profiling_rate);
+    pub_update_profiles_ = nh_->advertise<gazebo_msgs::UpdateProfiles>("profiling", 10);
+    if (profiling_rate > 0.0)
+      update_profiles_timer_ = nh_->createWallTimer(ros::WallTimerOptions(
+        ros::WallDuration(1.0 / profiling_rate),
+        boost::bind(&GazeboRosApiPlugin::publishUpdateProfiles,this,_1), &gazebo_queue_));
+  }
+
 
   // set param for use_sim_time if not set by user already
   if(!(nh_->hasParam("/use_sim_time")))
@@ -505,6 +661,14 @@ void GazeboRosApiPlugin::advertiseServices()
 
   // todo: contemplate setting environment variable ROBOT=sim here???
   nh_->getParam("pub_clock_frequency", pub_clock_frequency_);
+
+  // number of parsed model xmls kept for repeated spawns, 0 disables the cache
+  nh_->getParam("model_template_cache_size", model_template_cache_size_);
+
+  // number of world snapshots kept in memory, 0 disables save_world_snapshot
+  int world_snapshot_capacity = 16;
+  nh_->getParam("world_snapshot_capacity", world_snapshot_capacity);
+  world_snapshots_.setCapacity(std::max(0, world_snapshot_capacity));
 #if GAZEBO_MAJOR_VERSION >= 8
   last_pub_clock_time_ = world_->SimTime();
 #else
@@ -512,22 +676,137 @@ void GazeboRosApiPlugin::advertiseServices()
 #endif
 }
 
-void GazeboRosApiPlugin::onLinkStatesConnect()
+int GazeboRosApiPlugin::advertiseLinkStates(const std::string &topic, double rate,
+                                          const boost::shared_ptr<const StateStreamFilter> &filter)
+{
+  int stream = link_states_engine_->addStream(rate, filter);
+  if (stream < 0)
+    return stream;
+
+  ros::AdvertiseOptions pub_link_states_ao =
+    ros::AdvertiseOptions::create<gazebo_msgs::LinkStates>(
+                                                           topic,10,
+                                                           boost::bind(&GazeboRosApiPlugin::onLinkStatesConnect,this,stream),
+                                                           boost::bind(&GazeboRosApiPlugin::onLinkStatesDisconnect,this,stream),
+                                                           ros::VoidPtr(), &gazebo_queue_);
+  ros::Publisher pub = nh_->advertise(pub_link_states_ao);
+  {
+    // the publisher thread may be going through the streams right now
+    boost::mutex::scoped_lock lock(pub_link_states_mutex_);
+    pub_link_states_[stream] = pub;
+  }
+  return stream;
+}
+
+int GazeboRosApiPlugin::advertiseModelStates(const std::string &topic, double rate,
+                                          const boost::shared_ptr<const StateStreamFilter> &filter)
+{
+  int stream = model_states_engine_->addStream(rate, filter);
+  if (stream < 0)
+    return stream;
+
+  ros::AdvertiseOptions pub_model_states_ao =
+    ros::AdvertiseOptions::create<gazebo_msgs::ModelStates>(
+                                                            topic,10,
+                                                            boost::bind(&GazeboRosApiPlugin::onModelStatesConnect,this,stream),
+                                                            boost::bind(&GazeboRosApiPlugin::onModelStatesDisconnect,this,stream),
+                                                            ros::VoidPtr(), &gazebo_queue_);
+  ros::Publisher pub = nh_->advertise(pub_model_states_ao);
+  {
+    // the publisher thread may be going through the streams right now
+    boost::mutex::scoped_lock lock(pub_model_states_mutex_);
+    pub_model_states_[stream] = pub;
+  }
+  return stream;
+}
+
+bool GazeboRosApiPlugin::exportLinkStates(const std::string &shm_name, double rate, int capacity)
+{
+  if (capacity <= 0 || !link_states_shm_.create(shm_name, capacity))
+  {
+    ROS_ERROR_NAMED("api_plugin", "Could not create link states shared memory [%s]", shm_name.c_str());
+    return false;
+  }
+  int stream = link_states_engine_->addStream(rate);
+  if (stream < 0)
+  {
+    link_states_shm_.close();
+    return false;
+  }
+  {
+    // known as the export before its first snapshot, or it would be published as a topic
+    boost::mutex::scoped_lock lock(pub_link_states_mutex_);
+    link_states_shm_stream_ = stream;
+  }
+  // the export is a subscriber for as long as the plugin runs
+  onLinkStatesConnect(stream);
+  ROS_INFO_NAMED("api_plugin", "Exporting link states to shared memory [%s]", shm_name.c_str());
+  return true;
+}
+
+bool GazeboRosApiPlugin::exportModelStates(const std::string &shm_name, double rate, int capacity)
+{
+  if (capacity <= 0 || !model_states_shm_.create(shm_name, capacity))
+  {
+    ROS_ERROR_NAMED("api_plugin", "Could not create model states shared memory [%s]", shm_name.c_str());
+    return false;
+  }
+  int stream = model_states_engine_->addStream(rate);
+  if (stream < 0)
+  {
+    model_states_shm_.close();
+    return false;
+  }
+  {
+    // known as the export before its first snapshot, or it would be published as a topic
+    boost::mutex::scoped_lock lock(pub_model_states_mutex_);
+    model_states_shm_stream_ = stream;
+  }
+  // the export is a subscriber for as long as the plugin runs
+  onModelStatesConnect(stream);
+  ROS_INFO_NAMED("api_plugin", "Exporting model states to shared memory [%s]", shm_name.c_str());
+  return true;
+}
+
+void GazeboRosApiPlugin::exportSnapshot(StateShmWriter &writer, const StateSnapshot &snapshot)
+{
+  static const std::vector<std::string> no_names;
+  // the snapshot arrays have the layout of the segment, so this is a copy
+  writer.write(snapshot.sim_time.sec, snapshot.sim_time.nsec, snapshot.generation,
+               snapshot.names ? *snapshot.names : no_names,
+               snapshot.poses.empty() ? NULL : &snapshot.poses[0],
+               snapshot.twists.empty() ? NULL : &snapshot.twists[0]);
+}
+
+void GazeboRosApiPlugin::onLinkStatesConnect(unsigned int stream)
 {
+  link_states_engine_->addSubscriber(stream);
   pub_link_states_connection_count_++;
   if (pub_link_states_connection_count_ == 1) // connect on first subscriber
-    pub_link_states_event_   = gazebo::event::Events::ConnectWorldUpdateBegin(boost::bind(&GazeboRosApiPlugin::publishLinkStates,this));
+  {
+    // entities may have changed while nobody was listening
+    link_states_engine_->invalidate();
+    pub_link_states_event_   = gazebo::event::Events::ConnectWorldUpdateBegin(
+      ProfiledUpdate("gazebo_ros_api/link_states", boost::bind(&StateSnapshotEngine::update,link_states_engine_.get())));
+  }
 }
 
-void GazeboRosApiPlugin::onModelStatesConnect()
+void GazeboRosApiPlugin::onModelStatesConnect(unsigned int stream)
 {
+  model_states_engine_->addSubscriber(stream);
   pub_model_states_connection_count_++;
   if (pub_model_states_connection_count_ == 1) // connect on first subscriber
-    pub_model_states_event_   = gazebo::event::Events::ConnectWorldUpdateBegin(boost::bind(&GazeboRosApiPlugin::publishModelStates,this));
+  {
+    // entities may have changed while nobody was listening
+    model_states_engine_->invalidate();
+    pub_model_states_event_   = gazebo::event::Events::ConnectWorldUpdateBegin(
+      ProfiledUpdate("gazebo_ros_api/model_states", boost::bind(&StateSnapshotEngine::update,model_states_engine_.get())));
+  }
 }
 
-void GazeboRosApiPlugin::onLinkStatesDisconnect()
+void GazeboRosApiPlugin::onLinkStatesDisconnect(unsigned int stream)
 {
+  link_states_engine_->removeSubscriber(stream);
   pub_link_states_connection_count_--;
   if (pub_link_states_connection_count_ <= 0) // disconnect with no subscribers
   {
@@ -537,8 +816,9 @@ void GazeboRosApiPlugin::onLinkStatesDisconnect()
   }
 }
 
-void GazeboRosApiPlugin::onModelStatesDisconnect()
+void GazeboRosApiPlugin::onModelStatesDisconnect(unsigned int stream)
 {
+  model_states_engine_->removeSubscriber(stream);
   pub_model_states_connection_count_--;
   if (pub_model_states_connection_count_ <= 0) // disconnect with no subscribers
   {
@@ -548,16 +828,84 @@ void GazeboRosApiPlugin::onModelStatesDisconnect()
   }
 }
 
+bool GazeboRosApiPlugin::addStateStream(gazebo_msgs::AddStateStream::Request &req,
+                                        gazebo_msgs::AddStateStream::Response &res)
+{
+  if (req.rate < 0.0)
+  {
+    res.success = false;
+    res.status_message = "AddStateStream: rate must not be negative";
+    return true;
+  }
+
+  boost::shared_ptr<const StateStreamFilter> filter;
+  try
+  {
+    filter.reset(new StateStreamFilter(req.name_regex, req.names));
+  }
+  catch (const std::regex_error &e)
+  {
+    ROS_ERROR_NAMED("api_plugin", "AddStateStream: invalid name_regex [%s]: %s", req.name_regex.c_str(), e.what());
+    res.success = false;
+    res.status_message = "AddStateStream: invalid name_regex: " + std::string(e.what());
+    return true;
+  }
+
+  std::vector<ros::Publisher> &pubs = req.links ? pub_link_states_ : pub_model_states_;
+  std::string topic = req.topic_name;
+  if (topic.empty())
+  {
+    unsigned int &count = req.links ? link_states_filtered_count_ : model_states_filtered_count_;
+    topic = std::string(req.links ? "link_states" : "model_states") +
+      "/filtered_" + boost::lexical_cast<std::string>(count++);
+  }
+
+  std::string error;
+  if (!ros::names::validate(topic, error))
+  {
+    res.success = false;
+    res.status_message = "AddStateStream: invalid topic_name: " + error;
+    return true;
+  }
+  std::string resolved_topic = nh_->resolveName(topic);
+  for (unsigned int i = 0; i < pub_link_states_.size(); ++i)
+  {
+    if ((pub_link_states_[i] && pub_link_states_[i].getTopic() == resolved_topic) ||
+        (pub_model_states_[i] && pub_model_states_[i].getTopic() == resolved_topic))
+    {
+      res.success = false;
+      res.status_message = "AddStateStream: topic " + resolved_topic + " is already advertised";
+      return true;
+    }
+  }
+
+  int stream = req.links ? advertiseLinkStates(topic, req.rate, filter)
+                         : advertiseModelStates(topic, req.rate, filter);
+  if (stream < 0)
+  {
+    res.success = false;
+    res.status_message = "AddStateStream: too many state streams";
+    return true;
+  }
+
+  res.topic = pubs[stream].getTopic();
+  res.success = true;
+  res.status_message = "AddStateStream: publishing on " + res.topic;
+  return true;
+}
+
 bool GazeboRosApiPlugin::spawnURDFModel(gazebo_msgs::SpawnModel::Request &req,
                                         gazebo_msgs::SpawnModel::Response &res)
 {
-  // get namespace for the corresponding model plugins
-  robot_namespace_ = req.robot_namespace;
-
-  // incoming entity string
-  std::string model_xml = req.model_xml;
+  // parsed incoming entity string, with package:// paths resolved
+  boost::shared_ptr<const ModelTemplate> model_template = modelTemplate(req.model_xml, true, res.status_message);
+  if (!model_template)
+  {
+    res.success = false;
+    return false;
+  }
 
-  if (!isURDF(model_xml))
+  if (!model_template->is_urdf)
   {
     ROS_ERROR_NAMED("api_plugin", "SpawnModel: Failure - entity format is invalid.");
     res.success = false;
@@ -565,6 +913,20 @@ bool GazeboRosApiPlugin::spawnURDFModel(gazebo_msgs::SpawnModel::Request &req,
     return false;
   }
 
+  // Model is now considered convert to SDF
+  SpawnJob job;
+  if (!conformModel(req, *model_template, job, res.status_message))
+  {
+    res.success = false;
+    return true;
+  }
+
+  // do spawning check if spawn worked, return response
+  return spawnAndConform(job, res);
+}
+
+bool GazeboRosApiPlugin::preprocessURDF(std::string &model_xml, std::string &status_message)
+{
   /// STRIP DECLARATION <? ... xml version="1.0" ... ?> from model_xml
   /// @todo: does tinyxml have functionality for this?
   /// @todo: should gazebo take care of the declaration?
@@ -609,8 +971,7 @@ bool GazeboRosApiPlugin::spawnURDFModel(gazebo_msgs::SpawnModel::Request &req,
       if (package_path.empty())
       {
         ROS_FATAL_NAMED("api_plugin", "Package[%s] does not have a path",package_name.c_str());
-        res.success = false;
-        res.status_message = "urdf reference package name does not exist: " + package_name;
+        status_message = "urdf reference package name does not exist: " + package_name;
         return false;
       }
       ROS_DEBUG_ONCE_NAMED("api_plugin", "Package name [%s] has path [%s]", package_name.c_str(), package_path.c_str());
@@ -619,22 +980,94 @@ bool GazeboRosApiPlugin::spawnURDFModel(gazebo_msgs::SpawnModel::Request &req,
       pos1 = model_xml.find(package_prefix, pos1);
     }
   }
-  // ROS_DEBUG_NAMED("api_plugin", "Model XML\n\n%s\n\n ",model_xml.c_str());
-
-  req.model_xml = model_xml;
-
-  // Model is now considered convert to SDF
-  return spawnSDFModel(req,res);
+  return true;
 }
 
 bool GazeboRosApiPlugin::spawnSDFModel(gazebo_msgs::SpawnModel::Request &req,
                                        gazebo_msgs::SpawnModel::Response &res)
+{
+  boost::shared_ptr<const ModelTemplate> model_template = modelTemplate(req.model_xml, false, res.status_message);
+  SpawnJob job;
+  if (!model_template || !conformModel(req, *model_template, job, res.status_message))
+  {
+    res.success = false;
+    return true;
+  }
+
+  // do spawning check if spawn worked, return response
+  return spawnAndConform(job, res);
+}
+
+boost::shared_ptr<const GazeboRosApiPlugin::ModelTemplate>
+GazeboRosApiPlugin::modelTemplate(const std::string &model_xml, bool resolve_urdf, std::string &status_message)
+{
+  boost::mutex::scoped_lock lock(model_templates_mutex_);
+  ++model_template_uses_;
+
+  // content hash, the stored xml resolves collisions
+  size_t key = boost::hash<std::string>()(model_xml);
+  boost::hash_combine(key, resolve_urdf);
+  std::pair<std::multimap<size_t, ModelTemplateEntry>::iterator,
+            std::multimap<size_t, ModelTemplateEntry>::iterator> range = model_templates_.equal_range(key);
+  for (std::multimap<size_t, ModelTemplateEntry>::iterator iter = range.first; iter != range.second; ++iter)
+  {
+    if (iter->second.model_template->resolve_urdf == resolve_urdf &&
+        iter->second.model_template->source == model_xml)
+    {
+      iter->second.last_use = model_template_uses_;
+      ++model_template_hits_;
+      return iter->second.model_template;
+    }
+  }
+
+  boost::shared_ptr<ModelTemplate> model_template(new ModelTemplate);
+  model_template->source = model_xml;
+  model_template->resolve_urdf = resolve_urdf;
+
+  std::string xml = model_xml;
+  if (resolve_urdf && isURDF(xml) && !preprocessURDF(xml, status_message))
+    return boost::shared_ptr<const ModelTemplate>();
+
+  // store resulting Gazebo Model XML to be sent to spawn queue
+  // get incoming string containg either an URDF or a Gazebo Model XML
+  // grab from parameter server if necessary convert to SDF if necessary
+  stripXmlDeclaration(xml);
+
+  // put string in TiXmlDocument for manipulation
+  model_template->document.Parse(xml.c_str());
+  // FIXME: very crude check, same as isSDF and isURDF
+  model_template->is_sdf = model_template->document.FirstChild("gazebo") ||
+                           model_template->document.FirstChild("sdf");
+  model_template->is_urdf = model_template->document.FirstChild("robot") != NULL;
+
+  if (model_template_cache_size_ <= 0)
+    return model_template;
+
+  // evict the least recently used template
+  if (model_templates_.size() >= static_cast<size_t>(model_template_cache_size_))
+  {
+    std::multimap<size_t, ModelTemplateEntry>::iterator oldest = model_templates_.begin();
+    for (std::multimap<size_t, ModelTemplateEntry>::iterator iter = model_templates_.begin();
+         iter != model_templates_.end(); ++iter)
+      if (iter->second.last_use < oldest->second.last_use)
+        oldest = iter;
+    model_templates_.erase(oldest);
+  }
+  ModelTemplateEntry entry;
+  entry.model_template = model_template;
+  entry.last_use = model_template_uses_;
+  model_templates_.insert(std::make_pair(key, entry));
+  return model_template;
+}
+
+bool GazeboRosApiPlugin::conformModel(const gazebo_msgs::SpawnModel::Request &req, const ModelTemplate &model_template,
+                                      SpawnJob &job, std::string &status_message)
 {
   // incoming entity name
   std::string model_name = req.model_name;
 
-  // get namespace for the corresponding model plugins
-  robot_namespace_ = req.robot_namespace;
+  // get namespace for the corresponding model plugins, kept local as spawn_models conforms a batch of them
+  const std::string &robot_namespace = req.robot_namespace;
 
   // get initial pose of model
   ignition::math::Vector3d initial_xyz(req.initial_pose.position.x,req.initial_pose.position.y,req.initial_pose.position.z);
@@ -666,31 +1099,21 @@ bool GazeboRosApiPlugin::spawnSDFModel(gazebo_msgs::SpawnModel::Request &req,
   }
   else
   {
-    res.success = false;
-    res.status_message = "SpawnModel: reference reference_frame not found, did you forget to scope the link by model name?";
-    return true;
+    status_message = "SpawnModel: reference reference_frame not found, did you forget to scope the link by model name?";
+    return false;
   }
 
-  // incoming robot model string
-  std::string model_xml = req.model_xml;
-
-  // store resulting Gazebo Model XML to be sent to spawn queue
-  // get incoming string containg either an URDF or a Gazebo Model XML
-  // grab from parameter server if necessary convert to SDF if necessary
-  stripXmlDeclaration(model_xml);
-
-  // put string in TiXmlDocument for manipulation
-  TiXmlDocument gazebo_model_xml;
-  gazebo_model_xml.Parse(model_xml.c_str());
+  // copy of the parsed incoming model, only name, pose and namespace are changed
+  TiXmlDocument gazebo_model_xml(model_template.document);
 
   // optional model manipulations: update initial pose && replace model name
-  if (isSDF(model_xml))
+  if (model_template.is_sdf)
   {
     updateSDFAttributes(gazebo_model_xml, model_name, initial_xyz, initial_q);
 
     // Walk recursively through the entire SDF, locate plugin tags and
     // add robotNamespace as a child with the correct namespace
-    if (!this->robot_namespace_.empty())
+    if (!robot_namespace.empty())
     {
       // Get root element for SDF
       // TODO: implement the spawning also with <light></light> and <model></model>
@@ -699,7 +1122,7 @@ bool GazeboRosApiPlugin::spawnSDFModel(gazebo_msgs::SpawnModel::Request &req,
           gazebo_model_xml.FirstChild("gazebo") : model_tixml;
       if (model_tixml)
       {
-        walkChildAddRobotNamespace(model_tixml);
+        walkChildAddRobotNamespace(model_tixml, robot_namespace);
       }
       else
       {
@@ -707,20 +1130,20 @@ bool GazeboRosApiPlugin::spawnSDFModel(gazebo_msgs::SpawnModel::Request &req,
       }
     }
   }
-  else if (isURDF(model_xml))
+  else if (model_template.is_urdf)
   {
     updateURDFModelPose(gazebo_model_xml, initial_xyz, initial_q);
     updateURDFName(gazebo_model_xml, model_name);
 
     // Walk recursively through the entire URDF, locate plugin tags and
     // add robotNamespace as a child with the correct namespace
-    if (!this->robot_namespace_.empty())
+    if (!robot_namespace.empty())
     {
       // Get root element for URDF
       TiXmlNode* model_tixml = gazebo_model_xml.FirstChild("robot");
       if (model_tixml)
       {
-        walkChildAddRobotNamespace(model_tixml);
+        walkChildAddRobotNamespace(model_tixml, robot_namespace);
       }
       else
       {
@@ -731,13 +1154,131 @@ bool GazeboRosApiPlugin::spawnSDFModel(gazebo_msgs::SpawnModel::Request &req,
   else
   {
     ROS_ERROR_NAMED("api_plugin", "GazeboRosApiPlugin SpawnModel Failure: input xml format not recognized");
+    status_message = "GazeboRosApiPlugin SpawnModel Failure: input model_xml not SDF or URDF, or cannot be converted to Gazebo compatible format.";
+    return false;
+  }
+
+  std::string entity_type = gazebo_model_xml.RootElement()->FirstChild()->Value();
+  // Convert the entity type to lower case
+  std::transform(entity_type.begin(), entity_type.end(), entity_type.begin(), ::tolower);
+
+  job.model_name = model_name;
+  job.is_light = (entity_type == "light");
+  job.is_urdf = model_template.is_urdf;
+
+  // push to factory iface
+  std::ostringstream stream;
+  stream << gazebo_model_xml;
+  job.xml = stream.str();
+  ROS_DEBUG_NAMED("api_plugin.xml", "Gazebo Model XML\n\n%s\n\n ",job.xml.c_str());
+  return true;
+}
+
+bool GazeboRosApiPlugin::spawnModels(gazebo_msgs::SpawnModels::Request &req,
+                                     gazebo_msgs::SpawnModels::Response &res)
+{
+  const size_t count = req.model_names.size();
+  if (req.model_xmls.size() != count ||
+      (!req.robot_namespaces.empty() && req.robot_namespaces.size() != count) ||
+      (!req.initial_poses.empty() && req.initial_poses.size() != count) ||
+      (!req.reference_frames.empty() && req.reference_frames.size() != count))
+  {
+    res.success = false;
+    res.status_message = "SpawnModels: Failure - model_xmls and the non empty robot_namespaces, "
+      "initial_poses and reference_frames must have one entry per model name";
+    return true;
+  }
+  if (count > SPAWN_QUEUE_LIMIT)
+  {
     res.success = false;
-    res.status_message = "GazeboRosApiPlugin SpawnModel Failure: input model_xml not SDF or URDF, or cannot be converted to Gazebo compatible format.";
+    res.status_message = "SpawnModels: Failure - at most " +
+      boost::lexical_cast<std::string>(SPAWN_QUEUE_LIMIT) + " models can be spawned in one batch";
     return true;
   }
 
-  // do spawning check if spawn worked, return response
-  return spawnAndConform(gazebo_model_xml, model_name, res);
+  res.model_success.assign(count, false);
+  res.model_status_messages.assign(count, "");
+  uint64_t template_hits;
+  {
+    boost::mutex::scoped_lock lock(model_templates_mutex_);
+    template_hits = model_template_hits_;
+  }
+
+  // conform all models first, so the factory receives them back to back
+  std::vector<SpawnJob> jobs(count);
+  std::vector<size_t> submitted;
+  std::map<std::string, bool> pending;
+  std::set<std::string> names;
+  for (size_t i = 0; i < count; ++i)
+  {
+    gazebo_msgs::SpawnModel::Request model_req;
+    model_req.model_name = req.model_names[i];
+    model_req.model_xml = req.model_xmls[i];
+    if (!req.robot_namespaces.empty())
+      model_req.robot_namespace = req.robot_namespaces[i];
+    if (!req.initial_poses.empty())
+      model_req.initial_pose = req.initial_poses[i];
+    else
+      model_req.initial_pose.orientation.w = 1.0;
+    if (!req.reference_frames.empty())
+      model_req.reference_frame = req.reference_frames[i];
+
+    // recorded before conforming, so a name is taken even if its first entry fails
+    if (!names.insert(model_req.model_name).second)
+    {
+      res.model_status_messages[i] = "SpawnModels: Failure - model name appears more than once in the batch.";
+      continue;
+    }
+    boost::shared_ptr<const ModelTemplate> model_template =
+      modelTemplate(model_req.model_xml, true, res.model_status_messages[i]);
+    if (!model_template)
+      continue;
+    if (!conformModel(model_req, *model_template, jobs[i], res.model_status_messages[i]))
+      continue;
+    if (!checkSpawnable(jobs[i], res.model_status_messages[i]))
+      continue;
+
+    pending[jobs[i].model_name] = jobs[i].is_light;
+    submitted.push_back(i);
+  }
+
+  for (size_t i = 0; i < submitted.size(); ++i)
+    publishSpawn(jobs[submitted[i]]);
+
+  double timeout = req.timeout > 0.0 ? req.timeout : 10.0 + 0.01 * submitted.size();
+  waitForEntities(pending, ros::WallDuration(timeout));
+
+  size_t spawned = 0;
+  for (size_t i = 0; i < submitted.size(); ++i)
+  {
+    const SpawnJob &job = jobs[submitted[i]];
+    if (pending.count(job.model_name))
+    {
+      res.model_status_messages[submitted[i]] = "SpawnModels: Entity pushed to spawn queue, but spawn service "
+        "timed out waiting for entity to appear in simulation under the name " + job.model_name;
+      continue;
+    }
+    res.model_success[submitted[i]] = true;
+    res.model_status_messages[submitted[i]] = "SpawnModels: Successfully spawned entity";
+    ++spawned;
+  }
+
+  if (spawned > 0)
+    entitiesChanged();
+
+  {
+    boost::mutex::scoped_lock lock(model_templates_mutex_);
+    res.template_cache_hits = model_template_hits_ - template_hits;
+    res.template_cache_hit_rate = model_template_uses_ > 0 ?
+      static_cast<double>(model_template_hits_) / model_template_uses_ : 0.0;
+    ROS_DEBUG_NAMED("api_plugin", "SpawnModels: %u model template cache hits, %.1f%% since start",
+                    res.template_cache_hits, 100.0 * res.template_cache_hit_rate);
+  }
+
+  res.success = (spawned == count);
+  res.status_message = "SpawnModels: spawned " + boost::lexical_cast<std::string>(spawned) +
+    " of " + boost::lexical_cast<std::string>(count) + " entities";
+  return true;
 }
 
 bool GazeboRosApiPlugin::deleteModel(gazebo_msgs::DeleteModel::Request &req,
@@ -803,6 +1344,8 @@ bool GazeboRosApiPlugin::deleteModel(gazebo_msgs::DeleteModel::Request &req,
     usleep(1000);
   }
 
+  entitiesChanged();
+
   // set result
   res.success = true;
   res.status_message = "DeleteModel: successfully deleted model";
@@ -963,6 +1506,29 @@ bool GazeboRosApiPlugin::getModelState(gazebo_msgs::GetModelState::Request &req,
   return true;
 }
 
+bool GazeboRosApiPlugin::getUpdateTrace(gazebo_msgs::GetUpdateTrace::Request &req,
+                                        gazebo_msgs::GetUpdateTrace::Response &res)
+{
+  if (!UpdateProfiler::instance().enabled())
+  {
+    res.success = false;
+    res.status_message = "GetUpdateTrace: profiling is disabled, start gzserver with GAZEBO_ROS_PROFILE=1";
+    return true;
+  }
+  res.trace = UpdateProfiler::instance().chromeTrace();
+  res.success = true;
+  res.status_message = "GetUpdateTrace: got trace";
+  return true;
+}
+
+void GazeboRosApiPlugin::publishUpdateProfiles(const ros::WallTimerEvent &event)
+{
+  gazebo_msgs::UpdateProfilesPtr msg(new gazebo_msgs::UpdateProfiles());
+  msg->header.stamp = ros::Time::now();
+  UpdateProfiler::instance().report(*msg);
+  pub_update_profiles_.publish(msg);
+}
+
 bool GazeboRosApiPlugin::getModelProperties(gazebo_msgs::GetModelProperties::Request &req,
                                             gazebo_msgs::GetModelProperties::Response &res)
 {
@@ -1569,38 +2135,355 @@ void GazeboRosApiPlugin::updateModelState(const gazebo_msgs::ModelState::ConstPt
   /*bool success =*/ setModelState(req,res);
 }
 
-bool GazeboRosApiPlugin::applyJointEffort(gazebo_msgs::ApplyJointEffort::Request &req,
-                                          gazebo_msgs::ApplyJointEffort::Response &res)
+bool GazeboRosApiPlugin::getModelStates(gazebo_msgs::GetModelStates::Request &req,
+                                        gazebo_msgs::GetModelStates::Response &res)
 {
-  gazebo::physics::JointPtr joint;
-#if GAZEBO_MAJOR_VERSION >= 8
-  for (unsigned int i = 0; i < world_->ModelCount(); i ++)
+  const size_t count = req.model_names.size();
+  const size_t frame_count = req.relative_entity_names.size();
+  if (frame_count > 1 && frame_count != count)
   {
-    joint = world_->ModelByIndex(i)->GetJoint(req.joint_name);
-#else
-  for (unsigned int i = 0; i < world_->GetModelCount(); i ++)
+    res.success = false;
+    res.status_message = "GetModelStates: relative_entity_names must be empty, hold one name for all models or one per model";
+    return true;
+  }
+  res.pose.resize(count);
+  res.twist.resize(count);
+  res.model_success.assign(count, false);
+  res.model_status_messages.assign(count, std::string());
+
+  // resolve all names before the states are read
+  std::vector<gazebo::physics::ModelPtr> models(count);
+  std::vector<gazebo::physics::EntityPtr> frames(count);
+  for (size_t i = 0; i < count; ++i)
   {
-    joint = world_->GetModel(i)->GetJoint(req.joint_name);
-#endif
-    if (joint)
+    const std::string &frame_name = frame_count > 1 ? req.relative_entity_names[i] :
+      (frame_count == 1 ? req.relative_entity_names[0] : std::string());
+    models[i] = modelByName(req.model_names[i]);
+    if (!models[i])
     {
-      GazeboRosApiPlugin::ForceJointJob* fjj = new GazeboRosApiPlugin::ForceJointJob;
-      fjj->joint = joint;
-      fjj->force = req.effort;
-      fjj->start_time = req.start_time;
-#if GAZEBO_MAJOR_VERSION >= 8
-      if (fjj->start_time < ros::Time(world_->SimTime().Double()))
-        fjj->start_time = ros::Time(world_->SimTime().Double());
-#else
-      if (fjj->start_time < ros::Time(world_->GetSimTime().Double()))
-        fjj->start_time = ros::Time(world_->GetSimTime().Double());
-#endif
-      fjj->duration = req.duration;
-      lock_.lock();
-      force_joint_jobs_.push_back(fjj);
-      lock_.unlock();
-
-      res.success = true;
+      res.model_status_messages[i] = "GetModelStates: model does not exist";
+      continue;
+    }
+    frames[i] = entityByName(frame_name);
+    /// @todo: FIXME map is really wrong, need to use tf here somehow
+    if (!frames[i] && !(frame_name == "" || frame_name == "world" || frame_name == "map" || frame_name == "/map"))
+    {
+      models[i].reset();
+      res.model_status_messages[i] = "GetModelStates: reference relative_entity_name not found, did you forget to scope the body by model name?";
+    }
+  }
+
+  res.header.seq = ++get_model_states_count_;
+  res.header.stamp = ros::Time::now();
+  res.header.frame_id = frame_count == 1 ? req.relative_entity_names[0] : std::string();
+
+  size_t got = 0;
+  {
+    // hold off the physics so that all states are from the same step
+#if GAZEBO_MAJOR_VERSION >= 8
+    boost::recursive_mutex::scoped_lock lock(*world_->Physics()->GetPhysicsUpdateMutex());
+#else
+    boost::recursive_mutex::scoped_lock lock(*world_->GetPhysicsEngine()->GetPhysicsUpdateMutex());
+#endif
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (!models[i])
+        continue;
+#if GAZEBO_MAJOR_VERSION >= 8
+      ignition::math::Pose3d   model_pose = models[i]->WorldPose();
+      ignition::math::Vector3d model_linear_vel  = models[i]->WorldLinearVel();
+      ignition::math::Vector3d model_angular_vel = models[i]->WorldAngularVel();
+#else
+      ignition::math::Pose3d   model_pose = models[i]->GetWorldPose().Ign();
+      ignition::math::Vector3d model_linear_vel  = models[i]->GetWorldLinearVel().Ign();
+      ignition::math::Vector3d model_angular_vel = models[i]->GetWorldAngularVel().Ign();
+#endif
+      if (frames[i])
+      {
+        // convert to relative pose, rates
+#if GAZEBO_MAJOR_VERSION >= 8
+        ignition::math::Pose3d frame_pose = frames[i]->WorldPose();
+        ignition::math::Vector3d frame_vpos = frames[i]->WorldLinearVel();
+        ignition::math::Vector3d frame_veul = frames[i]->WorldAngularVel();
+#else
+        ignition::math::Pose3d frame_pose = frames[i]->GetWorldPose().Ign();
+        ignition::math::Vector3d frame_vpos = frames[i]->GetWorldLinearVel().Ign();
+        ignition::math::Vector3d frame_veul = frames[i]->GetWorldAngularVel().Ign();
+#endif
+        model_pose = model_pose - frame_pose;
+        model_linear_vel = frame_pose.Rot().RotateVectorReverse(model_linear_vel - frame_vpos);
+        model_angular_vel = frame_pose.Rot().RotateVectorReverse(model_angular_vel - frame_veul);
+      }
+
+      geometry_msgs::Pose &pose = res.pose[i];
+      pose.position.x = model_pose.Pos().X();
+      pose.position.y = model_pose.Pos().Y();
+      pose.position.z = model_pose.Pos().Z();
+      pose.orientation.w = model_pose.Rot().W();
+      pose.orientation.x = model_pose.Rot().X();
+      pose.orientation.y = model_pose.Rot().Y();
+      pose.orientation.z = model_pose.Rot().Z();
+
+      geometry_msgs::Twist &twist = res.twist[i];
+      twist.linear.x = model_linear_vel.X();
+      twist.linear.y = model_linear_vel.Y();
+      twist.linear.z = model_linear_vel.Z();
+      twist.angular.x = model_angular_vel.X();
+      twist.angular.y = model_angular_vel.Y();
+      twist.angular.z = model_angular_vel.Z();
+
+      res.model_success[i] = true;
+      res.model_status_messages[i] = "GetModelStates: got properties";
+      ++got;
+    }
+  }
+
+  res.success = got == count;
+  res.status_message = "GetModelStates: got " + boost::lexical_cast<std::string>(got) +
+    " of " + boost::lexical_cast<std::string>(count) + " model states";
+  return true;
+}
+
+bool GazeboRosApiPlugin::setModelStates(gazebo_msgs::SetModelStates::Request &req,
+                                        gazebo_msgs::SetModelStates::Response &res)
+{
+  const size_t count = req.model_states.size();
+  res.model_success.assign(count, false);
+  res.model_status_messages.assign(count, std::string());
+
+  // resolve all names first, a batch is only applied if every state can be set
+  std::vector<gazebo::physics::ModelPtr> models(count);
+  std::vector<gazebo::physics::EntityPtr> frames(count);
+  size_t failed = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    const gazebo_msgs::ModelState &state = req.model_states[i];
+    models[i] = modelByName(state.model_name);
+    if (!models[i])
+    {
+      res.model_status_messages[i] = "SetModelStates: model does not exist";
+      ++failed;
+      continue;
+    }
+    frames[i] = entityByName(state.reference_frame);
+    /// @todo: FIXME map is really wrong, need to use tf here somehow
+    if (!frames[i] && !(state.reference_frame == "" || state.reference_frame == "world" ||
+                        state.reference_frame == "map" || state.reference_frame == "/map"))
+    {
+      res.model_status_messages[i] = "SetModelStates: specified reference frame entity does not exist";
+      ++failed;
+    }
+  }
+  if (failed > 0)
+  {
+    ROS_ERROR_NAMED("api_plugin", "SetModelStates: %lu of %lu models or reference frames do not exist, no state was set",
+                    static_cast<unsigned long>(failed), static_cast<unsigned long>(count));
+    res.success = false;
+    res.status_message = "SetModelStates: " + boost::lexical_cast<std::string>(failed) + " of " +
+      boost::lexical_cast<std::string>(count) + " models or reference frames do not exist, no state was set";
+    return true;
+  }
+
+  // pause before taking the physics mutex, the world update takes them in that order
+  bool is_paused = world_->IsPaused();
+  world_->SetPaused(true);
+  {
+    // no physics step can run between the first and the last state
+#if GAZEBO_MAJOR_VERSION >= 8
+    boost::recursive_mutex::scoped_lock lock(*world_->Physics()->GetPhysicsUpdateMutex());
+#else
+    boost::recursive_mutex::scoped_lock lock(*world_->GetPhysicsEngine()->GetPhysicsUpdateMutex());
+#endif
+
+    // read the reference frames before any model moves, so a state relative
+    // to another model of the batch is relative to where that model was
+    std::vector<ignition::math::Pose3d> frame_poses(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (!frames[i])
+        continue;
+#if GAZEBO_MAJOR_VERSION >= 8
+      frame_poses[i] = frames[i]->WorldPose();
+#else
+      frame_poses[i] = frames[i]->GetWorldPose().Ign();
+#endif
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      const gazebo_msgs::ModelState &state = req.model_states[i];
+      ignition::math::Vector3d target_pos(state.pose.position.x,state.pose.position.y,state.pose.position.z);
+      ignition::math::Quaterniond target_rot(state.pose.orientation.w,state.pose.orientation.x,state.pose.orientation.y,state.pose.orientation.z);
+      target_rot.Normalize(); // eliminates invalid rotation (0, 0, 0, 0)
+      ignition::math::Pose3d target_pose(target_pos,target_rot);
+      ignition::math::Vector3d target_pos_dot(state.twist.linear.x,state.twist.linear.y,state.twist.linear.z);
+      ignition::math::Vector3d target_rot_dot(state.twist.angular.x,state.twist.angular.y,state.twist.angular.z);
+
+      if (frames[i])
+      {
+        target_pose = target_pose + frame_poses[i];
+        // Velocities should be commanded in the requested reference
+        // frame, so we need to translate them to the world frame
+        target_pos_dot = frame_poses[i].Rot().RotateVector(target_pos_dot);
+        target_rot_dot = frame_poses[i].Rot().RotateVector(target_rot_dot);
+      }
+
+      models[i]->SetWorldPose(target_pose);
+      models[i]->SetLinearVel(target_pos_dot);
+      models[i]->SetAngularVel(target_rot_dot);
+      res.model_success[i] = true;
+      res.model_status_messages[i] = "SetModelStates: set model state done";
+    }
+  }
+  world_->SetPaused(is_paused);
+
+  res.success = true;
+  res.status_message = "SetModelStates: set " + boost::lexical_cast<std::string>(count) + " model states";
+  return true;
+}
+
+gazebo::physics::ModelPtr GazeboRosApiPlugin::modelByName(const std::string &name)
+{
+  boost::mutex::scoped_lock lock(entity_index_mutex_);
+  for (int attempt = 0; attempt < 2; ++attempt)
+  {
+    updateEntityIndex();
+    boost::unordered_map<std::string, boost::weak_ptr<gazebo::physics::Model> >::const_iterator it = model_index_.find(name);
+    if (it == model_index_.end())
+      return gazebo::physics::ModelPtr();
+    gazebo::physics::ModelPtr model = it->second.lock();
+    // a model that went through Fini is still alive while someone holds it
+    if (model && model->GetWorld())
+      return model;
+    // deleted without an event we saw, look again in a fresh index
+    entity_index_stale_ = true;
+  }
+  return gazebo::physics::ModelPtr();
+}
+
+gazebo::physics::EntityPtr GazeboRosApiPlugin::entityByName(const std::string &name)
+{
+  if (name.empty())
+    return gazebo::physics::EntityPtr();
+  {
+    boost::mutex::scoped_lock lock(entity_index_mutex_);
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+      updateEntityIndex();
+      boost::unordered_map<std::string, boost::weak_ptr<gazebo::physics::Entity> >::const_iterator it = entity_index_.find(name);
+      if (it == entity_index_.end())
+        break;
+      gazebo::physics::EntityPtr entity = it->second.lock();
+      if (entity && entity->GetWorld())
+        return entity;
+      entity_index_stale_ = true;
+    }
+  }
+  // lights and other entities outside of models
+#if GAZEBO_MAJOR_VERSION >= 8
+  return world_->EntityByName(name);
+#else
+  return world_->GetEntity(name);
+#endif
+}
+
+gazebo::physics::JointPtr GazeboRosApiPlugin::jointByName(const std::string &name)
+{
+#if GAZEBO_MAJOR_VERSION >= 8
+  for (unsigned int i = 0; i < world_->ModelCount(); i ++)
+  {
+    gazebo::physics::JointPtr joint = world_->ModelByIndex(i)->GetJoint(name);
+#else
+  for (unsigned int i = 0; i < world_->GetModelCount(); i ++)
+  {
+    gazebo::physics::JointPtr joint = world_->GetModel(i)->GetJoint(name);
+#endif
+    if (joint)
+      return joint;
+  }
+  return gazebo::physics::JointPtr();
+}
+
+void GazeboRosApiPlugin::updateEntityIndex()
+{
+  // spawn and delete always change the model count, the explicit
+  // invalidation covers a model replaced between two lookups
+#if GAZEBO_MAJOR_VERSION >= 8
+  unsigned int model_count = world_->ModelCount();
+#else
+  unsigned int model_count = world_->GetModelCount();
+#endif
+  if (!entity_index_stale_.exchange(false) && model_count == entity_index_model_count_)
+    return;
+
+  model_index_.clear();
+  entity_index_.clear();
+  for (unsigned int i = 0; i < model_count; i ++)
+  {
+#if GAZEBO_MAJOR_VERSION >= 8
+    gazebo::physics::ModelPtr model = world_->ModelByIndex(i);
+#else
+    gazebo::physics::ModelPtr model = world_->GetModel(i);
+#endif
+    if (!model)
+      continue;
+    model_index_.insert(std::make_pair(model->GetName(), model));
+    indexEntity(model);
+  }
+  entity_index_model_count_ = model_count;
+}
+
+void GazeboRosApiPlugin::indexEntity(const gazebo::physics::EntityPtr &entity)
+{
+  // insert keeps the first entity of a name, which is also the one the
+  // depth first search of the world finds for an unscoped name
+  entity_index_.insert(std::make_pair(entity->GetScopedName(), entity));
+  entity_index_.insert(std::make_pair(entity->GetName(), entity));
+  for (unsigned int i = 0; i < entity->GetChildCount(); i ++)
+  {
+    gazebo::physics::EntityPtr child = boost::dynamic_pointer_cast<gazebo::physics::Entity>(entity->GetChild(i));
+    if (child)
+      indexEntity(child);
+  }
+}
+
+void GazeboRosApiPlugin::entitiesChanged()
+{
+  entity_index_stale_ = true;
+  link_states_engine_->invalidate();
+  model_states_engine_->invalidate();
+}
+
+bool GazeboRosApiPlugin::applyJointEffort(gazebo_msgs::ApplyJointEffort::Request &req,
+                                          gazebo_msgs::ApplyJointEffort::Response &res)
+{
+  gazebo::physics::JointPtr joint;
+#if GAZEBO_MAJOR_VERSION >= 8
+  for (unsigned int i = 0; i < world_->ModelCount(); i ++)
+  {
+    joint = world_->ModelByIndex(i)->GetJoint(req.joint_name);
+#else
+  for (unsigned int i = 0; i < world_->GetModelCount(); i ++)
+  {
+    joint = world_->GetModel(i)->GetJoint(req.joint_name);
+#endif
+    if (joint)
+    {
+      GazeboRosApiPlugin::ForceJointJob fjj;
+      fjj.joint = joint;
+      fjj.force = req.effort;
+      fjj.start_time = req.start_time;
+#if GAZEBO_MAJOR_VERSION >= 8
+      if (fjj.start_time < ros::Time(world_->SimTime().Double()))
+        fjj.start_time = ros::Time(world_->SimTime().Double());
+#else
+      if (fjj.start_time < ros::Time(world_->GetSimTime().Double()))
+        fjj.start_time = ros::Time(world_->GetSimTime().Double());
+#endif
+      fjj.duration = req.duration;
+      force_joint_jobs_.submit(fjj);
+
+      res.success = true;
       res.status_message = "ApplyJointEffort: effort set";
       return true;
     }
@@ -1642,24 +2525,9 @@ bool GazeboRosApiPlugin::clearJointForces(gazebo_msgs::JointRequest::Request &re
 }
 bool GazeboRosApiPlugin::clearJointForces(std::string joint_name)
 {
-  bool search = true;
-  lock_.lock();
-  while(search)
-  {
-    search = false;
-    for (std::vector<GazeboRosApiPlugin::ForceJointJob*>::iterator iter=force_joint_jobs_.begin();iter!=force_joint_jobs_.end();++iter)
-    {
-      if ((*iter)->joint->GetName() == joint_name)
-      {
-        // found one, search through again
-        search = true;
-        delete (*iter);
-        force_joint_jobs_.erase(iter);
-        break;
-      }
-    }
-  }
-  lock_.unlock();
+  // queued, the next world update removes the jobs before it applies any,
+  // also when the world is paused until then
+  force_joint_jobs_.clear(joint_name);
   return true;
 }
 
@@ -1670,25 +2538,9 @@ bool GazeboRosApiPlugin::clearBodyWrenches(gazebo_msgs::BodyRequest::Request &re
 }
 bool GazeboRosApiPlugin::clearBodyWrenches(std::string body_name)
 {
-  bool search = true;
-  lock_.lock();
-  while(search)
-  {
-    search = false;
-    for (std::vector<GazeboRosApiPlugin::WrenchBodyJob*>::iterator iter=wrench_body_jobs_.begin();iter!=wrench_body_jobs_.end();++iter)
-    {
-      //ROS_ERROR_NAMED("api_plugin", "search %s %s",(*iter)->body->GetScopedName().c_str(), body_name.c_str());
-      if ((*iter)->body->GetScopedName() == body_name)
-      {
-        // found one, search through again
-        search = true;
-        delete (*iter);
-        wrench_body_jobs_.erase(iter);
-        break;
-      }
-    }
-  }
-  lock_.unlock();
+  // queued, the next world update removes the jobs before it applies any,
+  // also when the world is paused until then
+  wrench_body_jobs_.clear(body_name);
   return true;
 }
 
@@ -1952,28 +2804,216 @@ bool GazeboRosApiPlugin::applyBodyWrench(gazebo_msgs::ApplyBodyWrench::Request &
   // schedule a job to do below at appropriate times:
   // body->SetForce(force)
   // body->SetTorque(torque)
-  GazeboRosApiPlugin::WrenchBodyJob* wej = new GazeboRosApiPlugin::WrenchBodyJob;
-  wej->body = body;
-  wej->force = target_force;
-  wej->torque = target_torque;
-  wej->start_time = req.start_time;
+  GazeboRosApiPlugin::WrenchBodyJob wej;
+  wej.body = body;
+  wej.force = target_force;
+  wej.torque = target_torque;
+  wej.start_time = req.start_time;
 #if GAZEBO_MAJOR_VERSION >= 8
-  if (wej->start_time < ros::Time(world_->SimTime().Double()))
-    wej->start_time = ros::Time(world_->SimTime().Double());
+  if (wej.start_time < ros::Time(world_->SimTime().Double()))
+    wej.start_time = ros::Time(world_->SimTime().Double());
 #else
-  if (wej->start_time < ros::Time(world_->GetSimTime().Double()))
-    wej->start_time = ros::Time(world_->GetSimTime().Double());
+  if (wej.start_time < ros::Time(world_->GetSimTime().Double()))
+    wej.start_time = ros::Time(world_->GetSimTime().Double());
 #endif
-  wej->duration = req.duration;
-  lock_.lock();
-  wrench_body_jobs_.push_back(wej);
-  lock_.unlock();
+  wej.duration = req.duration;
+  wrench_body_jobs_.submit(wej);
 
   res.success = true;
   res.status_message = "";
   return true;
 }
 
+bool GazeboRosApiPlugin::stepAndObserve(gazebo_msgs::StepAndObserve::Request &req,
+                                        gazebo_msgs::StepAndObserve::Response &res)
+{
+  res.iterations = 0;
+  if (req.joint_efforts.size() != req.joint_names.size() ||
+      req.body_wrenches.size() != req.body_names.size())
+  {
+    res.success = false;
+    res.status_message = "StepAndObserve: joint_efforts and body_wrenches must hold one entry per joint and body name";
+    return true;
+  }
+  if (req.steps == 0)
+  {
+    res.success = false;
+    res.status_message = "StepAndObserve: steps must be positive";
+    return true;
+  }
+  // a running world would mix its own iterations with the requested ones
+  if (!world_->IsPaused())
+  {
+    res.success = false;
+    res.status_message = "StepAndObserve: physics must be paused, call pause_physics first";
+    return true;
+  }
+
+  // resolve all names before the world is stepped, the physics thread only reads the batch
+  StepBatch batch;
+  for (size_t i = 0; i < req.joint_names.size(); ++i)
+  {
+    gazebo::physics::JointPtr joint = jointByName(req.joint_names[i]);
+    if (!joint)
+    {
+      res.success = false;
+      res.status_message = "StepAndObserve: joint [" + req.joint_names[i] + "] does not exist";
+      return true;
+    }
+    batch.effort_joints.push_back(joint);
+    batch.efforts.push_back(req.joint_efforts[i]);
+  }
+  for (size_t i = 0; i < req.body_names.size(); ++i)
+  {
+    gazebo::physics::LinkPtr body =
+      boost::dynamic_pointer_cast<gazebo::physics::Link>(entityByName(req.body_names[i]));
+    if (!body)
+    {
+      res.success = false;
+      res.status_message = "StepAndObserve: body [" + req.body_names[i] + "] does not exist";
+      return true;
+    }
+    const geometry_msgs::Wrench &wrench = req.body_wrenches[i];
+    batch.wrench_bodies.push_back(body);
+    batch.forces.push_back(ignition::math::Vector3d(wrench.force.x, wrench.force.y, wrench.force.z));
+    batch.torques.push_back(ignition::math::Vector3d(wrench.torque.x, wrench.torque.y, wrench.torque.z));
+  }
+  for (size_t i = 0; i < req.model_names.size(); ++i)
+  {
+    gazebo::physics::ModelPtr model = modelByName(req.model_names[i]);
+    if (!model)
+    {
+      res.success = false;
+      res.status_message = "StepAndObserve: model [" + req.model_names[i] + "] does not exist";
+      return true;
+    }
+    batch.models.push_back(model);
+  }
+  for (size_t i = 0; i < req.observed_joint_names.size(); ++i)
+  {
+    gazebo::physics::JointPtr joint = jointByName(req.observed_joint_names[i]);
+    if (!joint)
+    {
+      res.success = false;
+      res.status_message = "StepAndObserve: joint [" + req.observed_joint_names[i] + "] does not exist";
+      return true;
+    }
+    batch.joints.push_back(joint);
+  }
+
+  // the physics thread appends to the response without reallocating, so bound what is reserved
+  const size_t stamps = req.observe_every_step ? req.steps : 1;
+  const size_t entities = std::max(batch.models.size(), batch.joints.size());
+  if (entities > 0 && stamps > STEP_OBSERVATION_LIMIT / entities)
+  {
+    res.success = false;
+    res.status_message = "StepAndObserve: at most " +
+      boost::lexical_cast<std::string>(STEP_OBSERVATION_LIMIT) +
+      " observations of the models or joints can be returned, step fewer iterations or observe only the last one";
+    return true;
+  }
+  res.stamps.reserve(stamps);
+  res.pose.reserve(stamps * batch.models.size());
+  res.twist.reserve(stamps * batch.models.size());
+  res.joint_position.reserve(stamps * batch.joints.size());
+  res.joint_velocity.reserve(stamps * batch.joints.size());
+  res.joint_effort.reserve(stamps * batch.joints.size());
+  batch.steps = req.steps;
+  batch.every_step = req.observe_every_step;
+  batch.iterations = 0;
+  batch.res = &res;
+
+  // Step() blocks until the iterations are done, under the world update mutex the slots run in
+  step_batch_.store(&batch);
+  world_->Step(req.steps);
+  step_batch_.store(NULL);
+
+  res.iterations = batch.iterations;
+  if (batch.iterations < req.steps)
+  {
+    res.success = false;
+    res.status_message = "StepAndObserve: world stopped after " +
+      boost::lexical_cast<std::string>(batch.iterations) + " iterations";
+    return true;
+  }
+  res.success = true;
+  res.status_message = "StepAndObserve: stepped " + boost::lexical_cast<std::string>(req.steps) + " iterations";
+  return true;
+}
+
+bool GazeboRosApiPlugin::saveWorldSnapshot(gazebo_msgs::SaveWorldSnapshot::Request &req,
+                                           gazebo_msgs::SaveWorldSnapshot::Response &res)
+{
+  ros::WallTime start = ros::WallTime::now();
+  boost::shared_ptr<WorldSnapshot> snapshot(new WorldSnapshot);
+  {
+    // all states from the same step
+#if GAZEBO_MAJOR_VERSION >= 8
+    boost::recursive_mutex::scoped_lock lock(*world_->Physics()->GetPhysicsUpdateMutex());
+#else
+    boost::recursive_mutex::scoped_lock lock(*world_->GetPhysicsEngine()->GetPhysicsUpdateMutex());
+#endif
+    snapshot->capture(world_);
+  }
+  if (!world_snapshots_.put(req.snapshot_id, snapshot))
+  {
+    res.success = false;
+    res.status_message = "SaveWorldSnapshot: world snapshots are disabled, world_snapshot_capacity is 0";
+    return true;
+  }
+
+  res.model_count = snapshot->modelCount();
+  res.link_count = snapshot->linkCount();
+  res.joint_count = snapshot->jointCount();
+  if (req.return_state)
+    snapshot->toMsg(res.state);
+  res.success = true;
+  res.status_message = "SaveWorldSnapshot: saved " + boost::lexical_cast<std::string>(res.model_count) +
+    " models in " + boost::lexical_cast<std::string>((ros::WallTime::now() - start).toSec() * 1000.0) + " ms";
+  return true;
+}
+
+bool GazeboRosApiPlugin::restoreWorldSnapshot(gazebo_msgs::RestoreWorldSnapshot::Request &req,
+                                              gazebo_msgs::RestoreWorldSnapshot::Response &res)
+{
+  boost::shared_ptr<const WorldSnapshot> snapshot = world_snapshots_.get(req.snapshot_id);
+  if (!snapshot)
+  {
+    res.success = false;
+    res.status_message = "RestoreWorldSnapshot: no snapshot [" + req.snapshot_id + "]";
+    return true;
+  }
+
+  ros::WallTime start = ros::WallTime::now();
+  std::string missing;
+  bool restored;
+  // pause before taking the physics mutex, the world update takes them in that order
+  bool is_paused = world_->IsPaused();
+  world_->SetPaused(true);
+  {
+    // no physics step can run between the first and the last state
+#if GAZEBO_MAJOR_VERSION >= 8
+    boost::recursive_mutex::scoped_lock lock(*world_->Physics()->GetPhysicsUpdateMutex());
+#else
+    boost::recursive_mutex::scoped_lock lock(*world_->GetPhysicsEngine()->GetPhysicsUpdateMutex());
+#endif
+    restored = snapshot->restore(missing);
+  }
+  world_->SetPaused(is_paused);
+
+  res.sim_time = ros::Time(snapshot->sim_time.sec, snapshot->sim_time.nsec);
+  if (!restored)
+  {
+    res.success = false;
+    res.status_message = "RestoreWorldSnapshot: [" + missing + "] was deleted since the snapshot was saved";
+    return true;
+  }
+  res.success = true;
+  res.status_message = "RestoreWorldSnapshot: restored " + boost::lexical_cast<std::string>(snapshot->modelCount()) +
+    " models in " + boost::lexical_cast<std::string>((ros::WallTime::now() - start).toSec() * 1000.0) + " ms";
+  return true;
+}
+
 bool GazeboRosApiPlugin::isURDF(std::string model_xml)
 {
   TiXmlDocument doc_in;
@@ -1998,76 +3038,98 @@ bool GazeboRosApiPlugin::isSDF(std::string model_xml)
 
 void GazeboRosApiPlugin::wrenchBodySchedulerSlot()
 {
-  // MDMutex locks in case model is getting deleted, don't have to do this if we delete jobs first
-  // boost::recursive_mutex::scoped_lock lock(*world->GetMDMutex());
-  lock_.lock();
-  for (std::vector<GazeboRosApiPlugin::WrenchBodyJob*>::iterator iter=wrench_body_jobs_.begin();iter!=wrench_body_jobs_.end();)
-  {
-    // check times and apply wrench if necessary
+  // deleteModel queues the clears of the model before it requests the
+  // delete, and queued clears are processed before any job is applied, so
+  // no job of a model deleted through ROS is applied after the delete
 #if GAZEBO_MAJOR_VERSION >= 8
-    ros::Time simTime = ros::Time(world_->SimTime().Double());
+  wrench_body_jobs_.update(ros::Time(world_->SimTime().Double()));
 #else
-    ros::Time simTime = ros::Time(world_->GetSimTime().Double());
+  wrench_body_jobs_.update(ros::Time(world_->GetSimTime().Double()));
 #endif
-    if (simTime >= (*iter)->start_time)
-      if (simTime <= (*iter)->start_time+(*iter)->duration ||
-          (*iter)->duration.toSec() < 0.0)
-      {
-        if ((*iter)->body) // if body exists
-        {
-          (*iter)->body->SetForce((*iter)->force);
-          (*iter)->body->SetTorque((*iter)->torque);
-        }
-        else
-          (*iter)->duration.fromSec(0.0); // mark for delete
-      }
+}
 
-    if (simTime > (*iter)->start_time+(*iter)->duration &&
-        (*iter)->duration.toSec() >= 0.0)
-    {
-      // remove from queue once expires
-      delete (*iter);
-      iter = wrench_body_jobs_.erase(iter);
-    }
-    else
-      ++iter;
+void GazeboRosApiPlugin::forceJointSchedulerSlot()
+{
+  // deleteModel queues the clears of the model before it requests the
+  // delete, and queued clears are processed before any job is applied, so
+  // no job of a model deleted through ROS is applied after the delete
+#if GAZEBO_MAJOR_VERSION >= 8
+  force_joint_jobs_.update(ros::Time(world_->SimTime().Double()));
+#else
+  force_joint_jobs_.update(ros::Time(world_->GetSimTime().Double()));
+#endif
+}
+
+void GazeboRosApiPlugin::stepBatchBeginSlot()
+{
+  StepBatch *batch = step_batch_.load();
+  if (!batch || batch->iterations >= batch->steps)
+    return;
+  // efforts and wrenches only last one iteration, apply them again on each
+  for (size_t i = 0; i < batch->effort_joints.size(); ++i)
+    batch->effort_joints[i]->SetForce(0, batch->efforts[i]);
+  for (size_t i = 0; i < batch->wrench_bodies.size(); ++i)
+  {
+    batch->wrench_bodies[i]->SetForce(batch->forces[i]);
+    batch->wrench_bodies[i]->SetTorque(batch->torques[i]);
   }
-  lock_.unlock();
 }
 
-void GazeboRosApiPlugin::forceJointSchedulerSlot()
+void GazeboRosApiPlugin::stepBatchEndSlot()
 {
-  // MDMutex locks in case model is getting deleted, don't have to do this if we delete jobs first
-  // boost::recursive_mutex::scoped_lock lock(*world->GetMDMutex());
-  lock_.lock();
-  for (std::vector<GazeboRosApiPlugin::ForceJointJob*>::iterator iter=force_joint_jobs_.begin();iter!=force_joint_jobs_.end();)
+  StepBatch *batch = step_batch_.load();
+  if (!batch || batch->iterations >= batch->steps)
+    return;
+  ++batch->iterations;
+  if (!batch->every_step && batch->iterations < batch->steps)
+    return;
+
+  gazebo_msgs::StepAndObserve::Response &res = *batch->res;
+#if GAZEBO_MAJOR_VERSION >= 8
+  res.stamps.push_back(ros::Time(world_->SimTime().Double()));
+#else
+  res.stamps.push_back(ros::Time(world_->GetSimTime().Double()));
+#endif
+  for (size_t i = 0; i < batch->models.size(); ++i)
   {
-    // check times and apply force if necessary
 #if GAZEBO_MAJOR_VERSION >= 8
-    ros::Time simTime = ros::Time(world_->SimTime().Double());
+    ignition::math::Pose3d   model_pose = batch->models[i]->WorldPose();
+    ignition::math::Vector3d model_linear_vel  = batch->models[i]->WorldLinearVel();
+    ignition::math::Vector3d model_angular_vel = batch->models[i]->WorldAngularVel();
 #else
-    ros::Time simTime = ros::Time(world_->GetSimTime().Double());
+    ignition::math::Pose3d   model_pose = batch->models[i]->GetWorldPose().Ign();
+    ignition::math::Vector3d model_linear_vel  = batch->models[i]->GetWorldLinearVel().Ign();
+    ignition::math::Vector3d model_angular_vel = batch->models[i]->GetWorldAngularVel().Ign();
 #endif
-    if (simTime >= (*iter)->start_time)
-      if (simTime <= (*iter)->start_time+(*iter)->duration ||
-          (*iter)->duration.toSec() < 0.0)
-      {
-        if ((*iter)->joint) // if joint exists
-          (*iter)->joint->SetForce(0,(*iter)->force);
-        else
-          (*iter)->duration.fromSec(0.0); // mark for delete
-      }
+    geometry_msgs::Pose pose;
+    pose.position.x = model_pose.Pos().X();
+    pose.position.y = model_pose.Pos().Y();
+    pose.position.z = model_pose.Pos().Z();
+    pose.orientation.w = model_pose.Rot().W();
+    pose.orientation.x = model_pose.Rot().X();
+    pose.orientation.y = model_pose.Rot().Y();
+    pose.orientation.z = model_pose.Rot().Z();
+    res.pose.push_back(pose);
 
-    if (simTime > (*iter)->start_time+(*iter)->duration &&
-        (*iter)->duration.toSec() >= 0.0)
-    {
-      // remove from queue once expires
-      iter = force_joint_jobs_.erase(iter);
-    }
-    else
-      ++iter;
+    geometry_msgs::Twist twist;
+    twist.linear.x = model_linear_vel.X();
+    twist.linear.y = model_linear_vel.Y();
+    twist.linear.z = model_linear_vel.Z();
+    twist.angular.x = model_angular_vel.X();
+    twist.angular.y = model_angular_vel.Y();
+    twist.angular.z = model_angular_vel.Z();
+    res.twist.push_back(twist);
+  }
+  for (size_t i = 0; i < batch->joints.size(); ++i)
+  {
+#if GAZEBO_MAJOR_VERSION >= 8
+    res.joint_position.push_back(batch->joints[i]->Position(0));
+#else
+    res.joint_position.push_back(batch->joints[i]->GetAngle(0).Radian());
+#endif
+    res.joint_velocity.push_back(batch->joints[i]->GetVelocity(0));
+    res.joint_effort.push_back(batch->joints[i]->GetForce(0));
   }
-  lock_.unlock();
 }
 
 void GazeboRosApiPlugin::publishSimTime(const boost::shared_ptr<gazebo::msgs::WorldStatistics const> &msg)
@@ -2110,105 +3172,58 @@ void GazeboRosApiPlugin::publishSimTime()
   pub_clock_.publish(ros_time_);
 }
 
-void GazeboRosApiPlugin::publishLinkStates()
+void GazeboRosApiPlugin::publishLinkStates(const StateSnapshot &snapshot)
 {
-  gazebo_msgs::LinkStates link_states;
-
-  // fill link_states
-#if GAZEBO_MAJOR_VERSION >= 8
-  for (unsigned int i = 0; i < world_->ModelCount(); i ++)
-  {
-    gazebo::physics::ModelPtr model = world_->ModelByIndex(i);
-#else
-  for (unsigned int i = 0; i < world_->GetModelCount(); i ++)
+  boost::mutex::scoped_lock lock(pub_link_states_mutex_);
+  bool filled = false;
+  for (unsigned int i = 0; i < pub_link_states_.size(); ++i)
   {
-    gazebo::physics::ModelPtr model = world_->GetModel(i);
-#endif
-
-    for (unsigned int j = 0 ; j < model->GetChildCount(); j ++)
+    if (!(snapshot.streams & (1u << i)))
+      continue;
+    if (static_cast<int>(i) == link_states_shm_stream_)
     {
-      gazebo::physics::LinkPtr body = boost::dynamic_pointer_cast<gazebo::physics::Link>(model->GetChild(j));
-
-      if (body)
-      {
-        link_states.name.push_back(body->GetScopedName());
-        geometry_msgs::Pose pose;
-#if GAZEBO_MAJOR_VERSION >= 8
-        ignition::math::Pose3d  body_pose = body->WorldPose(); // - myBody->GetCoMPose();
-        ignition::math::Vector3d linear_vel  = body->WorldLinearVel();
-        ignition::math::Vector3d angular_vel = body->WorldAngularVel();
-#else
-        ignition::math::Pose3d  body_pose = body->GetWorldPose().Ign(); // - myBody->GetCoMPose();
-        ignition::math::Vector3d linear_vel  = body->GetWorldLinearVel().Ign();
-        ignition::math::Vector3d angular_vel = body->GetWorldAngularVel().Ign();
-#endif
-        ignition::math::Vector3d pos = body_pose.Pos();
-        ignition::math::Quaterniond rot = body_pose.Rot();
-        pose.position.x = pos.X();
-        pose.position.y = pos.Y();
-        pose.position.z = pos.Z();
-        pose.orientation.w = rot.W();
-        pose.orientation.x = rot.X();
-        pose.orientation.y = rot.Y();
-        pose.orientation.z = rot.Z();
-        link_states.pose.push_back(pose);
-        geometry_msgs::Twist twist;
-        twist.linear.x = linear_vel.X();
-        twist.linear.y = linear_vel.Y();
-        twist.linear.z = linear_vel.Z();
-        twist.angular.x = angular_vel.X();
-        twist.angular.y = angular_vel.Y();
-        twist.angular.z = angular_vel.Z();
-        link_states.twist.push_back(twist);
-      }
+      exportSnapshot(link_states_shm_, snapshot);
+      continue;
     }
+    if (snapshot.selection(i))
+    {
+      StateSnapshotEngine::toMsg(snapshot, i, link_states_stream_msgs_[i], link_states_stream_msg_generations_[i]);
+      pub_link_states_[i].publish(link_states_stream_msgs_[i]);
+      continue;
+    }
+    // unfiltered streams share one message
+    if (!filled)
+      StateSnapshotEngine::toMsg(snapshot, link_states_msg_, link_states_msg_generation_);
+    filled = true;
+    pub_link_states_[i].publish(link_states_msg_);
   }
-
-  pub_link_states_.publish(link_states);
 }
 
-void GazeboRosApiPlugin::publishModelStates()
+void GazeboRosApiPlugin::publishModelStates(const StateSnapshot &snapshot)
 {
-  gazebo_msgs::ModelStates model_states;
-
-  // fill model_states
-#if GAZEBO_MAJOR_VERSION >= 8
-  for (unsigned int i = 0; i < world_->ModelCount(); i ++)
+  boost::mutex::scoped_lock lock(pub_model_states_mutex_);
+  bool filled = false;
+  for (unsigned int i = 0; i < pub_model_states_.size(); ++i)
   {
-    gazebo::physics::ModelPtr model = world_->ModelByIndex(i);
-    ignition::math::Pose3d  model_pose = model->WorldPose(); // - myBody->GetCoMPose();
-    ignition::math::Vector3d linear_vel  = model->WorldLinearVel();
-    ignition::math::Vector3d angular_vel = model->WorldAngularVel();
-#else
-  for (unsigned int i = 0; i < world_->GetModelCount(); i ++)
-  {
-    gazebo::physics::ModelPtr model = world_->GetModel(i);
-    ignition::math::Pose3d  model_pose = model->GetWorldPose().Ign(); // - myBody->GetCoMPose();
-    ignition::math::Vector3d linear_vel  = model->GetWorldLinearVel().Ign();
-    ignition::math::Vector3d angular_vel = model->GetWorldAngularVel().Ign();
-#endif
-    ignition::math::Vector3d pos = model_pose.Pos();
-    ignition::math::Quaterniond rot = model_pose.Rot();
-    geometry_msgs::Pose pose;
-    pose.position.x = pos.X();
-    pose.position.y = pos.Y();
-    pose.position.z = pos.Z();
-    pose.orientation.w = rot.W();
-    pose.orientation.x = rot.X();
-    pose.orientation.y = rot.Y();
-    pose.orientation.z = rot.Z();
-    model_states.pose.push_back(pose);
-    model_states.name.push_back(model->GetName());
-    geometry_msgs::Twist twist;
-    twist.linear.x = linear_vel.X();
-    twist.linear.y = linear_vel.Y();
-    twist.linear.z = linear_vel.Z();
-    twist.angular.x = angular_vel.X();
-    twist.angular.y = angular_vel.Y();
-    twist.angular.z = angular_vel.Z();
-    model_states.twist.push_back(twist);
+    if (!(snapshot.streams & (1u << i)))
+      continue;
+    if (static_cast<int>(i) == model_states_shm_stream_)
+    {
+      exportSnapshot(model_states_shm_, snapshot);
+      continue;
+    }
+    if (snapshot.selection(i))
+    {
+      StateSnapshotEngine::toMsg(snapshot, i, model_states_stream_msgs_[i], model_states_stream_msg_generations_[i]);
+      pub_model_states_[i].publish(model_states_stream_msgs_[i]);
+      continue;
+    }
+    // unfiltered streams share one message
+    if (!filled)
+      StateSnapshotEngine::toMsg(snapshot, model_states_msg_, model_states_msg_generation_);
+    filled = true;
+    pub_model_states_[i].publish(model_states_msg_);
   }
-  pub_model_states_.publish(model_states);
 }
 
 void GazeboRosApiPlugin::physicsReconfigureCallback(gazebo_ros::PhysicsConfig &config, uint32_t level)
@@ -2542,7 +3557,7 @@ void GazeboRosApiPlugin::updateURDFName(TiXmlDocument &gazebo_model_xml, const s
     ROS_WARN_NAMED("api_plugin", "Could not find <robot> element in URDF, name not replaced");
 }
 
-void GazeboRosApiPlugin::walkChildAddRobotNamespace(TiXmlNode* model_xml)
+void GazeboRosApiPlugin::walkChildAddRobotNamespace(TiXmlNode* model_xml, const std::string &robot_namespace)
 {
   TiXmlNode* child = 0;
   child = model_xml->IterateChildren(child);
@@ -2560,108 +3575,178 @@ void GazeboRosApiPlugin::walkChildAddRobotNamespace(TiXmlNode* model_xml)
           child_elem = child->ToElement()->FirstChildElement("robotNamespace");
         }
         TiXmlElement* key = new TiXmlElement("robotNamespace");
-        TiXmlText* val = new TiXmlText(robot_namespace_);
+        TiXmlText* val = new TiXmlText(robot_namespace);
         key->LinkEndChild(val);
         child->ToElement()->LinkEndChild(key);
       }
     }
-    walkChildAddRobotNamespace(child);
+    walkChildAddRobotNamespace(child, robot_namespace);
     child = model_xml->IterateChildren(child);
   }
 }
 
-bool GazeboRosApiPlugin::spawnAndConform(TiXmlDocument &gazebo_model_xml, const std::string &model_name,
-                                         gazebo_msgs::SpawnModel::Response &res)
+bool GazeboRosApiPlugin::checkSpawnable(const SpawnJob &job, std::string &status_message)
 {
-  std::string entity_type = gazebo_model_xml.RootElement()->FirstChild()->Value();
-  // Convert the entity type to lower case
-  std::transform(entity_type.begin(), entity_type.end(), entity_type.begin(), ::tolower);
-
-  bool isLight = (entity_type == "light");
-
-  // push to factory iface
-  std::ostringstream stream;
-  stream << gazebo_model_xml;
-  std::string gazebo_model_xml_string = stream.str();
-  ROS_DEBUG_NAMED("api_plugin.xml", "Gazebo Model XML\n\n%s\n\n ",gazebo_model_xml_string.c_str());
-
-  // publish to factory topic
-  gazebo::msgs::Factory msg;
-  gazebo::msgs::Init(msg, "spawn_model");
-  msg.set_sdf( gazebo_model_xml_string );
-
-  //ROS_ERROR_NAMED("api_plugin", "attempting to spawn model name [%s] [%s]", model_name.c_str(),gazebo_model_xml_string.c_str());
-
   // FIXME: should use entity_info or add lock to World::receiveMutex
   // looking for Model to see if it exists already
-  gazebo::msgs::Request *entity_info_msg = gazebo::msgs::CreateRequest("entity_info", model_name);
+  gazebo::msgs::Request *entity_info_msg = gazebo::msgs::CreateRequest("entity_info", job.model_name);
   request_pub_->Publish(*entity_info_msg,true);
+  delete entity_info_msg;
   // todo: should wait for response response_sub_, check to see that if _msg->response == "nonexistant"
 
 #if GAZEBO_MAJOR_VERSION >= 8
-  gazebo::physics::ModelPtr model = world_->ModelByName(model_name);
-  gazebo::physics::LightPtr light = world_->LightByName(model_name);
+  gazebo::physics::ModelPtr model = world_->ModelByName(job.model_name);
+  gazebo::physics::LightPtr light = world_->LightByName(job.model_name);
 #else
-  gazebo::physics::ModelPtr model = world_->GetModel(model_name);
-  gazebo::physics::LightPtr light = world_->Light(model_name);
+  gazebo::physics::ModelPtr model = world_->GetModel(job.model_name);
+  gazebo::physics::LightPtr light = world_->Light(job.model_name);
 #endif
-  if ((isLight && light != NULL) || (model != NULL))
+  if ((job.is_light && light != NULL) || (model != NULL))
   {
-    ROS_ERROR_NAMED("api_plugin", "SpawnModel: Failure - model name %s already exist.",model_name.c_str());
-    res.success = false;
-    res.status_message = "SpawnModel: Failure - entity already exists.";
-    return true;
+    ROS_ERROR_NAMED("api_plugin", "SpawnModel: Failure - model name %s already exist.",job.model_name.c_str());
+    status_message = "SpawnModel: Failure - entity already exists.";
+    return false;
   }
+  return true;
+}
 
+void GazeboRosApiPlugin::publishSpawn(const SpawnJob &job)
+{
   // for Gazebo 7 and up, use a different method to spawn lights
-  if (isLight)
+  if (job.is_light)
   {
     // Publish the light message to spawn the light (Gazebo 7 and up)
     sdf::SDF sdf_light;
-    sdf_light.SetFromString(gazebo_model_xml_string);
+    sdf_light.SetFromString(job.xml);
     gazebo::msgs::Light msg = gazebo::msgs::LightFromSDF(sdf_light.Root()->GetElement("light"));
-    msg.set_name(model_name);
+    msg.set_name(job.model_name);
     factory_light_pub_->Publish(msg);
   }
   else
   {
-    // Publish the factory message
+    // the model plugins look up the URDF when they load
+    if (job.is_urdf)
+      ModelDescriptions::instance().set(job.model_name, job.xml);
+
+    // publish to factory topic
+    gazebo::msgs::Factory msg;
+    gazebo::msgs::Init(msg, "spawn_model");
+    msg.set_sdf(job.xml);
     factory_pub_->Publish(msg);
   }
-  /// FIXME: should change publish to direct invocation World::LoadModel() and/or
-  ///        change the poll for Model existence to common::Events based check.
-
-  /// \brief poll and wait, verify that the model is spawned within Hardcoded 10 seconds
-  ros::Duration model_spawn_timeout(10.0);
-  ros::Time timeout = ros::Time::now() + model_spawn_timeout;
+}
 
-  while (ros::ok())
+void GazeboRosApiPlugin::onAddEntity(std::string name)
+{
+  // a spawn through gz transport or the GUI may replace a deleted model
+  // without changing the model count
+  entitiesChanged();
   {
-    if (ros::Time::now() > timeout)
-    {
-      res.success = false;
-      res.status_message = "SpawnModel: Entity pushed to spawn queue, but spawn service timed out waiting for entity to appear in simulation under the name " + model_name;
-      return true;
-    }
+    boost::mutex::scoped_lock lock(spawn_mutex_);
+    if (spawn_waiters_ == 0)
+      return;
+    added_entities_.push_back(name);
+  }
+  spawn_cond_.notify_all();
+}
+
+void GazeboRosApiPlugin::onDeleteEntity(std::string name)
+{
+  entitiesChanged();
+  // a model of the same name spawned by another client must not find the
+  // URDF of this one
+  ModelDescriptions::instance().erase(name);
+}
 
+void GazeboRosApiPlugin::waitForEntities(std::map<std::string, bool> &pending, const ros::WallDuration &timeout)
+{
+  ros::WallTime deadline = ros::WallTime::now() + timeout;
+
+  // lights are added without an addEntity event, so they are only found by
+  // looking them up, at an interval short against the time a spawn takes
+  long look_up_ms = 500;
+  for (std::map<std::string, bool>::const_iterator iter = pending.begin(); iter != pending.end(); ++iter)
+    if (iter->second)
+      look_up_ms = 10;
+
+  boost::mutex::scoped_lock lock(spawn_mutex_);
+  ++spawn_waiters_;
+  size_t seen = added_entities_.size();
+  // entities added before we started listening are only found by looking
+  // them up, which is repeated now and then in case an event is missed
+  bool look_up = true;
+  while (!pending.empty() && ros::ok())
+  {
+    if (look_up)
     {
-      //boost::recursive_mutex::scoped_lock lock(*world->GetMRMutex());
+      lock.unlock();
+      std::set<std::string> models;
 #if GAZEBO_MAJOR_VERSION >= 8
-      if ((isLight && world_->LightByName(model_name) != NULL)
-          || (world_->ModelByName(model_name) != NULL))
+      gazebo::physics::Model_V world_models = world_->Models();
 #else
-      if ((isLight && world_->Light(model_name) != NULL)
-          || (world_->GetModel(model_name) != NULL))
+      gazebo::physics::Model_V world_models = world_->GetModels();
 #endif
-        break;
+      for (unsigned int i = 0; i < world_models.size(); ++i)
+        models.insert(world_models[i]->GetName());
+      for (std::map<std::string, bool>::iterator iter = pending.begin(); iter != pending.end();)
+      {
+#if GAZEBO_MAJOR_VERSION >= 8
+        bool exists = iter->second ? world_->LightByName(iter->first) != NULL : models.count(iter->first) > 0;
+#else
+        bool exists = iter->second ? world_->Light(iter->first) != NULL : models.count(iter->first) > 0;
+#endif
+        if (exists)
+          pending.erase(iter++);
+        else
+          ++iter;
+      }
+      lock.lock();
+      look_up = false;
     }
 
-    ROS_DEBUG_STREAM_ONCE_NAMED("api_plugin","Waiting for " << timeout - ros::Time::now()
-      << " for entity " << model_name << " to spawn");
+    for (; seen < added_entities_.size(); ++seen)
+      pending.erase(added_entities_[seen]);
+    if (pending.empty())
+      break;
+
+    ros::WallDuration remaining = deadline - ros::WallTime::now();
+    if (remaining <= ros::WallDuration(0))
+      break;
+    ROS_DEBUG_STREAM_ONCE_NAMED("api_plugin","Waiting for " << remaining
+      << " for " << pending.size() << " entities to spawn");
 
-    usleep(2000);
+    long wait_ms = std::min(look_up_ms, static_cast<long>(remaining.toSec() * 1000.0) + 1);
+    if (!spawn_cond_.timed_wait(lock, boost::posix_time::milliseconds(wait_ms)))
+      look_up = true;
   }
 
+  if (--spawn_waiters_ == 0)
+    added_entities_.clear();
+}
+
+bool GazeboRosApiPlugin::spawnAndConform(const SpawnJob &job, gazebo_msgs::SpawnModel::Response &res)
+{
+  if (!checkSpawnable(job, res.status_message))
+  {
+    res.success = false;
+    return true;
+  }
+
+  publishSpawn(job);
+
+  /// \brief wait for the entity added event, verify that the model is spawned within Hardcoded 10 seconds
+  std::map<std::string, bool> pending;
+  pending[job.model_name] = job.is_light;
+  waitForEntities(pending, ros::WallDuration(10.0));
+  if (!pending.empty())
+  {
+    res.success = false;
+    res.status_message = "SpawnModel: Entity pushed to spawn queue, but spawn service timed out waiting for entity to appear in simulation under the name " + job.model_name;
+    return true;
+  }
+
+  entitiesChanged();
+
   // set result
   res.success = true;
   res.status_message = "SpawnModel: Successfully spawned entity";
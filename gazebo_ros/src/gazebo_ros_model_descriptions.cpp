@@ -0,0 +1,51 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gazebo_ros/gazebo_ros_model_descriptions.h>
+
+namespace gazebo
+{
+
+ModelDescriptions &ModelDescriptions::instance()
+{
+  static ModelDescriptions descriptions;
+  return descriptions;
+}
+
+void ModelDescriptions::set(const std::string &model_name, const std::string &urdf)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  descriptions_[model_name] = urdf;
+}
+
+void ModelDescriptions::erase(const std::string &model_name)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  descriptions_.erase(model_name);
+}
+
+bool ModelDescriptions::get(const std::string &model_name, std::string &urdf) const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  std::map<std::string, std::string>::const_iterator it = descriptions_.find(model_name);
+  if (it == descriptions_.end())
+    return false;
+  urdf = it->second;
+  return true;
+}
+
+}
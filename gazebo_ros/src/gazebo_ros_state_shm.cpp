@@ -0,0 +1,326 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <gazebo_ros/gazebo_ros_state_shm.h>
+
+namespace gazebo
+{
+
+/// \brief Round up to a multiple of 64, keeps the seqlocks of neighbouring
+/// slots on separate cache lines
+static uint64_t alignUp(uint64_t size)
+{
+  return (size + 63) & ~static_cast<uint64_t>(63);
+}
+
+static const StateShmNames *namesOf(const char *base)
+{
+  const StateShmHeader *header = reinterpret_cast<const StateShmHeader*>(base);
+  return reinterpret_cast<const StateShmNames*>(base + header->names_offset);
+}
+
+static const StateShmSlot *slotOf(const char *base, uint64_t index)
+{
+  const StateShmHeader *header = reinterpret_cast<const StateShmHeader*>(base);
+  return reinterpret_cast<const StateShmSlot*>(base + header->slots_offset + index * header->slot_size);
+}
+
+StateShmWriter::StateShmWriter() :
+  base_(NULL),
+  size_(0),
+  write_count_(0),
+  names_generation_(0),
+  names_written_(false)
+{
+}
+
+StateShmWriter::~StateShmWriter()
+{
+  close();
+}
+
+bool StateShmWriter::create(const std::string &name, uint32_t capacity,
+                            uint32_t slot_count, uint32_t name_size)
+{
+  close();
+  if (slot_count < 2 || name_size < 2)
+    return false;
+
+  const uint64_t names_offset = alignUp(sizeof(StateShmHeader));
+  const uint64_t slots_offset = names_offset + alignUp(sizeof(StateShmNames) +
+                                                       static_cast<uint64_t>(capacity) * name_size);
+  const uint64_t slot_size = alignUp(sizeof(StateShmSlot) + static_cast<uint64_t>(capacity) * 13 * sizeof(double));
+  const uint64_t size = slots_offset + slot_count * slot_size;
+
+  // readers of a previous segment keep their mapping, new ones get this one
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0)
+    return false;
+  if (ftruncate(fd, size) != 0)
+  {
+    ::close(fd);
+    shm_unlink(name.c_str());
+    return false;
+  }
+  void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED)
+  {
+    shm_unlink(name.c_str());
+    return false;
+  }
+
+  // the segment is zero filled, so all sequences start even and empty
+  base_ = static_cast<char*>(base);
+  size_ = size;
+  name_ = name;
+  write_count_ = 0;
+  names_written_ = false;
+
+  StateShmHeader *header = reinterpret_cast<StateShmHeader*>(base_);
+  header->version = STATE_SHM_VERSION;
+  header->capacity = capacity;
+  header->slot_count = slot_count;
+  header->name_size = name_size;
+  header->names_offset = names_offset;
+  header->slots_offset = slots_offset;
+  header->slot_size = slot_size;
+  header->write_count.store(0, std::memory_order_relaxed);
+  header->magic.store(STATE_SHM_MAGIC, std::memory_order_release);
+  return true;
+}
+
+void StateShmWriter::close()
+{
+  if (!base_)
+    return;
+  munmap(base_, size_);
+  shm_unlink(name_.c_str());
+  base_ = NULL;
+  size_ = 0;
+}
+
+void StateShmWriter::writeNames(uint32_t generation, const std::vector<std::string> &names, uint32_t count)
+{
+  const StateShmHeader *header = reinterpret_cast<const StateShmHeader*>(base_);
+  StateShmNames *table = const_cast<StateShmNames*>(namesOf(base_));
+  char *entries = reinterpret_cast<char*>(table + 1);
+
+  uint64_t seq = table->seq.load(std::memory_order_relaxed);
+  table->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  table->generation = generation;
+  table->count = count;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    char *entry = entries + static_cast<size_t>(i) * header->name_size;
+    size_t length = std::min<size_t>(names[i].size(), header->name_size - 1);
+    memcpy(entry, names[i].data(), length);
+    entry[length] = '\0';
+  }
+
+  table->seq.store(seq + 2, std::memory_order_release);
+  names_generation_ = generation;
+  names_written_ = true;
+}
+
+void StateShmWriter::write(int32_t sec, int32_t nsec, uint32_t generation,
+                           const std::vector<std::string> &names,
+                           const double *poses, const double *twists)
+{
+  if (!base_)
+    return;
+
+  StateShmHeader *header = reinterpret_cast<StateShmHeader*>(base_);
+  const uint32_t count = std::min<size_t>(names.size(), header->capacity);
+
+  // names go first, a reader matching a slot to them needs them to be there
+  if (!names_written_ || generation != names_generation_)
+    writeNames(generation, names, count);
+
+  StateShmSlot *slot = const_cast<StateShmSlot*>(slotOf(base_, write_count_ % header->slot_count));
+  double *slot_poses = reinterpret_cast<double*>(slot + 1);
+  double *slot_twists = slot_poses + static_cast<size_t>(header->capacity) * 7;
+
+  uint64_t seq = slot->seq.load(std::memory_order_relaxed);
+  slot->seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->generation = generation;
+  slot->count = count;
+  slot->sec = sec;
+  slot->nsec = nsec;
+  if (count > 0)
+  {
+    memcpy(slot_poses, poses, count * 7 * sizeof(double));
+    memcpy(slot_twists, twists, count * 6 * sizeof(double));
+  }
+
+  slot->seq.store(seq + 2, std::memory_order_release);
+  header->write_count.store(++write_count_, std::memory_order_release);
+}
+
+StateShmReader::StateShmReader() :
+  base_(NULL),
+  size_(0)
+{
+}
+
+StateShmReader::~StateShmReader()
+{
+  close();
+}
+
+bool StateShmReader::open(const std::string &name)
+{
+  close();
+  int fd = shm_open(name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(StateShmHeader))
+  {
+    ::close(fd);
+    return false;
+  }
+  void *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED)
+    return false;
+
+  const StateShmHeader *header = static_cast<const StateShmHeader*>(base);
+  if (header->magic.load(std::memory_order_acquire) != STATE_SHM_MAGIC ||
+      header->version != STATE_SHM_VERSION ||
+      header->slot_count == 0 ||
+      header->slots_offset + header->slot_count * header->slot_size > static_cast<uint64_t>(st.st_size))
+  {
+    munmap(base, st.st_size);
+    return false;
+  }
+
+  base_ = static_cast<const char*>(base);
+  size_ = st.st_size;
+  return true;
+}
+
+void StateShmReader::close()
+{
+  if (!base_)
+    return;
+  munmap(const_cast<char*>(base_), size_);
+  base_ = NULL;
+  size_ = 0;
+}
+
+uint64_t StateShmReader::writeCount() const
+{
+  if (!base_)
+    return 0;
+  return reinterpret_cast<const StateShmHeader*>(base_)->write_count.load(std::memory_order_acquire);
+}
+
+bool StateShmReader::readNames(uint32_t generation, StateShmState &state) const
+{
+  const StateShmHeader *header = reinterpret_cast<const StateShmHeader*>(base_);
+  const StateShmNames *table = namesOf(base_);
+  const char *entries = reinterpret_cast<const char*>(table + 1);
+
+  uint64_t seq = table->seq.load(std::memory_order_acquire);
+  if (seq & 1)
+    return false;
+  // a newer table means the slot was overwritten after we copied it
+  if (table->generation != generation)
+    return false;
+
+  uint32_t count = std::min(table->count, header->capacity);
+  state.names.resize(count);
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    const char *entry = entries + static_cast<size_t>(i) * header->name_size;
+    state.names[i].assign(entry, strnlen(entry, header->name_size));
+  }
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return table->seq.load(std::memory_order_relaxed) == seq;
+}
+
+bool StateShmReader::read(StateShmState &state) const
+{
+  if (!base_)
+    return false;
+  const StateShmHeader *header = reinterpret_cast<const StateShmHeader*>(base_);
+
+  for (int attempt = 0; attempt < 64; ++attempt)
+  {
+    uint64_t write_count = header->write_count.load(std::memory_order_acquire);
+    if (write_count == 0)
+      return false;
+
+    const StateShmSlot *slot = slotOf(base_, (write_count - 1) % header->slot_count);
+    const double *slot_poses = reinterpret_cast<const double*>(slot + 1);
+    const double *slot_twists = slot_poses + static_cast<size_t>(header->capacity) * 7;
+
+    uint64_t seq = slot->seq.load(std::memory_order_acquire);
+    if (seq & 1)
+      continue;
+
+    uint32_t generation = slot->generation;
+    uint32_t count = std::min(slot->count, header->capacity);
+    int32_t sec = slot->sec;
+    int32_t nsec = slot->nsec;
+    state.poses.resize(static_cast<size_t>(count) * 7);
+    state.twists.resize(static_cast<size_t>(count) * 6);
+    if (count > 0)
+    {
+      memcpy(&state.poses[0], slot_poses, count * 7 * sizeof(double));
+      memcpy(&state.twists[0], slot_twists, count * 6 * sizeof(double));
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->seq.load(std::memory_order_relaxed) != seq)
+      continue;
+
+    if (generation != state.generation || state.names.size() != count)
+    {
+      if (!readNames(generation, state) || state.names.size() != count)
+      {
+        // do not keep names of an unknown generation
+        state.names.clear();
+        continue;
+      }
+    }
+
+    state.write_count = write_count;
+    state.generation = generation;
+    state.sec = sec;
+    state.nsec = nsec;
+    return true;
+  }
+  return false;
+}
+
+}
@@ -0,0 +1,319 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <boost/bind.hpp>
+
+#include <ros/ros.h>
+
+#include <gazebo/gazebo_config.h>
+#include <gazebo_ros/gazebo_ros_state_snapshot.h>
+
+namespace gazebo
+{
+
+const unsigned int StateSnapshotEngine::MAX_STREAMS;
+
+StateStreamFilter::StateStreamFilter(const std::string &name_regex,
+                                     const std::vector<std::string> &names) :
+  has_regex_(!name_regex.empty()),
+  names_(names.begin(), names.end())
+{
+  if (has_regex_)
+    regex_.assign(name_regex);
+}
+
+bool StateStreamFilter::matches(const std::string &name) const
+{
+  if (names_.count(name))
+    return true;
+  return has_regex_ && std::regex_match(name, regex_);
+}
+
+StateSnapshotEngine::StateSnapshotEngine(Kind kind, gazebo::physics::WorldPtr world,
+                                         const PublishFunc &publish_func) :
+  kind_(kind),
+  world_(world),
+  publish_func_(publish_func),
+  generation_(0),
+  indexed_model_count_(0),
+  stale_(true),
+  back_(new StateSnapshot),
+  pending_(new StateSnapshot),
+  front_(new StateSnapshot),
+  pending_ready_(false),
+  stop_(false)
+{
+}
+
+StateSnapshotEngine::~StateSnapshotEngine()
+{
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_one();
+  if (thread_.joinable())
+    thread_.join();
+}
+
+void StateSnapshotEngine::invalidate()
+{
+  stale_ = true;
+}
+
+int StateSnapshotEngine::addStream(double rate,
+                                   const boost::shared_ptr<const StateStreamFilter> &filter)
+{
+  boost::mutex::scoped_lock lock(streams_mutex_);
+  if (streams_.size() >= MAX_STREAMS)
+  {
+    ROS_ERROR_NAMED("api_plugin", "Too many state streams, ignoring the %g Hz stream", rate);
+    return -1;
+  }
+  Stream stream;
+  stream.period = rate > 0.0 ? 1.0 / rate : 0.0;
+  stream.next_time = 0.0;
+  stream.subscribers = 0;
+  stream.filter = filter;
+  streams_.push_back(stream);
+  // resolve the filter with the next capture, which takes streams_mutex_
+  // after us and so can not see the stream before the flag
+  if (filter)
+    stale_ = true;
+  return streams_.size() - 1;
+}
+
+void StateSnapshotEngine::addSubscriber(unsigned int stream)
+{
+  {
+    // worlds nobody subscribes to do not get an idle publisher thread
+    boost::mutex::scoped_lock lock(mutex_);
+    if (!thread_.joinable() && !stop_)
+      thread_ = boost::thread(boost::bind(&StateSnapshotEngine::publisherThread, this));
+  }
+  boost::mutex::scoped_lock lock(streams_mutex_);
+  if (stream < streams_.size())
+    ++streams_[stream].subscribers;
+}
+
+void StateSnapshotEngine::removeSubscriber(unsigned int stream)
+{
+  boost::mutex::scoped_lock lock(streams_mutex_);
+  if (stream < streams_.size() && streams_[stream].subscribers > 0)
+    --streams_[stream].subscribers;
+}
+
+void StateSnapshotEngine::update()
+{
+#if GAZEBO_MAJOR_VERSION >= 8
+  double sim_time = world_->SimTime().Double();
+#else
+  double sim_time = world_->GetSimTime().Double();
+#endif
+
+  unsigned int due = 0;
+  {
+    boost::mutex::scoped_lock lock(streams_mutex_);
+    for (unsigned int i = 0; i < streams_.size(); ++i)
+    {
+      Stream &stream = streams_[i];
+      if (stream.subscribers <= 0)
+        continue;
+
+      // the world was reset, restart the decimation
+      if (sim_time < stream.next_time - stream.period)
+        stream.next_time = sim_time;
+      if (sim_time < stream.next_time)
+        continue;
+
+      due |= 1u << i;
+      // keep the average rate exact when the period is not a multiple of
+      // the physics step, unless we fell behind by more than a period
+      stream.next_time += stream.period;
+      if (stream.next_time <= sim_time)
+        stream.next_time = sim_time + stream.period;
+    }
+  }
+
+  if (due)
+    capture(due);
+}
+
+void StateSnapshotEngine::rebuildIndex()
+{
+  boost::shared_ptr<std::vector<std::string> > names(new std::vector<std::string>);
+  entities_.clear();
+
+#if GAZEBO_MAJOR_VERSION >= 8
+  unsigned int model_count = world_->ModelCount();
+#else
+  unsigned int model_count = world_->GetModelCount();
+#endif
+  for (unsigned int i = 0; i < model_count; i ++)
+  {
+#if GAZEBO_MAJOR_VERSION >= 8
+    gazebo::physics::ModelPtr model = world_->ModelByIndex(i);
+#else
+    gazebo::physics::ModelPtr model = world_->GetModel(i);
+#endif
+    if (!model)
+      continue;
+
+    if (kind_ == MODELS)
+    {
+      entities_.push_back(model);
+      names->push_back(model->GetName());
+      continue;
+    }
+
+    for (unsigned int j = 0 ; j < model->GetChildCount(); j ++)
+    {
+      gazebo::physics::LinkPtr body = boost::dynamic_pointer_cast<gazebo::physics::Link>(model->GetChild(j));
+      if (body)
+      {
+        entities_.push_back(body);
+        names->push_back(body->GetScopedName());
+      }
+    }
+  }
+
+  // resolve the stream filters against the new index
+  boost::shared_ptr<StateStreamSelections> selections(new StateStreamSelections);
+  {
+    boost::mutex::scoped_lock lock(streams_mutex_);
+    selections->resize(streams_.size());
+    for (unsigned int i = 0; i < streams_.size(); ++i)
+    {
+      if (!streams_[i].filter)
+        continue;
+      boost::shared_ptr<StateStreamSelection> selection(new StateStreamSelection);
+      for (unsigned int j = 0; j < names->size(); ++j)
+      {
+        if (streams_[i].filter->matches((*names)[j]))
+        {
+          selection->indices.push_back(j);
+          selection->names.push_back((*names)[j]);
+        }
+      }
+      (*selections)[i] = selection;
+    }
+  }
+
+  names_ = names;
+  selections_ = selections;
+  indexed_model_count_ = model_count;
+  ++generation_;
+}
+
+void StateSnapshotEngine::capture(unsigned int streams)
+{
+  // spawn and delete always change the model count, the explicit
+  // invalidation covers a model replaced within one step
+#if GAZEBO_MAJOR_VERSION >= 8
+  unsigned int model_count = world_->ModelCount();
+#else
+  unsigned int model_count = world_->GetModelCount();
+#endif
+  if (stale_.exchange(false) || model_count != indexed_model_count_)
+    rebuildIndex();
+
+  // a model deleted and another spawned outside of the ROS services keeps
+  // the count, the index is rebuilt once a deleted entity shows up
+  if (!copyStates(streams))
+  {
+    rebuildIndex();
+    copyStates(streams);
+  }
+
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    // a snapshot not yet taken is superseded, but its streams are still due
+    if (pending_ready_)
+      back_->streams |= pending_->streams;
+    back_.swap(pending_);
+    pending_ready_ = true;
+  }
+  cond_.notify_one();
+}
+
+bool StateSnapshotEngine::copyStates(unsigned int streams)
+{
+  StateSnapshot &snapshot = *back_;
+#if GAZEBO_MAJOR_VERSION >= 8
+  snapshot.sim_time = world_->SimTime();
+#else
+  snapshot.sim_time = world_->GetSimTime();
+#endif
+  snapshot.generation = generation_;
+  snapshot.streams = streams;
+  snapshot.names = names_;
+  snapshot.selections = selections_;
+  snapshot.poses.resize(entities_.size() * 7);
+  snapshot.twists.resize(entities_.size() * 6);
+
+  double *p = snapshot.poses.empty() ? NULL : &snapshot.poses[0];
+  double *t = snapshot.twists.empty() ? NULL : &snapshot.twists[0];
+  for (size_t i = 0; i < entities_.size(); ++i, p += 7, t += 6)
+  {
+    gazebo::physics::EntityPtr entity = entities_[i].lock();
+    if (!entity || !entity->GetWorld())
+      return false;
+#if GAZEBO_MAJOR_VERSION >= 8
+    const ignition::math::Pose3d &pose = entity->WorldPose();
+    ignition::math::Vector3d linear_vel = entity->WorldLinearVel();
+    ignition::math::Vector3d angular_vel = entity->WorldAngularVel();
+#else
+    ignition::math::Pose3d pose = entity->GetWorldPose().Ign();
+    ignition::math::Vector3d linear_vel = entity->GetWorldLinearVel().Ign();
+    ignition::math::Vector3d angular_vel = entity->GetWorldAngularVel().Ign();
+#endif
+    p[0] = pose.Pos().X();
+    p[1] = pose.Pos().Y();
+    p[2] = pose.Pos().Z();
+    p[3] = pose.Rot().X();
+    p[4] = pose.Rot().Y();
+    p[5] = pose.Rot().Z();
+    p[6] = pose.Rot().W();
+    t[0] = linear_vel.X();
+    t[1] = linear_vel.Y();
+    t[2] = linear_vel.Z();
+    t[3] = angular_vel.X();
+    t[4] = angular_vel.Y();
+    t[5] = angular_vel.Z();
+  }
+  return true;
+}
+
+void StateSnapshotEngine::publisherThread()
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  while (true)
+  {
+    while (!pending_ready_ && !stop_)
+      cond_.wait(lock);
+    if (stop_)
+      break;
+
+    front_.swap(pending_);
+    pending_ready_ = false;
+    lock.unlock();
+    publish_func_(*front_);
+    lock.lock();
+  }
+}
+
+}
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
+
+namespace gazebo
+{
+
+const unsigned int UpdateProfile::TRACE_SIZE;
+const unsigned int UpdateProfile::BUCKETS;
+
+UpdateProfile::UpdateProfile(const std::string &name)
+  : name_(name), total_ns_(0), max_ns_(0), trace_head_(0), reported_total_ns_(0)
+{
+  for (unsigned int i = 0; i < BUCKETS; ++i)
+  {
+    buckets_[i].store(0, std::memory_order_relaxed);
+    reported_buckets_[i] = 0;
+  }
+  for (unsigned int i = 0; i < TRACE_SIZE; ++i)
+  {
+    trace_[i].start_ns.store(0, std::memory_order_relaxed);
+    trace_[i].duration_ns.store(0, std::memory_order_relaxed);
+  }
+}
+
+int64_t UpdateProfile::now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+unsigned int UpdateProfile::bucket(int64_t ns)
+{
+  // durations below 8 ns get a bucket each, then 8 buckets per power of two
+  if (ns < 8)
+    return ns > 0 ? static_cast<unsigned int>(ns) : 0;
+  unsigned int msb = 63 - __builtin_clzll(static_cast<uint64_t>(ns));
+  unsigned int sub = static_cast<unsigned int>(ns >> (msb - 3)) & 7;
+  return msb * 8 + sub;
+}
+
+double UpdateProfile::bucketValue(unsigned int bucket)
+{
+  if (bucket < 8)
+    return bucket;
+  unsigned int msb = bucket / 8;
+  unsigned int sub = bucket % 8;
+  double width = static_cast<double>(1ull << (msb - 3));
+  return (8 + sub) * width + 0.5 * width;
+}
+
+void UpdateProfile::report(double period, gazebo_msgs::UpdateProfile &msg)
+{
+  uint32_t counts[BUCKETS];
+  uint64_t calls = 0;
+  for (unsigned int i = 0; i < BUCKETS; ++i)
+  {
+    uint32_t count = buckets_[i].load(std::memory_order_relaxed);
+    counts[i] = count - reported_buckets_[i];
+    reported_buckets_[i] = count;
+    calls += counts[i];
+  }
+  int64_t total_ns = total_ns_.load(std::memory_order_relaxed);
+  int64_t period_ns = total_ns - reported_total_ns_;
+  reported_total_ns_ = total_ns;
+
+  msg.name = name_;
+  msg.calls = calls;
+  msg.calls_per_second = period > 0.0 ? calls / period : 0.0;
+  msg.mean = calls > 0 ? 1e-9 * period_ns / calls : 0.0;
+  msg.max = 1e-9 * max_ns_.exchange(0, std::memory_order_relaxed);
+
+  // first buckets reaching 50% and 99% of the calls
+  msg.p50 = 0.0;
+  msg.p99 = 0.0;
+  uint64_t seen = 0;
+  bool p50_done = false;
+  for (unsigned int i = 0; i < BUCKETS && calls > 0; ++i)
+  {
+    seen += counts[i];
+    if (!p50_done && 2 * seen >= calls)
+    {
+      msg.p50 = 1e-9 * bucketValue(i);
+      p50_done = true;
+    }
+    if (100 * seen >= 99 * calls)
+    {
+      msg.p99 = 1e-9 * bucketValue(i);
+      break;
+    }
+  }
+  // the bucket middle may overshoot the largest call
+  msg.p50 = std::min(msg.p50, msg.max);
+  msg.p99 = std::min(msg.p99, msg.max);
+}
+
+void UpdateProfile::appendTrace(std::string &out) const
+{
+  // copy the ring, then drop the entries the writer may have overwritten
+  // while copying
+  uint64_t head = trace_head_.load(std::memory_order_acquire);
+  uint64_t begin = head > TRACE_SIZE ? head - TRACE_SIZE : 0;
+  std::vector<int64_t> starts;
+  std::vector<int64_t> durations;
+  starts.reserve(head - begin);
+  durations.reserve(head - begin);
+  for (uint64_t i = begin; i < head; ++i)
+  {
+    const TraceEvent &event = trace_[i % TRACE_SIZE];
+    starts.push_back(event.start_ns.load(std::memory_order_relaxed));
+    durations.push_back(event.duration_ns.load(std::memory_order_relaxed));
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t after = trace_head_.load(std::memory_order_relaxed);
+  uint64_t valid = after > TRACE_SIZE ? after - TRACE_SIZE : 0;
+
+  std::string name;
+  for (size_t k = 0; k < name_.size(); ++k)
+  {
+    char c = name_[k];
+    if (c == '"' || c == '\\')
+      name += '\\';
+    if (static_cast<unsigned char>(c) >= 0x20)
+      name += c;
+  }
+
+  char buffer[128];
+  for (uint64_t i = std::max(begin, valid); i < head; ++i)
+  {
+    if (!out.empty())
+      out += ",\n";
+    // Chrome trace timestamps are in microseconds
+    snprintf(buffer, sizeof(buffer), "\"ts\":%.3f,\"dur\":%.3f",
+             1e-3 * starts[i - begin], 1e-3 * durations[i - begin]);
+    out += "{\"name\":\"" + name + "\",\"cat\":\"world_update\",\"ph\":\"X\",\"pid\":1,\"tid\":1,";
+    out += buffer;
+    out += "}";
+  }
+}
+
+UpdateProfiler::UpdateProfiler()
+  : enabled_(false), last_report_ns_(UpdateProfile::now())
+{
+  const char *env = getenv("GAZEBO_ROS_PROFILE");
+  enabled_ = env && atoi(env) != 0;
+}
+
+UpdateProfiler &UpdateProfiler::instance()
+{
+  static UpdateProfiler profiler;
+  return profiler;
+}
+
+UpdateProfile *UpdateProfiler::registerProfile(const std::string &name)
+{
+  if (!enabled_)
+    return NULL;
+
+  boost::mutex::scoped_lock lock(mutex_);
+  for (size_t i = 0; i < profiles_.size(); ++i)
+    if (profiles_[i]->name() == name)
+      return profiles_[i].get();
+  profiles_.push_back(boost::shared_ptr<UpdateProfile>(new UpdateProfile(name)));
+  return profiles_.back().get();
+}
+
+void UpdateProfiler::report(gazebo_msgs::UpdateProfiles &msg)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  int64_t now = UpdateProfile::now();
+  msg.period = 1e-9 * (now - last_report_ns_);
+  last_report_ns_ = now;
+
+  msg.profiles.resize(profiles_.size());
+  for (size_t i = 0; i < profiles_.size(); ++i)
+    profiles_[i]->report(msg.period, msg.profiles[i]);
+}
+
+std::string UpdateProfiler::chromeTrace() const
+{
+  std::string events;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    for (size_t i = 0; i < profiles_.size(); ++i)
+      profiles_[i]->appendTrace(events);
+  }
+  return "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" + events + "\n]}\n";
+}
+
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright 2018 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gazebo/gazebo_config.h>
+#include <gazebo_ros/gazebo_ros_world_snapshot.h>
+
+namespace gazebo
+{
+
+void WorldSnapshot::capture(const gazebo::physics::WorldPtr &world)
+{
+#if GAZEBO_MAJOR_VERSION >= 8
+  sim_time = world->SimTime();
+  const std::string physics_type = world->Physics()->GetType();
+  unsigned int model_count = world->ModelCount();
+#else
+  sim_time = world->GetSimTime();
+  const std::string physics_type = world->GetPhysicsEngine()->GetType();
+  unsigned int model_count = world->GetModelCount();
+#endif
+  // in maximal coordinates the joint states follow from the link states
+  reduced_coordinates_ = physics_type != "ode" && physics_type != "bullet";
+
+  model_count_ = 0;
+  links_.clear();
+  link_names_.clear();
+  link_poses_.clear();
+  link_twists_.clear();
+  joints_.clear();
+  joint_names_.clear();
+  joint_axes_.clear();
+  joint_positions_.clear();
+  joint_velocities_.clear();
+
+  for (unsigned int i = 0; i < model_count; i ++)
+  {
+#if GAZEBO_MAJOR_VERSION >= 8
+    gazebo::physics::ModelPtr model = world->ModelByIndex(i);
+#else
+    gazebo::physics::ModelPtr model = world->GetModel(i);
+#endif
+    if (!model)
+      continue;
+    ++model_count_;
+
+    for (unsigned int j = 0 ; j < model->GetChildCount(); j ++)
+    {
+      gazebo::physics::LinkPtr body = boost::dynamic_pointer_cast<gazebo::physics::Link>(model->GetChild(j));
+      if (!body)
+        continue;
+#if GAZEBO_MAJOR_VERSION >= 8
+      const ignition::math::Pose3d &pose = body->WorldPose();
+      ignition::math::Vector3d linear_vel = body->WorldLinearVel();
+      ignition::math::Vector3d angular_vel = body->WorldAngularVel();
+#else
+      ignition::math::Pose3d pose = body->GetWorldPose().Ign();
+      ignition::math::Vector3d linear_vel = body->GetWorldLinearVel().Ign();
+      ignition::math::Vector3d angular_vel = body->GetWorldAngularVel().Ign();
+#endif
+      links_.push_back(body);
+      link_names_.push_back(body->GetScopedName());
+      link_poses_.push_back(pose.Pos().X());
+      link_poses_.push_back(pose.Pos().Y());
+      link_poses_.push_back(pose.Pos().Z());
+      link_poses_.push_back(pose.Rot().X());
+      link_poses_.push_back(pose.Rot().Y());
+      link_poses_.push_back(pose.Rot().Z());
+      link_poses_.push_back(pose.Rot().W());
+      link_twists_.push_back(linear_vel.X());
+      link_twists_.push_back(linear_vel.Y());
+      link_twists_.push_back(linear_vel.Z());
+      link_twists_.push_back(angular_vel.X());
+      link_twists_.push_back(angular_vel.Y());
+      link_twists_.push_back(angular_vel.Z());
+    }
+
+    const gazebo::physics::Joint_V &joints = model->GetJoints();
+    for (size_t j = 0; j < joints.size(); ++j)
+    {
+      const gazebo::physics::JointPtr &joint = joints[j];
+      joints_.push_back(joint);
+      joint_names_.push_back(joint->GetScopedName());
+      joint_axes_.push_back(joint_positions_.size());
+#if GAZEBO_MAJOR_VERSION >= 8
+      for (unsigned int axis = 0; axis < joint->DOF(); ++axis)
+        joint_positions_.push_back(joint->Position(axis));
+      for (unsigned int axis = 0; axis < joint->DOF(); ++axis)
+        joint_velocities_.push_back(joint->GetVelocity(axis));
+#else
+      for (unsigned int axis = 0; axis < joint->GetAngleCount(); ++axis)
+        joint_positions_.push_back(joint->GetAngle(axis).Radian());
+      for (unsigned int axis = 0; axis < joint->GetAngleCount(); ++axis)
+        joint_velocities_.push_back(joint->GetVelocity(axis));
+#endif
+    }
+  }
+}
+
+bool WorldSnapshot::restore(std::string &missing) const
+{
+  // check every entity first, a snapshot is restored entirely or not at all.
+  // A deleted entity may outlive its model for a while, Fini() detaches it
+  // from the world though.
+  std::vector<gazebo::physics::LinkPtr> links(links_.size());
+  for (size_t i = 0; i < links_.size(); ++i)
+  {
+    links[i] = links_[i].lock();
+    if (!links[i] || !links[i]->GetWorld())
+    {
+      missing = link_names_[i];
+      return false;
+    }
+  }
+  std::vector<gazebo::physics::JointPtr> joints;
+  if (reduced_coordinates_)
+  {
+    joints.resize(joints_.size());
+    for (size_t i = 0; i < joints_.size(); ++i)
+    {
+      joints[i] = joints_[i].lock();
+      if (!joints[i] || !joints[i]->GetWorld())
+      {
+        missing = joint_names_[i];
+        return false;
+      }
+    }
+  }
+
+  const double *p = link_poses_.empty() ? NULL : &link_poses_[0];
+  const double *t = link_twists_.empty() ? NULL : &link_twists_[0];
+  for (size_t i = 0; i < links.size(); ++i, p += 7, t += 6)
+  {
+    links[i]->SetWorldPose(ignition::math::Pose3d(p[0], p[1], p[2], p[6], p[3], p[4], p[5]));
+    links[i]->SetLinearVel(ignition::math::Vector3d(t[0], t[1], t[2]));
+    links[i]->SetAngularVel(ignition::math::Vector3d(t[3], t[4], t[5]));
+  }
+
+  for (size_t i = 0; i < joints.size(); ++i)
+  {
+    const unsigned int first = joint_axes_[i];
+    const unsigned int last = i + 1 < joint_axes_.size() ? joint_axes_[i + 1] : joint_positions_.size();
+    for (unsigned int axis = 0; first + axis < last; ++axis)
+    {
+      joints[i]->SetPosition(axis, joint_positions_[first + axis]);
+      joints[i]->SetVelocity(axis, joint_velocities_[first + axis]);
+    }
+  }
+  return true;
+}
+
+void WorldSnapshot::toMsg(gazebo_msgs::WorldState &msg) const
+{
+  msg.header.stamp = ros::Time(sim_time.sec, sim_time.nsec);
+  msg.header.frame_id = "world";
+  msg.name = link_names_;
+  msg.pose.resize(links_.size());
+  msg.twist.resize(links_.size());
+  msg.wrench.assign(links_.size(), geometry_msgs::Wrench());
+  for (size_t i = 0; i < links_.size(); ++i)
+  {
+    const double *p = &link_poses_[i * 7];
+    const double *t = &link_twists_[i * 6];
+    geometry_msgs::Pose &pose = msg.pose[i];
+    pose.position.x = p[0];
+    pose.position.y = p[1];
+    pose.position.z = p[2];
+    pose.orientation.x = p[3];
+    pose.orientation.y = p[4];
+    pose.orientation.z = p[5];
+    pose.orientation.w = p[6];
+    geometry_msgs::Twist &twist = msg.twist[i];
+    twist.linear.x = t[0];
+    twist.linear.y = t[1];
+    twist.linear.z = t[2];
+    twist.angular.x = t[3];
+    twist.angular.y = t[4];
+    twist.angular.z = t[5];
+  }
+}
+
+void WorldSnapshotStore::setCapacity(unsigned int capacity)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  capacity_ = capacity;
+  evict(capacity_);
+}
+
+bool WorldSnapshotStore::put(const std::string &id, const boost::shared_ptr<const WorldSnapshot> &snapshot)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  if (capacity_ == 0)
+    return false;
+  // make room unless the id replaces an existing snapshot
+  if (!snapshots_.count(id))
+    evict(capacity_ - 1);
+  Entry &entry = snapshots_[id];
+  entry.snapshot = snapshot;
+  entry.last_use = ++uses_;
+  return true;
+}
+
+boost::shared_ptr<const WorldSnapshot> WorldSnapshotStore::get(const std::string &id)
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  std::map<std::string, Entry>::iterator it = snapshots_.find(id);
+  if (it == snapshots_.end())
+    return boost::shared_ptr<const WorldSnapshot>();
+  it->second.last_use = ++uses_;
+  return it->second.snapshot;
+}
+
+size_t WorldSnapshotStore::size() const
+{
+  boost::mutex::scoped_lock lock(mutex_);
+  return snapshots_.size();
+}
+
+void WorldSnapshotStore::evict(size_t size)
+{
+  // the store holds a handful of snapshots, a scan for the oldest is enough
+  while (snapshots_.size() > size)
+  {
+    std::map<std::string, Entry>::iterator oldest = snapshots_.begin();
+    for (std::map<std::string, Entry>::iterator it = snapshots_.begin(); it != snapshots_.end(); ++it)
+      if (it->second.last_use < oldest->second.last_use)
+        oldest = it;
+    snapshots_.erase(oldest);
+  }
+}
+
+}
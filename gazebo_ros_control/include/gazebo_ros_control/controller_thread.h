@@ -0,0 +1,248 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Open Source Robotics Foundation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Open Source Robotics Foundation
+ *     nor the names of its contributors may be
+ *     used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:   Runs the controller manager of a gazebo_ros_control robot on its own thread,
+           exchanging joint states and commands with the physics thread through snapshots
+*/
+
+#ifndef _GAZEBO_ROS_CONTROL___CONTROLLER_THREAD_H_
+#define _GAZEBO_ROS_CONTROL___CONTROLLER_THREAD_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Boost
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+// ROS
+#include <ros/ros.h>
+
+// ros_control
+#include <controller_manager/controller_manager.h>
+#include <hardware_interface/joint_command_interface.h>
+#include <hardware_interface/joint_state_interface.h>
+#include <hardware_interface/robot_hw.h>
+
+// gazebo_ros_control
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
+#include <gazebo_ros_control/robot_hw_sim.h>
+
+namespace gazebo_ros_control
+{
+
+/// \brief Latest value handed from one writer thread to one reader thread, without locks
+///
+/// Each side works on a buffer of its own, a third one holds the latest published value
+/// and is swapped in by publish() and update(). The writer never waits for the reader and
+/// the reader always gets the most recent complete value, older ones are skipped.
+template <typename T>
+class SnapshotBuffer
+{
+public:
+  SnapshotBuffer() : back_(0), middle_(1), front_(2) {}
+
+  /// \brief Set all buffers, before the threads start
+  void assign(const T& value)
+  {
+    buffers_[0] = buffers_[1] = buffers_[2] = value;
+  }
+
+  /// \brief Buffer of the writer
+  T& back() { return buffers_[back_]; }
+
+  /// \brief Hand the buffer of the writer over to the reader
+  void publish()
+  {
+    back_ = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel) & INDEX;
+  }
+
+  /// \brief Whether a value was published since the reader last took one
+  bool fresh() const
+  {
+    return middle_.load(std::memory_order_acquire) & FRESH;
+  }
+
+  /// \brief Take the latest published value as the buffer of the reader
+  /// \return false if nothing was published since the last call, front() is unchanged then
+  bool update()
+  {
+    if (!fresh())
+      return false;
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+    return true;
+  }
+
+  /// \brief Buffer of the reader
+  const T& front() const { return buffers_[front_]; }
+
+private:
+  static const unsigned int INDEX = 3;
+  static const unsigned int FRESH = 4;
+
+  T buffers_[3];
+  unsigned int back_;
+  std::atomic<unsigned int> middle_;
+  unsigned int front_;
+};
+
+/// \brief Runs a controller manager on a thread of its own
+///
+/// The controller manager is built on a mirror of the joint interfaces of the RobotHWSim
+/// instead of the RobotHWSim itself. At each control tick the physics thread hands the
+/// joint states read by readSim() over to the controller thread and applies the latest
+/// commands the controllers computed, writeSim() keeps running on the physics thread.
+///
+/// Without lockstep the physics thread never waits: it applies whichever commands are
+/// the latest and the controllers always work on the latest state. A controller cycle that
+/// is not done by the next control tick misses its deadline.
+///
+/// With lockstep the commands computed from the state of one control tick are applied at
+/// the next one, and the physics thread waits for them when the cycle is not done yet. The
+/// controllers then lag one control period behind, as on a real robot, but the simulation
+/// is reproducible whatever the time the controllers take.
+///
+/// A cycle is passed the time since the previous cycle as period, which spans the control
+/// ticks it skipped.
+class ControllerThread
+{
+public:
+  /// \brief Runs the controllers, ControllerManager::update() or a stand-in for it
+  typedef boost::function<void (const ros::Time&, const ros::Duration&, bool)> UpdateFunc;
+
+  ControllerThread();
+
+  ~ControllerThread();
+
+  /// \brief Mirror the joint interfaces of a RobotHWSim
+  /// \param name name of the robot, for the log and the update profiler
+  /// \return false if the RobotHWSim registers interfaces other than the joint state,
+  /// effort, position and velocity joint interfaces, which cannot be mirrored
+  bool init(RobotHWSim* robot_hw_sim, const std::string& name, bool lockstep);
+
+  /// \brief Hardware to build the controller manager on
+  hardware_interface::RobotHW* hardware() { return &hardware_; }
+
+  /// \brief Start running the controller manager
+  void start(const boost::shared_ptr<controller_manager::ControllerManager>& controller_manager);
+
+  /// \brief Start running an update function on the mirror, in place of a controller manager
+  void start(const UpdateFunc& update_func);
+
+  /// \brief Stop the thread, waits for the cycle in progress
+  void stop();
+
+  /// \brief Called by the physics thread at each control tick, after readSim()
+  ///
+  /// Applies the commands of the latest completed cycle to the RobotHWSim and hands the
+  /// joint states over to the controllers.
+  void update(const ros::Time& time, const ros::Duration& period, bool reset_controllers);
+
+  /// \brief Cycles run by the controller thread
+  uint64_t cycles() const { return completed_cycle_.load(std::memory_order_relaxed); }
+
+  /// \brief Control ticks at which the cycle of the previous tick was not done
+  uint64_t missedDeadlines() const { return missed_deadlines_; }
+
+private:
+  // Joint states at a control tick, position, velocity and effort of each joint
+  struct State
+  {
+    ros::Time time;
+    ros::Duration period;
+    uint64_t cycle;
+    std::vector<double> joints;
+  };
+
+  // Commands computed from the state of a cycle
+  struct Commands
+  {
+    uint64_t cycle;
+    std::vector<double> joints;
+  };
+
+  // Register mirrors of the handles of a command interface of the RobotHWSim
+  template <typename Interface>
+  bool mirrorCommandInterface(RobotHWSim* robot_hw_sim, Interface* mirror);
+
+  void run();
+
+  std::string name_;
+  bool lockstep_;
+
+  // Handles into the RobotHWSim, used by the physics thread
+  std::vector<hardware_interface::JointStateHandle> sim_states_;
+  std::vector<hardware_interface::JointHandle> sim_commands_;
+
+  // Mirror the controllers run on, used by the controller thread
+  hardware_interface::RobotHW hardware_;
+  hardware_interface::JointStateInterface js_interface_;
+  hardware_interface::EffortJointInterface ej_interface_;
+  hardware_interface::PositionJointInterface pj_interface_;
+  hardware_interface::VelocityJointInterface vj_interface_;
+  std::vector<double> joint_states_;
+  std::vector<double> joint_commands_;
+
+  SnapshotBuffer<State> states_;
+  SnapshotBuffer<Commands> commands_;
+
+  boost::shared_ptr<controller_manager::ControllerManager> controller_manager_;
+  UpdateFunc update_func_;
+  boost::thread thread_;
+
+  // Wake ups only, the snapshots themselves are exchanged without the mutex
+  boost::mutex mutex_;
+  boost::condition_variable state_ready_;
+  boost::condition_variable commands_ready_;
+  std::atomic<bool> stop_;
+
+  std::atomic<bool> reset_controllers_;
+  uint64_t published_cycle_;
+  std::atomic<uint64_t> completed_cycle_;
+  uint64_t missed_deadlines_;
+  std::atomic<int64_t> last_latency_ns_;
+  int64_t max_latency_ns_;
+
+  // Controller cycle durations, NULL unless profiling is enabled
+  gazebo::UpdateProfile* profile_;
+};
+
+}
+
+#endif // #ifndef _GAZEBO_ROS_CONTROL___CONTROLLER_THREAD_H_
@@ -75,6 +75,15 @@ class DefaultRobotHWSim : public gazebo_ros_control::RobotHWSim
 {
 public:
 
+  DefaultRobotHWSim() : params_loaded_(false) {}
+
+  // Read the joint limits and PID gains, initSim() reads them itself if this was not called
+  virtual bool loadSimParams(
+    const std::string& robot_namespace,
+    ros::NodeHandle model_nh,
+    const urdf::Model *const urdf_model,
+    const std::vector<transmission_interface::TransmissionInfo>& transmissions);
+
   virtual bool initSim(
     const std::string& robot_namespace,
     ros::NodeHandle model_nh,
@@ -92,6 +101,35 @@ protected:
   // Methods used to control a joint.
   enum ControlMethod {EFFORT, POSITION, POSITION_PID, VELOCITY, VELOCITY_PID};
 
+  // Limits of a joint from the URDF, overridden by the parameter server
+  struct JointLimitsData
+  {
+    JointLimitsData() : joint_type(urdf::Joint::UNKNOWN), has_limits(false), has_soft_limits(false) {}
+
+    int joint_type;
+    joint_limits_interface::JointLimits limits;
+    bool has_limits;
+    joint_limits_interface::SoftJointLimits soft_limits;
+    bool has_soft_limits;
+  };
+
+  // Read the limits of the joint specified by joint_name from the URDF, if urdf_model is not
+  // NULL, and from joint_limit_nh.
+  void loadJointLimits(const std::string& joint_name,
+                       const ros::NodeHandle& joint_limit_nh,
+                       const urdf::Model *const urdf_model,
+                       JointLimitsData *const data);
+
+  // Register the limits read by loadJointLimits() for the joint specified by joint_name and
+  // joint_handle. Return the joint's type, lower position limit, upper position limit, and
+  // effort limit.
+  void registerJointLimits(const std::string& joint_name,
+                           const hardware_interface::JointHandle& joint_handle,
+                           const ControlMethod ctrl_method,
+                           const JointLimitsData& data,
+                           int *const joint_type, double *const lower_limit,
+                           double *const upper_limit, double *const effort_limit);
+
   // Register the limits of the joint specified by joint_name and joint_handle. The limits are
   // retrieved from joint_limit_nh. If urdf_model is not NULL, limits are retrieved from it also.
   // Return the joint's type, lower position limit, upper position limit, and effort limit.
@@ -124,6 +162,11 @@ protected:
   std::vector<double> joint_effort_limits_;
   std::vector<ControlMethod> joint_control_methods_;
   std::vector<control_toolbox::Pid> pid_controllers_;
+
+  // Parameters read by loadSimParams(), by transmission
+  bool params_loaded_;
+  std::vector<JointLimitsData> joint_limits_data_;
+  std::vector<bool> has_pid_gains_;
   std::vector<double> joint_position_;
   std::vector<double> joint_velocity_;
   std::vector<double> joint_effort_;
@@ -134,8 +177,22 @@ protected:
 
   std::vector<gazebo::physics::JointPtr> sim_joints_;
 
+  // Joints grouped at init, so that readSim() and writeSim() run one tight loop per group
+  // instead of dispatching on the type and control method of every joint
+  std::vector<unsigned int> linear_joints_;   // prismatic, positions read as is
+  std::vector<unsigned int> angular_joints_;  // positions unwrapped
+  std::vector<unsigned int> effort_joints_;
+  std::vector<unsigned int> position_joints_;
+  std::vector<unsigned int> position_pid_joints_;
+  std::vector<unsigned int> velocity_joints_;
+  std::vector<unsigned int> velocity_pid_joints_;
+
   std::string physics_type_;
 
+  // Velocity commands go through Joint::SetVelocity() rather than the "vel" joint parameter,
+  // resolved from physics_type_ once
+  bool set_velocity_directly_;
+
   // e_stop_active_ is true if the emergency stop is active.
   bool e_stop_active_, last_e_stop_active_;
 };
@@ -39,6 +39,8 @@
            using pluginlib
 */
 
+#include <atomic>
+
 // Boost
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
@@ -52,9 +54,13 @@
 #include <gazebo/gazebo.hh>
 #include <gazebo/physics/physics.hh>
 #include <gazebo/common/common.hh>
+#include <gazebo_ros/gazebo_ros_model_descriptions.h>
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
 
 // ros_control
+#include <gazebo_ros_control/controller_thread.h>
 #include <gazebo_ros_control/robot_hw_sim.h>
+#include <gazebo_ros_control/robot_hw_sim_fleet.h>
 #include <controller_manager/controller_manager.h>
 #include <transmission_interface/transmission_parser.h>
 
@@ -65,6 +71,8 @@ class GazeboRosControlPlugin : public gazebo::ModelPlugin
 {
 public:
 
+  GazeboRosControlPlugin();
+
   virtual ~GazeboRosControlPlugin();
 
   // Overloaded Gazebo entry point
@@ -76,7 +84,8 @@ public:
   // Called on world reset
   virtual void Reset();
 
-  // Get the URDF XML from the parameter server
+  // Get the URDF XML from the plugin SDF, from the spawn request of the model with
+  // <useSpawnedDescription>, or from the parameter server, waiting for the parameter to be set
   std::string getURDF(std::string param_name) const;
 
   // Get Transmissions from the URDF
@@ -85,6 +94,10 @@ public:
 protected:
   void eStopCB(const std_msgs::BoolConstPtr& e_stop_active);
 
+  // Get the URDF, build the RobotHWSim and the controller manager and connect to the world update,
+  // on the Gazebo load thread or on deferred_load_thread_ with <asyncLoad>
+  void loadRobot(const std::string& robot_ns, bool deferred);
+
   // Node Handles
   ros::NodeHandle model_nh_; // namespaces to robot name
 
@@ -95,6 +108,9 @@ protected:
   // deferred load in case ros is blocking
   boost::thread deferred_load_thread_;
 
+  // set on unload, stops waiting for the URDF
+  std::atomic<bool> unloading_;
+
   // Pointer to the update event connection
   gazebo::event::ConnectionPtr update_connection_;
 
@@ -116,6 +132,12 @@ protected:
   // Controller manager
   boost::shared_ptr<controller_manager::ControllerManager> controller_manager_;
 
+  // Runs the controller manager with <controlThread>, NULL when it runs on the physics thread
+  boost::shared_ptr<ControllerThread> controller_thread_;
+
+  // Fleet the robot joined with <fleet>, which then runs the controllers instead of the plugin
+  boost::shared_ptr<RobotHWSimFleet> fleet_;
+
   // Timing
   ros::Duration control_period_;
   ros::Time last_update_sim_time_ros_;
@@ -71,6 +71,23 @@ namespace gazebo_ros_control {
 
     virtual ~RobotHWSim() { }
 
+    /// \brief Read the parameters of the simulated robot hardware
+    ///
+    /// Called before initSim() without the physics update mutex, so that parameter server round
+    /// trips do not stall the simulation. The default implementation of this function does nothing.
+    ///
+    /// \param robot_namespace  Robot namespace.
+    /// \param model_nh  Model node handle.
+    /// \param urdf_model  URDF model.
+    /// \param transmissions  Transmissions.
+    ///
+    /// \return  \c true if the parameters are read successfully, \c false if not.
+    virtual bool loadSimParams(
+        const std::string& robot_namespace,
+        ros::NodeHandle model_nh,
+        const urdf::Model *const urdf_model,
+        const std::vector<transmission_interface::TransmissionInfo>& transmissions) { return true; }
+
     /// \brief Initialize the simulated robot hardware
     ///
     /// Initialize the simulated robot hardware.
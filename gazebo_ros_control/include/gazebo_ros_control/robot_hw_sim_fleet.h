@@ -0,0 +1,180 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Open Source Robotics Foundation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Open Source Robotics Foundation
+ *     nor the names of its contributors may be
+ *     used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:   Robots of several gazebo_ros_control plugins simulated through one RobotHW and
+           controlled by one controller manager
+*/
+
+#ifndef _GAZEBO_ROS_CONTROL___ROBOT_HW_SIM_FLEET_H_
+#define _GAZEBO_ROS_CONTROL___ROBOT_HW_SIM_FLEET_H_
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+// Boost
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+
+// ROS
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <std_msgs/Bool.h>
+
+// Gazebo
+#include <gazebo/common/common.hh>
+#include <gazebo/physics/physics.hh>
+
+// ros_control
+#include <controller_manager/controller_manager.h>
+#include <hardware_interface/joint_command_interface.h>
+#include <hardware_interface/joint_state_interface.h>
+#include <hardware_interface/robot_hw.h>
+
+// gazebo_ros_control
+#include <gazebo_ros_control/robot_hw_sim.h>
+
+namespace gazebo_ros_control
+{
+
+/// \brief Robots sharing one controller manager and one world update
+///
+/// Plugins with <fleet>name</fleet> add their RobotHWSim to the fleet of that name instead
+/// of building a controller manager and connecting to the world update of their own. The
+/// fleet mirrors the joint interfaces of every robot under the names <robot>/<joint> and
+/// runs one controller manager, in the namespace of the fleet, on the mirror. Controllers
+/// are namespaced by robot, e.g. /agvs/agv_3/diff_drive_controller claiming the joints
+/// agv_3/left_wheel and agv_3/right_wheel.
+///
+/// At each step the fleet reads all robots, copies their states to the mirror in one pass,
+/// updates the controllers, copies the commands back and writes all robots.
+class RobotHWSimFleet
+{
+public:
+  /// \brief Fleet of a name, created for the first robot that joins it
+  ///
+  /// The fleet steps on the world update of the world its robots are in.
+  /// \param control_period period of the controllers, the first robot decides it
+  /// \param e_stop_topic emergency stop topic of the fleet, empty for none, the first robot
+  /// decides it
+  static boost::shared_ptr<RobotHWSimFleet> get(const std::string& name,
+                                                const ros::Duration& control_period,
+                                                const std::string& e_stop_topic);
+
+  ~RobotHWSimFleet();
+
+  /// \brief Add the joints of a robot, once the pending controller manager requests are done
+  /// \param robot name of the robot, prefixed to its joint names
+  void add(const std::string& robot, const boost::shared_ptr<RobotHWSim>& robot_hw_sim);
+
+  /// \brief Stop reading and writing a robot
+  ///
+  /// Its handles stay registered, a robot joining again under the same name gets them back.
+  void remove(const RobotHWSim* robot_hw_sim);
+
+  /// \brief Reset the timing, on world reset
+  void reset();
+
+private:
+  // A robot of the fleet and the slots of its joints in the mirror
+  struct Robot
+  {
+    std::string name;
+    boost::shared_ptr<RobotHWSim> robot_hw_sim;
+    std::vector<hardware_interface::JointStateHandle> states;
+    std::vector<unsigned int> state_slots;
+    std::vector<hardware_interface::JointHandle> commands;
+    std::vector<unsigned int> command_slots;
+  };
+
+  RobotHWSimFleet(const std::string& name, const ros::Duration& control_period,
+                  const std::string& e_stop_topic);
+
+  // Mirror the joints of a robot, on the service thread
+  void addRobot(const std::string& robot, const boost::shared_ptr<RobotHWSim>& robot_hw_sim);
+
+  // Mirror the handles of a command interface of a robot
+  template <typename Interface>
+  void mirrorCommandInterface(RobotHWSim* robot_hw_sim, Interface* mirror, Robot& robot);
+
+  // Called by the world update start event
+  void update(const gazebo::common::UpdateInfo& info);
+
+  // Serves the controller manager services and the robots joining, one at a time
+  void serviceThread();
+
+  void eStopCB(const std_msgs::BoolConstPtr& e_stop_active);
+
+  std::string name_;
+  std::string e_stop_topic_;
+
+  ros::NodeHandle nh_;
+  ros::CallbackQueue callback_queue_;
+  boost::thread service_thread_;
+  ros::Subscriber e_stop_sub_;
+
+  // Mirror of the joint interfaces of all robots, the controllers run on it. The deques keep
+  // the values in place when robots join.
+  hardware_interface::RobotHW hardware_;
+  hardware_interface::JointStateInterface js_interface_;
+  hardware_interface::EffortJointInterface ej_interface_;
+  hardware_interface::PositionJointInterface pj_interface_;
+  hardware_interface::VelocityJointInterface vj_interface_;
+  std::deque<double> joint_states_;
+  std::deque<double> joint_commands_;
+  std::map<std::string, unsigned int> state_slots_;
+  std::map<std::string, unsigned int> command_slots_;
+
+  // Guards robots_ and the growth of the deques against the world update
+  boost::mutex robots_mutex_;
+  std::vector<Robot> robots_;
+
+  boost::shared_ptr<controller_manager::ControllerManager> controller_manager_;
+  gazebo::event::ConnectionPtr update_connection_;
+
+  // Timing
+  ros::Duration control_period_;
+  ros::Time last_update_sim_time_ros_;
+  ros::Time last_write_sim_time_ros_;
+
+  std::atomic<bool> e_stop_active_;
+  bool last_e_stop_active_;
+};
+
+}
+
+#endif // #ifndef _GAZEBO_ROS_CONTROL___ROBOT_HW_SIM_FLEET_H_
@@ -0,0 +1,289 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Open Source Robotics Foundation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Open Source Robotics Foundation
+ *     nor the names of its contributors may be
+ *     used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:   Runs the controller manager of a gazebo_ros_control robot on its own thread
+*/
+
+// Boost
+#include <boost/bind.hpp>
+
+#include <gazebo_ros_control/controller_thread.h>
+#include <hardware_interface/internal/demangle_symbol.h>
+
+namespace gazebo_ros_control
+{
+
+ControllerThread::ControllerThread()
+  : lockstep_(false),
+    stop_(false),
+    reset_controllers_(false),
+    published_cycle_(0),
+    completed_cycle_(0),
+    missed_deadlines_(0),
+    last_latency_ns_(0),
+    max_latency_ns_(0),
+    profile_(NULL)
+{
+}
+
+ControllerThread::~ControllerThread()
+{
+  stop();
+}
+
+bool ControllerThread::init(RobotHWSim* robot_hw_sim, const std::string& name, bool lockstep)
+{
+  using namespace hardware_interface;
+  name_ = name;
+  lockstep_ = lockstep;
+
+  // Only the joint interfaces are known well enough to be copied between the threads
+  const std::vector<std::string> interfaces = robot_hw_sim->getNames();
+  for (size_t i = 0; i < interfaces.size(); ++i)
+  {
+    if (interfaces[i] != internal::demangledTypeName<JointStateInterface>() &&
+        interfaces[i] != internal::demangledTypeName<EffortJointInterface>() &&
+        interfaces[i] != internal::demangledTypeName<PositionJointInterface>() &&
+        interfaces[i] != internal::demangledTypeName<VelocityJointInterface>())
+    {
+      ROS_WARN_STREAM_NAMED("gazebo_ros_control", "The robot simulation interface of [" << name_
+        << "] registers a " << interfaces[i] << ", which cannot be run on a controller thread.");
+      return false;
+    }
+  }
+
+  JointStateInterface* js_interface = robot_hw_sim->get<JointStateInterface>();
+  if (!js_interface)
+    return false;
+  const std::vector<std::string> joint_names = js_interface->getNames();
+
+  // The handles point into these, they are not resized afterwards
+  joint_states_.resize(3 * joint_names.size());
+  for (size_t j = 0; j < joint_names.size(); ++j)
+  {
+    sim_states_.push_back(js_interface->getHandle(joint_names[j]));
+    js_interface_.registerHandle(JointStateHandle(joint_names[j], &joint_states_[3 * j],
+                                                  &joint_states_[3 * j + 1], &joint_states_[3 * j + 2]));
+  }
+  hardware_.registerInterface(&js_interface_);
+
+  size_t n_commands = 0;
+  if (robot_hw_sim->get<EffortJointInterface>())
+    n_commands += robot_hw_sim->get<EffortJointInterface>()->getNames().size();
+  if (robot_hw_sim->get<PositionJointInterface>())
+    n_commands += robot_hw_sim->get<PositionJointInterface>()->getNames().size();
+  if (robot_hw_sim->get<VelocityJointInterface>())
+    n_commands += robot_hw_sim->get<VelocityJointInterface>()->getNames().size();
+  joint_commands_.reserve(n_commands);
+
+  try
+  {
+    if (!mirrorCommandInterface(robot_hw_sim, &ej_interface_) ||
+        !mirrorCommandInterface(robot_hw_sim, &pj_interface_) ||
+        !mirrorCommandInterface(robot_hw_sim, &vj_interface_))
+      return false;
+  }
+  catch (const HardwareInterfaceException& ex)
+  {
+    // a command handle of a joint without a state handle
+    ROS_WARN_STREAM_NAMED("gazebo_ros_control", "Could not mirror the joint interfaces of ["
+      << name_ << "]: " << ex.what());
+    return false;
+  }
+
+  State state;
+  state.cycle = 0;
+  state.joints = joint_states_;
+  states_.assign(state);
+  Commands commands;
+  commands.cycle = 0;
+  commands.joints = joint_commands_;
+  commands_.assign(commands);
+
+  profile_ = gazebo::UpdateProfiler::instance().registerProfile("gazebo_ros_control/" + name_ + "/controllers");
+  return true;
+}
+
+template <typename Interface>
+bool ControllerThread::mirrorCommandInterface(RobotHWSim* robot_hw_sim, Interface* mirror)
+{
+  Interface* interface = robot_hw_sim->get<Interface>();
+  if (!interface)
+    return true;
+
+  const std::vector<std::string> joint_names = interface->getNames();
+  for (size_t j = 0; j < joint_names.size(); ++j)
+  {
+    hardware_interface::JointHandle handle = interface->getHandle(joint_names[j]);
+    sim_commands_.push_back(handle);
+    // the controllers start from the commands the RobotHWSim was initialized with
+    joint_commands_.push_back(handle.getCommand());
+    mirror->registerHandle(hardware_interface::JointHandle(js_interface_.getHandle(joint_names[j]),
+                                                           &joint_commands_.back()));
+  }
+  hardware_.registerInterface(mirror);
+  return true;
+}
+
+void ControllerThread::start(const boost::shared_ptr<controller_manager::ControllerManager>& controller_manager)
+{
+  controller_manager_ = controller_manager;
+  start(boost::bind(&controller_manager::ControllerManager::update, controller_manager.get(), _1, _2, _3));
+}
+
+void ControllerThread::start(const UpdateFunc& update_func)
+{
+  update_func_ = update_func;
+  thread_ = boost::thread(boost::bind(&ControllerThread::run, this));
+  ROS_INFO_NAMED("gazebo_ros_control", "Running the controllers of [%s] on their own thread%s.",
+                 name_.c_str(), lockstep_ ? ", in lockstep with the physics" : "");
+}
+
+void ControllerThread::stop()
+{
+  if (!thread_.joinable())
+    return;
+  {
+    boost::mutex::scoped_lock lock(mutex_);
+    stop_ = true;
+  }
+  state_ready_.notify_all();
+  commands_ready_.notify_all();
+  thread_.join();
+
+  ROS_INFO_NAMED("gazebo_ros_control", "Controller thread of [%s] ran %lu cycles, missed %lu "
+    "deadlines, longest cycle %.3f ms.", name_.c_str(), (unsigned long)cycles(),
+    (unsigned long)missed_deadlines_, max_latency_ns_ * 1e-6);
+}
+
+void ControllerThread::update(const ros::Time& time, const ros::Duration& period, bool reset_controllers)
+{
+  // The cycle handed over at the previous tick should be done by now
+  if (completed_cycle_.load(std::memory_order_acquire) < published_cycle_)
+  {
+    ++missed_deadlines_;
+    ROS_WARN_THROTTLE_NAMED(5.0, "gazebo_ros_control", "The controllers of [%s] missed %lu of %lu "
+      "deadlines, the latest cycle took %.3f ms.", name_.c_str(), (unsigned long)missed_deadlines_,
+      (unsigned long)published_cycle_, last_latency_ns_.load(std::memory_order_relaxed) * 1e-6);
+
+    if (lockstep_)
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while (!stop_ && completed_cycle_.load(std::memory_order_acquire) < published_cycle_)
+        commands_ready_.wait(lock);
+    }
+  }
+
+  // Apply the commands of the latest completed cycle, writeSim() sends them to the joints
+  if (commands_.update())
+  {
+    const std::vector<double>& commands = commands_.front().joints;
+    for (size_t k = 0; k < sim_commands_.size(); ++k)
+      sim_commands_[k].setCommand(commands[k]);
+  }
+
+  // A reset is kept until a cycle runs, the state it came with may be skipped
+  if (reset_controllers)
+    reset_controllers_ = true;
+
+  State& state = states_.back();
+  state.time = time;
+  state.period = period;
+  state.cycle = ++published_cycle_;
+  double* joints = state.joints.empty() ? NULL : &state.joints[0];
+  for (size_t j = 0; j < sim_states_.size(); ++j, joints += 3)
+  {
+    joints[0] = sim_states_[j].getPosition();
+    joints[1] = sim_states_[j].getVelocity();
+    joints[2] = sim_states_[j].getEffort();
+  }
+  states_.publish();
+
+  {
+    // pairs with the check of the waiting controller thread, so that the wake up is not lost
+    boost::mutex::scoped_lock lock(mutex_);
+  }
+  state_ready_.notify_one();
+}
+
+void ControllerThread::run()
+{
+  ros::Time last_cycle_time;
+  while (true)
+  {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while (!stop_ && !states_.fresh())
+        state_ready_.wait(lock);
+      if (stop_)
+        return;
+    }
+
+    states_.update();
+    const State& state = states_.front();
+    joint_states_ = state.joints;
+
+    // Without lockstep the states of the ticks the previous cycle overran are skipped, the
+    // controllers integrate over the time since they last ran. The first cycle and the one
+    // after a world reset take the control period.
+    ros::Duration period = state.period;
+    if (!last_cycle_time.isZero() && state.time > last_cycle_time)
+      period = state.time - last_cycle_time;
+    last_cycle_time = state.time;
+
+    const int64_t start_ns = gazebo::UpdateProfile::now();
+    update_func_(state.time, period, reset_controllers_.exchange(false));
+    const int64_t latency_ns = gazebo::UpdateProfile::now() - start_ns;
+
+    Commands& commands = commands_.back();
+    commands.cycle = state.cycle;
+    commands.joints = joint_commands_;
+    commands_.publish();
+
+    if (profile_)
+      profile_->record(start_ns, latency_ns);
+    last_latency_ns_.store(latency_ns, std::memory_order_relaxed);
+    if (latency_ns > max_latency_ns_)
+      max_latency_ns_ = latency_ns;
+
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      completed_cycle_.store(state.cycle, std::memory_order_release);
+    }
+    commands_ready_.notify_one();
+  }
+}
+
+}
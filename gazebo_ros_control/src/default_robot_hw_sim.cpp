@@ -51,23 +51,69 @@ double clamp(const double val, const double min_val, const double max_val)
   return std::min(std::max(val, min_val), max_val);
 }
 
+// True for the hardware interfaces whose joints may be driven by a PID controller
+bool hasPidControl(const std::string& hardware_interface)
+{
+  return hardware_interface == "PositionJointInterface" ||
+         hardware_interface == "hardware_interface/PositionJointInterface" ||
+         hardware_interface == "VelocityJointInterface" ||
+         hardware_interface == "hardware_interface/VelocityJointInterface";
+}
+
 }
 
 namespace gazebo_ros_control
 {
 
 
-bool DefaultRobotHWSim::initSim(
+bool DefaultRobotHWSim::loadSimParams(
   const std::string& robot_namespace,
   ros::NodeHandle model_nh,
-  gazebo::physics::ModelPtr parent_model,
   const urdf::Model *const urdf_model,
-  std::vector<transmission_interface::TransmissionInfo> transmissions)
+  const std::vector<transmission_interface::TransmissionInfo>& transmissions)
 {
   // getJointLimits() searches joint_limit_nh for joint limit parameters. The format of each
   // parameter's name is "joint_limits/<joint name>". An example is "joint_limits/axle_joint".
   const ros::NodeHandle joint_limit_nh(model_nh);
 
+  joint_limits_data_.assign(transmissions.size(), JointLimitsData());
+  has_pid_gains_.assign(transmissions.size(), false);
+  pid_controllers_.resize(transmissions.size());
+  for(unsigned int j=0; j < transmissions.size(); j++)
+  {
+    // initSim() warns about the transmissions it skips
+    if(transmissions[j].joints_.size() != 1)
+      continue;
+    const std::string& joint_name = transmissions[j].joints_[0].name_;
+    loadJointLimits(joint_name, joint_limit_nh, urdf_model, &joint_limits_data_[j]);
+
+    std::vector<std::string> joint_interfaces = transmissions[j].joints_[0].hardware_interfaces_;
+    if (joint_interfaces.empty() && !transmissions[j].actuators_.empty())
+      joint_interfaces = transmissions[j].actuators_[0].hardware_interfaces_;
+    if (joint_interfaces.empty() || !hasPidControl(joint_interfaces.front()))
+      continue;
+
+    // If no PID gain values are found, initSim() controls the joint with joint->SetAngle() or
+    // joint->SetParam("vel").
+    const ros::NodeHandle nh(robot_namespace + "/gazebo_ros_control/pid_gains/" + joint_name);
+    has_pid_gains_[j] = pid_controllers_[j].init(nh);
+  }
+
+  params_loaded_ = true;
+  return true;
+}
+
+bool DefaultRobotHWSim::initSim(
+  const std::string& robot_namespace,
+  ros::NodeHandle model_nh,
+  gazebo::physics::ModelPtr parent_model,
+  const urdf::Model *const urdf_model,
+  std::vector<transmission_interface::TransmissionInfo> transmissions)
+{
+  // Read the parameters here, unless the plugin read them before it took the physics update mutex
+  if (!params_loaded_ || joint_limits_data_.size() != transmissions.size())
+    loadSimParams(robot_namespace, model_nh, urdf_model, transmissions);
+
   // Resize vectors to our DOF
   n_dof_ = transmissions.size();
   joint_names_.resize(n_dof_);
@@ -76,13 +122,30 @@ bool DefaultRobotHWSim::initSim(
   joint_upper_limits_.resize(n_dof_);
   joint_effort_limits_.resize(n_dof_);
   joint_control_methods_.resize(n_dof_);
-  pid_controllers_.resize(n_dof_);
   joint_position_.resize(n_dof_);
   joint_velocity_.resize(n_dof_);
   joint_effort_.resize(n_dof_);
   joint_effort_command_.resize(n_dof_);
   joint_position_command_.resize(n_dof_);
   joint_velocity_command_.resize(n_dof_);
+  sim_joints_.resize(n_dof_);
+
+  // get physics engine type
+#if GAZEBO_MAJOR_VERSION >= 8
+  gazebo::physics::PhysicsEnginePtr physics = gazebo::physics::get_world()->Physics();
+#else
+  gazebo::physics::PhysicsEnginePtr physics = gazebo::physics::get_world()->GetPhysicsEngine();
+#endif
+  physics_type_ = physics->GetType();
+  if (physics_type_.empty())
+  {
+    ROS_WARN_STREAM_NAMED("default_robot_hw_sim", "No physics type found.");
+  }
+#if GAZEBO_MAJOR_VERSION > 2
+  set_velocity_directly_ = physics_type_ == "dart";
+#else
+  set_velocity_directly_ = true;
+#endif
 
   // Initialize values
   for(unsigned int j=0; j < n_dof_; j++)
@@ -195,31 +258,17 @@ bool DefaultRobotHWSim::initSim(
         << "\" which is not in the gazebo model.");
       return false;
     }
-    sim_joints_.push_back(joint);
-
-    // get physics engine type
-#if GAZEBO_MAJOR_VERSION >= 8
-    gazebo::physics::PhysicsEnginePtr physics = gazebo::physics::get_world()->Physics();
-#else
-    gazebo::physics::PhysicsEnginePtr physics = gazebo::physics::get_world()->GetPhysicsEngine();
-#endif
-    physics_type_ = physics->GetType();
-    if (physics_type_.empty())
-    {
-      ROS_WARN_STREAM_NAMED("default_robot_hw_sim", "No physics type found.");
-    }
+    sim_joints_[j] = joint;
 
     registerJointLimits(joint_names_[j], joint_handle, joint_control_methods_[j],
-                        joint_limit_nh, urdf_model,
+                        joint_limits_data_[j],
                         &joint_types_[j], &joint_lower_limits_[j], &joint_upper_limits_[j],
                         &joint_effort_limits_[j]);
     if (joint_control_methods_[j] != EFFORT)
     {
-      // Initialize the PID controller. If no PID gain values are found, use joint->SetAngle() or
-      // joint->SetParam("vel") to control the joint.
-      const ros::NodeHandle nh(robot_namespace + "/gazebo_ros_control/pid_gains/" +
-                               joint_names_[j]);
-      if (pid_controllers_[j].init(nh))
+      // Use the PID controller initialized by loadSimParams(). If no PID gain values were found,
+      // use joint->SetAngle() or joint->SetParam("vel") to control the joint.
+      if (has_pid_gains_[j])
       {
         switch (joint_control_methods_[j])
         {
@@ -245,6 +294,37 @@ bool DefaultRobotHWSim::initSim(
     }
   }
 
+  // Group the joints, skipped transmissions have no gazebo joint
+  for(unsigned int j=0; j < n_dof_; j++)
+  {
+    if (!sim_joints_[j])
+      continue;
+
+    if (joint_types_[j] == urdf::Joint::PRISMATIC)
+      linear_joints_.push_back(j);
+    else
+      angular_joints_.push_back(j);
+
+    switch (joint_control_methods_[j])
+    {
+      case EFFORT:
+        effort_joints_.push_back(j);
+        break;
+      case POSITION:
+        position_joints_.push_back(j);
+        break;
+      case POSITION_PID:
+        position_pid_joints_.push_back(j);
+        break;
+      case VELOCITY:
+        velocity_joints_.push_back(j);
+        break;
+      case VELOCITY_PID:
+        velocity_pid_joints_.push_back(j);
+        break;
+    }
+  }
+
   // Register interfaces
   registerInterface(&js_interface_);
   registerInterface(&ej_interface_);
@@ -260,23 +340,27 @@ bool DefaultRobotHWSim::initSim(
 
 void DefaultRobotHWSim::readSim(ros::Time time, ros::Duration period)
 {
-  for(unsigned int j=0; j < n_dof_; j++)
+  // Gazebo has an interesting API...
+  for(size_t i=0; i < linear_joints_.size(); i++)
   {
-    // Gazebo has an interesting API...
+    const unsigned int j = linear_joints_[i];
 #if GAZEBO_MAJOR_VERSION >= 8
-    double position = sim_joints_[j]->Position(0);
+    joint_position_[j] = sim_joints_[j]->Position(0);
 #else
-    double position = sim_joints_[j]->GetAngle(0).Radian();
+    joint_position_[j] = sim_joints_[j]->GetAngle(0).Radian();
 #endif
-    if (joint_types_[j] == urdf::Joint::PRISMATIC)
-    {
-      joint_position_[j] = position;
-    }
-    else
-    {
-      joint_position_[j] += angles::shortest_angular_distance(joint_position_[j],
-                            position);
-    }
+    joint_velocity_[j] = sim_joints_[j]->GetVelocity(0);
+    joint_effort_[j] = sim_joints_[j]->GetForce((unsigned int)(0));
+  }
+  for(size_t i=0; i < angular_joints_.size(); i++)
+  {
+    const unsigned int j = angular_joints_[i];
+#if GAZEBO_MAJOR_VERSION >= 8
+    const double position = sim_joints_[j]->Position(0);
+#else
+    const double position = sim_joints_[j]->GetAngle(0).Radian();
+#endif
+    joint_position_[j] += angles::shortest_angular_distance(joint_position_[j], position);
     joint_velocity_[j] = sim_joints_[j]->GetVelocity(0);
     joint_effort_[j] = sim_joints_[j]->GetForce((unsigned int)(0));
   }
@@ -306,83 +390,86 @@ void DefaultRobotHWSim::writeSim(ros::Time time, ros::Duration period)
   vj_sat_interface_.enforceLimits(period);
   vj_limits_interface_.enforceLimits(period);
 
-  for(unsigned int j=0; j < n_dof_; j++)
+  for(size_t i=0; i < effort_joints_.size(); i++)
   {
-    switch (joint_control_methods_[j])
-    {
-      case EFFORT:
-        {
-          const double effort = e_stop_active_ ? 0 : joint_effort_command_[j];
-          sim_joints_[j]->SetForce(0, effort);
-        }
-        break;
+    const unsigned int j = effort_joints_[i];
+    sim_joints_[j]->SetForce(0, e_stop_active_ ? 0 : joint_effort_command_[j]);
+  }
 
-      case POSITION:
+  if (!position_joints_.empty())
+  {
+#if GAZEBO_MAJOR_VERSION < 9
+    ROS_WARN_ONCE("The default_robot_hw_sim plugin is using the Joint::SetPosition method without preserving the link velocity.");
+    ROS_WARN_ONCE("As a result, gravity will not be simulated correctly for your model.");
+    ROS_WARN_ONCE("Please set gazebo_pid parameters, switch to the VelocityJointInterface or EffortJointInterface, or upgrade to Gazebo 9.");
+    ROS_WARN_ONCE("For details, see https://github.com/ros-simulation/gazebo_ros_pkgs/issues/612");
+#endif
+    for(size_t i=0; i < position_joints_.size(); i++)
+    {
+      const unsigned int j = position_joints_[i];
 #if GAZEBO_MAJOR_VERSION >= 9
-        sim_joints_[j]->SetPosition(0, joint_position_command_[j], true);
+      sim_joints_[j]->SetPosition(0, joint_position_command_[j], true);
 #else
-        ROS_WARN_ONCE("The default_robot_hw_sim plugin is using the Joint::SetPosition method without preserving the link velocity.");
-        ROS_WARN_ONCE("As a result, gravity will not be simulated correctly for your model.");
-        ROS_WARN_ONCE("Please set gazebo_pid parameters, switch to the VelocityJointInterface or EffortJointInterface, or upgrade to Gazebo 9.");
-        ROS_WARN_ONCE("For details, see https://github.com/ros-simulation/gazebo_ros_pkgs/issues/612");
-        sim_joints_[j]->SetPosition(0, joint_position_command_[j]);
+      sim_joints_[j]->SetPosition(0, joint_position_command_[j]);
 #endif
-        break;
+    }
+  }
 
-      case POSITION_PID:
-        {
-          double error;
-          switch (joint_types_[j])
-          {
-            case urdf::Joint::REVOLUTE:
-              angles::shortest_angular_distance_with_limits(joint_position_[j],
-                                                            joint_position_command_[j],
-                                                            joint_lower_limits_[j],
-                                                            joint_upper_limits_[j],
-                                                            error);
-              break;
-            case urdf::Joint::CONTINUOUS:
-              error = angles::shortest_angular_distance(joint_position_[j],
-                                                        joint_position_command_[j]);
-              break;
-            default:
-              error = joint_position_command_[j] - joint_position_[j];
-          }
-
-          const double effort_limit = joint_effort_limits_[j];
-          const double effort = clamp(pid_controllers_[j].computeCommand(error, period),
-                                      -effort_limit, effort_limit);
-          sim_joints_[j]->SetForce(0, effort);
-        }
+  for(size_t i=0; i < position_pid_joints_.size(); i++)
+  {
+    const unsigned int j = position_pid_joints_[i];
+    double error;
+    switch (joint_types_[j])
+    {
+      case urdf::Joint::REVOLUTE:
+        angles::shortest_angular_distance_with_limits(joint_position_[j],
+                                                      joint_position_command_[j],
+                                                      joint_lower_limits_[j],
+                                                      joint_upper_limits_[j],
+                                                      error);
+        break;
+      case urdf::Joint::CONTINUOUS:
+        error = angles::shortest_angular_distance(joint_position_[j],
+                                                  joint_position_command_[j]);
         break;
+      default:
+        error = joint_position_command_[j] - joint_position_[j];
+    }
 
-      case VELOCITY:
+    const double effort_limit = joint_effort_limits_[j];
+    const double effort = clamp(pid_controllers_[j].computeCommand(error, period),
+                                -effort_limit, effort_limit);
+    sim_joints_[j]->SetForce(0, effort);
+  }
+
+  if (set_velocity_directly_)
+  {
+    for(size_t i=0; i < velocity_joints_.size(); i++)
+    {
+      const unsigned int j = velocity_joints_[i];
+      sim_joints_[j]->SetVelocity(0, e_stop_active_ ? 0 : joint_velocity_command_[j]);
+    }
+  }
+  else
+  {
 #if GAZEBO_MAJOR_VERSION > 2
-        if (physics_type_.compare("dart") == 0)
-        {
-          sim_joints_[j]->SetVelocity(0, e_stop_active_ ? 0 : joint_velocity_command_[j]);
-        }
-        else 
-        {
-          sim_joints_[j]->SetParam("vel", 0, e_stop_active_ ? 0 : joint_velocity_command_[j]);
-        }
-#else
-        sim_joints_[j]->SetVelocity(0, e_stop_active_ ? 0 : joint_velocity_command_[j]);
+    const std::string vel("vel");
+    for(size_t i=0; i < velocity_joints_.size(); i++)
+    {
+      const unsigned int j = velocity_joints_[i];
+      sim_joints_[j]->SetParam(vel, 0, e_stop_active_ ? 0 : joint_velocity_command_[j]);
+    }
 #endif
-        break;
+  }
 
-      case VELOCITY_PID:
-        double error;
-        if (e_stop_active_)
-          error = -joint_velocity_[j];
-        else
-          error = joint_velocity_command_[j] - joint_velocity_[j];
-        const double effort_limit = joint_effort_limits_[j];
-        const double effort = clamp(pid_controllers_[j].computeCommand(error, period),
-                                    -effort_limit, effort_limit);
-        sim_joints_[j]->SetForce(0, effort);
-        break;
-    }
+  for(size_t i=0; i < velocity_pid_joints_.size(); i++)
+  {
+    const unsigned int j = velocity_pid_joints_[i];
+    const double error = (e_stop_active_ ? 0 : joint_velocity_command_[j]) - joint_velocity_[j];
+    const double effort_limit = joint_effort_limits_[j];
+    const double effort = clamp(pid_controllers_[j].computeCommand(error, period),
+                                -effort_limit, effort_limit);
+    sim_joints_[j]->SetForce(0, effort);
   }
 }
 
@@ -402,34 +489,55 @@ void DefaultRobotHWSim::registerJointLimits(const std::string& joint_name,
                          int *const joint_type, double *const lower_limit,
                          double *const upper_limit, double *const effort_limit)
 {
-  *joint_type = urdf::Joint::UNKNOWN;
-  *lower_limit = -std::numeric_limits<double>::max();
-  *upper_limit = std::numeric_limits<double>::max();
-  *effort_limit = std::numeric_limits<double>::max();
-
-  joint_limits_interface::JointLimits limits;
-  bool has_limits = false;
-  joint_limits_interface::SoftJointLimits soft_limits;
-  bool has_soft_limits = false;
+  JointLimitsData data;
+  loadJointLimits(joint_name, joint_limit_nh, urdf_model, &data);
+  registerJointLimits(joint_name, joint_handle, ctrl_method, data,
+                      joint_type, lower_limit, upper_limit, effort_limit);
+}
 
+// Read the limits of the joint specified by joint_name from the URDF, if urdf_model is not NULL,
+// and from joint_limit_nh.
+void DefaultRobotHWSim::loadJointLimits(const std::string& joint_name,
+                                        const ros::NodeHandle& joint_limit_nh,
+                                        const urdf::Model *const urdf_model,
+                                        JointLimitsData *const data)
+{
   if (urdf_model != NULL)
   {
     const urdf::JointConstSharedPtr urdf_joint = urdf_model->getJoint(joint_name);
     if (urdf_joint != NULL)
     {
-      *joint_type = urdf_joint->type;
+      data->joint_type = urdf_joint->type;
       // Get limits from the URDF file.
-      if (joint_limits_interface::getJointLimits(urdf_joint, limits))
-        has_limits = true;
-      if (joint_limits_interface::getSoftJointLimits(urdf_joint, soft_limits))
-        has_soft_limits = true;
+      if (joint_limits_interface::getJointLimits(urdf_joint, data->limits))
+        data->has_limits = true;
+      if (joint_limits_interface::getSoftJointLimits(urdf_joint, data->soft_limits))
+        data->has_soft_limits = true;
     }
   }
   // Get limits from the parameter server.
-  if (joint_limits_interface::getJointLimits(joint_name, joint_limit_nh, limits))
-    has_limits = true;
+  if (joint_limits_interface::getJointLimits(joint_name, joint_limit_nh, data->limits))
+    data->has_limits = true;
+}
+
+// Register the limits read by loadJointLimits() for the joint specified by joint_name and
+// joint_handle. Return the joint's type, lower position limit, upper position limit, and effort
+// limit.
+void DefaultRobotHWSim::registerJointLimits(const std::string& joint_name,
+                         const hardware_interface::JointHandle& joint_handle,
+                         const ControlMethod ctrl_method,
+                         const JointLimitsData& data,
+                         int *const joint_type, double *const lower_limit,
+                         double *const upper_limit, double *const effort_limit)
+{
+  *joint_type = data.joint_type;
+  *lower_limit = -std::numeric_limits<double>::max();
+  *upper_limit = std::numeric_limits<double>::max();
+  *effort_limit = std::numeric_limits<double>::max();
 
-  if (!has_limits)
+  const joint_limits_interface::JointLimits& limits = data.limits;
+  const joint_limits_interface::SoftJointLimits& soft_limits = data.soft_limits;
+  if (!data.has_limits)
     return;
 
   if (*joint_type == urdf::Joint::UNKNOWN)
@@ -457,7 +565,7 @@ void DefaultRobotHWSim::registerJointLimits(const std::string& joint_name,
   if (limits.has_effort_limits)
     *effort_limit = limits.max_effort;
 
-  if (has_soft_limits)
+  if (data.has_soft_limits)
   {
     switch (ctrl_method)
     {
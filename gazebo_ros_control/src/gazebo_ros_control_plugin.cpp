@@ -48,10 +48,26 @@
 namespace gazebo_ros_control
 {
 
+GazeboRosControlPlugin::GazeboRosControlPlugin()
+  : unloading_(false)
+{
+}
+
 GazeboRosControlPlugin::~GazeboRosControlPlugin()
 {
+  // Stop a deferred load still waiting for the URDF, it connects the update event when done
+  unloading_ = true;
+  if (deferred_load_thread_.joinable())
+    deferred_load_thread_.join();
+
   // Disconnect from gazebo events
   update_connection_.reset();
+
+  if (fleet_)
+    fleet_->remove(robot_hw_sim_.get());
+
+  if (controller_thread_)
+    controller_thread_->stop();
 }
 
 // Overloaded Gazebo entry point
@@ -164,7 +180,7 @@ void GazeboRosControlPlugin::Load(gazebo::physics::ModelPtr parent, sdf::Element
   // Initialize the emergency stop code.
   e_stop_active_ = false;
   last_e_stop_active_ = false;
-  if (sdf_->HasElement("eStopTopic"))
+  if (sdf_->HasElement("eStopTopic") && !sdf_->HasElement("fleet"))
   {
     const std::string e_stop_topic = sdf_->GetElement("eStopTopic")->Get<std::string>();
     e_stop_sub_ = model_nh_.subscribe(e_stop_topic, 1, &GazeboRosControlPlugin::eStopCB, this);
@@ -172,15 +188,36 @@ void GazeboRosControlPlugin::Load(gazebo::physics::ModelPtr parent, sdf::Element
 
   ROS_INFO_NAMED("gazebo_ros_control", "Starting gazebo_ros_control plugin in namespace: %s", robot_namespace_.c_str());
 
-  // Read urdf from ros parameter server then
+  // Waiting for the URDF and building the controllers takes a while, with many robots the
+  // Gazebo load thread would serialize all of them
+  if (sdf_->HasElement("asyncLoad") && sdf_->Get<bool>("asyncLoad"))
+  {
+    deferred_load_thread_ = boost::thread(boost::bind(&GazeboRosControlPlugin::loadRobot, this, robot_ns, true));
+    return;
+  }
+  loadRobot(robot_ns, false);
+}
+
+// Get the URDF, build the RobotHWSim and the controller manager and connect to the world update
+void GazeboRosControlPlugin::loadRobot(const std::string& robot_ns, bool deferred)
+{
+  ros::WallTime start = ros::WallTime::now();
+
+  // Read urdf from the plugin, the spawn request or the ros parameter server then
   // setup actuators and mechanism control node.
   // This call will block if ROS is not properly initialized.
   const std::string urdf_string = getURDF(robot_description_);
+  if (urdf_string.empty())
+  {
+    // unloaded while waiting
+    return;
+  }
   if (!parseTransmissionsFromURDF(urdf_string))
   {
     ROS_ERROR_NAMED("gazebo_ros_control", "Error parsing URDF in gazebo_ros_control plugin, plugin not active.\n");
     return;
   }
+  ros::WallTime urdf_time = ros::WallTime::now();
 
   // Load the RobotHWSim abstraction to interface the controllers with the gazebo model
   try
@@ -194,22 +231,86 @@ void GazeboRosControlPlugin::Load(gazebo::physics::ModelPtr parent, sdf::Element
     urdf::Model urdf_model;
     const urdf::Model *const urdf_model_ptr = urdf_model.initString(urdf_string) ? &urdf_model : NULL;
 
-    if(!robot_hw_sim_->initSim(robot_ns, model_nh_, parent_model_, urdf_model_ptr, transmissions_))
+    // Parameter server round trips, before the physics update mutex is taken
+    if(!robot_hw_sim_->loadSimParams(robot_ns, model_nh_, urdf_model_ptr, transmissions_))
+    {
+      ROS_FATAL_NAMED("gazebo_ros_control","Could not read the parameters of the robot simulation interface");
+      return;
+    }
+
+    {
+      // off the load thread, keep the physics from stepping the joints being set up
+#if GAZEBO_MAJOR_VERSION >= 8
+      boost::recursive_mutex::scoped_lock lock(*parent_model_->GetWorld()->Physics()->GetPhysicsUpdateMutex(),
+                                               boost::defer_lock);
+#else
+      boost::recursive_mutex::scoped_lock lock(*parent_model_->GetWorld()->GetPhysicsEngine()->GetPhysicsUpdateMutex(),
+                                               boost::defer_lock);
+#endif
+      if (deferred)
+        lock.lock();
+      if(!robot_hw_sim_->initSim(robot_ns, model_nh_, parent_model_, urdf_model_ptr, transmissions_))
+      {
+        ROS_FATAL_NAMED("gazebo_ros_control","Could not initialize robot simulation interface");
+        return;
+      }
+    }
+    ros::WallTime hw_sim_time = ros::WallTime::now();
+
+    // Robots of a fleet share the controller manager and the world update of the fleet
+    if (sdf_->HasElement("fleet"))
     {
-      ROS_FATAL_NAMED("gazebo_ros_control","Could not initialize robot simulation interface");
+      const std::string e_stop_topic = sdf_->HasElement("eStopTopic") ?
+        sdf_->GetElement("eStopTopic")->Get<std::string>() : std::string();
+      fleet_ = RobotHWSimFleet::get(sdf_->Get<std::string>("fleet"), control_period_, e_stop_topic);
+      if (sdf_->HasElement("controlThread") && sdf_->Get<bool>("controlThread"))
+        ROS_WARN_NAMED("gazebo_ros_control", "Ignoring <controlThread> of [%s], the controllers of the fleet [%s] "
+                       "run on the physics thread.", parent_model_->GetName().c_str(),
+                       sdf_->Get<std::string>("fleet").c_str());
+      std::string robot = robot_namespace_;
+      if (!robot.empty() && robot[0] == '/')
+        robot.erase(0, 1);
+      fleet_->add(robot, robot_hw_sim_);
+
+      ROS_INFO_NAMED("gazebo_ros_control", "Started gazebo_ros_control for [%s] in fleet [%s] in %.1f ms.",
+        parent_model_->GetName().c_str(), sdf_->Get<std::string>("fleet").c_str(),
+        (ros::WallTime::now() - start).toSec() * 1000.0);
       return;
     }
 
+    // Slow controllers would stall the physics of every robot, they may run on their own thread
+    if (sdf_->HasElement("controlThread") && sdf_->Get<bool>("controlThread"))
+    {
+      const bool lockstep = sdf_->HasElement("controlLockstep") && sdf_->Get<bool>("controlLockstep");
+      controller_thread_.reset(new ControllerThread());
+      if (!controller_thread_->init(robot_hw_sim_.get(), parent_model_->GetName(), lockstep))
+      {
+        ROS_WARN_NAMED("gazebo_ros_control", "Running the controllers of [%s] on the physics thread.",
+                       parent_model_->GetName().c_str());
+        controller_thread_.reset();
+      }
+    }
+
     // Create the controller manager
     ROS_DEBUG_STREAM_NAMED("ros_control_plugin","Loading controller_manager");
     controller_manager_.reset
-      (new controller_manager::ControllerManager(robot_hw_sim_.get(), model_nh_));
+      (new controller_manager::ControllerManager(controller_thread_ ? controller_thread_->hardware()
+                                                                    : robot_hw_sim_.get(), model_nh_));
+    if (controller_thread_)
+      controller_thread_->start(controller_manager_);
+    ros::WallTime controller_manager_time = ros::WallTime::now();
 
     // Listen to the update event. This event is broadcast every simulation iteration.
     update_connection_ =
       gazebo::event::Events::ConnectWorldUpdateBegin
-      (boost::bind(&GazeboRosControlPlugin::Update, this));
-
+      (gazebo::ProfiledUpdate("gazebo_ros_control/" + parent_model_->GetName(),
+                              boost::bind(&GazeboRosControlPlugin::Update, this)));
+
+    ROS_INFO_NAMED("gazebo_ros_control", "Started gazebo_ros_control for [%s] in %.1f ms: "
+      "URDF %.1f ms, RobotHWSim %.1f ms, controller manager %.1f ms.",
+      parent_model_->GetName().c_str(), (controller_manager_time - start).toSec() * 1000.0,
+      (urdf_time - start).toSec() * 1000.0, (hw_sim_time - urdf_time).toSec() * 1000.0,
+      (controller_manager_time - hw_sim_time).toSec() * 1000.0);
   }
   catch(pluginlib::LibraryLoadException &ex)
   {
@@ -260,7 +361,15 @@ void GazeboRosControlPlugin::Update()
         reset_ctrlrs = false;
       }
     }
-    controller_manager_->update(sim_time_ros, sim_period, reset_ctrlrs);
+    if (controller_thread_)
+    {
+      // hand the state over, the commands come back at a later tick
+      controller_thread_->update(sim_time_ros, sim_period, reset_ctrlrs);
+    }
+    else
+    {
+      controller_manager_->update(sim_time_ros, sim_period, reset_ctrlrs);
+    }
   }
 
   // Update the gazebo model with the result of the controller
@@ -275,33 +384,51 @@ void GazeboRosControlPlugin::Reset()
   // Reset timing variables to not pass negative update periods to controllers on world reset
   last_update_sim_time_ros_ = ros::Time();
   last_write_sim_time_ros_ = ros::Time();
+
+  if (fleet_)
+    fleet_->reset();
 }
 
-// Get the URDF XML from the parameter server
+// Get the URDF XML from the plugin SDF, from the spawn request with <useSpawnedDescription> or from
+// the parameter server
 std::string GazeboRosControlPlugin::getURDF(std::string param_name) const
 {
   std::string urdf_string;
 
-  // search and wait for robot_description on param server
-  while (urdf_string.empty())
+  // inline in the plugin, as <robotDescription><![CDATA[<robot ...>]]></robotDescription>
+  if (sdf_->HasElement("robotDescription"))
   {
-    std::string search_param_name;
-    if (model_nh_.searchParam(param_name, search_param_name))
+    urdf_string = sdf_->Get<std::string>("robotDescription");
+    if (!urdf_string.empty())
     {
-      ROS_INFO_ONCE_NAMED("gazebo_ros_control", "gazebo_ros_control plugin is waiting for model"
-        " URDF in parameter [%s] on the ROS param server.", search_param_name.c_str());
-
-      model_nh_.getParam(search_param_name, urdf_string);
+      ROS_DEBUG_STREAM_NAMED("gazebo_ros_control", "Using the urdf of the plugin sdf, parsing...");
+      return urdf_string;
     }
-    else
-    {
-      ROS_INFO_ONCE_NAMED("gazebo_ros_control", "gazebo_ros_control plugin is waiting for model"
-        " URDF in parameter [%s] on the ROS param server.", robot_description_.c_str());
+  }
 
-      model_nh_.getParam(param_name, urdf_string);
-    }
+  // the model was spawned from a URDF by the gazebo_ros api plugin of this process, only with
+  // <useSpawnedDescription> so robots that set robot_description keep reading it
+  if (sdf_->HasElement("useSpawnedDescription") && sdf_->Get<bool>("useSpawnedDescription") &&
+      gazebo::ModelDescriptions::instance().get(parent_model_->GetName(), urdf_string))
+  {
+    ROS_DEBUG_STREAM_NAMED("gazebo_ros_control", "Using the urdf the model was spawned from, parsing...");
+    return urdf_string;
+  }
+
+  // search and wait for robot_description on param server, the cached lookups subscribe to
+  // the parameter so the master is only asked once
+  std::string search_param_name;
+  for (unsigned int attempt = 0; urdf_string.empty() && !unloading_ && ros::ok(); ++attempt)
+  {
+    // the parameter may be set in any parent namespace, search again now and then
+    if (attempt % 100 == 0 && !model_nh_.searchParam(param_name, search_param_name))
+      search_param_name = model_nh_.resolveName(param_name);
+
+    ROS_INFO_ONCE_NAMED("gazebo_ros_control", "gazebo_ros_control plugin is waiting for model"
+      " URDF in parameter [%s] on the ROS param server.", search_param_name.c_str());
 
-    usleep(100000);
+    if (!ros::param::getCached(search_param_name, urdf_string))
+      usleep(10000);
   }
   ROS_DEBUG_STREAM_NAMED("gazebo_ros_control", "Recieved urdf from param server, parsing...");
 
@@ -0,0 +1,324 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Open Source Robotics Foundation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Open Source Robotics Foundation
+ *     nor the names of its contributors may be
+ *     used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:   Robots of several gazebo_ros_control plugins simulated through one RobotHW and
+           controlled by one controller manager
+*/
+
+// Boost
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <gazebo_ros/gazebo_ros_update_profiler.h>
+#include <gazebo_ros_control/robot_hw_sim_fleet.h>
+#include <hardware_interface/internal/demangle_symbol.h>
+
+namespace
+{
+
+// Runs a function on a ros::CallbackQueue
+class FunctionCallback : public ros::CallbackInterface
+{
+public:
+  explicit FunctionCallback(const boost::function<void()>& function) : function_(function) {}
+
+  virtual CallResult call()
+  {
+    function_();
+    return Success;
+  }
+
+private:
+  boost::function<void()> function_;
+};
+
+}
+
+namespace gazebo_ros_control
+{
+
+boost::shared_ptr<RobotHWSimFleet> RobotHWSimFleet::get(const std::string& name,
+                                                        const ros::Duration& control_period,
+                                                        const std::string& e_stop_topic)
+{
+  static boost::mutex mutex;
+  static std::map<std::string, boost::weak_ptr<RobotHWSimFleet> > fleets;
+
+  boost::mutex::scoped_lock lock(mutex);
+  boost::shared_ptr<RobotHWSimFleet> fleet = fleets[name].lock();
+  if (!fleet)
+  {
+    fleet.reset(new RobotHWSimFleet(name, control_period, e_stop_topic));
+    fleets[name] = fleet;
+    return fleet;
+  }
+
+  // the first robot configured the fleet, the others cannot change it
+  if (control_period != fleet->control_period_)
+    ROS_WARN_STREAM_NAMED("gazebo_ros_control", "Ignoring the control period (" << control_period
+      << ") of a robot joining the fleet [" << name << "], the fleet runs its controllers every "
+      << fleet->control_period_ << " s.");
+  if (e_stop_topic != fleet->e_stop_topic_)
+    ROS_WARN_STREAM_NAMED("gazebo_ros_control", "Ignoring the e-stop topic [" << e_stop_topic
+      << "] of a robot joining the fleet [" << name << "], the fleet listens to ["
+      << fleet->e_stop_topic_ << "].");
+  return fleet;
+}
+
+RobotHWSimFleet::RobotHWSimFleet(const std::string& name, const ros::Duration& control_period,
+                                 const std::string& e_stop_topic)
+  : name_(name),
+    e_stop_topic_(e_stop_topic),
+    nh_(name),
+    control_period_(control_period),
+    e_stop_active_(false),
+    last_e_stop_active_(false)
+{
+  // The controller manager looks the handles up while loading controllers, robots register
+  // theirs when they join. Both are served by one thread so that they never overlap.
+  nh_.setCallbackQueue(&callback_queue_);
+
+  hardware_.registerInterface(&js_interface_);
+  hardware_.registerInterface(&ej_interface_);
+  hardware_.registerInterface(&pj_interface_);
+  hardware_.registerInterface(&vj_interface_);
+  controller_manager_.reset(new controller_manager::ControllerManager(&hardware_, nh_));
+
+  if (!e_stop_topic.empty())
+    e_stop_sub_ = nh_.subscribe(e_stop_topic, 1, &RobotHWSimFleet::eStopCB, this);
+
+  service_thread_ = boost::thread(boost::bind(&RobotHWSimFleet::serviceThread, this));
+
+  update_connection_ = gazebo::event::Events::ConnectWorldUpdateBegin(
+    gazebo::ProfiledUpdate("gazebo_ros_control/fleet/" + name_, boost::bind(&RobotHWSimFleet::update, this, _1)));
+
+  ROS_INFO_NAMED("gazebo_ros_control", "Started the gazebo_ros_control fleet [%s].", name_.c_str());
+}
+
+RobotHWSimFleet::~RobotHWSimFleet()
+{
+  update_connection_.reset();
+  nh_.shutdown();
+  service_thread_.join();
+}
+
+void RobotHWSimFleet::add(const std::string& robot, const boost::shared_ptr<RobotHWSim>& robot_hw_sim)
+{
+  ros::CallbackInterfacePtr callback(new FunctionCallback(
+    boost::bind(&RobotHWSimFleet::addRobot, this, robot, robot_hw_sim)));
+  callback_queue_.addCallback(callback, reinterpret_cast<uint64_t>(robot_hw_sim.get()));
+}
+
+void RobotHWSimFleet::remove(const RobotHWSim* robot_hw_sim)
+{
+  // drop the robot if it has not joined yet, waits for it if it is joining
+  callback_queue_.removeByID(reinterpret_cast<uint64_t>(robot_hw_sim));
+
+  boost::mutex::scoped_lock lock(robots_mutex_);
+  for (size_t i = 0; i < robots_.size(); ++i)
+  {
+    if (robots_[i].robot_hw_sim.get() == robot_hw_sim)
+    {
+      ROS_INFO_NAMED("gazebo_ros_control", "Robot [%s] left the fleet [%s].",
+                     robots_[i].name.c_str(), name_.c_str());
+      robots_.erase(robots_.begin() + i);
+      return;
+    }
+  }
+}
+
+void RobotHWSimFleet::reset()
+{
+  // Reset timing variables to not pass negative update periods to controllers on world reset
+  last_update_sim_time_ros_ = ros::Time();
+  last_write_sim_time_ros_ = ros::Time();
+}
+
+void RobotHWSimFleet::addRobot(const std::string& robot, const boost::shared_ptr<RobotHWSim>& robot_hw_sim)
+{
+  using namespace hardware_interface;
+
+  // Only the joint interfaces are known well enough to be mirrored
+  const std::vector<std::string> interfaces = robot_hw_sim->getNames();
+  for (size_t i = 0; i < interfaces.size(); ++i)
+  {
+    if (interfaces[i] != internal::demangledTypeName<JointStateInterface>() &&
+        interfaces[i] != internal::demangledTypeName<EffortJointInterface>() &&
+        interfaces[i] != internal::demangledTypeName<PositionJointInterface>() &&
+        interfaces[i] != internal::demangledTypeName<VelocityJointInterface>())
+    {
+      ROS_ERROR_STREAM_NAMED("gazebo_ros_control", "The robot simulation interface of [" << robot
+        << "] registers a " << interfaces[i] << ", it cannot join the fleet [" << name_ << "].");
+      return;
+    }
+  }
+
+  Robot entry;
+  entry.name = robot;
+  entry.robot_hw_sim = robot_hw_sim;
+
+  boost::mutex::scoped_lock lock(robots_mutex_);
+  try
+  {
+    JointStateInterface* js_interface = robot_hw_sim->get<JointStateInterface>();
+    const std::vector<std::string> joint_names =
+      js_interface ? js_interface->getNames() : std::vector<std::string>();
+    for (size_t j = 0; j < joint_names.size(); ++j)
+    {
+      const std::string name = robot + "/" + joint_names[j];
+      std::map<std::string, unsigned int>::iterator slot = state_slots_.find(name);
+      if (slot == state_slots_.end())
+      {
+        // new joint, a robot joining again gets the slots it had
+        slot = state_slots_.insert(std::make_pair(name, joint_states_.size())).first;
+        joint_states_.resize(joint_states_.size() + 3, 0.0);
+        const unsigned int k = slot->second;
+        js_interface_.registerHandle(JointStateHandle(name, &joint_states_[k], &joint_states_[k + 1],
+                                                      &joint_states_[k + 2]));
+      }
+      entry.states.push_back(js_interface->getHandle(joint_names[j]));
+      entry.state_slots.push_back(slot->second);
+    }
+
+    mirrorCommandInterface(robot_hw_sim.get(), &ej_interface_, entry);
+    mirrorCommandInterface(robot_hw_sim.get(), &pj_interface_, entry);
+    mirrorCommandInterface(robot_hw_sim.get(), &vj_interface_, entry);
+  }
+  catch (const HardwareInterfaceException& ex)
+  {
+    ROS_ERROR_STREAM_NAMED("gazebo_ros_control", "Could not add [" << robot << "] to the fleet ["
+      << name_ << "]: " << ex.what());
+    return;
+  }
+
+  robots_.push_back(entry);
+  ROS_INFO_NAMED("gazebo_ros_control", "Robot [%s] joined the fleet [%s] with %lu joints, %lu robots in the fleet.",
+                 robot.c_str(), name_.c_str(), (unsigned long)entry.states.size(), (unsigned long)robots_.size());
+}
+
+template <typename Interface>
+void RobotHWSimFleet::mirrorCommandInterface(RobotHWSim* robot_hw_sim, Interface* mirror, Robot& robot)
+{
+  Interface* interface = robot_hw_sim->get<Interface>();
+  if (!interface)
+    return;
+
+  const std::vector<std::string> joint_names = interface->getNames();
+  for (size_t j = 0; j < joint_names.size(); ++j)
+  {
+    hardware_interface::JointHandle handle = interface->getHandle(joint_names[j]);
+    const std::string name = robot.name + "/" + joint_names[j];
+    std::map<std::string, unsigned int>::iterator slot = command_slots_.find(name);
+    if (slot == command_slots_.end())
+    {
+      slot = command_slots_.insert(std::make_pair(name, joint_commands_.size())).first;
+      joint_commands_.push_back(0.0);
+      mirror->registerHandle(hardware_interface::JointHandle(js_interface_.getHandle(name),
+                                                             &joint_commands_[slot->second]));
+    }
+    // the controllers start from the commands the RobotHWSim was initialized with
+    joint_commands_[slot->second] = handle.getCommand();
+    robot.commands.push_back(handle);
+    robot.command_slots.push_back(slot->second);
+  }
+}
+
+void RobotHWSimFleet::update(const gazebo::common::UpdateInfo& info)
+{
+  // Get the simulation time and period, the robots of the fleet are all in the world updating
+  const gazebo::common::Time& gz_time_now = info.simTime;
+  ros::Time sim_time_ros(gz_time_now.sec, gz_time_now.nsec);
+  ros::Duration sim_period = sim_time_ros - last_update_sim_time_ros_;
+
+  boost::mutex::scoped_lock lock(robots_mutex_);
+  const bool e_stop_active = e_stop_active_;
+  for (size_t i = 0; i < robots_.size(); ++i)
+    robots_[i].robot_hw_sim->eStopActive(e_stop_active);
+
+  // Check if we should update the controllers
+  if (sim_period >= control_period_)
+  {
+    // Store this simulation time
+    last_update_sim_time_ros_ = sim_time_ros;
+
+    // Update the robot simulations with the state of the gazebo models, then the mirror
+    for (size_t i = 0; i < robots_.size(); ++i)
+      robots_[i].robot_hw_sim->readSim(sim_time_ros, sim_period);
+    for (size_t i = 0; i < robots_.size(); ++i)
+    {
+      const Robot& robot = robots_[i];
+      for (size_t j = 0; j < robot.states.size(); ++j)
+      {
+        const unsigned int k = robot.state_slots[j];
+        joint_states_[k] = robot.states[j].getPosition();
+        joint_states_[k + 1] = robot.states[j].getVelocity();
+        joint_states_[k + 2] = robot.states[j].getEffort();
+      }
+    }
+
+    // Compute the controller commands, resetting the controllers when the e-stop is released
+    const bool reset_ctrlrs = last_e_stop_active_ && !e_stop_active;
+    last_e_stop_active_ = e_stop_active;
+    controller_manager_->update(sim_time_ros, sim_period, reset_ctrlrs);
+
+    for (size_t i = 0; i < robots_.size(); ++i)
+    {
+      Robot& robot = robots_[i];
+      for (size_t j = 0; j < robot.commands.size(); ++j)
+        robot.commands[j].setCommand(joint_commands_[robot.command_slots[j]]);
+    }
+  }
+
+  // Update the gazebo models with the result of the controller computation
+  const ros::Duration write_period = sim_time_ros - last_write_sim_time_ros_;
+  for (size_t i = 0; i < robots_.size(); ++i)
+    robots_[i].robot_hw_sim->writeSim(sim_time_ros, write_period);
+  last_write_sim_time_ros_ = sim_time_ros;
+}
+
+void RobotHWSimFleet::serviceThread()
+{
+  while (nh_.ok())
+    callback_queue_.callAvailable(ros::WallDuration(0.1));
+}
+
+void RobotHWSimFleet::eStopCB(const std_msgs::BoolConstPtr& e_stop_active)
+{
+  e_stop_active_ = e_stop_active->data;
+}
+
+}
@@ -0,0 +1,281 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Open Source Robotics Foundation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Open Source Robotics Foundation
+ *     nor the names of its contributors may be
+ *     used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Checks the hand over of the SnapshotBuffer, and runs a ControllerThread with a controller
+// slower than the physics: in lockstep every state gets its cycle and the commands arrive one
+// control tick late, free running the physics never waits and the periods passed to the
+// controllers span the ticks they skipped. Needs neither Gazebo nor a ROS master.
+
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+#include <gazebo_ros_control/controller_thread.h>
+
+using gazebo_ros_control::ControllerThread;
+using gazebo_ros_control::SnapshotBuffer;
+
+static const unsigned int kTicks = 50;
+static const ros::Duration kPeriod(0.001);
+
+/// \brief One effort joint, readSim() and writeSim() are left to the test
+class FakeRobotHWSim : public gazebo_ros_control::RobotHWSim
+{
+public:
+  FakeRobotHWSim() : position(0.0), velocity(0.0), effort(0.0), command(0.0)
+  {
+    js_interface_.registerHandle(hardware_interface::JointStateHandle("joint", &position, &velocity, &effort));
+    ej_interface_.registerHandle(hardware_interface::JointHandle(js_interface_.getHandle("joint"), &command));
+    registerInterface(&js_interface_);
+    registerInterface(&ej_interface_);
+  }
+
+  virtual bool initSim(const std::string&, ros::NodeHandle, gazebo::physics::ModelPtr,
+                       const urdf::Model *const, std::vector<transmission_interface::TransmissionInfo>)
+  {
+    return true;
+  }
+
+  virtual void readSim(ros::Time, ros::Duration) {}
+
+  virtual void writeSim(ros::Time, ros::Duration) {}
+
+  double position;
+  double velocity;
+  double effort;
+  double command;
+
+private:
+  hardware_interface::JointStateInterface js_interface_;
+  hardware_interface::EffortJointInterface ej_interface_;
+};
+
+/// \brief Commands the position it is given as effort, taking delay seconds per cycle
+class SlowController
+{
+public:
+  SlowController(hardware_interface::RobotHW* hardware, double delay)
+    : state_(hardware->get<hardware_interface::JointStateInterface>()->getHandle("joint")),
+      command_(hardware->get<hardware_interface::EffortJointInterface>()->getHandle("joint")),
+      delay_(delay)
+  {
+  }
+
+  void update(const ros::Time& time, const ros::Duration& period, bool reset_controllers)
+  {
+    ros::WallDuration(delay_).sleep();
+    command_.setCommand(state_.getPosition());
+    times.push_back(time);
+    periods.push_back(period);
+  }
+
+  // Written by the controller thread, read once it stopped
+  std::vector<ros::Time> times;
+  std::vector<ros::Duration> periods;
+
+private:
+  hardware_interface::JointStateHandle state_;
+  hardware_interface::JointHandle command_;
+  double delay_;
+};
+
+/// \brief Wait until the controllers ran the cycle of the last tick
+static bool WaitForCycle(const ControllerThread& thread, uint64_t cycle)
+{
+  for (unsigned int i = 0; i < 1000 && thread.cycles() < cycle; ++i)
+    ros::WallDuration(0.01).sleep();
+  return thread.cycles() == cycle;
+}
+
+TEST(SnapshotBuffer, freshness)
+{
+  SnapshotBuffer<int> buffer;
+  buffer.assign(0);
+  EXPECT_FALSE(buffer.fresh());
+  EXPECT_FALSE(buffer.update());
+  EXPECT_EQ(0, buffer.front());
+
+  buffer.back() = 1;
+  buffer.publish();
+  EXPECT_TRUE(buffer.fresh());
+  EXPECT_TRUE(buffer.update());
+  EXPECT_EQ(1, buffer.front());
+  // taken once only
+  EXPECT_FALSE(buffer.fresh());
+  EXPECT_FALSE(buffer.update());
+  EXPECT_EQ(1, buffer.front());
+
+  // the reader gets the latest value, older ones are skipped
+  buffer.back() = 2;
+  buffer.publish();
+  buffer.back() = 3;
+  buffer.publish();
+  EXPECT_TRUE(buffer.update());
+  EXPECT_EQ(3, buffer.front());
+  EXPECT_FALSE(buffer.update());
+
+  // the writer never gets the buffer the reader holds
+  buffer.back() = 4;
+  EXPECT_EQ(3, buffer.front());
+}
+
+TEST(SnapshotBuffer, concurrentHandOver)
+{
+  struct Pair
+  {
+    uint64_t first;
+    uint64_t second;
+  };
+  SnapshotBuffer<Pair> buffer;
+  Pair zero = {0, 0};
+  buffer.assign(zero);
+
+  const uint64_t writes = 200000;
+  boost::thread writer([&buffer, writes]()
+  {
+    for (uint64_t k = 1; k <= writes; ++k)
+    {
+      buffer.back().first = k;
+      buffer.back().second = k;
+      buffer.publish();
+    }
+  });
+
+  unsigned int torn = 0;
+  unsigned int reads = 0;
+  uint64_t last = 0;
+  while (last < writes)
+  {
+    if (!buffer.update())
+      continue;
+    ++reads;
+    const Pair& pair = buffer.front();
+    if (pair.first != pair.second || pair.first < last)
+      ++torn;
+    last = pair.first;
+  }
+  writer.join();
+
+  // every value read was published whole, and they only move forward
+  EXPECT_EQ(0u, torn) << "in " << reads << " reads";
+  EXPECT_EQ(writes, last);
+}
+
+TEST(ControllerThread, lockstep)
+{
+  FakeRobotHWSim robot_hw_sim;
+  ControllerThread thread;
+  ASSERT_TRUE(thread.init(&robot_hw_sim, "lockstep", true));
+  SlowController controller(thread.hardware(), 0.002);
+  thread.start(boost::bind(&SlowController::update, &controller, _1, _2, _3));
+
+  for (unsigned int i = 1; i <= kTicks; ++i)
+  {
+    // readSim()
+    robot_hw_sim.position = i;
+    thread.update(ros::Time(0.001 * i), kPeriod, false);
+    // the commands of the previous tick, whatever the time the controllers take
+    EXPECT_DOUBLE_EQ(i - 1.0, robot_hw_sim.command) << i;
+  }
+  ASSERT_TRUE(WaitForCycle(thread, kTicks));
+  thread.stop();
+
+  // every state got a cycle, in order, at the control period
+  ASSERT_EQ(kTicks, controller.times.size());
+  for (unsigned int i = 0; i < kTicks; ++i)
+  {
+    EXPECT_EQ(ros::Time(0.001 * (i + 1)), controller.times[i]) << i;
+    EXPECT_NEAR(kPeriod.toSec(), controller.periods[i].toSec(), 1e-8) << i;
+  }
+  // the physics had to wait for them
+  EXPECT_GT(thread.missedDeadlines(), 0u);
+}
+
+TEST(ControllerThread, freeRunning)
+{
+  FakeRobotHWSim robot_hw_sim;
+  ControllerThread thread;
+  ASSERT_TRUE(thread.init(&robot_hw_sim, "free_running", false));
+  SlowController controller(thread.hardware(), 0.005);
+  thread.start(boost::bind(&SlowController::update, &controller, _1, _2, _3));
+
+  // a physics step takes a fifth of a controller cycle
+  const ros::WallTime start = ros::WallTime::now();
+  for (unsigned int i = 1; i <= kTicks; ++i)
+  {
+    robot_hw_sim.position = i;
+    thread.update(ros::Time(0.001 * i), kPeriod, false);
+    // commands of a completed cycle, never of a state not handed over yet
+    EXPECT_LT(robot_hw_sim.command, i);
+    ros::WallDuration(0.001).sleep();
+  }
+  // the physics never waits for the controllers
+  EXPECT_LT((ros::WallTime::now() - start).toSec(), 0.5 * kTicks * 0.005);
+  ASSERT_TRUE(WaitForCycle(thread, kTicks));
+  thread.stop();
+
+  // the controllers skipped states, but always work on the latest one
+  EXPECT_GE(controller.times.size(), 3u);
+  EXPECT_LT(controller.times.size(), kTicks);
+  EXPECT_GT(thread.missedDeadlines(), 0u);
+  EXPECT_EQ(ros::Time(0.001 * kTicks), controller.times.back());
+
+  // a cycle integrates over the ticks since the previous one, so the periods add up to the
+  // simulated time
+  EXPECT_NEAR(kPeriod.toSec(), controller.periods[0].toSec(), 1e-8);
+  double sum = 0.0;
+  for (size_t i = 0; i < controller.periods.size(); ++i)
+  {
+    if (i > 0)
+      EXPECT_EQ(controller.times[i] - controller.times[i - 1], controller.periods[i]) << i;
+    sum += controller.periods[i].toSec();
+  }
+  EXPECT_NEAR((controller.times.back() - controller.times.front()).toSec() + kPeriod.toSec(), sum, 1e-6);
+}
+
+int main(int argc, char** argv)
+{
+  // wall clock for ros::Time::now(), which the throttled warnings use
+  ros::Time::init();
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,283 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Open Source Robotics Foundation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Open Source Robotics Foundation
+ *     nor the names of its contributors may be
+ *     used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Times readSim() and writeSim() of the DefaultRobotHWSim on synthetic chains of N joints,
+// a third of them on each of the effort, position and velocity interfaces and half of the
+// position and velocity ones with PID gains, and checks that every group gets its commands
+// and that initSim() uses the parameters read by loadSimParams().
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+#include <gazebo/gazebo.hh>
+#include <gazebo/gazebo_config.h>
+#include <gazebo/physics/physics.hh>
+
+#include <gazebo_ros_control/default_robot_hw_sim.h>
+
+static const unsigned int kCalls = 10000;
+
+/// \brief Chain of n links on revolute joints joint_0 ... joint_<n-1>, fixed to the world
+static std::string ChainModel(const std::string& name, unsigned int n, double y)
+{
+  std::ostringstream sdf;
+  sdf << "<model name='" << name << "'><pose>0 " << y << " 1 0 0 0</pose>"
+      << "<link name='base'/>"
+      << "<joint name='fixed' type='fixed'><parent>world</parent><child>base</child></joint>";
+  for (unsigned int i = 0; i < n; ++i)
+  {
+    sdf << "<link name='link_" << i << "'><pose>0 0 " << 0.1 * (i + 1) << " 0 0 0</pose>"
+        << "<inertial><mass>0.1</mass><inertia><ixx>0.001</ixx><iyy>0.001</iyy><izz>0.001</izz></inertia></inertial>"
+        << "</link>"
+        << "<joint name='joint_" << i << "' type='revolute'>"
+        << "<parent>" << (i == 0 ? std::string("base") : "link_" + std::to_string(i - 1)) << "</parent>"
+        << "<child>link_" << i << "</child><axis><xyz>" << (i % 2 ? "0 1 0" : "1 0 0") << "</xyz></axis>"
+        << "</joint>";
+  }
+  sdf << "</model>";
+  return sdf.str();
+}
+
+/// \brief Transmission of joint_i, cycling through the effort, position and velocity interfaces
+static transmission_interface::TransmissionInfo ChainTransmission(unsigned int i)
+{
+  static const char* const interfaces[] = {"hardware_interface/EffortJointInterface",
+                                           "hardware_interface/PositionJointInterface",
+                                           "hardware_interface/VelocityJointInterface"};
+  transmission_interface::JointInfo joint;
+  joint.name_ = "joint_" + std::to_string(i);
+  joint.hardware_interfaces_.push_back(interfaces[i % 3]);
+
+  transmission_interface::TransmissionInfo transmission;
+  transmission.name_ = joint.name_ + "_transmission";
+  transmission.type_ = "transmission_interface/SimpleTransmission";
+  transmission.joints_.push_back(joint);
+  return transmission;
+}
+
+class DefaultRobotHWSimBenchmark : public testing::Test
+{
+protected:
+  static void SetUpTestCase()
+  {
+    std::ostringstream world;
+    world << "<?xml version='1.0'?><sdf version='1.4'><world name='default'>"
+          << "<gravity>0 0 0</gravity>"
+          << ChainModel("chain_12", 12, 0.0)
+          << ChainModel("chain_60", 60, 2.0)
+          << ChainModel("chain_240", 240, 4.0)
+          << "</world></sdf>";
+    world_file_ = "/tmp/default_robot_hw_sim_benchmark.world";
+    FILE* file = fopen(world_file_.c_str(), "w");
+    ASSERT_TRUE(file != NULL);
+    fputs(world.str().c_str(), file);
+    fclose(file);
+
+    ASSERT_TRUE(gazebo::setupServer());
+    world_ = gazebo::loadWorld(world_file_);
+    ASSERT_TRUE(world_ != NULL);
+  }
+
+  static void TearDownTestCase()
+  {
+    world_.reset();
+    gazebo::shutdown();
+    remove(world_file_.c_str());
+  }
+
+  /// \brief Robot hardware of a chain, with PID gains for every other position and velocity joint
+  bool InitSim(const std::string& name, unsigned int n, gazebo_ros_control::DefaultRobotHWSim& robot_hw_sim)
+  {
+    std::vector<transmission_interface::TransmissionInfo> transmissions;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+      transmissions.push_back(ChainTransmission(i));
+      if (i % 3 != 0 && i % 2 == 0)
+        ros::param::set("/" + name + "/gazebo_ros_control/pid_gains/joint_" + std::to_string(i) + "/p", 10.0);
+    }
+#if GAZEBO_MAJOR_VERSION >= 8
+    gazebo::physics::ModelPtr model = world_->ModelByName(name);
+#else
+    gazebo::physics::ModelPtr model = world_->GetModel(name);
+#endif
+    if (!model)
+      return false;
+    return robot_hw_sim.initSim(name, ros::NodeHandle(name), model, NULL, transmissions);
+  }
+
+  static std::string world_file_;
+  static gazebo::physics::WorldPtr world_;
+};
+
+std::string DefaultRobotHWSimBenchmark::world_file_;
+gazebo::physics::WorldPtr DefaultRobotHWSimBenchmark::world_;
+
+TEST_F(DefaultRobotHWSimBenchmark, commandsReachEveryGroup)
+{
+  gazebo_ros_control::DefaultRobotHWSim robot_hw_sim;
+  ASSERT_TRUE(InitSim("chain_12", 12, robot_hw_sim));
+#if GAZEBO_MAJOR_VERSION >= 8
+  gazebo::physics::ModelPtr model = world_->ModelByName("chain_12");
+#else
+  gazebo::physics::ModelPtr model = world_->GetModel("chain_12");
+#endif
+
+  hardware_interface::EffortJointInterface* ej = robot_hw_sim.get<hardware_interface::EffortJointInterface>();
+  hardware_interface::PositionJointInterface* pj = robot_hw_sim.get<hardware_interface::PositionJointInterface>();
+  hardware_interface::VelocityJointInterface* vj = robot_hw_sim.get<hardware_interface::VelocityJointInterface>();
+  ASSERT_EQ(4u, ej->getNames().size());
+  ASSERT_EQ(4u, pj->getNames().size());
+  ASSERT_EQ(4u, vj->getNames().size());
+
+  for (unsigned int i = 0; i < 12; ++i)
+  {
+    const std::string joint = "joint_" + std::to_string(i);
+    if (i % 3 == 0)
+      ej->getHandle(joint).setCommand(0.01 * i);
+    else if (i % 3 == 1)
+      pj->getHandle(joint).setCommand(0.1);
+    else
+      vj->getHandle(joint).setCommand(0.2);
+  }
+
+  const ros::Duration period(0.001);
+  robot_hw_sim.readSim(ros::Time(), period);
+  robot_hw_sim.writeSim(ros::Time(), period);
+
+  for (unsigned int i = 0; i < 12; ++i)
+  {
+    const std::string joint = "joint_" + std::to_string(i);
+    gazebo::physics::JointPtr sim_joint = model->GetJoint(joint);
+    const bool pid = i % 3 != 0 && i % 2 == 0;
+    if (i % 3 == 0)
+    {
+      EXPECT_DOUBLE_EQ(0.01 * i, sim_joint->GetForce(0u)) << joint;
+    }
+    else if (pid)
+    {
+      // the joints are at rest at 0, the PIDs push them toward the commands
+      EXPECT_GT(sim_joint->GetForce(0u), 0.0) << joint;
+    }
+    else if (i % 3 == 1)
+    {
+#if GAZEBO_MAJOR_VERSION >= 8
+      EXPECT_NEAR(0.1, sim_joint->Position(0), 1e-6) << joint;
+#else
+      EXPECT_NEAR(0.1, sim_joint->GetAngle(0).Radian(), 1e-6) << joint;
+#endif
+    }
+  }
+
+  // the velocity joints without gains follow their command from the next step on
+  gazebo::runWorld(world_, 1);
+  robot_hw_sim.readSim(ros::Time(), period);
+  hardware_interface::JointStateInterface* js = robot_hw_sim.get<hardware_interface::JointStateInterface>();
+  EXPECT_NEAR(0.2, js->getHandle("joint_5").getVelocity(), 0.02);
+  EXPECT_NEAR(0.2, js->getHandle("joint_11").getVelocity(), 0.02);
+}
+
+TEST_F(DefaultRobotHWSimBenchmark, paramsLoadedBeforeInitSim)
+{
+  // effort, position and velocity joint
+  std::vector<transmission_interface::TransmissionInfo> transmissions;
+  for (unsigned int i = 0; i < 3; ++i)
+    transmissions.push_back(ChainTransmission(i));
+  const std::string ns = "/preloaded";
+  ros::param::set(ns + "/gazebo_ros_control/pid_gains/joint_1/p", 100.0);
+  ros::param::set(ns + "/joint_limits/joint_1/has_effort_limits", true);
+  ros::param::set(ns + "/joint_limits/joint_1/max_effort", 0.5);
+
+  // the plugin reads the parameters before it takes the physics update mutex for initSim(),
+  // which must not read them again
+  gazebo_ros_control::DefaultRobotHWSim robot_hw_sim;
+  ASSERT_TRUE(robot_hw_sim.loadSimParams(ns, ros::NodeHandle(ns), NULL, transmissions));
+  ros::param::del(ns + "/gazebo_ros_control");
+  ros::param::del(ns + "/joint_limits");
+#if GAZEBO_MAJOR_VERSION >= 8
+  gazebo::physics::ModelPtr model = world_->ModelByName("chain_12");
+#else
+  gazebo::physics::ModelPtr model = world_->GetModel("chain_12");
+#endif
+  ASSERT_TRUE(robot_hw_sim.initSim(ns, ros::NodeHandle(ns), model, NULL, transmissions));
+
+  hardware_interface::PositionJointInterface* pj = robot_hw_sim.get<hardware_interface::PositionJointInterface>();
+  ASSERT_EQ(1u, pj->getNames().size());
+  pj->getHandle("joint_1").setCommand(1.0);
+  const ros::Duration period(0.001);
+  robot_hw_sim.readSim(ros::Time(), period);
+  robot_hw_sim.writeSim(ros::Time(), period);
+
+  // a PID far from its command, saturated at the preloaded effort limit
+  EXPECT_DOUBLE_EQ(0.5, model->GetJoint("joint_1")->GetForce(0u));
+}
+
+TEST_F(DefaultRobotHWSimBenchmark, readWriteSim)
+{
+  const char* const names[] = {"chain_12", "chain_60", "chain_240"};
+  const unsigned int sizes[] = {12, 60, 240};
+  const ros::Duration period(0.001);
+
+  for (unsigned int k = 0; k < 3; ++k)
+  {
+    gazebo_ros_control::DefaultRobotHWSim robot_hw_sim;
+    ASSERT_TRUE(InitSim(names[k], sizes[k], robot_hw_sim));
+
+    ros::WallTime start = ros::WallTime::now();
+    for (unsigned int i = 0; i < kCalls; ++i)
+      robot_hw_sim.readSim(ros::Time(), period);
+    const double read_s = (ros::WallTime::now() - start).toSec();
+
+    start = ros::WallTime::now();
+    for (unsigned int i = 0; i < kCalls; ++i)
+      robot_hw_sim.writeSim(ros::Time(), period);
+    const double write_s = (ros::WallTime::now() - start).toSec();
+
+    printf("%3u joints: readSim %.2f us (%.0f ns per joint), writeSim %.2f us (%.0f ns per joint)\n",
+           sizes[k], 1e6 * read_s / kCalls, 1e9 * read_s / kCalls / sizes[k],
+           1e6 * write_s / kCalls, 1e9 * write_s / kCalls / sizes[k]);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "default_robot_hw_sim_benchmark");
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
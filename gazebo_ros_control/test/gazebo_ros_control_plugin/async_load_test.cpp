@@ -0,0 +1,273 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Open Source Robotics Foundation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Open Source Robotics Foundation
+ *     nor the names of its contributors may be
+ *     used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Loads robots with <asyncLoad> into an in-process server running the gazebo_ros api plugin.
+// Checks that the world keeps stepping while a robot waits for its URDF, that the joint limits
+// and PID gains are read while somebody else holds the physics update mutex, that the URDF of a
+// model spawned through the api plugin with <useSpawnedDescription> is found without
+// robot_description and forgotten once the model is deleted outside of ROS, and that a robot
+// unloaded while it waits does not hang.
+
+#include <cstdio>
+#include <string>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+#include <gazebo/gazebo.hh>
+#include <gazebo/gazebo_config.h>
+#include <gazebo/msgs/msgs.hh>
+#include <gazebo/physics/physics.hh>
+#include <gazebo/transport/transport.hh>
+
+#include <gazebo_msgs/SpawnModel.h>
+#include <gazebo_ros/gazebo_ros_model_descriptions.h>
+
+/// \brief Pendulum fixed to the world, with the gazebo_ros_control plugin loading asynchronously
+static std::string RobotURDF(const std::string& name)
+{
+  const std::string inertial = "<inertial><mass value='0.1'/>"
+    "<inertia ixx='0.001' ixy='0' ixz='0' iyy='0.001' iyz='0' izz='0.001'/></inertial>";
+  return "<?xml version='1.0'?><robot name='" + name + "'>"
+    "<link name='world'/>"
+    "<joint name='fixed' type='fixed'><parent link='world'/><child link='base'/></joint>"
+    "<link name='base'>" + inertial + "</link>"
+    "<link name='link_0'>" + inertial + "</link>"
+    "<joint name='joint_0' type='revolute'><parent link='base'/><child link='link_0'/>"
+    "<origin xyz='0 0 0.1'/><axis xyz='1 0 0'/>"
+    "<limit lower='-1' upper='1' effort='10' velocity='1'/></joint>"
+    "<transmission name='joint_0_transmission'><type>transmission_interface/SimpleTransmission</type>"
+    "<joint name='joint_0'><hardwareInterface>hardware_interface/PositionJointInterface</hardwareInterface></joint>"
+    "<actuator name='joint_0_motor'><mechanicalReduction>1</mechanicalReduction></actuator>"
+    "</transmission>"
+    "<gazebo><plugin name='gazebo_ros_control' filename='libgazebo_ros_control.so'>"
+    "<robotNamespace>/" + name + "</robotNamespace>"
+    "<legacyModeNS>false</legacyModeNS>"
+    "<asyncLoad>true</asyncLoad>"
+    "<useSpawnedDescription>true</useSpawnedDescription>"
+    "</plugin></gazebo></robot>";
+}
+
+/// \brief The same pendulum as an SDF, which leaves the plugin to find the URDF on its own
+static std::string RobotSDF(const std::string& name, double y)
+{
+  const std::string inertial = "<inertial><mass>0.1</mass>"
+    "<inertia><ixx>0.001</ixx><iyy>0.001</iyy><izz>0.001</izz></inertia></inertial>";
+  return "<?xml version='1.0'?><sdf version='1.4'><model name='" + name + "'>"
+    "<pose>0 " + std::to_string(y) + " 1 0 0 0</pose>"
+    "<link name='base'>" + inertial + "</link>"
+    "<joint name='fixed' type='fixed'><parent>world</parent><child>base</child></joint>"
+    "<link name='link_0'><pose>0 0 0.1 0 0 0</pose>" + inertial + "</link>"
+    "<joint name='joint_0' type='revolute'><parent>base</parent><child>link_0</child>"
+    "<axis><xyz>1 0 0</xyz></axis></joint>"
+    "<plugin name='gazebo_ros_control' filename='libgazebo_ros_control.so'>"
+    "<robotNamespace>/" + name + "</robotNamespace>"
+    "<legacyModeNS>false</legacyModeNS>"
+    "<asyncLoad>true</asyncLoad>"
+    "</plugin></model></sdf>";
+}
+
+static bool ServiceExists(const std::string& service)
+{
+  return ros::service::exists(service, false);
+}
+
+class AsyncLoadTest : public testing::Test
+{
+protected:
+  static void SetUpTestCase()
+  {
+    world_file_ = "/tmp/async_load_test.world";
+    FILE* file = fopen(world_file_.c_str(), "w");
+    ASSERT_TRUE(file != NULL);
+    fputs("<?xml version='1.0'?><sdf version='1.4'><world name='default'>"
+          "<gravity>0 0 0</gravity></world></sdf>", file);
+    fclose(file);
+
+    // records the URDF of the models spawned through ROS and forgets it on delete
+    gazebo::addPlugin("libgazebo_ros_api_plugin.so");
+    ASSERT_TRUE(gazebo::setupServer());
+    world_ = gazebo::loadWorld(world_file_);
+    ASSERT_TRUE(world_ != NULL);
+  }
+
+  static void TearDownTestCase()
+  {
+    world_.reset();
+    gazebo::shutdown();
+    remove(world_file_.c_str());
+  }
+
+  /// \brief Wait until done() holds, stepping the world unless step is false
+  /// \return false after timeout seconds of wall time
+  static bool Until(const boost::function<bool ()>& done, double timeout, bool step = true)
+  {
+    const ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(timeout);
+    while (!done())
+    {
+      if (ros::WallTime::now() > deadline)
+        return false;
+      if (step)
+        gazebo::runWorld(world_, 10);
+      else
+        ros::WallDuration(0.01).sleep();
+    }
+    return true;
+  }
+
+  static bool HasModel(const std::string& name)
+  {
+#if GAZEBO_MAJOR_VERSION >= 8
+    return world_->ModelByName(name) != NULL;
+#else
+    return world_->GetModel(name) != NULL;
+#endif
+  }
+
+  static double SimTime()
+  {
+#if GAZEBO_MAJOR_VERSION >= 8
+    return world_->SimTime().Double();
+#else
+    return world_->GetSimTime().Double();
+#endif
+  }
+
+  static boost::recursive_mutex* PhysicsUpdateMutex()
+  {
+#if GAZEBO_MAJOR_VERSION >= 8
+    return world_->Physics()->GetPhysicsUpdateMutex();
+#else
+    return world_->GetPhysicsEngine()->GetPhysicsUpdateMutex();
+#endif
+  }
+
+  /// \brief Delete a model the way gz and the GUI do, without the ROS services
+  static void DeleteOutsideROS(const std::string& name)
+  {
+    gazebo::transport::NodePtr node(new gazebo::transport::Node());
+    node->Init();
+    gazebo::transport::PublisherPtr pub = node->Advertise<gazebo::msgs::Request>("~/request");
+    pub->WaitForConnection();
+    gazebo::msgs::Request* msg = gazebo::msgs::CreateRequest("entity_delete", name);
+    pub->Publish(*msg, true);
+    delete msg;
+  }
+
+  static std::string world_file_;
+  static gazebo::physics::WorldPtr world_;
+};
+
+std::string AsyncLoadTest::world_file_;
+gazebo::physics::WorldPtr AsyncLoadTest::world_;
+
+TEST_F(AsyncLoadTest, urdfFromParameterServer)
+{
+  const std::string name = "param_robot";
+  const std::string controller_manager = "/" + name + "/controller_manager/list_controllers";
+  world_->InsertModelString(RobotSDF(name, 0.0));
+  ASSERT_TRUE(Until([&name]() { return HasModel(name); }, 30.0));
+
+  // there is no URDF yet, the world steps on while the plugin waits for it
+  const double waiting = SimTime();
+  gazebo::runWorld(world_, 100);
+  EXPECT_GT(SimTime(), waiting);
+  EXPECT_FALSE(ServiceExists(controller_manager));
+
+  ros::param::set("/" + name + "/gazebo_ros_control/pid_gains/joint_0/p", 10.0);
+  {
+    // the PID gains are read before the physics update mutex is taken, the controller manager
+    // only comes up once initSim() got it
+    boost::recursive_mutex::scoped_lock lock(*PhysicsUpdateMutex());
+    ros::param::set("/" + name + "/robot_description", RobotURDF(name));
+    EXPECT_TRUE(Until(boost::bind(&ServiceExists, "/" + name + "/gazebo_ros_control/pid_gains/joint_0/set_parameters"),
+                      30.0, false));
+    ros::WallDuration(0.1).sleep();
+    EXPECT_FALSE(ServiceExists(controller_manager));
+  }
+  EXPECT_TRUE(Until(boost::bind(&ServiceExists, controller_manager), 30.0));
+}
+
+TEST_F(AsyncLoadTest, urdfFromSpawnRequest)
+{
+  const std::string name = "spawned_robot";
+  const std::string controller_manager = "/" + name + "/controller_manager/list_controllers";
+
+  // the spawn service waits for the model, which needs the world to step
+  gazebo_msgs::SpawnModel spawn;
+  spawn.request.model_name = name;
+  spawn.request.model_xml = RobotURDF(name);
+  spawn.request.initial_pose.position.y = 1.0;
+  spawn.request.initial_pose.orientation.w = 1.0;
+  bool called = false;
+  boost::thread caller([&spawn, &called]() { called = ros::service::call("/gazebo/spawn_urdf_model", spawn); });
+  ASSERT_TRUE(Until([&caller]() { return caller.try_join_for(boost::chrono::milliseconds(0)); }, 60.0));
+  ASSERT_TRUE(called);
+  ASSERT_TRUE(spawn.response.success) << spawn.response.status_message;
+
+  // nothing on the parameter server, the URDF comes from the spawn request
+  std::string urdf;
+  EXPECT_TRUE(gazebo::ModelDescriptions::instance().get(name, urdf));
+  EXPECT_FALSE(ros::param::has("/" + name + "/robot_description"));
+  EXPECT_TRUE(Until(boost::bind(&ServiceExists, controller_manager), 30.0));
+
+  // a model of the same name spawned later from an SDF must not find this URDF
+  DeleteOutsideROS(name);
+  ASSERT_TRUE(Until([&name]() { return !HasModel(name); }, 30.0));
+  EXPECT_FALSE(gazebo::ModelDescriptions::instance().get(name, urdf));
+}
+
+TEST_F(AsyncLoadTest, unloadWhileWaiting)
+{
+  const std::string name = "abandoned_robot";
+  world_->InsertModelString(RobotSDF(name, 2.0));
+  ASSERT_TRUE(Until([&name]() { return HasModel(name); }, 30.0));
+  gazebo::runWorld(world_, 10);
+
+  // the plugin waits for a URDF that never comes, deleting the model stops the wait
+  DeleteOutsideROS(name);
+  EXPECT_TRUE(Until([&name]() { return !HasModel(name); }, 30.0));
+  EXPECT_FALSE(ServiceExists("/" + name + "/controller_manager/list_controllers"));
+}
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "async_load_test");
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,336 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2018, Open Source Robotics Foundation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the Open Source Robotics Foundation
+ *     nor the names of its contributors may be
+ *     used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Runs fleets of fake robots without Gazebo, firing the world update event by hand: a robot
+// joining again gets the mirror slots, and so the controllers, it had, a robot removed while
+// its join is queued never joins, and releasing the e-stop restarts the controllers. The
+// controllers are loaded through the controller manager services, so a ROS master is needed.
+
+#include <atomic>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread.hpp>
+#include <controller_manager_msgs/LoadController.h>
+#include <controller_manager_msgs/SwitchController.h>
+#include <gazebo/common/common.hh>
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+#include <std_msgs/Bool.h>
+#include <std_msgs/Float64.h>
+
+#include <gazebo_ros_control/robot_hw_sim_fleet.h>
+
+using gazebo_ros_control::RobotHWSimFleet;
+
+static const ros::Duration kPeriod(0.001);
+
+/// \brief One effort joint named wheel, counting the reads and writes of the fleet
+class FakeRobotHWSim : public gazebo_ros_control::RobotHWSim
+{
+public:
+  FakeRobotHWSim()
+    : reads(0), writes(0), e_stop_active(false), position(0.25), velocity(0.0), effort(0.0), command(0.0),
+      gated_(false), waiting_(false)
+  {
+    js_interface_.registerHandle(hardware_interface::JointStateHandle("wheel", &position, &velocity, &effort));
+    ej_interface_.registerHandle(hardware_interface::JointHandle(js_interface_.getHandle("wheel"), &command));
+    registerInterface(&js_interface_);
+    registerInterface(&ej_interface_);
+  }
+
+  virtual bool initSim(const std::string&, ros::NodeHandle, gazebo::physics::ModelPtr,
+                       const urdf::Model *const, std::vector<transmission_interface::TransmissionInfo>)
+  {
+    return true;
+  }
+
+  virtual void readSim(ros::Time, ros::Duration)
+  {
+    boost::mutex::scoped_lock lock(gate_mutex_);
+    waiting_ = gated_;
+    while (gated_)
+      gate_.wait(lock);
+    ++reads;
+  }
+
+  virtual void writeSim(ros::Time, ros::Duration)
+  {
+    ++writes;
+  }
+
+  virtual void eStopActive(const bool active)
+  {
+    e_stop_active = active;
+  }
+
+  /// \brief Hold the next readSim(), and with it the update of the fleet, until open()
+  void close()
+  {
+    boost::mutex::scoped_lock lock(gate_mutex_);
+    gated_ = true;
+  }
+
+  void open()
+  {
+    boost::mutex::scoped_lock lock(gate_mutex_);
+    gated_ = false;
+    gate_.notify_all();
+  }
+
+  /// \brief Whether a readSim() waits for open()
+  bool waiting()
+  {
+    boost::mutex::scoped_lock lock(gate_mutex_);
+    return waiting_ && gated_;
+  }
+
+  std::atomic<unsigned int> reads;
+  std::atomic<unsigned int> writes;
+  std::atomic<bool> e_stop_active;
+  double position;
+  double velocity;
+  double effort;
+  double command;
+
+private:
+  hardware_interface::JointStateInterface js_interface_;
+  hardware_interface::EffortJointInterface ej_interface_;
+  boost::mutex gate_mutex_;
+  boost::condition_variable gate_;
+  bool gated_;
+  bool waiting_;
+};
+
+class RobotHWSimFleetTest : public testing::Test
+{
+protected:
+  RobotHWSimFleetTest() : sim_time_(0.0) {}
+
+  /// \brief Advance the simulation time by a control period and fire the world update
+  void Step()
+  {
+    sim_time_ += kPeriod.toSec();
+    gazebo::common::UpdateInfo info;
+    info.simTime = gazebo::common::Time(sim_time_);
+    gazebo::event::Events::worldUpdateBegin(info);
+  }
+
+  /// \brief Step until the condition holds, for at most 10 s of wall time
+  bool StepUntil(const boost::function<bool()>& condition)
+  {
+    const ros::WallTime deadline = ros::WallTime::now() + ros::WallDuration(10.0);
+    while (!condition())
+    {
+      if (ros::WallTime::now() > deadline)
+        return false;
+      Step();
+      ros::WallDuration(0.0001).sleep();
+    }
+    return true;
+  }
+
+  /// \brief Load and start an effort controller of a joint of the fleet
+  bool StartController(const std::string& fleet, const std::string& controller, const std::string& joint)
+  {
+    const std::string ns = "/" + fleet + "/";
+    ros::param::set(ns + controller + "/type", "effort_controllers/JointEffortController");
+    ros::param::set(ns + controller + "/joint", joint);
+
+    controller_manager_msgs::LoadController load;
+    load.request.name = controller;
+    if (!ros::service::waitForService(ns + "controller_manager/load_controller", 10000) ||
+        !ros::service::call(ns + "controller_manager/load_controller", load) || !load.response.ok)
+      return false;
+
+    // the controller manager switches controllers in its update, the world has to step meanwhile
+    controller_manager_msgs::SwitchController switch_controller;
+    switch_controller.request.start_controllers.push_back(controller);
+    switch_controller.request.strictness = controller_manager_msgs::SwitchController::Request::STRICT;
+    std::atomic<bool> done(false);
+    bool ok = false;
+    boost::thread call([&]()
+    {
+      ok = ros::service::call(ns + "controller_manager/switch_controller", switch_controller) &&
+           switch_controller.response.ok;
+      done = true;
+    });
+    const bool switched = StepUntil([&done]() { return done.load(); });
+    call.join();
+    return switched && ok;
+  }
+
+  /// \brief Publish a value once a subscriber listens, e.g. a controller command
+  template <typename Message>
+  bool Publish(const std::string& topic, const Message& message)
+  {
+    // the publishers live as long as the test, so that nothing published gets lost
+    publishers_.push_back(nh_.advertise<Message>(topic, 1));
+    ros::Publisher& publisher = publishers_.back();
+    if (!StepUntil([&publisher]() { return publisher.getNumSubscribers() > 0; }))
+      return false;
+    publisher.publish(message);
+    return true;
+  }
+
+  ros::NodeHandle nh_;
+  std::deque<ros::Publisher> publishers_;
+  double sim_time_;
+};
+
+TEST_F(RobotHWSimFleetTest, rejoinReusesMirrorSlots)
+{
+  boost::shared_ptr<RobotHWSimFleet> fleet = RobotHWSimFleet::get("rejoin_fleet", kPeriod, "");
+  // later robots get the fleet as the first one configured it
+  EXPECT_EQ(fleet, RobotHWSimFleet::get("rejoin_fleet", kPeriod * 2.0, "e_stop"));
+
+  boost::shared_ptr<FakeRobotHWSim> first = boost::make_shared<FakeRobotHWSim>();
+  fleet->add("robot_a", first);
+  ASSERT_TRUE(StepUntil([&first]() { return first->reads > 0; }));
+  ASSERT_TRUE(StartController("rejoin_fleet", "robot_a/effort_controller", "robot_a/wheel"));
+
+  std_msgs::Float64 command;
+  command.data = 1.5;
+  ASSERT_TRUE(Publish("/rejoin_fleet/robot_a/effort_controller/command", command));
+  ASSERT_TRUE(StepUntil([&first]() { return first->command == 1.5; }));
+
+  fleet->remove(first.get());
+  const unsigned int reads = first->reads;
+  const unsigned int writes = first->writes;
+  for (unsigned int i = 0; i < 10; ++i)
+    Step();
+  EXPECT_EQ(reads, first->reads);
+  EXPECT_EQ(writes, first->writes);
+
+  // the controller loaded for the first robot drives the robot joining under its name
+  boost::shared_ptr<FakeRobotHWSim> second = boost::make_shared<FakeRobotHWSim>();
+  fleet->add("robot_a", second);
+  EXPECT_TRUE(StepUntil([&second]() { return second->command == 1.5; }));
+  EXPECT_EQ(reads, first->reads);
+
+  fleet->remove(second.get());
+}
+
+TEST_F(RobotHWSimFleetTest, removeWhileJoinQueued)
+{
+  boost::shared_ptr<RobotHWSimFleet> fleet = RobotHWSimFleet::get("queue_fleet", kPeriod, "");
+  boost::shared_ptr<FakeRobotHWSim> gate = boost::make_shared<FakeRobotHWSim>();
+  fleet->add("gate", gate);
+  ASSERT_TRUE(StepUntil([&gate]() { return gate->reads > 0; }));
+
+  // hold an update of the fleet, the join of joining then waits for it on the service thread
+  // and the join of removed is queued behind
+  gate->close();
+  boost::thread update([this]() { Step(); });
+  while (!gate->waiting())
+    boost::this_thread::yield();
+
+  boost::shared_ptr<FakeRobotHWSim> joining = boost::make_shared<FakeRobotHWSim>();
+  boost::shared_ptr<FakeRobotHWSim> removed = boost::make_shared<FakeRobotHWSim>();
+  fleet->add("joining", joining);
+  fleet->add("removed", removed);
+  // remove() also waits for the update to look up the joined robots
+  boost::thread remove(boost::bind(&RobotHWSimFleet::remove, fleet.get(), removed.get()));
+  ros::WallDuration(0.1).sleep();
+  gate->open();
+  update.join();
+  remove.join();
+
+  EXPECT_TRUE(StepUntil([&joining]() { return joining->reads > 0; }));
+  for (unsigned int i = 0; i < 10; ++i)
+    Step();
+  EXPECT_EQ(0u, removed->reads);
+  EXPECT_EQ(0u, removed->writes);
+
+  // a robot leaving before its join ran cannot join later either, whatever the interleaving
+  for (unsigned int i = 0; i < 100; ++i)
+  {
+    boost::shared_ptr<FakeRobotHWSim> robot = boost::make_shared<FakeRobotHWSim>();
+    fleet->add("robot_" + std::to_string(i), robot);
+    // give every other join the time to run
+    if (i % 2)
+      ros::WallDuration(0.001).sleep();
+    fleet->remove(robot.get());
+    const unsigned int robot_reads = robot->reads;
+    Step();
+    EXPECT_EQ(robot_reads, robot->reads) << i;
+  }
+
+  fleet->remove(joining.get());
+  fleet->remove(gate.get());
+}
+
+TEST_F(RobotHWSimFleetTest, eStopReleaseRestartsControllers)
+{
+  boost::shared_ptr<RobotHWSimFleet> fleet = RobotHWSimFleet::get("e_stop_fleet", kPeriod, "e_stop");
+  boost::shared_ptr<FakeRobotHWSim> robot = boost::make_shared<FakeRobotHWSim>();
+  fleet->add("robot_a", robot);
+  ASSERT_TRUE(StepUntil([&robot]() { return robot->reads > 0; }));
+  ASSERT_TRUE(StartController("e_stop_fleet", "robot_a/effort_controller", "robot_a/wheel"));
+
+  std_msgs::Float64 command;
+  command.data = 1.5;
+  ASSERT_TRUE(Publish("/e_stop_fleet/robot_a/effort_controller/command", command));
+  ASSERT_TRUE(StepUntil([&robot]() { return robot->command == 1.5; }));
+
+  // the robots stop, the controllers keep their commands while the e-stop is active
+  std_msgs::Bool e_stop;
+  e_stop.data = true;
+  ASSERT_TRUE(Publish("/e_stop_fleet/e_stop", e_stop));
+  ASSERT_TRUE(StepUntil([&robot]() { return robot->e_stop_active.load(); }));
+  for (unsigned int i = 0; i < 10; ++i)
+    Step();
+  EXPECT_EQ(1.5, robot->command);
+
+  // releasing it restarts the controllers, the effort controller starts with no effort
+  e_stop.data = false;
+  ASSERT_TRUE(Publish("/e_stop_fleet/e_stop", e_stop));
+  ASSERT_TRUE(StepUntil([&robot]() { return !robot->e_stop_active; }));
+  Step();
+  EXPECT_EQ(0.0, robot->command);
+
+  fleet->remove(robot.get());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  ros::init(argc, argv, "robot_hw_sim_fleet_test");
+  return RUN_ALL_TESTS();
+}